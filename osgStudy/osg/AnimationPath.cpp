@@ -1,72 +1,345 @@
 #include "AnimationPath.h"
 #include "NodeVisitor.h"
 
-bool osg::AnimationPath::getMatrix(double time, Matrix & matrix) const
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/types.h>
+#endif
+
+osg::AnimationPath::AnimationPath(const AnimationPath & path) :
+	_times(path._times),
+	_keys(path._keys),
+	_rotationInterpolation(path._rotationInterpolation),
+	_uniform(path._uniform),
+	_interval(path._interval),
+	_inverseInterval(path._inverseInterval),
+	_compressed(path._compressed),
+	_compressedKeys(path._compressedKeys),
+	_compressedScales(path._compressedScales),
+	_constantScale(path._constantScale),
+	_positionOrigin(path._positionOrigin),
+	_positionStep(path._positionStep),
+	_numKeys(path._numKeys),
+	_timeData(path._timeData),
+	_keyData(path._keyData),
+	_compressedKeyData(path._compressedKeyData),
+	_compressedScaleData(path._compressedScaleData),
+	_mappedFile(path._mappedFile)
+{
+	// a mapped file is shared, otherwise point at the copied lists.
+	if (!_mappedFile.valid()) updateKeyData();
+}
+
+void osg::AnimationPath::updateKeyData()
+{
+	_numKeys = _times.size();
+	_timeData = _times.empty() ? 0 : &_times.front();
+	_keyData = _keys.empty() ? 0 : &_keys.front();
+	_compressedKeyData = _compressedKeys.empty() ? 0 : &_compressedKeys.front();
+	_compressedScaleData = _compressedScales.empty() ? 0 : &_compressedScales.front();
+}
+
+unsigned int osg::AnimationPath::findInterval(double time, Cursor & cursor) const
+{
+	unsigned int lastInterval = _numKeys - 2;
+
+	if (_uniform)
+	{
+		double position = (time - _timeData[0]) * _inverseInterval;
+		if (position <= 0.0) return 0;
+		unsigned int i = position < (double)lastInterval ? (unsigned int)position : lastInterval;
+		// rounding at an interval's ends, or a mapped file whose times are not as
+		// even as its header claims, falls back to the search below.
+		if (_timeData[i] <= time && time < _timeData[i + 1]) return i;
+	}
+
+	// try the interval of the previous lookup and the one after it first.
+	unsigned int i = cursor._index;
+	if (i <= lastInterval && _timeData[i] <= time)
+	{
+		if (time < _timeData[i + 1]) return i;
+		if (i < lastInterval && time < _timeData[i + 2])
+		{
+			cursor._index = i + 1;
+			return i + 1;
+		}
+	}
+
+	const double* theIter = std::upper_bound(_timeData, _timeData + _numKeys, time);
+	i = (theIter == _timeData) ? 0 : (unsigned int)(theIter - _timeData) - 1;
+	if (i > lastInterval) i = lastInterval;
+	cursor._index = i;
+	return i;
+}
+
+bool osg::AnimationPath::getKey(double time, Key & key, Cursor & cursor) const
 {
-	if (_timeKeyMap.empty())
+	if (_numKeys == 0)
 	{
 		return false;
 	}
-	TimeKeyMap::const_iterator theIter = _timeKeyMap.lower_bound(time);
-	if (theIter == _timeKeyMap.begin())
+	if (_numKeys == 1 || time <= _timeData[0])
+	{
+		getKey(0, key);
+	}
+	else if (time >= _timeData[_numKeys - 1])
 	{
-		theIter->second.getMatrix(matrix);
+		getKey(_numKeys - 1, key);
 	}
-	else if (theIter != _timeKeyMap.end())
+	else
 	{
-		TimeKeyMap::const_iterator it = theIter;
-		--it;
-		double delta_time = theIter->first - it->first;
+		unsigned int i = findInterval(time, cursor);
+		double delta_time = _timeData[i + 1] - _timeData[i];
 		if (delta_time == 0.0)
 		{
-			it->second.getMatrix(matrix);
+			getKey(i, key);
+		}
+		else if (!_compressed)
+		{
+			key.interpolate((time - _timeData[i]) / delta_time, _keyData[i], _keyData[i + 1], _rotationInterpolation);
 		}
 		else
 		{
-			Key theKey;
-			theKey.interpolate((time - it->first) / delta_time, it->second, theIter->second);
-			theKey.getMatrix(matrix);
+			Key first, second;
+			getKey(i, first);
+			getKey(i + 1, second);
+			key.interpolate((time - _timeData[i]) / delta_time, first, second, _rotationInterpolation);
 		}
 	}
-	else
+	return true;
+}
+
+// smallest three quaternion encoding, the three smallest components of a unit
+// quaternion lie within +-1/sqrt(2) and are quantised to 15 bits each.
+static const float s_rotationRange = 0.70710678f;
+static const float s_rotationLevels = 32767.0f;
+
+static void encodeRotation(const osg::Quat & rotation, unsigned short packed[3])
+{
+	osg::Vec4 v = rotation.asVec4();
+	float length = v.length();
+	if (length > 0.0f) v /= length;
+
+	int largest = 0;
+	for (int i = 1; i < 4; ++i)
 	{
-		_timeKeyMap.rbegin().base()->second.getMatrix(matrix);
+		if (fabs(v[i]) > fabs(v[largest])) largest = i;
 	}
-	return true;
+	// q and -q are the same rotation, so make the dropped component positive.
+	if (v[largest] < 0.0f) v = -v;
 
+	int j = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (i == largest) continue;
+		float c = (v[i] + s_rotationRange) / (2.0f * s_rotationRange);
+		if (c < 0.0f) c = 0.0f;
+		else if (c > 1.0f) c = 1.0f;
+		packed[j++] = (unsigned short)(c * s_rotationLevels + 0.5f);
+	}
+	packed[0] |= (largest & 1) << 15;
+	packed[1] |= (largest >> 1) << 15;
 }
 
-bool osg::AnimationPath::getInverse(double time, Matrix & matrix) const
+static void decodeRotation(const unsigned short packed[3], osg::Quat & rotation)
 {
-	if (_timeKeyMap.empty())
+	int largest = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+	float c[3];
+	float sum = 0.0f;
+	for (int j = 0; j < 3; ++j)
 	{
-		return false;
+		c[j] = (packed[j] & 0x7fff) * (2.0f * s_rotationRange / s_rotationLevels) - s_rotationRange;
+		sum += c[j] * c[j];
 	}
-	TimeKeyMap::const_iterator theIter = _timeKeyMap.lower_bound(time);
-	if (theIter == _timeKeyMap.begin())
+
+	int j = 0;
+	for (int i = 0; i < 4; ++i)
 	{
-		theIter->second.getInverse(matrix);
+		rotation._fv[i] = (i == largest) ? (sum < 1.0f ? sqrtf(1.0f - sum) : 0.0f) : c[j++];
 	}
-	else if (theIter != _timeKeyMap.end())
+}
+
+void osg::AnimationPath::getKey(unsigned int i, Key & key) const
+{
+	if (!_compressed)
 	{
-		TimeKeyMap::const_iterator it = theIter;
-		--it;
-		double delta_time = theIter->first - it->first;
-		if (delta_time == 0.0)
+		key = _keyData[i];
+		return;
+	}
+
+	const CompressedKey& ck = _compressedKeyData[i];
+	key._position.set(_positionOrigin.x() + ck._position[0] * _positionStep.x(),
+		_positionOrigin.y() + ck._position[1] * _positionStep.y(),
+		_positionOrigin.z() + ck._position[2] * _positionStep.z());
+	decodeRotation(ck._rotation, key._rotation);
+	key._scale = _compressedScaleData ? _compressedScaleData[i] : _constantScale;
+}
+
+// angle in radians between two rotations, via the chord lengths which stay accurate for small angles.
+static float rotationDifference(const osg::Quat & a, const osg::Quat & b)
+{
+	osg::Vec4 bv = (a.asVec4() * b.asVec4() < 0.0f) ? -b.asVec4() : b.asVec4();
+	return 4.0f * atan2f((a.asVec4() - bv).length(), (a.asVec4() + bv).length());
+}
+
+void osg::AnimationPath::compress(float positionTolerance, float rotationTolerance, float scaleTolerance)
+{
+	unmap();
+	if (_compressed) decompress();
+	if (_keys.empty()) return;
+
+	// key reduction, greedily extend each segment while interpolating across it
+	// reproduces every key it skips within the tolerances. Each extension checks
+	// the whole segment again, so segments are capped at MAX_SEGMENT_KEYS to keep
+	// the cost linear in the number of keys.
+	const unsigned int MAX_SEGMENT_KEYS = 128;
+	std::vector<unsigned int> kept;
+	kept.push_back(0);
+	unsigned int start = 0;
+	for (unsigned int end = 2; end < _keys.size(); ++end)
+	{
+		if (end - start > MAX_SEGMENT_KEYS)
 		{
-			it->second.getInverse(matrix);
+			start = end - 1;
+			kept.push_back(start);
+			continue;
 		}
-		else
+
+		bool withinTolerance = true;
+		for (unsigned int i = start + 1; i < end && withinTolerance; ++i)
 		{
-			Key theKey;
-			theKey.interpolate((time - it->first) / delta_time, it->second, theIter->second);
-			theKey.getInverse(matrix);
+			Key key;
+			key.interpolate((_times[i] - _times[start]) / (_times[end] - _times[start]), _keys[start], _keys[end], _rotationInterpolation);
+			withinTolerance = (key._position - _keys[i]._position).length() <= positionTolerance &&
+				rotationDifference(key._rotation, _keys[i]._rotation) <= rotationTolerance &&
+				(key._scale - _keys[i]._scale).length() <= scaleTolerance;
+		}
+		if (!withinTolerance)
+		{
+			start = end - 1;
+			kept.push_back(start);
 		}
 	}
-	else
+	if (_keys.size() > 1) kept.push_back(_keys.size() - 1);
+
+	// bounding box of the positions, and whether the scale ever changes.
+	Vec3 minimum = _keys[0]._position;
+	Vec3 maximum = minimum;
+	bool constantScale = true;
+	for (unsigned int k = 0; k < kept.size(); ++k)
+	{
+		const Key& key = _keys[kept[k]];
+		for (int c = 0; c < 3; ++c)
+		{
+			if (key._position[c] < minimum[c]) minimum[c] = key._position[c];
+			if (key._position[c] > maximum[c]) maximum[c] = key._position[c];
+		}
+		if ((key._scale - _keys[0]._scale).length() > scaleTolerance) constantScale = false;
+	}
+
+	_positionOrigin = minimum;
+	Vec3 inverseStep;
+	for (int c = 0; c < 3; ++c)
+	{
+		float extent = maximum[c] - minimum[c];
+		_positionStep[c] = extent / 65535.0f;
+		inverseStep[c] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+	}
+
+	TimeList times(kept.size());
+	CompressedKeyList compressedKeys(kept.size());
+	std::vector<Vec3> scales;
+	if (!constantScale) scales.resize(kept.size());
+	for (unsigned int k = 0; k < kept.size(); ++k)
+	{
+		const Key& key = _keys[kept[k]];
+		times[k] = _times[kept[k]];
+		for (int c = 0; c < 3; ++c)
+		{
+			compressedKeys[k]._position[c] = (unsigned short)((key._position[c] - minimum[c]) * inverseStep[c] + 0.5f);
+		}
+		encodeRotation(key._rotation, compressedKeys[k]._rotation);
+		if (!constantScale) scales[k] = key._scale;
+	}
+	_constantScale = _keys[0]._scale;
+
+	_times.swap(times);
+	_compressedKeys.swap(compressedKeys);
+	_compressedScales.swap(scales);
+	KeyList().swap(_keys);
+	_compressed = true;
+	_cursor._index = 0;
+	updateKeyData();
+	updateUniform();
+}
+
+void osg::AnimationPath::decompress()
+{
+	if (!_compressed) return;
+
+	KeyList keys(_numKeys);
+	for (unsigned int i = 0; i < keys.size(); ++i)
+	{
+		getKey(i, keys[i]);
+	}
+	_keys.swap(keys);
+	if (_mappedFile.valid())
+	{
+		_times.assign(_timeData, _timeData + _numKeys);
+		_mappedFile = 0;
+	}
+
+	_compressed = false;
+	CompressedKeyList().swap(_compressedKeys);
+	std::vector<Vec3>().swap(_compressedScales);
+	updateKeyData();
+}
+
+unsigned int osg::AnimationPath::getKeyMemorySize() const
+{
+	return _times.capacity() * sizeof(double) + _keys.capacity() * sizeof(Key) +
+		_compressedKeys.capacity() * sizeof(CompressedKey) + _compressedScales.capacity() * sizeof(Vec3);
+}
+
+bool osg::AnimationPath::getMatrix(double time, Matrix & matrix) const
+{
+	return getMatrix(time, matrix, _cursor);
+}
+
+bool osg::AnimationPath::getInverse(double time, Matrix & matrix) const
+{
+	return getInverse(time, matrix, _cursor);
+}
+
+bool osg::AnimationPath::getMatrix(double time, Matrix & matrix, Cursor & cursor) const
+{
+	Key theKey;
+	if (!getKey(time, theKey, cursor))
+	{
+		return false;
+	}
+	theKey.getMatrix(matrix);
+	return true;
+}
+
+bool osg::AnimationPath::getInverse(double time, Matrix & matrix, Cursor & cursor) const
+{
+	Key theKey;
+	if (!getKey(time, theKey, cursor))
 	{
-		_timeKeyMap.rbegin().base()->second.getInverse(matrix);
+		return false;
 	}
+	theKey.getInverse(matrix);
 	return true;
 }
 
@@ -78,7 +351,8 @@ const bool osg::AnimationPath::computeLocalToWorldMatrix(Matrix & matrix, const
 		if (fs)
 		{
 			osg::Matrix localMatrix;
-			getMatrix(fs->getReferenceTime(), localMatrix);
+			Cursor cursor;
+			getMatrix(fs->getReferenceTime(), localMatrix, cursor);
 			matrix.preMult(localMatrix);
 			return true;
 		}
@@ -94,7 +368,8 @@ const bool osg::AnimationPath::computeWorldToLocalMatrix(Matrix & matrix, const
 		if (fs)
 		{
 			osg::Matrix localInverse;
-			getMatrix(fs->getReferenceTime(), localInverse);
+			Cursor cursor;
+			getInverse(fs->getReferenceTime(), localInverse, cursor);
 			matrix.postMult(localInverse);
 			return true;
 		}
@@ -104,5 +379,674 @@ const bool osg::AnimationPath::computeWorldToLocalMatrix(Matrix & matrix, const
 
 void osg::AnimationPath::insert(double time, const Key & key)
 {
-	_timeKeyMap[time] = key;
+	unmap();
+	if (_compressed) decompress();
+
+	if (_times.empty() || time > _times.back())
+	{
+		_times.push_back(time);
+		_keys.push_back(key);
+		updateKeyData();
+
+		// appending keeps the path uniform if the new interval matches, without rechecking every key.
+		unsigned int numTimes = _times.size();
+		if (numTimes <= 2 || !_uniform)
+		{
+			updateUniform();
+		}
+		else if (fabs((_times[numTimes - 1] - _times[numTimes - 2]) - _interval) > _interval * 1e-6)
+		{
+			_uniform = false;
+		}
+		return;
+	}
+
+	TimeList::iterator theIter = std::lower_bound(_times.begin(), _times.end(), time);
+	unsigned int i = theIter - _times.begin();
+	if (*theIter == time)
+	{
+		_keys[i] = key;
+		return;
+	}
+
+	_times.insert(theIter, time);
+	_keys.insert(_keys.begin() + i, key);
+	updateKeyData();
+	_cursor._index = 0;
+	updateUniform();
+}
+
+void osg::AnimationPath::updateUniform()
+{
+	_uniform = false;
+	if (_numKeys < 2)
+	{
+		return;
+	}
+
+	double interval = (_timeData[_numKeys - 1] - _timeData[0]) / (_numKeys - 1);
+	if (interval <= 0.0)
+	{
+		return;
+	}
+	for (unsigned int i = 1; i < _numKeys; ++i)
+	{
+		if (fabs((_timeData[i] - _timeData[i - 1]) - interval) > interval * 1e-6)
+		{
+			return;
+		}
+	}
+
+	_uniform = true;
+	_interval = interval;
+	_inverseInterval = 1.0 / interval;
 }
+
+void osg::AnimationPath::resample(double interval)
+{
+	if (_numKeys < 2 || interval <= 0.0)
+	{
+		return;
+	}
+
+	double startTime = _timeData[0];
+	unsigned int numKeys = (unsigned int)ceil((_timeData[_numKeys - 1] - startTime) / interval) + 1;
+
+	TimeList times(numKeys);
+	KeyList keys(numKeys);
+	Cursor cursor;
+	for (unsigned int i = 0; i < numKeys; ++i)
+	{
+		times[i] = startTime + interval * i;
+		getKey(times[i], keys[i], cursor);
+	}
+
+	_times.swap(times);
+	_keys.swap(keys);
+	_cursor._index = 0;
+
+	_compressed = false;
+	CompressedKeyList().swap(_compressedKeys);
+	std::vector<Vec3>().swap(_compressedScales);
+	_mappedFile = 0;
+	updateKeyData();
+
+	_uniform = true;
+	_interval = interval;
+	_inverseInterval = 1.0 / interval;
+}
+
+namespace
+{
+	/** A read only mapping of a whole file, released with the last reference.*/
+	class MappedFile : public osg::Referenced
+	{
+	public:
+		MappedFile() : _data(0), _size(0)
+#ifdef WIN32
+			, _file(INVALID_HANDLE_VALUE), _mapping(0)
+#endif
+		{}
+
+		bool open(const std::string& fileName);
+
+		const char* getData() const { return _data; }
+		unsigned long long getSize() const { return _size; }
+
+	protected:
+		virtual ~MappedFile();
+
+		const char* _data;
+		unsigned long long _size;
+#ifdef WIN32
+		HANDLE _file;
+		HANDLE _mapping;
+#endif
+	};
+
+#ifdef WIN32
+
+	bool MappedFile::open(const std::string & fileName)
+	{
+		_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (_file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0 || (unsigned long long)size.QuadPart > (size_t)-1) return false;
+
+		_mapping = CreateFileMappingA(_file, 0, PAGE_READONLY, 0, 0, 0);
+		if (!_mapping) return false;
+
+		_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+		_size = size.QuadPart;
+		return _data != 0;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (_data) UnmapViewOfFile(_data);
+		if (_mapping) CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+	}
+
+#else
+
+	bool MappedFile::open(const std::string & fileName)
+	{
+		int fd = ::open(fileName.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat status;
+		if (fstat(fd, &status) != 0 || status.st_size == 0 || (unsigned long long)status.st_size > (size_t)-1)
+		{
+			::close(fd);
+			return false;
+		}
+
+		// the mapping keeps its own reference to the file.
+		void* data = mmap(0, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (data == MAP_FAILED) return false;
+
+		_data = (const char*)data;
+		_size = status.st_size;
+		return true;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (_data) munmap((void*)_data, _size);
+	}
+
+#endif
+
+	const char s_fileMagic[4] = { 'O', 'S', 'G', 'A' };
+
+	// arrays in the file start on 16 byte boundaries.
+	inline unsigned long long alignFileOffset(unsigned long long offset)
+	{
+		return (offset + 15) & ~15ULL;
+	}
+
+	// write size bytes of data at offset, zero filling from position, the current end of the file.
+	bool writeBlock(FILE* fp, unsigned long long& position, unsigned long long offset, const void* data, unsigned long long size)
+	{
+		static const char zeros[16] = { 0 };
+		if (offset > position && fwrite(zeros, 1, (size_t)(offset - position), fp) != offset - position) return false;
+		if (size > 0 && fwrite(data, 1, (size_t)size, fp) != size) return false;
+		position = offset + size;
+		return true;
+	}
+
+	bool seekFile(FILE* fp, unsigned long long offset)
+	{
+#ifdef WIN32
+		return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+		return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+	}
+}
+
+bool osg::AnimationPath::resetFromFileHeader(const FileHeader & header, unsigned long long fileSize)
+{
+	if (memcmp(header._magic, s_fileMagic, 4) != 0 || header._version != FileHeader::VERSION)
+	{
+		return false;
+	}
+
+	bool compressed = (header._flags & FileHeader::COMPRESSED) != 0;
+	bool perKeyScales = (header._flags & FileHeader::PER_KEY_SCALES) != 0;
+	bool uniform = (header._flags & FileHeader::UNIFORM) != 0;
+	unsigned long long numKeys = header._numKeys;
+	// the array sizes are compared against the space left after each offset, as an
+	// offset near the top of the range would wrap offset + size back below fileSize.
+	// numKeys is below 2^32 and the element sizes small, so the sizes cannot wrap.
+	if (header._keySize != (compressed ? sizeof(CompressedKey) : sizeof(Key)) ||
+		header._fileSize != fileSize ||
+		header._rotationInterpolation > NLERP ||
+		header._timesOffset < sizeof(FileHeader) ||
+		(header._timesOffset & 15) != 0 || (header._keysOffset & 15) != 0 || (header._scalesOffset & 15) != 0 ||
+		header._timesOffset > fileSize || numKeys * sizeof(double) > fileSize - header._timesOffset ||
+		header._keysOffset > fileSize || numKeys * header._keySize > fileSize - header._keysOffset ||
+		(perKeyScales && (header._scalesOffset > fileSize || numKeys * sizeof(Vec3) > fileSize - header._scalesOffset)) ||
+		(perKeyScales && !compressed) ||
+		(uniform && !(header._interval > 0.0 && header._interval <= DBL_MAX)))
+	{
+		return false;
+	}
+
+	_mappedFile = 0;
+	TimeList().swap(_times);
+	KeyList().swap(_keys);
+	CompressedKeyList().swap(_compressedKeys);
+	std::vector<Vec3>().swap(_compressedScales);
+	updateKeyData();
+	_cursor._index = 0;
+
+	_rotationInterpolation = (RotationInterpolation)header._rotationInterpolation;
+	_compressed = compressed;
+	_constantScale.set(header._constantScale[0], header._constantScale[1], header._constantScale[2]);
+	_positionOrigin.set(header._positionOrigin[0], header._positionOrigin[1], header._positionOrigin[2]);
+	_positionStep.set(header._positionStep[0], header._positionStep[1], header._positionStep[2]);
+
+	// scanning every time would read the whole file, so the flag is checked against
+	// the first and last times by map() and against every time once read() has them
+	// all, while findInterval() checks each index it computes.
+	_uniform = uniform;
+	_interval = _uniform ? header._interval : 0.0;
+	_inverseInterval = _uniform ? 1.0 / header._interval : 0.0;
+	return true;
+}
+
+bool osg::AnimationPath::write(const std::string & fileName) const
+{
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header._magic, s_fileMagic, 4);
+	header._version = FileHeader::VERSION;
+	header._flags = (_compressed ? FileHeader::COMPRESSED : 0) |
+		(_compressedScaleData ? FileHeader::PER_KEY_SCALES : 0) |
+		(_uniform ? FileHeader::UNIFORM : 0);
+	header._rotationInterpolation = _rotationInterpolation;
+	header._numKeys = _numKeys;
+	header._keySize = _compressed ? sizeof(CompressedKey) : sizeof(Key);
+	header._interval = _uniform ? _interval : 0.0;
+	for (int c = 0; c < 3; ++c)
+	{
+		header._constantScale[c] = _constantScale[c];
+		header._positionOrigin[c] = _positionOrigin[c];
+		header._positionStep[c] = _positionStep[c];
+	}
+
+	unsigned long long numKeys = _numKeys;
+	unsigned long long scalesSize = _compressedScaleData ? numKeys * sizeof(Vec3) : 0;
+	header._timesOffset = alignFileOffset(sizeof(FileHeader));
+	header._keysOffset = alignFileOffset(header._timesOffset + numKeys * sizeof(double));
+	header._scalesOffset = alignFileOffset(header._keysOffset + numKeys * header._keySize);
+	header._fileSize = header._scalesOffset + scalesSize;
+
+	FILE* fp = fopen(fileName.c_str(), "wb");
+	if (!fp)
+	{
+		return false;
+	}
+
+	const void* keyData = _compressed ? (const void*)_compressedKeyData : (const void*)_keyData;
+	unsigned long long position = 0;
+	bool written = writeBlock(fp, position, 0, &header, sizeof(FileHeader)) &&
+		writeBlock(fp, position, header._timesOffset, _timeData, numKeys * sizeof(double)) &&
+		writeBlock(fp, position, header._keysOffset, keyData, numKeys * header._keySize) &&
+		writeBlock(fp, position, header._scalesOffset, _compressedScaleData, scalesSize);
+	return fclose(fp) == 0 && written;
+}
+
+bool osg::AnimationPath::map(const std::string & fileName)
+{
+	ref_ptr<MappedFile> file = osgNew MappedFile;
+	if (!file->open(fileName) || file->getSize() < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	const char* data = file->getData();
+	const FileHeader& header = *(const FileHeader*)data;
+	if (!resetFromFileHeader(header, file->getSize()))
+	{
+		return false;
+	}
+
+	_mappedFile = file.get();
+	_numKeys = header._numKeys;
+	_timeData = (const double*)(data + header._timesOffset);
+	if (_compressed)
+	{
+		_compressedKeyData = (const CompressedKey*)(data + header._keysOffset);
+		if (header._flags & FileHeader::PER_KEY_SCALES) _compressedScaleData = (const Vec3*)(data + header._scalesOffset);
+	}
+	else
+	{
+		_keyData = (const Key*)(data + header._keysOffset);
+	}
+
+	// a file claiming even spacing must at least span its keys at that spacing.
+	if (_uniform && _numKeys > 1)
+	{
+		double span = _interval * (_numKeys - 1);
+		if (fabs((_timeData[_numKeys - 1] - _timeData[0]) - span) > span * 1e-6) _uniform = false;
+	}
+	return true;
+}
+
+void osg::AnimationPath::unmap()
+{
+	if (!_mappedFile.valid()) return;
+
+	_times.assign(_timeData, _timeData + _numKeys);
+	if (_compressed)
+	{
+		_compressedKeys.assign(_compressedKeyData, _compressedKeyData + _numKeys);
+		if (_compressedScaleData) _compressedScales.assign(_compressedScaleData, _compressedScaleData + _numKeys);
+	}
+	else
+	{
+		_keys.assign(_keyData, _keyData + _numKeys);
+	}
+	_mappedFile = 0;
+	updateKeyData();
+}
+
+bool osg::AnimationPathReader::open(const std::string & fileName, AnimationPath * path)
+{
+	close();
+	if (!path)
+	{
+		return false;
+	}
+
+	_file = fopen(fileName.c_str(), "rb");
+	if (!_file)
+	{
+		return false;
+	}
+
+	// a truncated file is only found when read() reaches the missing keys.
+	if (fread(&_header, sizeof(_header), 1, _file) != 1 || !path->resetFromFileHeader(_header, _header._fileSize))
+	{
+		close();
+		return false;
+	}
+
+	// reserve the whole path up front so that appending never moves the keys during playback.
+	_path = path;
+	_path->_times.reserve(_header._numKeys);
+	if (_path->_compressed)
+	{
+		_path->_compressedKeys.reserve(_header._numKeys);
+		if (_header._flags & AnimationPath::FileHeader::PER_KEY_SCALES) _path->_compressedScales.reserve(_header._numKeys);
+	}
+	else
+	{
+		_path->_keys.reserve(_header._numKeys);
+	}
+	_numKeys = _header._numKeys;
+	_numRead = 0;
+	return true;
+}
+
+unsigned int osg::AnimationPathReader::read(unsigned int maxKeys)
+{
+	if (!_file || _numRead == _numKeys || maxKeys == 0)
+	{
+		return 0;
+	}
+
+	unsigned int numKeys = (maxKeys < _numKeys - _numRead) ? maxKeys : _numKeys - _numRead;
+	unsigned int numTotal = _numRead + numKeys;
+	AnimationPath& path = *_path;
+
+	path._times.resize(numTotal);
+	bool ok = seekFile(_file, _header._timesOffset + (unsigned long long)_numRead * sizeof(double)) &&
+		fread(&path._times[_numRead], sizeof(double), numKeys, _file) == numKeys;
+
+	if (ok)
+	{
+		void* keys;
+		if (path._compressed)
+		{
+			path._compressedKeys.resize(numTotal);
+			keys = &path._compressedKeys[_numRead];
+		}
+		else
+		{
+			path._keys.resize(numTotal);
+			keys = &path._keys[_numRead];
+		}
+		ok = seekFile(_file, _header._keysOffset + (unsigned long long)_numRead * _header._keySize) &&
+			fread(keys, _header._keySize, numKeys, _file) == numKeys;
+	}
+
+	if (ok && (_header._flags & AnimationPath::FileHeader::PER_KEY_SCALES))
+	{
+		path._compressedScales.resize(numTotal);
+		ok = seekFile(_file, _header._scalesOffset + (unsigned long long)_numRead * sizeof(Vec3)) &&
+			fread(&path._compressedScales[_numRead], sizeof(Vec3), numKeys, _file) == numKeys;
+	}
+
+	if (!ok)
+	{
+		// drop the partly read keys, keeping the ones before.
+		path._times.resize(_numRead);
+		if (path._compressed) path._compressedKeys.resize(_numRead);
+		else path._keys.resize(_numRead);
+		if (!path._compressedScales.empty()) path._compressedScales.resize(_numRead);
+		path.updateKeyData();
+		close();
+		return 0;
+	}
+
+	_numRead = numTotal;
+	path.updateKeyData();
+
+	// every time is in memory now, check the spacing the header claimed.
+	if (_numRead == _numKeys && path._uniform) path.updateUniform();
+	return numKeys;
+}
+
+void osg::AnimationPathReader::close()
+{
+	if (_file)
+	{
+		fclose(_file);
+		_file = 0;
+	}
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/Timer.h>
+#include <osg/ref_ptr.h>
+#include <iostream>
+
+/** Play numPaths paths of numKeys keys each forward over numFrames frames,
+  * timing a fresh binary search for every lookup against the cursor, and
+  * then against direct indexing once the paths have been resampled.
+  * 10000 paths of 1000 keys need around 500MB.*/
+void benchmark_AnimationPath(unsigned int numPaths, unsigned int numKeys, unsigned int numFrames)
+{
+	using namespace osg;
+
+	std::vector< ref_ptr<AnimationPath> > paths(numPaths);
+	for (unsigned int p = 0; p < numPaths; ++p)
+	{
+		paths[p] = osgNew AnimationPath;
+		double time = 0.0;
+		for (unsigned int k = 0; k < numKeys; ++k)
+		{
+			Quat rotation;
+			rotation.makeRotate(0.01f * k, 0.0f, 0.0f, 1.0f);
+			paths[p]->insert(time, AnimationPath::Key(Vec3((float)k, (float)p, 0.0f), rotation, Vec3(1.0f, 1.0f, 1.0f)));
+			// uneven spacing so that the first passes cannot index directly.
+			time += 0.5 + 0.5 * ((k * 7) % 3);
+		}
+	}
+
+	double duration = paths[0]->getLastTime();
+	std::vector<AnimationPath::Cursor> cursors(numPaths);
+	Matrix matrix;
+	float checksum = 0.0f;
+	Timer timer;
+
+	Timer_t t0 = timer.tick();
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		double time = duration * f / numFrames;
+		for (unsigned int p = 0; p < numPaths; ++p)
+		{
+			AnimationPath::Cursor fresh;
+			paths[p]->getMatrix(time, matrix, fresh);
+			checksum += matrix(3, 0);
+		}
+	}
+	Timer_t t1 = timer.tick();
+	double searchTime = timer.delta_m(t0, t1);
+
+	t0 = timer.tick();
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		double time = duration * f / numFrames;
+		for (unsigned int p = 0; p < numPaths; ++p)
+		{
+			paths[p]->getMatrix(time, matrix, cursors[p]);
+			checksum -= matrix(3, 0);
+		}
+	}
+	t1 = timer.tick();
+	double cursorTime = timer.delta_m(t0, t1);
+
+	for (unsigned int p = 0; p < numPaths; ++p)
+	{
+		paths[p]->resample(duration / (numKeys - 1));
+	}
+
+	t0 = timer.tick();
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		double time = duration * f / numFrames;
+		for (unsigned int p = 0; p < numPaths; ++p)
+		{
+			paths[p]->getMatrix(time, matrix, cursors[p]);
+		}
+	}
+	t1 = timer.tick();
+	double uniformTime = timer.delta_m(t0, t1);
+
+	unsigned int numLookups = numPaths * numFrames;
+	std::cout << "AnimationPath " << numPaths << " paths x " << numKeys << " keys, " << numLookups << " lookups" << std::endl;
+	std::cout << "  binary search " << searchTime << "ms  cursor " << cursorTime << "ms  uniform " << uniformTime << "ms"
+		<< "  (checksum " << checksum << ")" << std::endl;
+}
+
+/** Write a path to fileName, compressed and not, and check that mapping the
+  * file and streaming it in gives back the same matrices as the original.*/
+void test_AnimationPath_file(const std::string& fileName)
+{
+	using namespace osg;
+
+	ref_ptr<AnimationPath> path = osgNew AnimationPath;
+	for (unsigned int k = 0; k < 1000; ++k)
+	{
+		Quat rotation;
+		rotation.makeRotate(0.01f * k, 0.0f, 0.0f, 1.0f);
+		path->insert(0.1 * k, AnimationPath::Key(Vec3((float)k, 0.5f * k, 0.0f), rotation, Vec3(1.0f, 1.0f + 0.001f * k, 1.0f)));
+	}
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 1) path->compress(0.01f, 0.001f);
+
+		ref_ptr<AnimationPath> mapped = osgNew AnimationPath;
+		ref_ptr<AnimationPath> streamed = osgNew AnimationPath;
+		ref_ptr<AnimationPathReader> reader = osgNew AnimationPathReader;
+		bool opened = path->write(fileName) && mapped->map(fileName) && reader->open(fileName, streamed.get());
+
+		// play the streamed path while it loads, reading the 10 keys of each second every second.
+		float mappedError = 0.0f;
+		float streamedError = 0.0f;
+		Matrix expected, matrix;
+		for (double time = 0.0; opened && time < path->getLastTime(); time += 1.0)
+		{
+			reader->read(10);
+			path->getMatrix(time, expected);
+			mapped->getMatrix(time, matrix);
+			for (int i = 0; i < 16; ++i) mappedError = std::max(mappedError, (float)fabs(matrix.ptr()[i] - expected.ptr()[i]));
+			streamed->getMatrix(time, matrix);
+			for (int i = 0; i < 16; ++i) streamedError = std::max(streamedError, (float)fabs(matrix.ptr()[i] - expected.ptr()[i]));
+		}
+		remove(fileName.c_str());
+
+		std::cout << "AnimationPath file " << (pass == 1 ? "compressed" : "uncompressed") << (opened ? "" : " FAILED to open")
+			<< "  mapped error " << mappedError << "  streamed error " << streamedError
+			<< (mappedError == 0.0f && streamedError == 0.0f ? "  OK" : "  FAILED") << std::endl;
+	}
+}
+
+/** Compress a 20000 key helix and check that the matrices between and at the
+  * keys stay within the tolerances, plus the position and rotation quantisation.*/
+void test_AnimationPath_compress()
+{
+	using namespace osg;
+
+	const float positionTolerance = 0.05f;
+	const float rotationTolerance = 0.001f;
+	const float radius = 1000.0f;
+
+	ref_ptr<AnimationPath> path = osgNew AnimationPath;
+	ref_ptr<AnimationPath> original = osgNew AnimationPath;
+	Vec3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vec3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int k = 0; k < 20000; ++k)
+	{
+		double time = 0.1 * k;
+		Quat rotation;
+		rotation.makeRotate((float)(time * 0.05), Vec3(0.2f, 0.3f, 1.0f));
+		Vec3 position(radius * cosf((float)(time * 0.01)), radius * sinf((float)(time * 0.01)), 100.0f + 0.1f * (float)time);
+		AnimationPath::Key key(position, rotation, Vec3(1.0f, 1.0f, 1.0f));
+		path->insert(time, key);
+		original->insert(time, key);
+		for (int c = 0; c < 3; ++c)
+		{
+			minimum[c] = std::min(minimum[c], position[c]);
+			maximum[c] = std::max(maximum[c], position[c]);
+		}
+	}
+
+	Timer timer;
+	Timer_t t0 = timer.tick();
+	path->compress(positionTolerance, rotationTolerance);
+	Timer_t t1 = timer.tick();
+
+	// rounding to 16 bits moves each axis by up to half a step, the 15 bit
+	// rotation components move it by a fraction of a milliradian.
+	float positionQuantisation = 0.5f * (maximum - minimum).length() / 65535.0f;
+	float rotationQuantisation = 2e-4f;
+
+	float positionError = 0.0f;
+	float rotationError = 0.0f;
+	Matrix expected, matrix;
+	AnimationPath::Cursor expectedCursor, cursor;
+	for (double time = 0.0; time <= original->getLastTime(); time += 0.037)
+	{
+		original->getMatrix(time, expected, expectedCursor);
+		path->getMatrix(time, matrix, cursor);
+		positionError = std::max(positionError, (matrix.getTrans() - expected.getTrans()).length());
+		Quat expectedRotation, rotation;
+		expectedRotation.set(expected);
+		rotation.set(matrix);
+		rotationError = std::max(rotationError, rotationDifference(rotation, expectedRotation));
+	}
+
+	bool passed = path->isCompressed() && path->getNumKeys() < original->getNumKeys() &&
+		positionError <= positionTolerance + positionQuantisation &&
+		rotationError <= rotationTolerance + rotationQuantisation;
+	std::cout << "AnimationPath compress " << original->getNumKeys() << " keys to " << path->getNumKeys() << " in " << timer.delta_m(t0, t1) << "ms"
+		<< "  " << original->getKeyMemorySize() << " to " << path->getKeyMemorySize() << " bytes"
+		<< "  position error " << positionError << "  rotation error " << rotationError
+		<< (passed ? "  OK" : "  FAILED") << std::endl;
+
+	// a straight line at constant speed, every key but the ends could go, the
+	// segment cap keeps one in MAX_SEGMENT_KEYS and the time linear.
+	ref_ptr<AnimationPath> line = osgNew AnimationPath;
+	for (unsigned int k = 0; k < 20000; ++k)
+	{
+		line->insert(0.1 * k, AnimationPath::Key(Vec3((float)k, 0.0f, 0.0f), Quat(), Vec3(1.0f, 1.0f, 1.0f)));
+	}
+	t0 = timer.tick();
+	line->compress(positionTolerance, rotationTolerance);
+	t1 = timer.tick();
+	passed = line->getNumKeys() <= 20000 / 128 + 2;
+	std::cout << "AnimationPath compress line 20000 keys to " << line->getNumKeys() << " in " << timer.delta_m(t0, t1) << "ms"
+		<< (passed ? "  OK" : "  FAILED") << std::endl;
+}
+
+#endif
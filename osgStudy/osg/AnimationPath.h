@@ -2,19 +2,37 @@
 #include <osg/Matrix.h>
 #include <osg/Quat.h>
 #include <osg/Transform.h>
+#include <osg/ref_ptr.h>
 
-#include <map>
+#include <stdio.h>
+#include <string>
+#include <vector>
 
 namespace osg
 {
+	class AnimationPathReader;
+
 	class SG_EXPORT AnimationPath : public Transform::ComputeTransformCallback
 	{
 	public:
+		/** How rotations are interpolated between keys, trading accuracy against speed.
+		  * See Quat::slerp, Quat::approximateSlerp and Quat::nlerp.*/
+		enum RotationInterpolation
+		{
+			SLERP,
+			APPROXIMATE_SLERP,
+			NLERP
+		};
+
 		struct Key
 		{
 			osg::Vec3 _position;
 			osg::Quat _rotation;
 			osg::Vec3 _scale;
+			Key()
+			{
+				_scale.set(1.0f, 1.0f, 1.0f);
+			}
 			Key(const osg::Vec3& position, const osg::Quat& rotation, const osg::Vec3& scale)
 			{
 				_position = position;
@@ -22,39 +40,270 @@ namespace osg
 				_scale = scale;
 			}
 
-			inline void interpolate(const float ratio, const Key& first, const Key& second)
+			inline void interpolate(const float ratio, const Key& first, const Key& second, RotationInterpolation mode = SLERP)
 			{
 				float one_minus_ratio = 1.0f - ratio;
 				_position = first._position * one_minus_ratio + second._position * ratio;
-				_rotation.slerp(ratio, first._rotation, second._rotation);
+				switch (mode)
+				{
+				case APPROXIMATE_SLERP:
+					_rotation.approximateSlerp(ratio, first._rotation, second._rotation);
+					break;
+				case NLERP:
+					_rotation.nlerp(ratio, first._rotation, second._rotation);
+					break;
+				default:
+					_rotation.slerp(ratio, first._rotation, second._rotation);
+					break;
+				}
 				_scale = first._scale * one_minus_ratio + second._scale * ratio;
 			}
 
+			/** matrix = scale * rotate * translate, built directly rather than by multiplying three matrices.*/
 			inline void getMatrix(Matrix& matrix) const
 			{
-				matrix.makeScale(_scale);
-				matrix.postMult(_rotation.getMatrix());
-				matrix.postMult(osg::Matrix::translate(_position));
+				_rotation.get(matrix);
+				for (int col = 0; col < 3; ++col)
+				{
+					matrix(0, col) *= _scale.x();
+					matrix(1, col) *= _scale.y();
+					matrix(2, col) *= _scale.z();
+				}
+				matrix.setTrans(_position);
 			}
 
+			/** matrix = inverse(scale * rotate * translate) = translate^-1 * rotate^-1 * scale^-1.*/
 			inline void getInverse(Matrix& matrix) const
 			{
-				matrix.makeScale(1.0f / _scale.x(), 1.0f / _scale.y(), 1.0f / _scale.z() );
-				matrix.postMult(_rotation.inverse.getMatrix());
-				matrix.postMult(osg::Matrix::translate(-_position));
+				matrix.makeTranslate(-_position);
+				matrix.postMult(_rotation.inverse().getMatrix());
+				matrix.postMult(osg::Matrix::scale(1.0f / _scale.x(), 1.0f / _scale.y(), 1.0f / _scale.z()));
 			}
 		};
+
+		/** Remembers the key interval found by the previous lookup. During playback the
+		  * next time is normally in the same or the following interval, so it is found
+		  * without a search, making monotonic playback amortised O(1).
+		  * Keep one Cursor per evaluator, i.e. per animated object or thread.*/
+		struct Cursor
+		{
+			Cursor() : _index(0) {}
+			unsigned int _index;
+		};
+
 	protected:
+		friend class AnimationPathReader;
+
 		virtual ~AnimationPath() {}
-		typedef std::map<double, Key> TimeKeyMap;
-		TimeKeyMap _timeKeyMap;
+
+		AnimationPath& operator = (const AnimationPath&) { return *this; }
+
+		typedef std::vector<double> TimeList;
+		typedef std::vector<Key> KeyList;
+
+		// keys sorted by time, held in two contiguous arrays so that lookups only touch the times.
+		TimeList _times;
+		KeyList _keys;
+		RotationInterpolation _rotationInterpolation;
+
+		// set when the keys are evenly spaced in time, lookups then index directly.
+		bool _uniform;
+		double _interval;
+		double _inverseInterval;
+
+		// the cursor of the overloads without one, only for single threaded playback.
+		mutable Cursor _cursor;
+
+		/** A key packed into 12 bytes, see compress(). The position is quantised to 16 bits
+		  * per axis within the bounding box of the path, the rotation uses the smallest three
+		  * encoding: the largest component is dropped, and recomputed from the unit length,
+		  * and the other three are quantised to 15 bits, the top bits of the first two
+		  * shorts holding the index of the dropped component.*/
+		struct CompressedKey
+		{
+			unsigned short _position[3];
+			unsigned short _rotation[3];
+		};
+		typedef std::vector<CompressedKey> CompressedKeyList;
+
+		bool _compressed;
+		CompressedKeyList _compressedKeys;
+		// per key scales, left empty when every key has _constantScale.
+		std::vector<Vec3> _compressedScales;
+		Vec3 _constantScale;
+		Vec3 _positionOrigin;
+		Vec3 _positionStep;
+
+		// the keys used by lookups, pointing into the lists above, or into _mappedFile
+		// when the path has been mapped from a file.
+		unsigned int _numKeys;
+		const double* _timeData;
+		const Key* _keyData;
+		const CompressedKey* _compressedKeyData;
+		const Vec3* _compressedScaleData;
+		ref_ptr<Referenced> _mappedFile;
+
+		/** Point the key data at the lists, call after they change.*/
+		void updateKeyData();
+
+		/** Layout of the binary file written by write(). The header is followed by the
+		  * times, then either the keys or the compressed keys and the per key scales, each
+		  * array starting at the offset given in the header, aligned to 16 bytes so that a
+		  * mapped file can be used in place. Values are in the byte order and the struct
+		  * layout of the writing machine, _keySize rejects files written with another Key.*/
+		struct FileHeader
+		{
+			enum
+			{
+				VERSION = 1,
+				COMPRESSED = 1,
+				PER_KEY_SCALES = 2,
+				UNIFORM = 4
+			};
+
+			char _magic[4];
+			unsigned int _version;
+			unsigned int _flags;
+			unsigned int _rotationInterpolation;
+			unsigned int _numKeys;
+			unsigned int _keySize;
+			double _interval;
+			float _constantScale[3];
+			float _positionOrigin[3];
+			float _positionStep[3];
+			unsigned int _reserved;
+			unsigned long long _timesOffset;
+			unsigned long long _keysOffset;
+			unsigned long long _scalesOffset;
+			unsigned long long _fileSize;
+		};
+
+		/** Check the header of a file of fileSize bytes, then remove the keys and take the
+		  * settings from the header, ready for the file's keys. Return false, leaving the
+		  * path unchanged, if the header is not valid.*/
+		bool resetFromFileHeader(const FileHeader& header, unsigned long long fileSize);
+
+		void updateUniform();
+
+		/** get key i, decoding it if the path is compressed.*/
+		void getKey(unsigned int i, Key& key) const;
+
+		/** find the index i of the interval times[i] <= time < times[i+1], clamped to the first and last keys.*/
+		unsigned int findInterval(double time, Cursor& cursor) const;
+
+		/** compute the interpolated Key at time, return false if there are no keys.*/
+		bool getKey(double time, Key& key, Cursor& cursor) const;
+
 	public:
-		AnimationPath() {}
+		AnimationPath() : _rotationInterpolation(SLERP), _uniform(false), _interval(0.0), _inverseInterval(0.0), _compressed(false),
+			_numKeys(0), _timeData(0), _keyData(0), _compressedKeyData(0), _compressedScaleData(0) {}
+
+		AnimationPath(const AnimationPath& path);
+
+		void setRotationInterpolation(RotationInterpolation mode) { _rotationInterpolation = mode; }
+		RotationInterpolation getRotationInterpolation() const { return _rotationInterpolation; }
+
+		/** Get the matrix at time, using the path's own cursor. The cursor is shared by
+		  * every caller, so only call these from one thread, the traversals use
+		  * computeLocalToWorldMatrix() and computeWorldToLocalMatrix() which do not touch it.*/
 		virtual bool getMatrix(double time, Matrix& matrix) const;
-		virtual bool getInverse(double time, Matrix& matrix) const;
-		virtual const bool computeLocalToWorldMatrix(Matrix& matrix, const Transform* transform, NodeVisitor* nv) const;
+		virtual bool getInverse(double time, Matrix& matrix) const;
+
+		/** Get the matrix at time, using the caller's cursor. Use when several
+		  * objects play the same path at different times.*/
+		bool getMatrix(double time, Matrix& matrix, Cursor& cursor) const;
+		bool getInverse(double time, Matrix& matrix, Cursor& cursor) const;
+
+		/** Apply the matrix at the visitor's frame time. Cull traversals on several threads
+		  * may call these at once, so they search for the key interval with a cursor of
+		  * their own, O(1) for a uniform path and O(log n) otherwise.*/
+		virtual const bool computeLocalToWorldMatrix(Matrix& matrix, const Transform* transform, NodeVisitor* nv) const;
 		virtual const bool computeWorldToLocalMatrix(Matrix& matrix, const Transform* transform, NodeVisitor* nv) const;
 
+		/** Insert a key, replacing any key already at time. Appending in time
+		  * order is O(1), inserting earlier keys has to shift the later ones.*/
 		void insert(double time, const Key& key);
+
+		/** Replace the keys with ones sampled every interval seconds from the
+		  * first to the last key, so that lookups can index directly.*/
+		void resample(double interval);
+
+		/** Return true if the keys are evenly spaced in time, either as inserted or after resample().*/
+		bool isUniform() const { return _uniform; }
+
+		/** Replace the keys by a compact representation, 12 bytes per key instead of 40,
+		  * plus a single scale when the scale never changes. Keys are first dropped where
+		  * interpolating between their neighbours stays within positionTolerance, in the
+		  * units of the path, rotationTolerance radians and scaleTolerance. Pass zero
+		  * tolerances to keep every key. Lookups decode the keys they need on the fly,
+		  * inserting a key or resampling decompresses the path first.
+		  * The position quantisation adds up to 1/131070 of the path's extent on each axis.*/
+		void compress(float positionTolerance, float rotationTolerance, float scaleTolerance = 1e-4f);
+
+		/** Expand a compressed path back to full keys.*/
+		void decompress();
+
+		bool isCompressed() const { return _compressed; }
+
+		/** Return the memory in bytes allocated for the times and keys, not counting a mapped file.*/
+		unsigned int getKeyMemorySize() const;
+
+		/** Write the keys, compressed or not, to a binary file that map() or an
+		  * AnimationPathReader can load. Return false if the file could not be written.*/
+		bool write(const std::string& fileName) const;
+
+		/** Replace the keys by those of a file written by write(), mapping the file into
+		  * memory and using the keys in place. Opening costs the same whatever the size of
+		  * the file, its pages are only read as playback reaches them. Inserting keys,
+		  * resampling or compressing copies the keys out of the file first.
+		  * Return false, leaving the path unchanged, if the file cannot be mapped or is
+		  * not a valid AnimationPath file.*/
+		bool map(const std::string& fileName);
+
+		/** Copy the keys of a mapped file into the path and release the file.*/
+		void unmap();
+
+		bool isMapped() const { return _mappedFile.valid(); }
+
+		unsigned int getNumKeys() const { return _numKeys; }
+		double getFirstTime() const { return _numKeys == 0 ? 0.0 : _timeData[0]; }
+		double getLastTime() const { return _numKeys == 0 ? 0.0 : _timeData[_numKeys - 1]; }
+	};
+
+	/** Loads a file written by AnimationPath::write() progressively, appending its keys
+	  * to a path that can already be playing, so that long recordings start at once.
+	  * Call read() every frame, from the update traversal, with a budget of keys;
+	  * lookups beyond the keys read so far hold the last one. read() must not run
+	  * at the same time as lookups on the path from other threads.*/
+	class SG_EXPORT AnimationPathReader : public Referenced
+	{
+	public:
+		AnimationPathReader() : _file(0), _numKeys(0), _numRead(0) {}
+
+		/** Open fileName and clear path, ready to take the file's keys. Return false if the
+		  * file cannot be opened or is not a valid AnimationPath file.*/
+		bool open(const std::string& fileName, AnimationPath* path);
+
+		/** Append up to maxKeys more keys to the path, return the number appended,
+		  * zero once every key has been read or if reading fails.*/
+		unsigned int read(unsigned int maxKeys);
+
+		void close();
+
+		bool isOpen() const { return _file != 0; }
+		bool isComplete() const { return _numRead == _numKeys; }
+		unsigned int getNumKeys() const { return _numKeys; }
+		unsigned int getNumKeysRead() const { return _numRead; }
+
+		AnimationPath* getAnimationPath() { return _path.get(); }
+
+	protected:
+		virtual ~AnimationPathReader() { close(); }
+
+		ref_ptr<AnimationPath> _path;
+		FILE* _file;
+		AnimationPath::FileHeader _header;
+		unsigned int _numKeys;
+		unsigned int _numRead;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include <osg/AsyncNotifyHandler.h>
+
+#include <chrono>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+using namespace osg;
+
+namespace
+{
+
+const char* s_severityNames[] = { "ALWAYS", "FATAL", "WARN", "NOTICE", "INFO", "DEBUG_INFO", "DEBUG_FP" };
+
+}
+
+AsyncNotifyHandler::AsyncNotifyHandler(NotifyHandler* sink,unsigned int capacity):
+    _sink(sink),
+    _records(0),
+    _mask(0),
+    _enqueuePos(0),
+    _dequeuePos(0),
+    _numDropped(0),
+    _numDroppedReported(0),
+    _done(false),
+    _writerWaiting(false)
+{
+    if (!_sink) _sink = osgNew StandardNotifyHandler;
+
+    size_t size = 2;
+    while (size<capacity) size *= 2;
+    _mask = size-1;
+
+    // each record carries the queue position it is free for, or that it was written at plus one.
+    _records = osgNew Record[size];
+    for(size_t i=0;i<size;++i) _records[i]._sequence.store(i,std::memory_order_relaxed);
+
+    _startTick = _timer.tick();
+    _writer = std::thread(&AsyncNotifyHandler::run,this);
+}
+
+AsyncNotifyHandler::~AsyncNotifyHandler()
+{
+    _done.store(true);
+    wakeWriter();
+    _writer.join();
+    osgDelete [] _records;
+}
+
+void AsyncNotifyHandler::notify(NotifySeverity severity, const char* message)
+{
+    // claim a position, giving up rather than waiting when the queue is full.
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    Record* record;
+    for(;;)
+    {
+        record = &_records[pos&_mask];
+        size_t sequence = record->_sequence.load(std::memory_order_acquire);
+        long long difference = (long long)sequence-(long long)pos;
+        if (difference==0)
+        {
+            if (_enqueuePos.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed)) break;
+        }
+        else if (difference<0)
+        {
+            _numDropped.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->_severity = severity;
+    record->_tick = _timer.tick();
+    record->_threadId = std::this_thread::get_id();
+
+    size_t length = strlen(message);
+    if (length<MAX_MESSAGE_LENGTH)
+    {
+        memcpy(record->_message,message,length+1);
+    }
+    else
+    {
+        memcpy(record->_message,message,MAX_MESSAGE_LENGTH-5);
+        strcpy(record->_message+MAX_MESSAGE_LENGTH-5,"...\n");
+    }
+
+    record->_sequence.store(pos+1,std::memory_order_release);
+    wakeWriter();
+}
+
+void AsyncNotifyHandler::flush()
+{
+    size_t pos = _enqueuePos.load();
+    while (_dequeuePos.load()<pos)
+    {
+        wakeWriter();
+        std::this_thread::yield();
+    }
+}
+
+void AsyncNotifyHandler::wakeWriter()
+{
+    // the writer may be just about to wait and miss this, it then wakes at its next timeout.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_writerWaiting.load()) _wakeUp.notify_one();
+}
+
+bool AsyncNotifyHandler::writeNext()
+{
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    Record& record = _records[pos&_mask];
+    if (record._sequence.load(std::memory_order_acquire)!=pos+1) return false;
+
+    std::ostringstream line;
+    line.setf(std::ios::fixed);
+    line.precision(6);
+    line<<_timer.delta_s(_startTick,record._tick)<<" ["<<record._threadId<<"] "<<s_severityNames[record._severity]<<": "<<record._message;
+    NotifySeverity severity = record._severity;
+
+    // hand the record back to the senders before the sink does its I/O, flush()
+    // waits for the I/O though.
+    record._sequence.store(pos+_mask+1,std::memory_order_release);
+    _sink->notify(severity,line.str().c_str());
+
+    _dequeuePos.store(pos+1);
+    return true;
+}
+
+void AsyncNotifyHandler::run()
+{
+    for(;;)
+    {
+        bool done = _done.load();
+        while (writeNext()) {}
+
+        unsigned int numDropped = _numDropped.load(std::memory_order_relaxed);
+        if (numDropped!=_numDroppedReported)
+        {
+            std::ostringstream line;
+            line<<"AsyncNotifyHandler: "<<numDropped-_numDroppedReported<<" messages dropped, the queue was full."<<std::endl;
+            _sink->notify(WARN,line.str().c_str());
+            _numDroppedReported = numDropped;
+        }
+
+        // once asked to stop, return after writing everything queued before.
+        if (done) return;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _writerWaiting.store(true);
+        size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        if (_records[pos&_mask]._sequence.load()!=pos+1 && !_done.load())
+        {
+            _wakeUp.wait_for(lock,std::chrono::milliseconds(100));
+        }
+        _writerWaiting.store(false);
+    }
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <vector>
+
+namespace
+{
+
+/** counts the messages sent by the test, and adds up the dropped message notices.*/
+class CountingNotifyHandler : public NotifyHandler
+{
+    public:
+        CountingNotifyHandler() : _numMessages(0), _numDroppedReported(0) {}
+        virtual void notify(NotifySeverity, const char* message)
+        {
+            unsigned int numDropped;
+            if (strstr(message,"clamping")) ++_numMessages;
+            else if (sscanf(message,"AsyncNotifyHandler: %u messages dropped",&numDropped)==1) _numDroppedReported += numDropped;
+        }
+        unsigned int _numMessages;
+        unsigned int _numDroppedReported;
+};
+
+/** send numMessages warnings from each of numThreads threads, each thread
+  * flushing after every burstSize messages when burstSize is not 0. Returns
+  * the microseconds the senders spent in total.*/
+double sendMessages(AsyncNotifyHandler* handler, unsigned int numThreads, unsigned int numMessages, unsigned int burstSize)
+{
+    std::vector<std::thread> threads;
+    std::vector<double> sendTime(numThreads,0.0);
+    for(unsigned int t=0;t<numThreads;++t)
+    {
+        threads.push_back(std::thread([handler,&sendTime,t,numMessages,burstSize]()
+        {
+            Timer timer;
+            Timer_t t0 = timer.tick();
+            for(unsigned int i=0;i<numMessages;++i)
+            {
+                handler->notify(WARN,"Warning: clamping value to permitted maximum.\n");
+                if (burstSize && (i+1)%burstSize==0) handler->flush();
+            }
+            sendTime[t] = timer.delta_u(t0,timer.tick());
+        }));
+    }
+    for(unsigned int t=0;t<numThreads;++t) threads[t].join();
+    handler->flush();
+
+    double totalSendTime = 0.0;
+    for(unsigned int t=0;t<numThreads;++t) totalSendTime += sendTime[t];
+    return totalSendTime;
+}
+
+}
+
+/** Send numMessages warnings from each of numThreads threads through an
+  * AsyncNotifyHandler. First with each thread keeping no more than its share
+  * of the queue unwritten, checking that every message is delivered. Then
+  * as fast as they can, checking that every message is either delivered or
+  * dropped, that the drops are reported, and timing the senders per message.*/
+void test_AsyncNotifyHandler(unsigned int numThreads, unsigned int numMessages)
+{
+    const unsigned int capacity = 256;
+    const unsigned int total = numThreads*numMessages;
+
+    ref_ptr<CountingNotifyHandler> pacedSink = osgNew CountingNotifyHandler;
+    ref_ptr<AsyncNotifyHandler> handler = osgNew AsyncNotifyHandler(pacedSink.get(),capacity);
+    unsigned int burstSize = capacity/numThreads>0 ? capacity/numThreads : 1;
+    sendMessages(handler.get(),numThreads,numMessages,burstSize);
+    unsigned int numPacedDropped = handler->getNumDroppedMessages();
+    handler = 0;
+    bool passed = numThreads<=capacity && numPacedDropped==0 && pacedSink->_numMessages==total;
+
+    ref_ptr<CountingNotifyHandler> sink = osgNew CountingNotifyHandler;
+    handler = osgNew AsyncNotifyHandler(sink.get(),capacity);
+    double totalSendTime = sendMessages(handler.get(),numThreads,numMessages,0);
+    unsigned int numDropped = handler->getNumDroppedMessages();
+    handler = 0;
+    passed = passed && sink->_numMessages+numDropped==total && sink->_numDroppedReported==numDropped;
+
+    std::cout<<"AsyncNotifyHandler "<<numThreads<<" threads x "<<numMessages<<" messages, paced written "<<pacedSink->_numMessages
+             <<" dropped "<<numPacedDropped<<", unpaced written "<<sink->_numMessages<<" dropped "<<numDropped
+             <<" send "<<totalSendTime*1000.0/total<<"ns/message"<<(passed?"  OK":"  FAILED")<<std::endl;
+}
+
+#endif
@@ -0,0 +1,90 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_ASYNCNOTIFYHANDLER
+#define OSG_ASYNCNOTIFYHANDLER 1
+
+#include <osg/Notify.h>
+#include <osg/Timer.h>
+#include <osg/ref_ptr.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace osg {
+
+/** NotifyHandler which queues the messages and writes them from a thread of
+  * its own, so that a thread sending a message never waits for I/O or for a
+  * lock. Messages go through a bounded lock free queue, several threads may
+  * send at once, and are passed to the sink prefixed with the time since the
+  * handler was created, the id of the sending thread and the severity.
+  * When the queue is full messages are dropped and counted rather than
+  * making the sender wait, a notice of how many were dropped is written
+  * once the queue has room again.*/
+class SG_EXPORT AsyncNotifyHandler : public NotifyHandler
+{
+    public:
+
+        /** longer messages are truncated.*/
+        enum { MAX_MESSAGE_LENGTH = 480 };
+
+        /** sink receives the messages on the writer thread, a StandardNotifyHandler
+          * when 0. capacity is the number of messages queued at most, rounded up to
+          * a power of two.*/
+        AsyncNotifyHandler(NotifyHandler* sink=0, unsigned int capacity=1024);
+
+        virtual void notify(NotifySeverity severity, const char* message);
+
+        /** wait until the messages queued so far have been passed to the sink.*/
+        void flush();
+
+        NotifyHandler* getSink() { return _sink.get(); }
+
+        /** return the number of messages dropped because the queue was full.*/
+        unsigned int getNumDroppedMessages() const { return _numDropped.load(std::memory_order_relaxed); }
+
+    protected:
+
+        /** writes the messages still queued and stops the writer thread.*/
+        virtual ~AsyncNotifyHandler();
+
+        AsyncNotifyHandler(const AsyncNotifyHandler&);
+        AsyncNotifyHandler& operator = (const AsyncNotifyHandler&);
+
+        struct Record
+        {
+            std::atomic<size_t> _sequence;
+            NotifySeverity      _severity;
+            Timer_t             _tick;
+            std::thread::id     _threadId;
+            char                _message[MAX_MESSAGE_LENGTH];
+        };
+
+        void run();
+        bool writeNext();
+        void wakeWriter();
+
+        ref_ptr<NotifyHandler>      _sink;
+        Record*                     _records;
+        size_t                      _mask;
+        std::atomic<size_t>         _enqueuePos;
+        std::atomic<size_t>         _dequeuePos;
+        std::atomic<unsigned int>   _numDropped;
+        unsigned int                _numDroppedReported;
+
+        Timer                       _timer;
+        Timer_t                     _startTick;
+
+        std::atomic<bool>           _done;
+        std::atomic<bool>           _writerWaiting;
+        std::mutex                  _mutex;
+        std::condition_variable     _wakeUp;
+        std::thread                 _writer;
+};
+
+}
+
+#endif
@@ -99,6 +99,12 @@ class SG_EXPORT BoundingBox
             return (_min+_max)*0.5f;
         }
 
+        /** Calculate and return the half size of the bounding box along each axis.*/
+        inline const Vec3 extent() const
+        {
+            return (_max-_min)*0.5f;
+        }
+
         /** Calculate and return the radius of the bounding box.*/
         inline const float radius() const
         {
@@ -168,6 +174,31 @@ class SG_EXPORT BoundingBox
         }
 };
 
+/** Axis-aligned box held as its center and half size along each axis, the
+    form taken by the branchless Plane::intersect(const CenterExtentBox&).
+    Convert from a BoundingBox once and cull against it many times.*/
+class SG_EXPORT CenterExtentBox
+{
+    public:
+
+        Vec3 _center;
+        Vec3 _extent;
+
+        inline CenterExtentBox() : _center(0.0f,0.0f,0.0f), _extent(-1.0f,-1.0f,-1.0f) {}
+
+        inline CenterExtentBox(const Vec3& center,const Vec3& extent) : _center(center), _extent(extent) {}
+
+        inline CenterExtentBox(const BoundingBox& bb) : _center(bb.center()), _extent(bb.extent()) {}
+
+        inline void set(const BoundingBox& bb) { _center = bb.center(); _extent = bb.extent(); }
+
+        inline const bool valid() const { return _extent.x()>=0.0f; }
+
+        inline const Vec3& center() const { return _center; }
+
+        inline const Vec3& extent() const { return _extent; }
+};
+
 }
 
 #endif
@@ -0,0 +1,669 @@
+#include <osg/BoundingVolumeHierarchy.h>
+#include <osg/MatrixTransform.h>
+
+#include <algorithm>
+#include <typeinfo>
+#include <float.h>
+
+using namespace osg;
+
+class BoundingVolumeHierarchy::BuildEntry
+{
+    public:
+
+        BoundingBox     _bb;
+        Vec3            _centroid;
+        unsigned int    _index;
+};
+
+namespace
+{
+
+/** number of bins the centroids are sorted into along each axis when
+  * looking for the split of least surface area cost.*/
+const unsigned int NUM_BINS = 16;
+
+inline float surfaceArea(const BoundingBox& bb)
+{
+    if (!bb.valid()) return 0.0f;
+    Vec3 d = bb._max-bb._min;
+    return 2.0f*(d.x()*d.y()+d.y()*d.z()+d.z()*d.x());
+}
+
+inline BoundingBox boxOf(const BoundingSphere& bs)
+{
+    Vec3 r(bs._radius,bs._radius,bs._radius);
+    return BoundingBox(bs._center-r,bs._center+r);
+}
+
+/** number of tests made on entering cell, of the two cells or the children below it.*/
+inline float numTestsOf(const BoundingVolumeHierarchy::Cell& cell)
+{
+    return cell.isLeaf() ? (float)cell._numChildren : 2.0f;
+}
+
+inline unsigned int binOf(float value,float minValue,float scale)
+{
+    unsigned int bin = (unsigned int)((value-minValue)*scale);
+    return bin<NUM_BINS ? bin : NUM_BINS-1;
+}
+
+struct BinLessEqual
+{
+    BinLessEqual(unsigned int axis,float minValue,float scale,unsigned int bin):
+        _axis(axis),_minValue(minValue),_scale(scale),_bin(bin) {}
+
+    template<class T>
+    bool operator () (const T& entry) const { return binOf(entry._centroid[_axis],_minValue,_scale)<=_bin; }
+
+    unsigned int    _axis;
+    float           _minValue;
+    float           _scale;
+    unsigned int    _bin;
+};
+
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy():
+    _maxChildrenPerCell(4),
+    _rebuildRatio(1.5f),
+    _dirty(true),
+    _needsBuild(true),
+    _checkAllChildren(true),
+    _buildCost(0.0f),
+    _weightedArea(0.0),
+    _numBuilds(0),
+    _numRefits(0),
+    _numCellsRefitted(0),
+    _numChildrenChecked(0)
+{
+}
+
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{
+}
+
+bool BoundingVolumeHierarchy::traversesAllChildren(const Group& group)
+{
+    const std::type_info& type = typeid(group);
+    return type==typeid(Group) || type==typeid(Transform) || type==typeid(MatrixTransform);
+}
+
+void BoundingVolumeHierarchy::build(const ChildList& children)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    buildTree(children);
+    _dirty.store(false,std::memory_order_release);
+}
+
+void BoundingVolumeHierarchy::buildTree(const ChildList& children)
+{
+    unsigned int numChildren = children.size();
+
+    _cells.clear();
+    _childIndices.clear();
+    _unboundedChildIndices.clear();
+    _childNodes.resize(numChildren);
+    _childBounds.resize(numChildren);
+    _childCells.assign(numChildren,~0u);
+    _childIndexMap.clear();
+    _dirtyChildren.clear();
+
+    BuildEntryList entries;
+    entries.reserve(numChildren);
+    for(unsigned int i=0;i<numChildren;++i)
+    {
+        const Node* child = children[i].get();
+        const BoundingSphere& bs = child->getBound();
+        _childNodes[i] = child;
+        _childBounds[i] = bs;
+        _childIndexMap.insert(ChildIndexMap::value_type(child,i));
+        if (bs.valid())
+        {
+            entries.push_back(BuildEntry());
+            BuildEntry& entry = entries.back();
+            entry._bb = boxOf(bs);
+            entry._centroid = bs._center;
+            entry._index = i;
+        }
+        else
+        {
+            _unboundedChildIndices.push_back(i);
+        }
+    }
+
+    if (!entries.empty())
+    {
+        _cells.reserve(2*(entries.size()/_maxChildrenPerCell)+1);
+        _childIndices.reserve(entries.size());
+        _cells.push_back(Cell());
+        build(0,entries,0,entries.size());
+    }
+
+    _weightedArea = 0.0;
+    for(CellList::const_iterator itr=_cells.begin();
+        itr!=_cells.end();
+        ++itr)
+    {
+        _weightedArea += numTestsOf(*itr)*surfaceArea(itr->_bb);
+    }
+    _buildCost = getCost();
+    _needsBuild = false;
+    _checkAllChildren = false;
+    ++_numBuilds;
+}
+
+void BoundingVolumeHierarchy::build(unsigned int cellIndex,BuildEntryList& entries,unsigned int begin,unsigned int end)
+{
+    BoundingBox bb;
+    BoundingBox centroidBB;
+    for(unsigned int i=begin;i<end;++i)
+    {
+        bb.expandBy(entries[i]._bb);
+        centroidBB.expandBy(entries[i]._centroid);
+    }
+    _cells[cellIndex]._bb = bb;
+
+    unsigned int num = end-begin;
+    if (num<=_maxChildrenPerCell)
+    {
+        Cell& cell = _cells[cellIndex];
+        cell._first = _childIndices.size();
+        cell._numChildren = num;
+        for(unsigned int i=begin;i<end;++i)
+        {
+            _childIndices.push_back(entries[i]._index);
+            _childCells[entries[i]._index] = cellIndex;
+        }
+        return;
+    }
+
+    // the split between bins of least surface area cost, on any axis.
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+    float bestCost = FLT_MAX;
+    float bestMin = 0.0f;
+    float bestScale = 0.0f;
+    for(unsigned int axis=0;axis<3;++axis)
+    {
+        float minValue = centroidBB._min[axis];
+        float extent = centroidBB._max[axis]-minValue;
+        if (extent<=0.0f) continue;
+        float scale = (float)NUM_BINS/extent;
+
+        BoundingBox binBB[NUM_BINS];
+        unsigned int binCount[NUM_BINS] = {0};
+        for(unsigned int i=begin;i<end;++i)
+        {
+            unsigned int bin = binOf(entries[i]._centroid[axis],minValue,scale);
+            binBB[bin].expandBy(entries[i]._bb);
+            ++binCount[bin];
+        }
+
+        float rightArea[NUM_BINS];
+        unsigned int rightCount[NUM_BINS];
+        BoundingBox sweepBB;
+        unsigned int count = 0;
+        for(unsigned int bin=NUM_BINS-1;bin>0;--bin)
+        {
+            sweepBB.expandBy(binBB[bin]);
+            count += binCount[bin];
+            rightArea[bin] = surfaceArea(sweepBB);
+            rightCount[bin] = count;
+        }
+
+        sweepBB.init();
+        count = 0;
+        for(unsigned int bin=0;bin<NUM_BINS-1;++bin)
+        {
+            sweepBB.expandBy(binBB[bin]);
+            count += binCount[bin];
+            if (count==0 || rightCount[bin+1]==0) continue;
+
+            float cost = surfaceArea(sweepBB)*(float)count+rightArea[bin+1]*(float)rightCount[bin+1];
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+                bestMin = minValue;
+                bestScale = scale;
+            }
+        }
+    }
+
+    unsigned int middle;
+    if (bestAxis>=0)
+    {
+        middle = std::partition(entries.begin()+begin,entries.begin()+end,
+                                BinLessEqual(bestAxis,bestMin,bestScale,bestBin))-entries.begin();
+    }
+    else
+    {
+        // all the centroids coincide, nothing to choose between.
+        middle = begin+num/2;
+    }
+
+    unsigned int first = _cells.size();
+    _cells.resize(first+2);
+    _cells[first]._parent = cellIndex;
+    _cells[first+1]._parent = cellIndex;
+    _cells[cellIndex]._first = first;
+    _cells[cellIndex]._numChildren = 0;
+
+    build(first,entries,begin,middle);
+    build(first+1,entries,middle,end);
+}
+
+void BoundingVolumeHierarchy::dirtyChild(const Node* child)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _dirty.store(true,std::memory_order_release);
+    if (_needsBuild || _checkAllChildren) return;
+
+    std::pair<ChildIndexMap::const_iterator,ChildIndexMap::const_iterator> range = _childIndexMap.equal_range(child);
+    if (range.first==range.second)
+    {
+        // not a child when last built, only checking them all will tell what has changed.
+        _checkAllChildren = true;
+        return;
+    }
+    for(ChildIndexMap::const_iterator itr=range.first;itr!=range.second;++itr)
+    {
+        _dirtyChildren.push_back(itr->second);
+    }
+
+    // past one entry per child checking them all costs no more.
+    if (_dirtyChildren.size()>=_childNodes.size()) _checkAllChildren = true;
+}
+
+bool BoundingVolumeHierarchy::update(const ChildList& children)
+{
+    if (!_dirty.load(std::memory_order_acquire)) return false;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // another thread may have updated it while this one waited.
+    if (!_dirty.load(std::memory_order_relaxed)) return false;
+
+    // only clear the flag once the cells are done, threads seeing it clear
+    // go on to walk them without taking the lock.
+    bool changed = refit(children);
+    _dirty.store(false,std::memory_order_release);
+    return changed;
+}
+
+bool BoundingVolumeHierarchy::refit(const ChildList& children)
+{
+    if (_needsBuild || children.size()!=_childNodes.size())
+    {
+        buildTree(children);
+        return true;
+    }
+
+    IndexList leaves;
+    if (_checkAllChildren)
+    {
+        for(unsigned int i=0;i<children.size();++i)
+        {
+            if (!checkChild(children,i,leaves))
+            {
+                buildTree(children);
+                return true;
+            }
+        }
+    }
+    else
+    {
+        for(IndexList::const_iterator itr=_dirtyChildren.begin();
+            itr!=_dirtyChildren.end();
+            ++itr)
+        {
+            if (!checkChild(children,*itr,leaves))
+            {
+                buildTree(children);
+                return true;
+            }
+        }
+    }
+
+    _checkAllChildren = false;
+    _dirtyChildren.clear();
+    if (leaves.empty()) return false;
+
+    std::sort(leaves.begin(),leaves.end());
+    leaves.erase(std::unique(leaves.begin(),leaves.end()),leaves.end());
+    for(IndexList::iterator itr=leaves.begin();
+        itr!=leaves.end();
+        ++itr)
+    {
+        refitLeaf(*itr);
+    }
+    ++_numRefits;
+
+    if (_rebuildRatio>0.0f && getCost()>_rebuildRatio*_buildCost) buildTree(children);
+
+    return true;
+}
+
+bool BoundingVolumeHierarchy::checkChild(const ChildList& children,unsigned int index,IndexList& leaves)
+{
+    ++_numChildrenChecked;
+
+    // a replaced child or one gaining or losing its bound needs a rebuild.
+    const Node* child = children[index].get();
+    if (child!=_childNodes[index]) return false;
+
+    const BoundingSphere& bs = child->getBound();
+    BoundingSphere& lastBound = _childBounds[index];
+    if (bs._center==lastBound._center && bs._radius==lastBound._radius) return true;
+    if (bs.valid()!=lastBound.valid()) return false;
+
+    lastBound = bs;
+    if (bs.valid()) leaves.push_back(_childCells[index]);
+    return true;
+}
+
+void BoundingVolumeHierarchy::refitLeaf(unsigned int cellIndex)
+{
+    const Cell& leaf = _cells[cellIndex];
+    BoundingBox bb;
+    for(unsigned int i=leaf._first;i<leaf._first+leaf._numChildren;++i)
+    {
+        bb.expandBy(boxOf(_childBounds[_childIndices[i]]));
+    }
+
+    // climb while the boxes change, above that the cells already fit.
+    int index = cellIndex;
+    for(;;)
+    {
+        ++_numCellsRefitted;
+
+        Cell& cell = _cells[index];
+        if (cell._bb._min==bb._min && cell._bb._max==bb._max) return;
+        _weightedArea += numTestsOf(cell)*(surfaceArea(bb)-surfaceArea(cell._bb));
+        cell._bb = bb;
+
+        index = cell._parent;
+        if (index<0) return;
+
+        const Cell& parent = _cells[index];
+        bb = _cells[parent._first]._bb;
+        bb.expandBy(_cells[parent._first+1]._bb);
+    }
+}
+
+float BoundingVolumeHierarchy::computeCost() const
+{
+    if (_cells.empty()) return 0.0f;
+
+    float rootArea = surfaceArea(_cells[0]._bb);
+    if (rootArea<=0.0f) return 0.0f;
+
+    // the root is always tested, each cell entered tests the two cells or
+    // the children below it.
+    float cost = 1.0f;
+    for(CellList::const_iterator itr=_cells.begin();
+        itr!=_cells.end();
+        ++itr)
+    {
+        cost += numTestsOf(*itr)*surfaceArea(itr->_bb)/rootArea;
+    }
+    return cost;
+}
+
+float BoundingVolumeHierarchy::getCost() const
+{
+    if (_cells.empty()) return 0.0f;
+
+    float rootArea = surfaceArea(_cells[0]._bb);
+    if (rootArea<=0.0f) return 0.0f;
+
+    return 1.0f+(float)(_weightedArea/rootArea);
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/Group.h>
+#include <osg/Polytope.h>
+#include <osg/Timer.h>
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+
+namespace
+{
+
+/** A leaf with a bound which can be moved, standing in for a Geode.*/
+class MovableNode : public Node
+{
+    public:
+
+        MovableNode(const BoundingSphere& bs) : _fixedBound(bs) {}
+
+        void setFixedBound(const BoundingSphere& bs) { _fixedBound = bs; dirtyBound(); }
+        const BoundingSphere& getFixedBound() const { return _fixedBound; }
+
+    protected:
+
+        virtual const bool computeBound() const
+        {
+            _bsphere = _fixedBound;
+            _bsphere_computed = true;
+            return true;
+        }
+
+        BoundingSphere _fixedBound;
+};
+
+float randomFloat(float minValue,float maxValue)
+{
+    return minValue+(maxValue-minValue)*(float)rand()/(float)RAND_MAX;
+}
+
+BoundingSphere randomBound(float halfSize)
+{
+    return BoundingSphere(Vec3(randomFloat(-halfSize,halfSize),0.0f,randomFloat(-halfSize,halfSize)),randomFloat(0.5f,5.0f));
+}
+
+inline bool encloses(const BoundingBox& outer,const BoundingBox& inner)
+{
+    return outer._min.x()<=inner._min.x() && outer._min.y()<=inner._min.y() && outer._min.z()<=inner._min.z() &&
+           outer._max.x()>=inner._max.x() && outer._max.y()>=inner._max.y() && outer._max.z()>=inner._max.z();
+}
+
+/** Check that each cell encloses the cells or the children below it, and
+  * that every child with a valid bound is in exactly one leaf.*/
+bool checkCells(const BoundingVolumeHierarchy& bvh,BoundingVolumeHierarchy::ChildList& children)
+{
+    const BoundingVolumeHierarchy::CellList& cells = bvh.getCellList();
+    const BoundingVolumeHierarchy::IndexList& indices = bvh.getChildIndexList();
+    std::vector<unsigned int> numLeaves(children.size(),0);
+    for(unsigned int i=0;i<cells.size();++i)
+    {
+        const BoundingVolumeHierarchy::Cell& cell = cells[i];
+        if (cell.isLeaf())
+        {
+            for(unsigned int c=cell._first;c<cell._first+cell._numChildren;++c)
+            {
+                BoundingBox bb;
+                bb.expandBy(children[indices[c]]->getBound());
+                if (!encloses(cell._bb,bb)) return false;
+                ++numLeaves[indices[c]];
+            }
+        }
+        else
+        {
+            if (!encloses(cell._bb,cells[cell._first]._bb) || !encloses(cell._bb,cells[cell._first+1]._bb)) return false;
+            if (cells[cell._first]._parent!=(int)i || cells[cell._first+1]._parent!=(int)i) return false;
+        }
+    }
+    for(unsigned int i=0;i<children.size();++i)
+    {
+        if (numLeaves[i]!=(children[i]->getBound().valid() ? 1u : 0u)) return false;
+    }
+    return true;
+}
+
+/** Counts the children in the frustum, testing cells on the way as a cull traversal does.*/
+class CountVisible
+{
+    public:
+
+        CountVisible(Polytope& frustum) : _frustum(frustum), _numVisible(0), _numTests(0) {}
+
+        bool enterCell(const BoundingBox& bb)
+        {
+            ++_numTests;
+            if (!_frustum.contains(bb)) return false;
+            _frustum.pushCurrentMask();
+            return true;
+        }
+
+        void leaveCell() { _frustum.popCurrentMask(); }
+
+        void applyChild(Node& child)
+        {
+            ++_numTests;
+            if (_frustum.contains(child.getBound())) ++_numVisible;
+        }
+
+        Polytope&       _frustum;
+        unsigned int    _numVisible;
+        unsigned int    _numTests;
+};
+
+unsigned int countVisible(const BoundingVolumeHierarchy& bvh,BoundingVolumeHierarchy::ChildList& children,const Polytope& viewFrustum,unsigned int& numTests)
+{
+    Polytope frustum(viewFrustum);
+    // give the mask stack a bottom to pop back to.
+    frustum.pushCurrentMask();
+    CountVisible counter(frustum);
+    bvh.accept(counter,children);
+    numTests = counter._numTests;
+    return counter._numVisible;
+}
+
+unsigned int countVisible(BoundingVolumeHierarchy::ChildList& children,const Polytope& viewFrustum)
+{
+    Polytope frustum(viewFrustum);
+    unsigned int numVisible = 0;
+    for(unsigned int i=0;i<children.size();++i)
+    {
+        if (frustum.contains(children[i]->getBound())) ++numVisible;
+    }
+    return numVisible;
+}
+
+}
+
+/** Build a hierarchy over numChildren spheres scattered on a plane and count
+  * the ones in a view looking across it, against testing each in turn. Then
+  * move one in a hundred of them a little, refit and count again, and finally
+  * move them all, which degrades the refitted hierarchy into a rebuild.
+  * Last check that moving the children of a Group refits it, checking every
+  * child as the Group is not told which have moved, and that dirtying the
+  * Group through a Node pointer does the same.*/
+void benchmark_BoundingVolumeHierarchy(unsigned int numChildren)
+{
+    const float halfSize = 2000.0f;
+
+    BoundingVolumeHierarchy::ChildList children;
+    for(unsigned int i=0;i<numChildren;++i)
+    {
+        children.push_back(osgNew MovableNode(randomBound(halfSize)));
+    }
+
+    Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(Matrix::translate(0.0f,-20.0f,0.0f)*Matrix::perspective(45.0,1.3,1.0,2000.0));
+
+    Timer timer;
+    ref_ptr<BoundingVolumeHierarchy> bvh = osgNew BoundingVolumeHierarchy;
+    Timer_t t0 = timer.tick();
+    bvh->update(children);
+    Timer_t t1 = timer.tick();
+    unsigned int numTests;
+    unsigned int numVisible = countVisible(*bvh,children,frustum,numTests);
+    Timer_t t2 = timer.tick();
+    unsigned int numVisibleFlat = countVisible(children,frustum);
+    Timer_t t3 = timer.tick();
+
+    bool ok = checkCells(*bvh,children) && numVisible==numVisibleFlat;
+    std::cout<<"BoundingVolumeHierarchy "<<numChildren<<" children  build "<<timer.delta_m(t0,t1)<<"ms  "<<bvh->getCellList().size()<<" cells  cost "<<bvh->computeCost()<<std::endl;
+    std::cout<<"  view "<<numVisible<<" visible  "<<numTests<<" tests "<<timer.delta_m(t1,t2)<<"ms  flat "<<numChildren<<" tests "<<timer.delta_m(t2,t3)<<"ms"<<(ok ? "  OK" : "  FAILED")<<std::endl;
+
+    // dirtyBound() reaches the hierarchy of a Group through its children's parent list,
+    // these children have no parent so it is told directly.
+    for(unsigned int i=0;i<numChildren;i+=100)
+    {
+        MovableNode* child = static_cast<MovableNode*>(children[i].get());
+        BoundingSphere bs = child->getFixedBound();
+        bs._center += Vec3(randomFloat(-20.0f,20.0f),0.0f,randomFloat(-20.0f,20.0f));
+        child->setFixedBound(bs);
+        bvh->dirtyChild(child);
+    }
+    unsigned int numCellsRefitted = bvh->getNumCellsRefitted();
+    unsigned int numChildrenChecked = bvh->getNumChildrenChecked();
+    t0 = timer.tick();
+    bvh->update(children);
+    t1 = timer.tick();
+    numVisible = countVisible(*bvh,children,frustum,numTests);
+    numVisibleFlat = countVisible(children,frustum);
+
+    ok = checkCells(*bvh,children) && numVisible==numVisibleFlat && bvh->getNumBuilds()==1 &&
+         bvh->getNumChildrenChecked()-numChildrenChecked==(numChildren+99)/100 &&
+         fabsf(bvh->getCost()-bvh->computeCost())<=1e-3f*bvh->computeCost();
+    std::cout<<"  refit "<<(numChildren+99)/100<<" moved  "<<timer.delta_m(t0,t1)<<"ms  "<<bvh->getNumChildrenChecked()-numChildrenChecked<<" children checked  "
+             <<bvh->getNumCellsRefitted()-numCellsRefitted<<" cells refitted  cost "<<bvh->computeCost()
+             <<"  "<<numVisible<<" visible  "<<numTests<<" tests"<<(ok ? "  OK" : "  FAILED")<<std::endl;
+
+    for(unsigned int i=0;i<numChildren;++i)
+    {
+        static_cast<MovableNode*>(children[i].get())->setFixedBound(randomBound(halfSize));
+    }
+    bvh->dirty();
+    t0 = timer.tick();
+    bvh->update(children);
+    t1 = timer.tick();
+    numVisible = countVisible(*bvh,children,frustum,numTests);
+    numVisibleFlat = countVisible(children,frustum);
+
+    ok = checkCells(*bvh,children) && numVisible==numVisibleFlat && bvh->getNumBuilds()==2;
+    std::cout<<"  all moved, refit and rebuild "<<timer.delta_m(t0,t1)<<"ms  cost "<<bvh->computeCost()
+             <<"  "<<numVisible<<" visible  "<<numTests<<" tests"<<(ok ? "  OK" : "  FAILED")<<std::endl;
+
+    ref_ptr<Group> group = osgNew Group;
+    for(unsigned int i=0;i<numChildren;++i) group->addChild(children[i].get());
+    group->setBoundingVolumeHierarchy(osgNew BoundingVolumeHierarchy);
+    BoundingVolumeHierarchy* groupBVH = group->getBoundingVolumeHierarchy();
+    Polytope groupFrustum(frustum);
+    groupFrustum.pushCurrentMask();
+    CountVisible counter(groupFrustum);
+    group->acceptBoundingVolumeHierarchy(counter);
+
+    numChildrenChecked = groupBVH->getNumChildrenChecked();
+    for(unsigned int i=0;i<numChildren;i+=100)
+    {
+        MovableNode* child = static_cast<MovableNode*>(children[i].get());
+        BoundingSphere bs = child->getFixedBound();
+        bs._center += Vec3(randomFloat(-20.0f,20.0f),0.0f,randomFloat(-20.0f,20.0f));
+        child->setFixedBound(bs);
+    }
+    t0 = timer.tick();
+    group->acceptBoundingVolumeHierarchy(counter);
+    t1 = timer.tick();
+    unsigned int numMovedChecked = groupBVH->getNumChildrenChecked()-numChildrenChecked;
+
+    numChildrenChecked = groupBVH->getNumChildrenChecked();
+    Node* groupNode = group.get();
+    groupNode->dirtyBound();
+    group->acceptBoundingVolumeHierarchy(counter);
+    unsigned int numAllChecked = groupBVH->getNumChildrenChecked()-numChildrenChecked;
+
+    ok = checkCells(*groupBVH,children) && numMovedChecked==numChildren && numAllChecked==numChildren && groupBVH->getNumBuilds()==1;
+    std::cout<<"  group refit "<<(numChildren+99)/100<<" moved  "<<timer.delta_m(t0,t1)<<"ms  "<<numMovedChecked<<" children checked"
+             <<"  dirtied as a Node "<<numAllChecked<<" checked"<<(ok ? "  OK" : "  FAILED")<<std::endl;
+}
+
+#endif
@@ -0,0 +1,222 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_BOUNDINGVOLUMEHIERARCHY
+#define OSG_BOUNDINGVOLUMEHIERARCHY 1
+
+#include <osg/Node.h>
+#include <osg/BoundingBox.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace osg {
+
+class Group;
+
+/** Bounding volume hierarchy over the children of a Group, a binary tree of
+  * boxes built with the surface area heuristic from the children's bounding
+  * spheres. Visitors walk it with accept() rather than testing every child,
+  * so that a box outside the view or missing every pick segment skips all the
+  * children below it. When children move the hierarchy is refitted, only the
+  * boxes above the children whose bound has changed are recomputed, and it
+  * is rebuilt when children are added or removed, or when refitting has let
+  * it degrade too far. Finding the children which have moved reads the bound
+  * of every child, unless the hierarchy is told them with dirtyChild().*/
+class SG_EXPORT BoundingVolumeHierarchy : public Referenced
+{
+    public:
+
+        /** The same as Group::ChildList.*/
+        typedef std::vector< ref_ptr<Node> > ChildList;
+
+        BoundingVolumeHierarchy();
+
+        /** A box of the hierarchy. An inner cell has the two cells _first and
+          * _first+1 below it, a leaf cell the _numChildren children listed from
+          * _first in the child index list.*/
+        class Cell
+        {
+            public:
+
+                Cell() : _parent(-1), _first(0), _numChildren(0) {}
+
+                inline bool isLeaf() const { return _numChildren!=0; }
+
+                BoundingBox     _bb;
+                int             _parent;
+                unsigned int    _first;
+                unsigned int    _numChildren;
+        };
+
+        typedef std::vector<Cell> CellList;
+        typedef std::vector<unsigned int> IndexList;
+
+        /** Set the most children a leaf cell holds, 4 by default.*/
+        inline void setMaxChildrenPerCell(unsigned int num)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _maxChildrenPerCell = num>0 ? num : 1;
+            _needsBuild = true;
+            _dirty.store(true,std::memory_order_release);
+        }
+        inline unsigned int getMaxChildrenPerCell() const { return _maxChildrenPerCell; }
+
+        /** Set how far the surface area cost may grow through refits, as a ratio
+          * of its cost when built, before the hierarchy is rebuilt. 1.5 by default,
+          * 0 never rebuilds for refitting.*/
+        inline void setRebuildRatio(float ratio) { _rebuildRatio = ratio; }
+        inline float getRebuildRatio() const { return _rebuildRatio; }
+
+        /** Return true if group is of a type known to traverse all of its children,
+          * Group, Transform or MatrixTransform, the only groups whose hierarchy is
+          * walked in place of traverse(). Subclasses may select children, as
+          * Switch and LOD do, which the hierarchy would bypass.*/
+        static bool traversesAllChildren(const Group& group);
+
+        /** Build the hierarchy over children.*/
+        void build(const ChildList& children);
+
+        /** Mark the hierarchy as needing update() to check every child.
+          * Group::dirtyBound() calls it, which the children of a Group reach
+          * whenever their bound changes, so a Group's hierarchy always checks
+          * all of its children.*/
+        inline void dirty()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _checkAllChildren = true;
+            _dirty.store(true,std::memory_order_release);
+        }
+
+        /** Mark the hierarchy as needing update() to check child only, for code
+          * driving a hierarchy of its own which knows the children it moves.*/
+        void dirtyChild(const Node* child);
+
+        inline bool isDirty() const { return _dirty.load(std::memory_order_acquire); }
+
+        /** If dirty bring the hierarchy up to date with children, rebuilding it
+          * if they have been added, removed or replaced, else refitting the cells
+          * above the children whose bounds have changed. Only the children passed
+          * to dirtyChild() are checked, unless dirty() has been called. Return
+          * true if any cell changed.
+          * Several cull or pick threads may call it at once, one updates the
+          * hierarchy while the others wait for it and return false. The hierarchy must not be
+          * dirtied while it is walked, which holds as the update traversal of
+          * a frame is done before its cull traversals.*/
+        bool update(const ChildList& children);
+
+        inline const CellList& getCellList() const { return _cells; }
+
+        /** The child indices of the leaf cells.*/
+        inline const IndexList& getChildIndexList() const { return _childIndices; }
+
+        /** The children with invalid bounds, which are in no cell.*/
+        inline const IndexList& getUnboundedChildIndexList() const { return _unboundedChildIndices; }
+
+        /** Get the surface area heuristic cost of the hierarchy, the expected
+          * number of cell and child tests of a random ray through the root cell.
+          * Walks every cell.*/
+        float computeCost() const;
+
+        /** Get the cost as computeCost() does, from a sum kept up to date as
+          * cells are built and refitted, without walking the cells.*/
+        float getCost() const;
+
+        inline unsigned int getNumBuilds() const { return _numBuilds; }
+        inline unsigned int getNumRefits() const { return _numRefits; }
+        inline unsigned int getNumCellsRefitted() const { return _numCellsRefitted; }
+        inline unsigned int getNumChildrenChecked() const { return _numChildrenChecked; }
+
+        /** Walk the hierarchy depth first. For each cell reached
+          * cellVisitor.enterCell(const BoundingBox&) is called, if it returns true
+          * the cells or children below it are visited, then cellVisitor.leaveCell()
+          * is called. Children are passed to cellVisitor.applyChild(Node&), the
+          * ones with invalid bounds before the cells.*/
+        template<class CellVisitor>
+        void accept(CellVisitor& cellVisitor,ChildList& children) const
+        {
+            for(IndexList::const_iterator itr=_unboundedChildIndices.begin();
+                itr!=_unboundedChildIndices.end();
+                ++itr)
+            {
+                cellVisitor.applyChild(*children[*itr]);
+            }
+            if (!_cells.empty()) accept(0,cellVisitor,children);
+        }
+
+    protected:
+
+        virtual ~BoundingVolumeHierarchy();
+
+        template<class CellVisitor>
+        void accept(unsigned int cellIndex,CellVisitor& cellVisitor,ChildList& children) const
+        {
+            const Cell& cell = _cells[cellIndex];
+            if (!cellVisitor.enterCell(cell._bb)) return;
+
+            if (cell.isLeaf())
+            {
+                for(unsigned int i=cell._first;i<cell._first+cell._numChildren;++i)
+                {
+                    cellVisitor.applyChild(*children[_childIndices[i]]);
+                }
+            }
+            else
+            {
+                accept(cell._first,cellVisitor,children);
+                accept(cell._first+1,cellVisitor,children);
+            }
+
+            cellVisitor.leaveCell();
+        }
+
+        class BuildEntry;
+        typedef std::vector<BuildEntry> BuildEntryList;
+
+        void buildTree(const ChildList& children);
+        bool refit(const ChildList& children);
+        void build(unsigned int cellIndex,BuildEntryList& entries,unsigned int begin,unsigned int end);
+        bool checkChild(const ChildList& children,unsigned int index,IndexList& leaves);
+        void refitLeaf(unsigned int cellIndex);
+
+        unsigned int        _maxChildrenPerCell;
+        float               _rebuildRatio;
+        std::atomic<bool>   _dirty;
+        std::mutex          _mutex;
+
+        CellList        _cells;
+        IndexList       _childIndices;
+        IndexList       _unboundedChildIndices;
+
+        /** the children and their bounds as last built or refitted, and the
+          * leaf cell of each, ~0u for those with invalid bounds.*/
+        std::vector<const Node*>        _childNodes;
+        std::vector<BoundingSphere>     _childBounds;
+        IndexList                       _childCells;
+        bool                            _needsBuild;
+
+        /** the indices of each child, a node may be added more than once, and
+          * those dirtied since the last update().*/
+        typedef std::multimap<const Node*,unsigned int> ChildIndexMap;
+        ChildIndexMap                   _childIndexMap;
+        IndexList                       _dirtyChildren;
+        bool                            _checkAllChildren;
+
+        float           _buildCost;
+
+        /** the sum over the cells of their surface area times the tests made
+          * on entering them, the cost without the division by the root area.*/
+        double          _weightedArea;
+
+        unsigned int    _numBuilds;
+        unsigned int    _numRefits;
+        unsigned int    _numCellsRefitted;
+        unsigned int    _numChildrenChecked;
+};
+
+}
+
+#endif
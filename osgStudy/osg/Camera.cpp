@@ -30,6 +30,8 @@ Camera::Camera(DisplaySettings* ds)
 
     _attachedTransformMode = NO_ATTACHED_TRANSFORM;
 
+    _cameraRelative = false;
+
     if (ds) _screenDistance = ds->getScreenDistance();
     else _screenDistance = 0.33f;
 
@@ -78,9 +80,12 @@ void Camera::copy(const Camera& camera)
     _up = camera._up;
 
     _attachedTransformMode = camera._attachedTransformMode;
+    _attachedTransform = camera._attachedTransform;
     _eyeToModelTransform = camera._eyeToModelTransform;
     _modelToEyeTransform = camera._modelToEyeTransform;
 
+    _cameraRelative = camera._cameraRelative;
+
     _screenDistance = camera._screenDistance;
     _fusionDistanceMode = camera._fusionDistanceMode;
     _fusionDistanceRatio = camera._fusionDistanceRatio;
@@ -212,7 +217,7 @@ void Camera::adjustAspectRatio(const double newAspectRatio, const AdjustAspectRa
 {
     if (newAspectRatio<0.01f || newAspectRatio>100.0f)
     {
-        notify(NOTICE)<<"Warning: aspect ratio out of range (0.01..100) in Camera::adjustAspectRatio("<<newAspectRatio<<","<<aa<<")"<<std::endl;
+        OSG_NOTIFY(NOTICE)<<"Warning: aspect ratio out of range (0.01..100) in Camera::adjustAspectRatio("<<newAspectRatio<<","<<aa<<")"<<std::endl;
         return;
     }
 
@@ -271,13 +276,13 @@ const Matrix Camera::getProjectionMatrix() const
         case(ORTHO):
         case(ORTHO2D):
             {
-                return Matrix::ortho(_left,_right,_bottom,_top,_zNear,_zFar);
+                return Matrixd::ortho(_left,_right,_bottom,_top,_zNear,_zFar);
             }
             break;
         case(FRUSTUM):
         case(PERSPECTIVE):
             {
-                return Matrix::frustum(_left,_right,_bottom,_top,_zNear,_zFar);
+                return Matrixd::frustum(_left,_right,_bottom,_top,_zNear,_zFar);
             }
             break;
 
@@ -303,9 +308,9 @@ void Camera::setView(const Vec3& eyePoint, const Vec3& lookPoint, const Vec3& up
 }
 
 
-void Camera::setLookAt(const Vec3& eye,
-                       const Vec3& center,
-                       const Vec3& up)
+void Camera::setLookAt(const Vec3d& eye,
+                       const Vec3d& center,
+                       const Vec3d& up)
 {
     _lookAtType = USE_EYE_CENTER_AND_UP;
     _eye = eye;
@@ -331,7 +336,7 @@ void Camera::setLookAt(const double eyeX, const double eyeY, const double eyeZ,
 
 /** post multiple the existing eye point and orientation by matrix.
   * note, does not affect any ModelTransforms that are applied.*/
-void Camera::transformLookAt(const Matrix& matrix)
+void Camera::transformLookAt(const Matrixd& matrix)
 {
     _up = (_up+_eye)*matrix;
     _eye = _eye*matrix;
@@ -344,110 +349,136 @@ void Camera::transformLookAt(const Matrix& matrix)
 
 const Vec3 Camera::getLookVector() const
 {
-    osg::Vec3 lv(_center-_eye);
+    osg::Vec3d lv(_center-_eye);
     lv.normalize();
     return lv;
 }
 
 const Vec3 Camera::getSideVector() const
 {
-    osg::Vec3 lv(_center-_eye);
+    osg::Vec3d lv(_center-_eye);
     lv.normalize();
-    osg::Vec3 sv(lv^_up);
+    osg::Vec3d sv(lv^_up);
     sv.normalize();
     return sv;
 }
 
 
-void Camera::attachTransform(const TransformMode mode, Matrix* matrix)
+void Camera::attachTransform(const TransformMode mode, RefMatrix* matrix)
 {
+    switch(mode)
+    {
+    case(EYE_TO_MODEL):
+    case(MODEL_TO_EYE):
+        _attachedTransform = matrix;
+        _attachedTransformMode = _attachedTransform.valid() ? mode : NO_ATTACHED_TRANSFORM;
+        break;
+    case(NO_ATTACHED_TRANSFORM):
+        _attachedTransformMode = NO_ATTACHED_TRANSFORM;
+        _attachedTransform = NULL;
+        break;
+    default: 
+        _attachedTransformMode = NO_ATTACHED_TRANSFORM;
+        _attachedTransform = NULL;
+        OSG_NOTIFY(WARN)<<"Warning: invalid TransformMode pass to osg::Camera::attachTransform(..)"<<std::endl;
+        OSG_NOTIFY(WARN)<<"         setting Camera to NO_ATTACHED_TRANSFORM."<<std::endl;
+        break;
+    }
+}
+
+void Camera::attachTransform(const TransformMode mode, const Matrixd& matrix)
+{
+    _attachedTransform = NULL;
     switch(mode)
     {
     case(EYE_TO_MODEL):
         {
+            _attachedTransformMode = mode;
             _eyeToModelTransform = matrix;
-            if (_eyeToModelTransform.valid())
+            if (!_modelToEyeTransform.invert(_eyeToModelTransform))
             {
-                _attachedTransformMode = mode;
-                if (!_modelToEyeTransform.valid()) _modelToEyeTransform = osgNew Matrix;
-                if (!_modelToEyeTransform->invert(*_eyeToModelTransform))
-                {
-                    notify(WARN)<<"Warning: Camera::attachTransform() failed to invert _modelToEyeTransform"<<std::endl;
-                }
-            }
-            else
-            {
-                _attachedTransformMode = NO_ATTACHED_TRANSFORM;
-                _modelToEyeTransform = NULL;
+                OSG_NOTIFY(WARN)<<"Warning: Camera::attachTransform() failed to invert _modelToEyeTransform"<<std::endl;
             }
         }
         break;
     case(MODEL_TO_EYE):
         {
+            _attachedTransformMode = mode;
             _modelToEyeTransform = matrix;
-            if (_modelToEyeTransform.valid())
+            if (!_eyeToModelTransform.invert(_modelToEyeTransform))
             {
-                _attachedTransformMode = mode;
-                if (!_eyeToModelTransform.valid()) _eyeToModelTransform = osgNew Matrix;
-                if (!_eyeToModelTransform->invert(*_modelToEyeTransform))
-                {
-                    notify(WARN)<<"Warning: Camera::attachTransform() failed to invert _modelToEyeTransform"<<std::endl;
-                }
-            }
-            else
-            {
-                _attachedTransformMode = NO_ATTACHED_TRANSFORM;
-                _eyeToModelTransform = NULL;
+                OSG_NOTIFY(WARN)<<"Warning: Camera::attachTransform() failed to invert _modelToEyeTransform"<<std::endl;
             }
         }
         break;
     case(NO_ATTACHED_TRANSFORM):
         _attachedTransformMode = NO_ATTACHED_TRANSFORM;
-        _eyeToModelTransform =  NULL;
-        _modelToEyeTransform = NULL;
         break;
     default: 
         _attachedTransformMode = NO_ATTACHED_TRANSFORM;
-        notify(WARN)<<"Warning: invalid TransformMode pass to osg::Camera::attachTransform(..)"<<std::endl;
-        notify(WARN)<<"         setting Camera to NO_ATTACHED_TRANSFORM."<<std::endl;
+        OSG_NOTIFY(WARN)<<"Warning: invalid TransformMode pass to osg::Camera::attachTransform(..)"<<std::endl;
+        OSG_NOTIFY(WARN)<<"         setting Camera to NO_ATTACHED_TRANSFORM."<<std::endl;
         break;
     }
 }
 
-Matrix* Camera::getTransform(const TransformMode mode)
+const bool Camera::getTransform(const TransformMode mode, Matrixd& matrix) const
 {
-    switch(mode)
+    if (_attachedTransformMode==NO_ATTACHED_TRANSFORM) return false;
+    if (mode!=EYE_TO_MODEL && mode!=MODEL_TO_EYE) return false;
+
+    if (_attachedTransform.valid())
     {
-    case(EYE_TO_MODEL): return _eyeToModelTransform.get();
-    case(MODEL_TO_EYE): return _modelToEyeTransform.get();
-    default: return NULL;
+        // a shared transform may have changed since it was attached, so the
+        // other direction is inverted from it each time.
+        if (mode==_attachedTransformMode) matrix = *_attachedTransform;
+        else matrix.invert(Matrixd(*_attachedTransform));
+        return true;
     }
+
+    matrix = mode==EYE_TO_MODEL ? _eyeToModelTransform : _modelToEyeTransform;
+    return true;
 }
 
-const Matrix* Camera::getTransform(const TransformMode mode) const
+
+const Vec3d Camera::getRenderOrigin() const
 {
-    switch(mode)
+    Matrixd eyeToModelTransform;
+    if (_lookAtType==USE_HOME_POSITON)
     {
-    case(EYE_TO_MODEL): return _eyeToModelTransform.get();
-    case(MODEL_TO_EYE): return _modelToEyeTransform.get();
-    default: return NULL;
+        if (getTransform(EYE_TO_MODEL,eyeToModelTransform)) return eyeToModelTransform.getTrans();
+        else return Vec3d(0.0,0.0,0.0);
     }
-}
 
+    if (getTransform(EYE_TO_MODEL,eyeToModelTransform)) return _eye*eyeToModelTransform;
+    else return _eye;
+}
 
 const Matrix Camera::getModelViewMatrix() const
 {
-    Matrix modelViewMatrix;
+    if (!_cameraRelative) return getModelViewMatrixd();
+
+    // compose in double, then move the origin to the eye so that the large
+    // translations cancel before the result is narrowed to float.
+    Matrixd modelViewMatrix(getModelViewMatrixd());
+    modelViewMatrix.preMult(Matrixd::translate(getRenderOrigin()));
+    return modelViewMatrix;
+}
+
+const Matrixd Camera::getModelViewMatrixd() const
+{
+    Matrixd modelViewMatrix;
+    Matrixd modelToEyeTransform;
 
     // set up the model view matrix.
     switch(_lookAtType)
     {
     case(USE_HOME_POSITON):
         {
-            if (_eyeToModelTransform.valid()) 
-                modelViewMatrix.invert(*_eyeToModelTransform);
-            else if (_modelToEyeTransform.valid())
-                modelViewMatrix = *_modelToEyeTransform;
+            // a copied transform is kept in both directions, so the model
+            // to eye transform is used without inverting it.
+            if (getTransform(MODEL_TO_EYE,modelToEyeTransform))
+                modelViewMatrix = modelToEyeTransform;
             else
                 modelViewMatrix.makeIdentity();
         }
@@ -456,15 +487,10 @@ const Matrix Camera::getModelViewMatrix() const
     case(USE_EYE_CENTER_AND_UP):
     default:
         {
-            if (_eyeToModelTransform.valid()) 
-            {
-                modelViewMatrix.invert(*_eyeToModelTransform);
-                modelViewMatrix.postMult(Matrix::lookAt(_eye,_center,_up));
-            }
-            else if (_modelToEyeTransform.valid())
+            if (getTransform(MODEL_TO_EYE,modelToEyeTransform))
             {
                 modelViewMatrix.makeLookAt(_eye,_center,_up);
-                modelViewMatrix.preMult(*_modelToEyeTransform);
+                modelViewMatrix.preMult(modelToEyeTransform);
             }
             else
                 modelViewMatrix.makeLookAt(_eye,_center,_up);
@@ -487,8 +513,8 @@ const float Camera::getFusionDistance() const
 
 void Camera::ensureOrthogonalUpVector()
 {
-    Vec3 lv = _center-_eye;
-    Vec3 sv = lv^_up;
+    Vec3d lv = _center-_eye;
+    Vec3d sv = lv^_up;
     _up = sv^lv;
     _up.normalize();
 }
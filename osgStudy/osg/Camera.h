@@ -9,6 +9,7 @@
 #include <osg/ref_ptr.h>
 #include <osg/Referenced.h>
 #include <osg/Matrix.h>
+#include <osg/RefMatrix.h>
 #include <osg/Quat.h>
 #include <osg/Viewport.h>
 #include <osg/DisplaySettings.h>
@@ -158,9 +159,9 @@ class SG_EXPORT Camera: public osg::Referenced
         /** set the position and orientation of the camera, using the same convention as
           * gluLookAt.
           */
-        void setLookAt(const Vec3& eye,
-                       const Vec3& center,
-                       const Vec3& up);
+        void setLookAt(const Vec3d& eye,
+                       const Vec3d& center,
+                       const Vec3d& up);
         
         /** set the position and orientation of the camera, using the same convention as
           * gluLookAt.
@@ -171,18 +172,18 @@ class SG_EXPORT Camera: public osg::Referenced
         
         /** post multiple the existing eye point and orientation by matrix.
           * note, does not affect any ModelTransforms that are applied.*/
-        void transformLookAt(const Matrix& matrix);
+        void transformLookAt(const Matrixd& matrix);
         
         void ensureOrthogonalUpVector();        
 
         /** get the eye point. */
-        inline const Vec3& getEyePoint() const      { return _eye; }
+        inline const Vec3d& getEyePoint() const     { return _eye; }
 
         /** get the center point. */
-        inline const Vec3& getCenterPoint() const   { return _center; }
+        inline const Vec3d& getCenterPoint() const  { return _center; }
 
         /** get the up vector */
-        inline const Vec3& getUpVector() const      { return _up; }
+        inline const Vec3d& getUpVector() const     { return _up; }
 
         /** calculate look vector.*/
         const Vec3 getLookVector() const;
@@ -214,13 +215,26 @@ class SG_EXPORT Camera: public osg::Referenced
           * default direction is along the y axis, unlike OpenGL and the default OSG.
           * If modelTransfor is NULL then do not use any model transform - just use the
           * basic LookAt values.
-          * note: Camera internals maintains the both EYE_TO_MODEL and MODEL_TO_EYE
-          * internally and ensures that they are the inverse of one another.*/
-        void attachTransform(const TransformMode mode, Matrix* modelTransform=0);
+          * The camera holds a reference to modelTransform, so changes made to it
+          * later are tracked, at the cost of inverting it each time the other
+          * direction is needed.*/
+        void attachTransform(const TransformMode mode, RefMatrix* modelTransform=0);
 
-        Matrix* getTransform(const TransformMode mode);
-        
-        const Matrix* getTransform(const TransformMode mode) const;
+        /** Attach a copy of a double precision transform, see attachTransform(TransformMode,RefMatrix*).
+          * Later changes to modelTransform are not tracked, instead both directions
+          * are kept, inverted once here. Use for transforms that carry large world
+          * coordinates, or that change less often than the model view matrix is read.*/
+        void attachTransform(const TransformMode mode, const Matrixd& modelTransform);
+
+        /** Get the transform attached by reference, NULL if none is or it was copied.*/
+        RefMatrix* getAttachedTransform() { return _attachedTransform.get(); }
+
+        /** Get the transform attached by reference, NULL if none is or it was copied.*/
+        const RefMatrix* getAttachedTransform() const { return _attachedTransform.get(); }
+
+        /** Get the attached transform in the direction given by mode, whether it was
+          * attached by reference or copied. Return false if no transform is attached.*/
+        const bool getTransform(const TransformMode mode, Matrixd& matrix) const;
 
         
         
@@ -260,6 +274,21 @@ class SG_EXPORT Camera: public osg::Referenced
 
 
         
+        /** Set whether getModelViewMatrix() is camera relative.
+          * In camera relative mode the model view matrix is composed in double
+          * precision and the render origin, see getRenderOrigin(), is folded
+          * back out of it, so the float matrix that is returned only holds
+          * eye relative offsets. Geometry must then be supplied relative to the
+          * render origin. Use this for scenes whose coordinates are too large
+          * for float, which otherwise jitter as the eye moves. Default is false.*/
+        void setCameraRelative(bool flag) { _cameraRelative = flag; }
+
+        /** Get whether getModelViewMatrix() is camera relative.*/
+        bool getCameraRelative() const { return _cameraRelative; }
+
+        /** Get the render origin, the eye point in model coordinates.*/
+        const Vec3d getRenderOrigin() const;
+
         /** Get the Projection Matrix.*/
         const Matrix getProjectionMatrix() const;
 
@@ -267,9 +296,16 @@ class SG_EXPORT Camera: public osg::Referenced
           * If a ModelTransform is supplied then the ModelView matrix is
           * created by multiplying the current LookAt by ModelTransform.
           * Otherwise it is simply created by using the current LookAt,
-          * equivalent to using gluLookAt.*/
+          * equivalent to using gluLookAt.
+          * If camera relative mode is on the result is relative to
+          * getRenderOrigin(), see setCameraRelative(bool).*/
         const Matrix getModelViewMatrix() const;
 
+        /** Get the ModelView matrix in double precision, never camera relative.
+          * Use it to compose with double precision model transforms before
+          * converting to float.*/
+        const Matrixd getModelViewMatrixd() const;
+
 
 
 
@@ -302,13 +338,16 @@ class SG_EXPORT Camera: public osg::Referenced
         // look at details.
         LookAtType      _lookAtType;
         
-        Vec3            _eye;
-        Vec3            _center;
-        Vec3            _up;
+        Vec3d           _eye;
+        Vec3d           _center;
+        Vec3d           _up;
         
-        TransformMode   _attachedTransformMode;
-        ref_ptr<Matrix> _eyeToModelTransform;
-        ref_ptr<Matrix> _modelToEyeTransform;
+        TransformMode       _attachedTransformMode;
+        ref_ptr<RefMatrix>  _attachedTransform;
+        Matrixd             _eyeToModelTransform;
+        Matrixd             _modelToEyeTransform;
+
+        bool            _cameraRelative;
 
         float               _screenDistance;
         
@@ -0,0 +1,208 @@
+#include <osg/FrameArena.h>
+#include <osg/FrameStamp.h>
+
+using namespace osg;
+
+namespace
+{
+
+/** Put in front of each object created with META_ArenaAllocated, ALIGNMENT
+  * bytes long so that the object stays aligned. _liveObjects is the arena's
+  * FrameArena::LiveObjects, 0 for heap objects.*/
+struct ObjectHeader
+{
+    void* _liveObjects;
+};
+
+const size_t s_objectHeaderSize = FrameArena::ALIGNMENT;
+
+}
+
+FrameArena::FrameArena(size_t blockSize):
+    _currentBlock(0),
+    _ptr(0),
+    _end(0),
+    _blockSize(blockSize),
+    _liveObjects(osgNew LiveObjects),
+    _numAllocations(0),
+    _numBlockAllocations(0),
+    _frameNumber(-1)
+{
+    _liveObjects->_count = 0;
+}
+
+FrameArena::~FrameArena()
+{
+    if (_liveObjects->_count>0)
+    {
+        // the objects still alive are in the blocks, the last one deleted frees them.
+        _liveObjects->_orphanedBlocks.swap(_blocks);
+        return;
+    }
+    deleteBlocks(_blocks);
+    osgDelete _liveObjects;
+}
+
+void FrameArena::deleteBlocks(BlockList& blocks)
+{
+    for(BlockList::iterator itr=blocks.begin();itr!=blocks.end();++itr)
+    {
+        osgDelete [] itr->_data;
+    }
+    blocks.clear();
+}
+
+void* FrameArena::allocateFromNextBlock(size_t size)
+{
+    // move on to the next block big enough, blocks skipped stay unused until the next reset.
+    if (!_blocks.empty()) ++_currentBlock;
+    while (_currentBlock<_blocks.size() && _blocks[_currentBlock]._size<size) ++_currentBlock;
+
+    if (_currentBlock>=_blocks.size())
+    {
+        Block block;
+        block._size = size>_blockSize ? size : _blockSize;
+        block._data = osgNew char[block._size+ALIGNMENT];
+        _blocks.push_back(block);
+        _currentBlock = _blocks.size()-1;
+        ++_numBlockAllocations;
+    }
+
+    // new[] only guarantees the alignment of the largest fundamental type.
+    Block& block = _blocks[_currentBlock];
+    _ptr = (char*)(((size_t)block._data+ALIGNMENT-1)&~(size_t)(ALIGNMENT-1));
+    _end = _ptr+block._size;
+
+    void* ptr = _ptr;
+    _ptr += size;
+    return ptr;
+}
+
+bool FrameArena::reset()
+{
+    if (_liveObjects->_count>0) return false;
+
+    _currentBlock = 0;
+    _ptr = 0;
+    _end = 0;
+    if (!_blocks.empty())
+    {
+        _ptr = (char*)(((size_t)_blocks[0]._data+ALIGNMENT-1)&~(size_t)(ALIGNMENT-1));
+        _end = _ptr+_blocks[0]._size;
+    }
+    _numAllocations = 0;
+    return true;
+}
+
+bool FrameArena::resetIfNewFrame(const FrameStamp* frameStamp)
+{
+    if (!frameStamp || frameStamp->getFrameNumber()==_frameNumber) return false;
+    _frameNumber = frameStamp->getFrameNumber();
+    return reset();
+}
+
+size_t FrameArena::getBytesUsed() const
+{
+    if (_blocks.empty()) return 0;
+
+    size_t bytesUsed = 0;
+    for(unsigned int i=0;i<_currentBlock;++i) bytesUsed += _blocks[i]._size;
+    return bytesUsed+(_ptr-(_end-_blocks[_currentBlock]._size));
+}
+
+size_t FrameArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for(BlockList::const_iterator itr=_blocks.begin();itr!=_blocks.end();++itr) capacity += itr->_size;
+    return capacity;
+}
+
+void* FrameArena::allocateObject(size_t size,FrameArena* arena)
+{
+    char* memory;
+    if (arena)
+    {
+        memory = (char*)arena->allocate(s_objectHeaderSize+size);
+        ++arena->_liveObjects->_count;
+        ((ObjectHeader*)memory)->_liveObjects = arena->_liveObjects;
+    }
+    else
+    {
+        memory = (char*)::operator new(s_objectHeaderSize+size);
+        ((ObjectHeader*)memory)->_liveObjects = 0;
+    }
+    return memory+s_objectHeaderSize;
+}
+
+void FrameArena::deallocateObject(void* ptr)
+{
+    if (!ptr) return;
+
+    char* memory = (char*)ptr-s_objectHeaderSize;
+    LiveObjects* liveObjects = (LiveObjects*)((ObjectHeader*)memory)->_liveObjects;
+    if (!liveObjects)
+    {
+        ::operator delete(memory);
+        return;
+    }
+
+    // the last object of a destroyed arena frees its blocks, memory among them.
+    if (--liveObjects->_count==0 && !liveObjects->_orphanedBlocks.empty())
+    {
+        deleteBlocks(liveObjects->_orphanedBlocks);
+        osgDelete liveObjects;
+    }
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/LineSegment.h>
+#include <osg/ref_ptr.h>
+#include <iostream>
+
+/** Run numFrames frames, each creating numSegments line segment pairs in an
+  * arena held in an arena allocated vector, as an IntersectVisitor does. Check
+  * that the arena stops allocating blocks after the first frame, that it
+  * refuses to reset while an object from it is alive, and that such an object
+  * may outlive the arena.*/
+void test_FrameArena(unsigned int numFrames, unsigned int numSegments)
+{
+    typedef std::pair< ref_ptr<LineSegment>,ref_ptr<LineSegment> > LineSegmentPair;
+    typedef std::vector< LineSegmentPair,FrameArena::Allocator<LineSegmentPair> > LineSegmentList;
+
+    FrameArena arena(4096);
+    bool passed = true;
+    unsigned int blocksAfterFirstFrame = 0;
+    for(unsigned int frame=0;frame<numFrames;++frame)
+    {
+        {
+            LineSegmentList segments((FrameArena::Allocator<LineSegmentPair>(&arena)));
+            for(unsigned int i=0;i<numSegments;++i)
+            {
+                LineSegment* local = new (arena) LineSegment(Vec3(0.0f,0.0f,(float)i),Vec3(1.0f,0.0f,(float)i));
+                segments.push_back(LineSegmentPair(local,local));
+            }
+            passed = passed && arena.getNumLiveObjects()==numSegments && !arena.reset();
+        }
+        passed = passed && arena.getNumLiveObjects()==0 && arena.reset();
+        if (frame==0) blocksAfterFirstFrame = arena.getNumBlockAllocations();
+    }
+    passed = passed && arena.getNumBlockAllocations()==blocksAfterFirstFrame;
+
+    ref_ptr<LineSegment> survivor;
+    {
+        FrameArena shortArena;
+        survivor = new (shortArena) LineSegment(Vec3(0.0f,0.0f,0.0f),Vec3(1.0f,0.0f,0.0f));
+    }
+    passed = passed && survivor->end()==Vec3(1.0f,0.0f,0.0f);
+    survivor = 0;
+
+    // heap objects of an arena allocated class are unaffected.
+    ref_ptr<LineSegment> heapSegment = osgNew LineSegment;
+    heapSegment = 0;
+
+    std::cout<<"FrameArena "<<numFrames<<" frames x "<<numSegments<<" segments, "<<arena.getNumBlockAllocations()
+             <<" block allocations, capacity "<<arena.getCapacity()/1024<<"k"<<(passed?"  OK":"  FAILED")<<std::endl;
+}
+
+#endif
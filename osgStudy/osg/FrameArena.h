@@ -0,0 +1,155 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_FRAMEARENA
+#define OSG_FRAMEARENA 1
+
+#include <osg/Export.h>
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+namespace osg {
+
+class FrameStamp;
+
+/** META_ArenaAllocated macro defines class operator new and delete which let
+  * the class be created in a FrameArena with new (arena) T(..), as well as on
+  * the heap with plain new. Deleting an object made in an arena, typically
+  * through the last unref(), only runs its destructor, the memory is released
+  * by the arena's next reset(). Objects still alive when their arena is
+  * destroyed keep its blocks until the last of them is deleted.*/
+#define META_ArenaAllocated \
+        static void* operator new(size_t size) { return osg::FrameArena::allocateObject(size,0); } \
+        static void* operator new(size_t size,osg::FrameArena& arena) { return osg::FrameArena::allocateObject(size,&arena); } \
+        static void operator delete(void* ptr) { osg::FrameArena::deallocateObject(ptr); } \
+        static void operator delete(void* ptr,osg::FrameArena&) { osg::FrameArena::deallocateObject(ptr); }
+
+/** Linear allocator for data which lives for one frame or one traversal, such
+  * as the states and transformed line segments of an IntersectVisitor.
+  * Allocation bumps a pointer through a list of blocks, reset() releases
+  * everything at once and keeps the blocks, so once the arena has grown to the
+  * size of a frame no more heap allocations are made.
+  * An arena must only be used by one thread at a time.*/
+class SG_EXPORT FrameArena
+{
+    public:
+
+        enum { ALIGNMENT = 16 };
+
+        FrameArena(size_t blockSize=65536);
+        ~FrameArena();
+
+        /** Return size bytes, aligned to ALIGNMENT, valid until reset().*/
+        inline void* allocate(size_t size)
+        {
+            size = (size+ALIGNMENT-1)&~(size_t)(ALIGNMENT-1);
+            ++_numAllocations;
+            if (size<=(size_t)(_end-_ptr))
+            {
+                void* ptr = _ptr;
+                _ptr += size;
+                return ptr;
+            }
+            return allocateFromNextBlock(size);
+        }
+
+        /** Release all the allocations, rewinding to the first block. Returns
+          * false, releasing nothing, while objects created with
+          * META_ArenaAllocated's new (arena) are still alive.*/
+        bool reset();
+
+        /** reset() if frameStamp is from a different frame than the previous
+          * call, ties the arena to the frames of a viewer.*/
+        bool resetIfNewFrame(const FrameStamp* frameStamp);
+
+        /** Return the number of objects created in the arena and not deleted yet.*/
+        unsigned int getNumLiveObjects() const { return _liveObjects->_count; }
+
+        /** Return the number of allocations since the last reset().*/
+        unsigned int getNumAllocations() const { return _numAllocations; }
+
+        /** Return the number of heap allocations the arena made for its blocks since construction.*/
+        unsigned int getNumBlockAllocations() const { return _numBlockAllocations; }
+
+        /** Return the bytes allocated since the last reset, including alignment.*/
+        size_t getBytesUsed() const;
+
+        /** Return the total size of the blocks.*/
+        size_t getCapacity() const;
+
+        /** Used by META_ArenaAllocated.*/
+        static void* allocateObject(size_t size,FrameArena* arena);
+        static void deallocateObject(void* ptr);
+
+        /** STL allocator taking its memory from an arena, or from the heap when
+          * constructed without one. Deallocating arena memory does nothing,
+          * the containers using it must be destroyed before the arena is reset.*/
+        template<class T>
+        class Allocator
+        {
+            public:
+                typedef T value_type;
+
+                Allocator(FrameArena* arena=0) : _arena(arena) {}
+                template<class U> Allocator(const Allocator<U>& rhs) : _arena(rhs.getArena()) {}
+
+                T* allocate(size_t n)
+                {
+                    if (_arena) return static_cast<T*>(_arena->allocate(n*sizeof(T)));
+                    return static_cast<T*>(::operator new(n*sizeof(T)));
+                }
+                void deallocate(T* ptr,size_t)
+                {
+                    if (!_arena) ::operator delete(ptr);
+                }
+
+                FrameArena* getArena() const { return _arena; }
+
+                template<class U> bool operator == (const Allocator<U>& rhs) const { return _arena==rhs.getArena(); }
+                template<class U> bool operator != (const Allocator<U>& rhs) const { return _arena!=rhs.getArena(); }
+
+            protected:
+                FrameArena* _arena;
+        };
+
+    protected:
+
+        FrameArena(const FrameArena&);
+        FrameArena& operator = (const FrameArena&);
+
+        void* allocateFromNextBlock(size_t size);
+
+        struct Block
+        {
+            char*   _data;
+            size_t  _size;
+        };
+        typedef std::vector<Block> BlockList;
+
+        /** Count of the live objects, referenced by each of them so that it
+          * outlives the arena, and takes over the blocks, while any is alive.*/
+        struct LiveObjects
+        {
+            unsigned int    _count;
+            BlockList       _orphanedBlocks;
+        };
+
+        static void deleteBlocks(BlockList& blocks);
+
+        BlockList       _blocks;
+        unsigned int    _currentBlock;
+        char*           _ptr;
+        char*           _end;
+        size_t          _blockSize;
+        LiveObjects*    _liveObjects;
+        unsigned int    _numAllocations;
+        unsigned int    _numBlockAllocations;
+        int             _frameNumber;
+};
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <osg/Node.h>
 #include <osg/NodeVisitor.h>
+#include <osg/BoundingVolumeHierarchy.h>
 
 namespace osg {
 
@@ -107,6 +108,44 @@ class SG_EXPORT Group : public Node
             return _children.end();
         }
 
+        /** Set the bounding volume hierarchy over the children, which visitors
+          * that cull or pick walk in place of testing every child. Worth having
+          * for wide groups only, by default there is none. As it is walked in
+          * place of traverse() it is only walked for the groups which traverse
+          * all of their children, see BoundingVolumeHierarchy::traversesAllChildren(),
+          * others such as Switch and LOD are traversed as without one.*/
+        inline void setBoundingVolumeHierarchy(BoundingVolumeHierarchy* bvh)
+        {
+            _boundingVolumeHierarchy = bvh;
+            if (bvh) bvh->dirty();
+        }
+
+        inline BoundingVolumeHierarchy* getBoundingVolumeHierarchy() { return _boundingVolumeHierarchy.get(); }
+
+        inline const BoundingVolumeHierarchy* getBoundingVolumeHierarchy() const { return _boundingVolumeHierarchy.get(); }
+
+        /** Bring the bounding volume hierarchy up to date with the children and
+          * walk it with cellVisitor, see BoundingVolumeHierarchy::update() for
+          * calling it from several threads and BoundingVolumeHierarchy::accept().
+          * Return false if there is none, or the group selects which children it
+          * traverses, in which case nothing is visited.*/
+        template<class CellVisitor>
+        bool acceptBoundingVolumeHierarchy(CellVisitor& cellVisitor)
+        {
+            if (!_boundingVolumeHierarchy.valid() || !BoundingVolumeHierarchy::traversesAllChildren(*this)) return false;
+            _boundingVolumeHierarchy->update(_children);
+            _boundingVolumeHierarchy->accept(cellVisitor,_children);
+            return true;
+        }
+
+        /** Mark this group's bounding sphere dirty, and its bounding volume
+          * hierarchy for checking every child, as addChild() and alike need.*/
+        virtual void dirtyBound()
+        {
+            if (_boundingVolumeHierarchy.valid()) _boundingVolumeHierarchy->dirty();
+            Node::dirtyBound();
+        }
+
     protected:
 
         virtual ~Group();
@@ -115,6 +154,8 @@ class SG_EXPORT Group : public Node
 
         ChildList _children;
 
+        ref_ptr<BoundingVolumeHierarchy> _boundingVolumeHierarchy;
+
 
 };
 
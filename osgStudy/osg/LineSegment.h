@@ -8,6 +8,7 @@
 #include <osg/Matrix.h>
 #include <osg/BoundingBox.h>
 #include <osg/BoundingSphere.h>
+#include <osg/FrameArena.h>
 
 namespace osg {
 
@@ -22,6 +23,10 @@ class SG_EXPORT LineSegment : public Referenced
 
         LineSegment& operator = (const LineSegment& seg) { _s = seg._s;  _e = seg._e; return *this; }
 
+        /** Transformed copies of segments made during a traversal can be created in a FrameArena,
+          * those kept after it, such as a Hit's local segment, must be created on the heap.*/
+        META_ArenaAllocated
+
         inline void set(const Vec3& s,const Vec3& e) { _s=s; _e=e; }
         
         inline Vec3& start() { return _s; }
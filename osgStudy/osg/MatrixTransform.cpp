@@ -4,29 +4,113 @@ using namespace osg;
 
 MatrixTransform::MatrixTransform()
 {
-    _matrix = osgNew Matrix;
-    _inverse = osgNew Matrix;
-    _inverseDirty = false;
+    _inverseState = INVERSE_VALID;
 }
 
 MatrixTransform::MatrixTransform(const MatrixTransform& transform,const CopyOp& copyop):
     Transform(transform,copyop),
-    _matrix(osgNew Matrix(*transform._matrix)),
-    _inverse(osgNew Matrix(*transform._inverse)),
-    _inverseDirty(transform._inverseDirty)
+    _matrix(transform._matrix),
+    _inverse(transform._inverse),
+    _inverseState(transform._inverseState.load()==INVERSE_VALID ? INVERSE_VALID : INVERSE_DIRTY)
 {    
 }
 
-MatrixTransform::MatrixTransform(const Matrix& mat )
+MatrixTransform::MatrixTransform(const Matrix& mat ):
+    _matrix(mat)
 {
     _referenceFrame = RELATIVE_TO_PARENTS;
 
-    _matrix = osgNew Matrix(mat);
-    _inverse = osgNew Matrix();
-    _inverseDirty = false;
+    dirtyInverse();
 }
 
 
 MatrixTransform::~MatrixTransform()
 {
 }
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <math.h>
+
+static bool equivalent(const Matrix& lhs,const Matrix& rhs)
+{
+    for(int row=0;row<4;++row)
+    {
+        for(int col=0;col<4;++col)
+        {
+            if (fabs(lhs(row,col)-rhs(row,col))>1e-4*(1.0+fabs(rhs(row,col)))) return false;
+        }
+    }
+    return true;
+}
+
+static bool checkInverse(const char* step,const MatrixTransform& transform)
+{
+    Matrix expected = Matrix::inverse(transform.getMatrix());
+    Matrix worldToLocal;
+    transform.computeWorldToLocalMatrix(worldToLocal,0);
+    bool passed = equivalent(transform.getInverseMatrix(),expected) && equivalent(worldToLocal,expected);
+    if (!passed) std::cout<<"  "<<step<<" FAILED"<<std::endl;
+    return passed;
+}
+
+static void worldToLocalLoop(const MatrixTransform* transform,const Matrix* expected,std::atomic<unsigned int>* numFailed)
+{
+    // classifying the matrix here races the thread inverting it, unless the cache is atomic.
+    Matrix::Classification classification = transform->getMatrix().getClassification();
+    Matrix worldToLocal;
+    transform->computeWorldToLocalMatrix(worldToLocal,0);
+    if (classification==Matrix::UNCLASSIFIED) numFailed->fetch_add(1);
+    if (!equivalent(worldToLocal,*expected)) numFailed->fetch_add(1);
+}
+
+/** Check that the lazily computed inverse matches Matrix::inverse() after
+  * construction, setMatrix(), preMult() and postMult(), is computed once per
+  * change, and is computed once when numThreads traversals ask for it at once.*/
+void test_MatrixTransform_inverse(unsigned int numThreads)
+{
+    bool passed = true;
+    Transform::resetInverseStats();
+
+    ref_ptr<MatrixTransform> transform = osgNew MatrixTransform(Matrix::rotate(0.5f,0.0f,0.0f,1.0f)*Matrix::translate(1.0f,2.0f,3.0f));
+    passed = checkInverse("constructor",*transform) && passed;
+
+    transform->setMatrix(Matrix::scale(2.0f,3.0f,4.0f)*Matrix::translate(-5.0f,0.0f,1.0f));
+    passed = checkInverse("setMatrix",*transform) && passed;
+
+    transform->preMult(Matrix::rotate(1.0f,0.0f,1.0f,0.0f));
+    passed = checkInverse("preMult",*transform) && passed;
+
+    transform->postMult(Matrix::translate(0.0f,7.0f,0.0f));
+    transform->postMult(Matrix::rotate(-0.3f,1.0f,0.0f,0.0f));
+    passed = checkInverse("postMult",*transform) && passed;
+
+    // two changes before one use, a single inversion.
+    if (Transform::getInverseStats()._numComputed!=4 || Transform::getInverseStats().getNumAvoided()!=1)
+    {
+        std::cout<<"  computed "<<Transform::getInverseStats()._numComputed<<" inverses, expected 4 FAILED"<<std::endl;
+        passed = false;
+    }
+
+    transform->setMatrix(Matrix::rotate(0.7f,1.0f,1.0f,0.0f)*Matrix::translate(3.0f,-2.0f,1.0f));
+    Matrix expected = Matrix::inverse(transform->getMatrix());
+    std::atomic<unsigned int> numFailed(0);
+    std::vector<std::thread> threads;
+    for(unsigned int t=0;t<numThreads;++t)
+    {
+        threads.push_back(std::thread(worldToLocalLoop,transform.get(),&expected,&numFailed));
+    }
+    for(unsigned int t=0;t<threads.size();++t) threads[t].join();
+    if (numFailed!=0 || Transform::getInverseStats()._numComputed!=5)
+    {
+        std::cout<<"  "<<numThreads<<" threads, "<<numFailed<<" wrong inverses, "<<Transform::getInverseStats()._numComputed<<" computed FAILED"<<std::endl;
+        passed = false;
+    }
+
+    std::cout<<"MatrixTransform lazy inverse "<<(passed ? "OK" : "FAILED")<<std::endl;
+}
+
+#endif
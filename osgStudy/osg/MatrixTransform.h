@@ -40,39 +40,43 @@ class SG_EXPORT MatrixTransform : public Transform
         META_Node(osg, MatrixTransform);
 
         /** Set the transform's matrix.*/
-        void setMatrix(const Matrix& mat) { (*_matrix) = mat; _inverseDirty=true; computeInverse(); dirtyBound(); }
+        void setMatrix(const Matrix& mat) { _matrix = mat; dirtyInverse(); dirtyBound(); }
         
         /** Get the transform's matrix. */
-        inline const Matrix& getMatrix() const { return *_matrix; }
+        inline const Matrix& getMatrix() const { return _matrix; }
+
+        /** Get the inverse of the transform's matrix, computing it if the matrix has changed.*/
+        inline const Matrix& getInverseMatrix() const { computeInverse(); return _inverse; }
 
         /** preMult transform.*/
-        void preMult(const Matrix& mat) { _matrix->preMult(mat); _inverseDirty=true; computeInverse(); dirtyBound(); }
+        void preMult(const Matrix& mat) { _matrix.preMult(mat); dirtyInverse(); dirtyBound(); }
         
         /** postMult transform.*/
-        void postMult(const Matrix& mat)  { _matrix->postMult(mat); _inverseDirty=true; computeInverse(); dirtyBound(); }
+        void postMult(const Matrix& mat)  { _matrix.postMult(mat); dirtyInverse(); dirtyBound(); }
     
         virtual const bool computeLocalToWorldMatrix(Matrix& matrix,NodeVisitor*) const
         {
             if (_referenceFrame==RELATIVE_TO_PARENTS)
             {
-                matrix.preMult(*_matrix);
+                matrix.preMult(_matrix);
             }
             else // absolute
             {
-                matrix = *_matrix;
+                matrix = _matrix;
             }
             return true;
         }
 
         virtual const bool computeWorldToLocalMatrix(Matrix& matrix,NodeVisitor*) const
         {
+            computeInverse();
             if (_referenceFrame==RELATIVE_TO_PARENTS)
             {
-                matrix.postMult(*_inverse);
+                matrix.postMult(_inverse);
             }
             else // absolute
             {
-                matrix = *_inverse;
+                matrix = _inverse;
             }
             return true;
         }
@@ -81,18 +85,13 @@ class SG_EXPORT MatrixTransform : public Transform
     
         virtual ~MatrixTransform();
         
-        inline void computeInverse() const
-        {
-            if (_inverseDirty)
-            {
-                _inverse->invert(*_matrix);
-                _inverseDirty = false;
-            }
-        }
+        inline void dirtyInverse() { dirtyLazyInverse(_inverseState); }
+
+        inline void computeInverse() const { computeLazyInverse(_matrix,_inverse,_inverseState); }
 
-        ref_ptr<Matrix>                     _matrix;
-        mutable ref_ptr<Matrix>             _inverse;
-        mutable bool                        _inverseDirty;        
+        Matrix                              _matrix;
+        mutable Matrix                      _inverse;
+        mutable std::atomic<unsigned char>  _inverseState;
 
 };
 
@@ -0,0 +1,482 @@
+// Implementation shared by Matrixf and Matrixd.  Not compiled on its own,
+// Matrixf.cpp and Matrixd.cpp each define Matrix_implementation to their
+// class name and include this file, after defining the precision specific
+// kernels mult_4x4(), mult_translate_lhs() and mult_translate_rhs().
+// Defining MATRIX_INVERT_4X4_KERNEL selects a replacement for the
+// Gauss-Jordan fallback of invert_4x4().
+
+#include <osg/Quat.h>
+#include <osg/Notify.h>
+#include <osg/Types.h>
+#include <osg/Math.h>
+
+#include <stdlib.h>
+
+using namespace osg;
+
+typedef Matrix_implementation::value_type value_type;
+
+#define SET_ROW(row, v1, v2, v3, v4 )    \
+    _mat[(row)][0] = (v1); \
+    _mat[(row)][1] = (v2); \
+    _mat[(row)][2] = (v3); \
+    _mat[(row)][3] = (v4);
+
+
+
+
+Matrix_implementation::Matrix_implementation()
+{
+    makeIdentity();
+}
+
+Matrix_implementation::Matrix_implementation( const Matrix_implementation& other)
+{
+    set( other );
+}
+
+Matrix_implementation::Matrix_implementation( const value_type * const def )
+{    
+    set( def ); 
+}
+
+Matrix_implementation::Matrix_implementation( value_type a00, value_type a01, value_type a02, value_type a03,
+                value_type a10, value_type a11, value_type a12, value_type a13,
+                value_type a20, value_type a21, value_type a22, value_type a23,
+                value_type a30, value_type a31, value_type a32, value_type a33)
+{
+    SET_ROW(0, a00, a01, a02, a03 )
+    SET_ROW(1, a10, a11, a12, a13 )
+    SET_ROW(2, a20, a21, a22, a23 )
+    SET_ROW(3, a30, a31, a32, a33 )
+    storeClassification(UNCLASSIFIED);
+}
+
+void Matrix_implementation::set( value_type a00, value_type a01, value_type a02, value_type a03,
+                  value_type a10, value_type a11, value_type a12, value_type a13,
+                  value_type a20, value_type a21, value_type a22, value_type a23,
+                  value_type a30, value_type a31, value_type a32, value_type a33)
+{
+    SET_ROW(0, a00, a01, a02, a03 )
+    SET_ROW(1, a10, a11, a12, a13 )
+    SET_ROW(2, a20, a21, a22, a23 )
+    SET_ROW(3, a30, a31, a32, a33 )
+    storeClassification(UNCLASSIFIED);
+}
+
+void Matrix_implementation::setTrans( value_type tx, value_type ty, value_type tz )
+{
+    _mat[3][0] = tx;
+    _mat[3][1] = ty;
+    _mat[3][2] = tz;
+    // the translation only decides between identity and translate.
+    if (loadClassification()<=TRANSLATE) storeClassification(UNCLASSIFIED);
+}
+
+
+void Matrix_implementation::setTrans( const Vec3& v )
+{
+    setTrans( v[0], v[1], v[2] );
+}
+
+void Matrix_implementation::makeIdentity()
+{
+    SET_ROW(0,    1, 0, 0, 0 )
+    SET_ROW(1,    0, 1, 0, 0 )
+    SET_ROW(2,    0, 0, 1, 0 )
+    SET_ROW(3,    0, 0, 0, 1 )
+    storeClassification(IDENTITY);
+}
+
+Matrix_implementation::Classification Matrix_implementation::classify() const
+{
+    if (!isAffine()) return PROJECTIVE;
+
+    if (_mat[0][0]==1.0f && _mat[0][1]==0.0f && _mat[0][2]==0.0f &&
+        _mat[1][0]==0.0f && _mat[1][1]==1.0f && _mat[1][2]==0.0f &&
+        _mat[2][0]==0.0f && _mat[2][1]==0.0f && _mat[2][2]==1.0f)
+    {
+        if (_mat[3][0]==0.0f && _mat[3][1]==0.0f && _mat[3][2]==0.0f) return IDENTITY;
+        return TRANSLATE;
+    }
+
+    // rigid if the rows of the upper 3x3 are orthonormal, reflections
+    // included, as the inverse is then just the transpose.
+    const value_type epsilon = 1e-6;
+    for(int i=0;i<3;++i)
+    {
+        for(int j=i;j<3;++j)
+        {
+            value_type dot = _mat[i][0]*_mat[j][0] + _mat[i][1]*_mat[j][1] + _mat[i][2]*_mat[j][2];
+            if (fabs(dot-(i==j?1.0f:0.0f))>epsilon) return AFFINE;
+        }
+    }
+    return RIGID;
+}
+
+void Matrix_implementation::makeScale( const Vec3& v )
+{
+    makeScale(v[0], v[1], v[2] );
+}
+
+void Matrix_implementation::makeScale( value_type x, value_type y, value_type z )
+{
+    SET_ROW(0,    x, 0, 0, 0 )
+    SET_ROW(1,    0, y, 0, 0 )
+    SET_ROW(2,    0, 0, z, 0 )
+    SET_ROW(3,    0, 0, 0, 1 )
+    storeClassification(UNCLASSIFIED);
+}
+
+void Matrix_implementation::makeTranslate( const Vec3& v )
+{
+    makeTranslate( v[0], v[1], v[2] );
+}
+
+void Matrix_implementation::makeTranslate( value_type x, value_type y, value_type z )
+{
+    SET_ROW(0,    1, 0, 0, 0 )
+    SET_ROW(1,    0, 1, 0, 0 )
+    SET_ROW(2,    0, 0, 1, 0 )
+    SET_ROW(3,    x, y, z, 1 )
+    storeClassification((x==0.0f && y==0.0f && z==0.0f) ? IDENTITY : TRANSLATE);
+}
+
+void Matrix_implementation::makeRotate( const Vec3& from, const Vec3& to )
+{
+    Quat quat;
+    quat.makeRotate(from,to);
+    quat.get(*this);
+}
+
+void Matrix_implementation::makeRotate( value_type angle, const Vec3& axis )
+{
+    Quat quat;
+    quat.makeRotate( angle, axis);
+    quat.get(*this);
+}
+
+void Matrix_implementation::makeRotate( value_type angle, value_type x, value_type y, value_type z ) 
+{
+    Quat quat;
+    quat.makeRotate( angle, x, y, z);
+    quat.get(*this);
+}
+
+void Matrix_implementation::makeRotate( const Quat& q )
+{
+    q.get(*this);    
+}
+
+void Matrix_implementation::makeRotate( value_type heading, value_type pitch, value_type roll)
+{
+    Quat quat;
+    quat.makeRotate(heading,pitch,roll);
+    quat.get(*this);
+}
+
+// Multiply lhs by rhs into result, taking the identity and translate only
+// shortcuts when the operands are already known to qualify. Classifying
+// on the spot would cost more than the multiply it could save.
+static inline void mult_classified(value_type* result, const value_type* lhs, Matrix_implementation::Classification lc, const value_type* rhs, Matrix_implementation::Classification rc)
+{
+    if (lc==Matrix_implementation::IDENTITY) { if (result!=rhs) std::copy(rhs,rhs+16,result); }
+    else if (rc==Matrix_implementation::IDENTITY) { if (result!=lhs) std::copy(lhs,lhs+16,result); }
+    else if (lc==Matrix_implementation::TRANSLATE) mult_translate_lhs(result,lhs,rhs);
+    else if (rc==Matrix_implementation::TRANSLATE) mult_translate_rhs(result,lhs,rhs);
+    else mult_4x4(result,lhs,rhs);
+}
+
+static inline Matrix_implementation::Classification product_classification(Matrix_implementation::Classification lc, Matrix_implementation::Classification rc)
+{
+    if (lc==Matrix_implementation::IDENTITY) return rc;
+    if (rc==Matrix_implementation::IDENTITY) return lc;
+    return Matrix_implementation::UNCLASSIFIED;
+}
+
+void Matrix_implementation::mult( const Matrix_implementation& lhs, const Matrix_implementation& rhs )
+{
+    Classification lc = lhs.loadClassification();
+    Classification rc = rhs.loadClassification();
+    mult_classified((value_type*)_mat,(const value_type*)lhs._mat,lc,(const value_type*)rhs._mat,rc);
+    storeClassification(product_classification(lc,rc));
+}
+
+void Matrix_implementation::preMult( const Matrix_implementation& other )
+{
+    // this = other * this
+    Classification lc = other.loadClassification();
+    Classification rc = loadClassification();
+    mult_classified((value_type*)_mat,(const value_type*)other._mat,lc,(const value_type*)_mat,rc);
+    storeClassification(product_classification(lc,rc));
+}
+
+void Matrix_implementation::postMult( const Matrix_implementation& other )
+{
+    // this = this * other
+    Classification lc = loadClassification();
+    Classification rc = other.loadClassification();
+    mult_classified((value_type*)_mat,(const value_type*)_mat,lc,(const value_type*)other._mat,rc);
+    storeClassification(product_classification(lc,rc));
+}
+
+
+template <class T>
+inline T SGL_ABS(T a)
+{
+   return (a >= 0 ? a : -a);
+}
+
+#ifndef SGL_SWAP
+#define SGL_SWAP(a,b,temp) ((temp)=(a),(a)=(b),(b)=(temp))
+#endif
+
+#if !defined(MATRIX_INVERT_4X4_KERNEL) || defined(OSG_USE_UNIT_TESTS)
+// General Gauss-Jordan inversion with full pivoting, used as the scalar
+// fallback of invert_4x4() and as the reference for the SIMD path.
+static bool invert_gaussJordan( Matrix_implementation& result, const Matrix_implementation& mat )
+{
+    unsigned int indxc[4], indxr[4], ipiv[4];
+    unsigned int i,j,k,l,ll;
+    unsigned int icol = 0;
+    unsigned int irow = 0;
+    value_type temp, pivinv, dum, big;
+
+    // copy in place this may be unnecessary
+    result = mat;
+
+    for (j=0; j<4; j++) ipiv[j]=0;
+
+    for(i=0;i<4;i++)
+    {
+       big=(value_type)0.0;
+       for (j=0; j<4; j++)
+          if (ipiv[j] != 1)
+             for (k=0; k<4; k++)
+             {
+                if (ipiv[k] == 0)
+                {
+                   if (SGL_ABS(result(j,k)) >= big)
+                   {
+                      big = SGL_ABS(result(j,k));
+                      irow=j;
+                      icol=k;
+                   }
+                }
+                else if (ipiv[k] > 1)
+                   return false;
+             }
+       ++(ipiv[icol]);
+       if (irow != icol)
+          for (l=0; l<4; l++) SGL_SWAP(result(irow,l),
+                                       result(icol,l),
+                                       temp);
+
+       indxr[i]=irow;
+       indxc[i]=icol;
+       if (result(icol,icol) == 0)
+          return false;
+
+       pivinv = 1.0/result(icol,icol);
+       result(icol,icol) = 1;
+       for (l=0; l<4; l++) result(icol,l) *= pivinv;
+       for (ll=0; ll<4; ll++)
+          if (ll != icol)
+          {
+             dum=result(ll,icol);
+             result(ll,icol) = 0;
+             for (l=0; l<4; l++) result(ll,l) -= result(icol,l)*dum;
+          }
+    }
+    for (int lx=4; lx>0; --lx)
+    {
+       if (indxr[lx-1] != indxc[lx-1])
+          for (k=0; k<4; k++) SGL_SWAP(result(k,indxr[lx-1]),
+                                       result(k,indxc[lx-1]),temp);
+    }
+
+    return true;
+}
+#endif
+
+bool Matrix_implementation::invert( const Matrix_implementation& mat )
+{
+    switch(mat.getClassification())
+    {
+        case(IDENTITY):
+            makeIdentity();
+            return true;
+        case(TRANSLATE):
+            makeTranslate(-mat._mat[3][0],-mat._mat[3][1],-mat._mat[3][2]);
+            return true;
+        case(RIGID):
+            invert_rigid(mat);
+            return true;
+        case(AFFINE):
+            return invert_4x3(mat);
+        default:
+            return invert_4x4(mat);
+    }
+}
+
+void Matrix_implementation::invert_rigid( const Matrix_implementation& mat )
+{
+    // inverse of an orthonormal upper 3x3 is its transpose, and the
+    // inverse translation is -t * transpose.
+    value_type tx = mat._mat[3][0];
+    value_type ty = mat._mat[3][1];
+    value_type tz = mat._mat[3][2];
+
+    value_type r00 = mat._mat[0][0], r01 = mat._mat[1][0], r02 = mat._mat[2][0];
+    value_type r10 = mat._mat[0][1], r11 = mat._mat[1][1], r12 = mat._mat[2][1];
+    value_type r20 = mat._mat[0][2], r21 = mat._mat[1][2], r22 = mat._mat[2][2];
+
+    SET_ROW(0, r00, r01, r02, 0.0f )
+    SET_ROW(1, r10, r11, r12, 0.0f )
+    SET_ROW(2, r20, r21, r22, 0.0f )
+    SET_ROW(3, -(tx*r00 + ty*r10 + tz*r20),
+               -(tx*r01 + ty*r11 + tz*r21),
+               -(tx*r02 + ty*r12 + tz*r22), 1.0f )
+    storeClassification(RIGID);
+}
+
+bool Matrix_implementation::invert_4x3( const Matrix_implementation& mat )
+{
+    // cofactors of the upper 3x3.
+    value_type c00 = mat._mat[1][1]*mat._mat[2][2] - mat._mat[1][2]*mat._mat[2][1];
+    value_type c01 = mat._mat[1][2]*mat._mat[2][0] - mat._mat[1][0]*mat._mat[2][2];
+    value_type c02 = mat._mat[1][0]*mat._mat[2][1] - mat._mat[1][1]*mat._mat[2][0];
+
+    value_type det = mat._mat[0][0]*c00 + mat._mat[0][1]*c01 + mat._mat[0][2]*c02;
+    if (det==0.0f) return false;
+    value_type inv_det = 1.0f/det;
+
+    value_type r00 = c00*inv_det;
+    value_type r01 = (mat._mat[0][2]*mat._mat[2][1] - mat._mat[0][1]*mat._mat[2][2])*inv_det;
+    value_type r02 = (mat._mat[0][1]*mat._mat[1][2] - mat._mat[0][2]*mat._mat[1][1])*inv_det;
+    value_type r10 = c01*inv_det;
+    value_type r11 = (mat._mat[0][0]*mat._mat[2][2] - mat._mat[0][2]*mat._mat[2][0])*inv_det;
+    value_type r12 = (mat._mat[0][2]*mat._mat[1][0] - mat._mat[0][0]*mat._mat[1][2])*inv_det;
+    value_type r20 = c02*inv_det;
+    value_type r21 = (mat._mat[0][1]*mat._mat[2][0] - mat._mat[0][0]*mat._mat[2][1])*inv_det;
+    value_type r22 = (mat._mat[0][0]*mat._mat[1][1] - mat._mat[0][1]*mat._mat[1][0])*inv_det;
+
+    // inverse translation is -t * inverse(upper 3x3).
+    value_type tx = mat._mat[3][0];
+    value_type ty = mat._mat[3][1];
+    value_type tz = mat._mat[3][2];
+
+    SET_ROW(0, r00, r01, r02, 0.0f )
+    SET_ROW(1, r10, r11, r12, 0.0f )
+    SET_ROW(2, r20, r21, r22, 0.0f )
+    SET_ROW(3, -(tx*r00 + ty*r10 + tz*r20),
+               -(tx*r01 + ty*r11 + tz*r21),
+               -(tx*r02 + ty*r12 + tz*r22), 1.0f )
+    storeClassification(UNCLASSIFIED);
+
+    return true;
+}
+
+bool Matrix_implementation::invert_4x4( const Matrix_implementation& mat )
+{
+#if defined(MATRIX_INVERT_4X4_KERNEL)
+    storeClassification(UNCLASSIFIED);
+    return MATRIX_INVERT_4X4_KERNEL((value_type*)_mat,(const value_type*)mat._mat);
+#else
+    if (&mat==this) {
+       Matrix_implementation tm(mat);
+       return invert_gaussJordan(*this,tm);
+    }
+    return invert_gaussJordan(*this,mat);
+#endif
+}
+
+void Matrix_implementation::makeOrtho(const double left, const double right,
+                       const double bottom, const double top,
+                       const double zNear, const double zFar)
+{
+    // note transpose of Matrix_implementation wr.t OpenGL documentation, since the OSG use post multiplication rather than pre.
+    double tx = -(right+left)/(right-left);
+    double ty = -(top+bottom)/(top-bottom);
+    double tz = -(zFar+zNear)/(zFar-zNear);
+    SET_ROW(0, 2.0f/(right-left),              0.0f,               0.0f, 0.0f )
+    SET_ROW(1,              0.0f, 2.0f/(top-bottom),               0.0f, 0.0f )
+    SET_ROW(2,              0.0f,              0.0f, -2.0f/(zFar-zNear), 0.0f )
+    SET_ROW(3,                tx,                ty,                 tz, 1.0f )
+    storeClassification(UNCLASSIFIED);
+}
+
+void Matrix_implementation::makeFrustum(const double left, const double right,
+                         const double bottom, const double top,
+                         const double zNear, const double zFar)
+{
+    // note transpose of Matrix_implementation wr.t OpenGL documentation, since the OSG use post multiplication rather than pre.
+    double A = (right+left)/(right-left);
+    double B = (top+bottom)/(top-bottom);
+    double C = -(zFar+zNear)/(zFar-zNear);
+    double D = -2.0*zFar*zNear/(zFar-zNear);
+    SET_ROW(0, 2.0f*zNear/(right-left),                    0.0f, 0.0f,  0.0f )
+    SET_ROW(1,                    0.0f, 2.0f*zNear/(top-bottom), 0.0f,  0.0f )
+    SET_ROW(2,                       A,                       B,    C, -1.0f )
+    SET_ROW(3,                    0.0f,                   0.0f,     D,  0.0f )
+    storeClassification(UNCLASSIFIED);
+}
+
+
+void Matrix_implementation::makePerspective(const double fovy,const double aspectRatio,
+                             const double zNear, const double zFar)
+{
+    // calculate the appropriate left, right etc.
+    double tan_fovy = tan(DegreesToRadians(fovy*0.5));
+    double right  =  tan_fovy * aspectRatio * zNear;
+    double left   = -right;
+    double top    =  tan_fovy * zNear;
+    double bottom =  -top;
+    makeFrustum(left,right,bottom,top,zNear,zFar);
+}
+
+
+void Matrix_implementation::makeLookAt(const Vec3d& eye,const Vec3d& center,const Vec3d& up)
+{
+    // computed in double so that distant eye points do not lose precision.
+    Vec3d f(center-eye);
+    f.normalize();
+    Vec3d s(f^up);
+    s.normalize();
+    Vec3d u(s^f);
+    u.normalize();
+
+    // the translation row is -eye rotated into the view, folded in here
+    // rather than via preMult(translate(-eye)) so it is also kept in double.
+    set(
+        s[0],     u[0],     -f[0],     0.0f,
+        s[1],     u[1],     -f[1],     0.0f,
+        s[2],     u[2],     -f[2],     0.0f,
+        -(s*eye), -(u*eye), f*eye,     1.0f);
+}
+
+void Matrix_implementation::transform(const Vec3Array& src, Vec3Array& dst) const
+{
+    if (&src!=&dst) dst.resize(src.size());
+    if (!src.empty()) transform(&src.front(),&dst.front(),src.size());
+}
+
+void Matrix_implementation::transform(const Vec4Array& src, Vec4Array& dst) const
+{
+    if (&src!=&dst) dst.resize(src.size());
+    if (!src.empty()) transform(&src.front(),&dst.front(),src.size());
+}
+
+void Matrix_implementation::transform3x3(const Vec3Array& src, Vec3Array& dst) const
+{
+    if (&src!=&dst) dst.resize(src.size());
+    if (!src.empty()) transform3x3(&src.front(),&dst.front(),src.size());
+}
+
+void Matrix_implementation::transformNormals(const Vec3Array& src, Vec3Array& dst) const
+{
+    if (&src!=&dst) dst.resize(src.size());
+    if (!src.empty()) transformNormals(&src.front(),&dst.front(),src.size());
+}
+
+#undef SET_ROW
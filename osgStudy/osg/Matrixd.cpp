@@ -0,0 +1,102 @@
+#include <osg/Matrix.h>
+
+using namespace osg;
+
+// Scalar kernels, the four wide float SIMD paths of Matrixf.cpp do not
+// apply to double precision.
+
+// Multiply the 4x4 row major matrices lhs and rhs and store in result,
+// rhs is copied first so result may alias either lhs or rhs.
+static inline void mult_4x4(double* result, const double* lhs, const double* rhs)
+{
+    double r[16];
+    std::copy(rhs,rhs+16,r);
+
+    for(int row=0; row<4; ++row)
+    {
+        double l0 = lhs[row*4], l1 = lhs[row*4+1], l2 = lhs[row*4+2], l3 = lhs[row*4+3];
+        for(int col=0; col<4; ++col)
+        {
+            result[row*4+col] = l0*r[col] + l1*r[4+col] + l2*r[8+col] + l3*r[12+col];
+        }
+    }
+}
+
+// result = translate(lhs[3][0..2]) * rhs.  result may alias rhs.
+static inline void mult_translate_lhs(double* result, const double* lhs, const double* rhs)
+{
+    double tx = lhs[12], ty = lhs[13], tz = lhs[14];
+    if (result!=rhs) std::copy(rhs,rhs+12,result);
+    for(int col=0; col<4; ++col)
+    {
+        result[12+col] = tx*rhs[col] + ty*rhs[4+col] + tz*rhs[8+col] + rhs[12+col];
+    }
+}
+
+// result = lhs * translate(rhs[3][0..2]).  result may alias lhs.
+static inline void mult_translate_rhs(double* result, const double* lhs, const double* rhs)
+{
+    double tx = rhs[12], ty = rhs[13], tz = rhs[14];
+    for(int row=0; row<4; ++row)
+    {
+        const double* l = lhs+row*4;
+        double* r = result+row*4;
+        double l3 = l[3];
+        r[0] = l[0] + l3*tx;
+        r[1] = l[1] + l3*ty;
+        r[2] = l[2] + l3*tz;
+        r[3] = l3;
+    }
+}
+
+#define Matrix_implementation Matrixd
+#include "Matrix_implementation.cpp"
+
+Matrixd::Matrixd( const Matrixf& other)
+{
+    set( other );
+}
+
+Matrixd& Matrixd::operator = (const Matrixf& other)
+{
+    set( other );
+    return *this;
+}
+
+void Matrixd::set(const Matrixf& other)
+{
+    const Matrixf::value_type* src = other.ptr();
+    double* dst = (double*)_mat;
+    for(int i=0;i<16;++i) dst[i] = src[i];
+    storeClassification(UNCLASSIFIED);
+}
+
+void Matrixd::makeTranslate( const Vec3d& v )
+{
+    makeTranslate( v[0], v[1], v[2] );
+}
+
+void Matrixd::setTrans( const Vec3d& v )
+{
+    setTrans( v[0], v[1], v[2] );
+}
+
+void Matrixd::transform(const Vec3* src, Vec3* dst, unsigned int num) const
+{
+    for(unsigned int i=0;i<num;++i) dst[i] = preMult(src[i]);
+}
+
+void Matrixd::transform(const Vec4* src, Vec4* dst, unsigned int num) const
+{
+    for(unsigned int i=0;i<num;++i) dst[i] = preMult(src[i]);
+}
+
+void Matrixd::transform3x3(const Vec3* src, Vec3* dst, unsigned int num) const
+{
+    for(unsigned int i=0;i<num;++i) dst[i] = transform3x3(src[i],*this);
+}
+
+void Matrixd::transformNormals(const Vec3* src, Vec3* dst, unsigned int num) const
+{
+    for(unsigned int i=0;i<num;++i) dst[i] = transform3x3(*this,src[i]);
+}
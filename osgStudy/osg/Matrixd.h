@@ -0,0 +1,638 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_MATRIXD
+#define OSG_MATRIXD 1
+
+#include <osg/Export.h>
+#include <osg/Vec3.h>
+#include <osg/Vec4.h>
+#include <osg/Vec3d.h>
+#include <osg/Vec4d.h>
+#include <osg/Array.h>
+
+#include <string.h>
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+
+namespace osg {
+
+class Quat;
+class Matrixd;
+
+/** Double precision counterpart of Matrixf, with the same layout and
+  * conventions. Useful for accumulating transforms over large extents
+  * where single precision runs out of bits.*/
+class SG_EXPORT Matrixd
+{
+
+    public:
+
+        typedef double value_type;
+
+        /** Classification of the matrix by the kind of transform it applies,
+          * ordered from most to least specialised.  Each class is a subset
+          * of the ones that follow it, and is used to pick cheaper paths in
+          * multiplication, inversion and point transformation.*/
+        enum Classification
+        {
+            IDENTITY,
+            TRANSLATE,      ///< upper 3x3 is identity, non zero translation.
+            RIGID,          ///< upper 3x3 is orthonormal, plus translation.
+            AFFINE,         ///< last column is (0,0,0,1).
+            PROJECTIVE,
+            UNCLASSIFIED    ///< not yet computed, never returned by getClassification().
+        };
+
+        Matrixd();
+        Matrixd( const Matrixd& other);
+        explicit Matrixd( value_type const * const def );
+        Matrixd( value_type a00, value_type a01, value_type a02, value_type a03,
+            value_type a10, value_type a11, value_type a12, value_type a13,
+            value_type a20, value_type a21, value_type a22, value_type a23,
+            value_type a30, value_type a31, value_type a32, value_type a33);
+        Matrixd( const Matrixf& other);
+
+        ~Matrixd() {}
+
+
+        int compare(const Matrixd& m) const { return memcmp(_mat,m._mat,sizeof(_mat)); }
+
+        bool operator < (const Matrixd& m) const { return compare(m)<0; }
+        bool operator == (const Matrixd& m) const { return compare(m)==0; }
+        bool operator != (const Matrixd& m) const { return compare(m)!=0; }
+
+        inline value_type& operator()(int row, int col) { storeClassification(UNCLASSIFIED); return _mat[row][col]; }
+        inline value_type operator()(int row, int col) const { return _mat[row][col]; }
+
+        inline const bool valid() const { return !isNaN(); }
+        inline const bool isNaN() const { return osg::isNaN(_mat[0][0]) || osg::isNaN(_mat[0][1]) || osg::isNaN(_mat[0][2]) || osg::isNaN(_mat[0][3]) ||
+                                                 osg::isNaN(_mat[1][0]) || osg::isNaN(_mat[1][1]) || osg::isNaN(_mat[1][2]) || osg::isNaN(_mat[1][3]) ||
+                                                 osg::isNaN(_mat[2][0]) || osg::isNaN(_mat[2][1]) || osg::isNaN(_mat[2][2]) || osg::isNaN(_mat[2][3]) ||
+                                                 osg::isNaN(_mat[3][0]) || osg::isNaN(_mat[3][1]) || osg::isNaN(_mat[3][2]) || osg::isNaN(_mat[3][3]); }
+
+
+
+        inline Matrixd& operator = (const Matrixd& other)
+        {
+            if( &other == this ) return *this;
+            std::copy((const value_type*)other._mat,(const value_type*)other._mat+16,(value_type*)(_mat));
+            storeClassification(other.loadClassification());
+            return *this;
+        }
+        
+        Matrixd& operator = (const Matrixf& other);
+
+        inline void set(const Matrixd& other)
+        {
+            std::copy((const value_type*)other._mat,(const value_type*)other._mat+16,(value_type*)(_mat));
+            storeClassification(other.loadClassification());
+        }
+        
+        void set(const Matrixf& other);
+
+        inline void set(value_type const * const ptr)
+        {
+            std::copy(ptr,ptr+16,(value_type*)(_mat));
+            storeClassification(UNCLASSIFIED);
+        }
+        
+        void set( value_type a00, value_type a01, value_type a02, value_type a03,
+                  value_type a10, value_type a11, value_type a12, value_type a13,
+                  value_type a20, value_type a21, value_type a22, value_type a23,
+                  value_type a30, value_type a31, value_type a32, value_type a33);
+                  
+        value_type * ptr() { storeClassification(UNCLASSIFIED); return (value_type *)_mat; }
+        const value_type * ptr() const { return (const value_type *)_mat; }
+
+        void makeIdentity();
+        
+        void makeScale( const Vec3& );
+        void makeScale( value_type, value_type, value_type );
+        
+        void makeTranslate( const Vec3& );
+        void makeTranslate( const Vec3d& );
+        void makeTranslate( value_type, value_type, value_type );
+        
+        void makeRotate( const Vec3& from, const Vec3& to );
+        void makeRotate( value_type angle, const Vec3& axis );
+        void makeRotate( value_type angle, value_type x, value_type y, value_type z );
+        void makeRotate( const Quat& );
+
+        /** make a rotation Matrix from euler angles.
+          * assume Z up, Y north, X east and euler convention
+          * as per Open Flight & Performer.
+          * Applies a positive rotation about Y axis for roll,
+          * then applies a positive roation about X for pitch,
+          * and finally a negative rotation about the Z axis.*/
+        void makeRotate( value_type heading, value_type pitch, value_type roll); //Euler angles
+        
+        
+        /** Set to a orthographic projection. See glOrtho for further details.*/
+        void makeOrtho(const double left, const double right,
+                       const double bottom, const double top,
+                       const double zNear, const double zFar);
+
+        /** Set to a 2D orthographic projection. See glOrtho2D for further details.*/
+        inline void makeOrtho2D(const double left, const double right,
+                                const double bottom, const double top)
+        {
+            makeOrtho(left,right,bottom,top,-1.0,1.0);
+        }
+
+        /** Set to a perspective projection. See glFrustum for further details.*/
+        void makeFrustum(const double left, const double right,
+                         const double bottom, const double top,
+                         const double zNear, const double zFar);
+
+        /** Set to a symmetrical perspective projection, See gluPerspective for further details.
+          * Aspect ratio is defined as width/height.*/
+        void makePerspective(const double fovy,const double aspectRatio,
+                             const double zNear, const double zFar);
+
+        /** Set to the position and orientation as per a camera, using the same convention as gluLookAt. */
+        void makeLookAt(const Vec3d& eye,const Vec3d& center,const Vec3d& up);
+        
+
+        /** invert the matrix rhs, automatically selecting the cheapest
+          * path for the classification of rhs.
+          * return false if rhs is singular.*/
+        bool invert( const Matrixd& rhs);
+
+        /** invert an affine matrix, i.e. one whose last column is (0,0,0,1),
+          * by inverting the upper 3x3 and back transforming the translation.
+          * Results are undefined if rhs is a projective matrix.*/
+        bool invert_4x3( const Matrixd& rhs);
+
+        /** invert a general 4x4 matrix.*/
+        bool invert_4x4( const Matrixd& rhs);
+
+        /** invert a rigid matrix, i.e. rotation and translation only, by
+          * transposing the upper 3x3. Results are undefined if the upper
+          * 3x3 of rhs is not orthonormal.*/
+        void invert_rigid( const Matrixd& rhs);
+
+        /** return true if the last column is (0,0,0,1), i.e. the matrix
+          * has no projective component.*/
+        inline bool isAffine() const { return _mat[0][3]==0.0 && _mat[1][3]==0.0 && _mat[2][3]==0.0 && _mat[3][3]==1.0; }
+
+        /** return the classification of the matrix. It is computed on
+          * first use after the matrix has been modified and then cached,
+          * several threads may classify the same const matrix at once.
+          * The non-const operator() and ptr() drop the cached value as
+          * they may be written through, read a matrix which is not being
+          * modified through a const reference to keep it.
+          * RIGID allows a small tolerance on orthonormality, so that
+          * rotations built from Quat's still qualify.*/
+        inline Classification getClassification() const
+        {
+            Classification classification = loadClassification();
+            if (classification==UNCLASSIFIED)
+            {
+                classification = classify();
+                storeClassification(classification);
+            }
+            return classification;
+        }
+
+        /** return the cached classification without computing it,
+          * UNCLASSIFIED if the matrix has been modified since it was
+          * last classified. Used by operations too cheap to be worth
+          * classifying for, such as multiplication.*/
+        inline Classification getCachedClassification() const { return loadClassification(); }
+
+        //basic utility functions to create new matrices
+	inline static Matrixd identity( void );
+        inline static Matrixd scale( const Vec3& sv);
+        inline static Matrixd scale( value_type sx, value_type sy, value_type sz);
+        inline static Matrixd translate( const Vec3& dv);
+        inline static Matrixd translate( const Vec3d& dv);
+        inline static Matrixd translate( value_type x, value_type y, value_type z);
+        inline static Matrixd rotate( const Vec3& from, const Vec3& to);
+        inline static Matrixd rotate( value_type angle, value_type x, value_type y, value_type z);        
+        inline static Matrixd rotate( value_type angle, const Vec3& axis);
+        /** construct rotation matrix from euler angles, for conventions see makeRotate().*/
+        inline static Matrixd rotate( value_type heading, value_type pitch, value_type roll);
+        inline static Matrixd rotate( const Quat& quat);
+        inline static Matrixd inverse( const Matrixd& matrix);
+        
+        /** Create a orthographic projection. See glOrtho for further details.*/
+        inline static Matrixd ortho(const double left, const double right,
+                                   const double bottom, const double top,
+                                   const double zNear, const double zFar);
+
+        /** Create a 2D orthographic projection. See glOrtho for further details.*/
+        inline static Matrixd ortho2D(const double left, const double right,
+                                     const double bottom, const double top);
+
+        /** Create a perspective projection. See glFrustum for further details.*/
+        inline static Matrixd frustum(const double left, const double right,
+                                     const double bottom, const double top,
+                                     const double zNear, const double zFar);
+
+        /** Create a symmetrical perspective projection, See gluPerspective for further details.
+          * Aspect ratio is defined as width/height.*/
+        inline static Matrixd perspective(const double fovy,const double aspectRatio,
+                                         const double zNear, const double zFar);
+
+        /** Create the position and orientation as per a camera, using the same convention as gluLookAt. */
+        inline static Matrixd lookAt(const Vec3d& eye,const Vec3d& center,const Vec3d& up);
+
+
+        inline Vec3 preMult( const Vec3& v ) const;
+        inline Vec3 postMult( const Vec3& v ) const;
+        inline Vec3 operator* ( const Vec3& v ) const;
+        inline Vec4 preMult( const Vec4& v ) const;
+        inline Vec4 postMult( const Vec4& v ) const;
+        inline Vec4 operator* ( const Vec4& v ) const;
+
+        /** mixed precision transforms, the arithmetic is done in double so
+          * that large world coordinates keep their precision.*/
+        inline Vec3d preMult( const Vec3d& v ) const;
+        inline Vec3d postMult( const Vec3d& v ) const;
+        inline Vec3d operator* ( const Vec3d& v ) const;
+        inline Vec4d preMult( const Vec4d& v ) const;
+        inline Vec4d postMult( const Vec4d& v ) const;
+        inline Vec4d operator* ( const Vec4d& v ) const;
+
+        void setTrans( value_type tx, value_type ty, value_type tz );
+	void setTrans( const Vec3& v );
+        void setTrans( const Vec3d& v );
+        inline Vec3d getTrans() const { return Vec3d(_mat[3][0],_mat[3][1],_mat[3][2]); } 
+        
+        inline Vec3 getScale() const { return Vec3(_mat[0][0],_mat[1][1],_mat[2][2]); }
+        
+    	/** apply apply an 3x3 transform of v*M[0..2,0..2]  */
+    	inline static Vec3 transform3x3(const Vec3& v,const Matrixd& m);
+    	/** apply apply an 3x3 transform of M[0..2,0..2]*v  */
+    	inline static Vec3 transform3x3(const Matrixd& m,const Vec3& v);
+
+        /** transform num points as per preMult(Vec3), i.e. dst[i] = src[i]*M
+          * including the divide by w for projective matrices.
+          * dst may be the same array as src, but must not partially overlap it.
+          * Points are processed four at a time with SIMD.*/
+        void transform(const Vec3* src, Vec3* dst, unsigned int num) const;
+
+        /** transform num vectors as per preMult(Vec4), i.e. dst[i] = src[i]*M.*/
+        void transform(const Vec4* src, Vec4* dst, unsigned int num) const;
+
+        /** apply the 3x3 transform src[i]*M[0..2,0..2] to num vectors,
+          * as per transform3x3(Vec3,Matrixd).*/
+        void transform3x3(const Vec3* src, Vec3* dst, unsigned int num) const;
+
+        /** apply the 3x3 transform M[0..2,0..2]*src[i] to num vectors,
+          * as per transform3x3(Matrixd,Vec3). Calling this on the inverse of a
+          * model matrix gives the correct transform for normals, as long as
+          * non uniform scales are acceptable to leave the normals unnormalized.*/
+        void transformNormals(const Vec3* src, Vec3* dst, unsigned int num) const;
+
+        /** transform all the points in src into dst, resizing dst to fit.*/
+        void transform(const Vec3Array& src, Vec3Array& dst) const;
+        /** transform all the points in array in place.*/
+        void transform(Vec3Array& array) const { transform(array,array); }
+        void transform(const Vec4Array& src, Vec4Array& dst) const;
+        void transform(Vec4Array& array) const { transform(array,array); }
+        void transform3x3(const Vec3Array& src, Vec3Array& dst) const;
+        void transform3x3(Vec3Array& array) const { transform3x3(array,array); }
+        void transformNormals(const Vec3Array& src, Vec3Array& dst) const;
+        void transformNormals(Vec3Array& array) const { transformNormals(array,array); }
+
+
+        // basic Matrix multiplication, our workhorse methods.
+        void mult( const Matrixd&, const Matrixd& );
+        void preMult( const Matrixd& );
+        void postMult( const Matrixd& );
+
+        inline void operator *= ( const Matrixd& other ) 
+        {    if( this == &other ) {
+                Matrixd temp(other);
+                postMult( temp );
+            }
+            else postMult( other ); 
+        }
+
+        inline Matrixd operator * ( const Matrixd &m ) const
+	{
+	    osg::Matrixd r;
+            r.mult(*this,m);
+	    return  r;
+	}
+
+
+// temporarily commented out while waiting for a more generic implementation
+// of MatrixProduct proxy class.
+//         // Helper class to optimize product expressions somewhat
+//         class MatrixProduct {
+//         public:
+//             const Matrixd& A;
+//             const Matrixd& B;
+// 
+//             MatrixProduct( const Matrixd& lhs, const Matrixd& rhs ) : A(lhs), B(rhs) {}
+//         };
+// 
+//         inline MatrixProduct operator * ( const Matrixd& other ) const    
+//             {    return MatrixProduct(*this, other); }
+// 
+//         inline void operator = ( const MatrixProduct& p ) 
+//             {
+//                 if( this == &(p.A)) postMult(p.B);
+//                 else if( this == &(p.B)) preMult(p.A);
+//                 else mult( p.A, p.B );
+//             }
+// 
+//         Matrixd( const MatrixProduct& p ) //allows implicit evaluation of the product
+//             {    mult( p.A, p.B ); }
+
+    private:
+
+        Classification classify() const;
+
+        // relaxed as the classification only caches a function of _mat.
+        inline Classification loadClassification() const { return (Classification)_classification.load(std::memory_order_relaxed); }
+        inline void storeClassification(Classification classification) const { _classification.store((unsigned char)classification,std::memory_order_relaxed); }
+
+        value_type _mat[4][4];
+        mutable std::atomic<unsigned char> _classification;
+
+};
+
+//static utility methods
+inline Matrixd Matrixd::identity(void)
+{
+    Matrixd m;
+    m.makeIdentity();
+    return m;
+}
+
+inline Matrixd Matrixd::scale(value_type sx, value_type sy, value_type sz)
+{
+    Matrixd m;
+    m.makeScale(sx,sy,sz);
+    return m;
+}
+
+inline Matrixd Matrixd::scale(const Vec3& v )
+{
+    return scale(v.x(), v.y(), v.z() );
+}
+
+inline Matrixd Matrixd::translate(value_type tx, value_type ty, value_type tz)
+{
+    Matrixd m;
+    m.makeTranslate(tx,ty,tz);
+    return m;
+}
+
+inline Matrixd Matrixd::translate(const Vec3& v )
+{
+    return translate(v.x(), v.y(), v.z() );
+}
+
+inline Matrixd Matrixd::translate(const Vec3d& v )
+{
+    return translate(v.x(), v.y(), v.z() );
+}
+
+inline Matrixd Matrixd::rotate( const Quat& q )
+{
+    Matrixd m;
+    m.makeRotate( q );
+    return m;
+}
+inline Matrixd Matrixd::rotate(value_type angle, value_type x, value_type y, value_type z )
+{
+    Matrixd m;
+    m.makeRotate(angle,x,y,z);
+    return m;
+}
+inline Matrixd Matrixd::rotate(value_type angle, const Vec3& axis )
+{
+    Matrixd m;
+    m.makeRotate(angle,axis);
+    return m;
+}
+inline Matrixd Matrixd::rotate(value_type heading, value_type pitch, value_type roll)
+{
+    Matrixd m;
+    m.makeRotate(heading,pitch,roll);
+    return m;
+}
+inline Matrixd Matrixd::rotate(const Vec3& from, const Vec3& to )
+{
+    Matrixd m;
+    m.makeRotate(from,to);
+    return m;
+}
+
+inline Matrixd Matrixd::inverse( const Matrixd& matrix)
+{
+    Matrixd m;
+    m.invert(matrix);
+    return m;
+}
+
+inline Matrixd Matrixd::ortho(const double left, const double right,
+                            const double bottom, const double top,
+                            const double zNear, const double zFar)
+{
+    Matrixd m;
+    m.makeOrtho(left,right,bottom,top,zNear,zFar);
+    return m;
+}
+
+inline Matrixd Matrixd::ortho2D(const double left, const double right,
+                              const double bottom, const double top)
+{
+    Matrixd m;
+    m.makeOrtho2D(left,right,bottom,top);
+    return m;
+}
+
+inline Matrixd Matrixd::frustum(const double left, const double right,
+                              const double bottom, const double top,
+                              const double zNear, const double zFar)
+{
+    Matrixd m;
+    m.makeFrustum(left,right,bottom,top,zNear,zFar);
+    return m;
+}
+
+inline Matrixd Matrixd::perspective(const double fovy,const double aspectRatio,
+                                  const double zNear, const double zFar)
+{
+    Matrixd m;
+    m.makePerspective(fovy,aspectRatio,zNear,zFar);
+    return m;
+}
+
+inline Matrixd Matrixd::lookAt(const Vec3d& eye,const Vec3d& center,const Vec3d& up)
+{
+    Matrixd m;
+    m.makeLookAt(eye,center,up);
+    return m;
+}
+
+
+inline Vec3 Matrixd::postMult( const Vec3& v ) const
+{
+    value_type d = 1.0/(_mat[3][0]*v.x()+_mat[3][1]*v.y()+_mat[3][2]*v.z()+_mat[3][3]) ;
+    return Vec3( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3])*d,
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3])*d,
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3])*d) ;
+}
+
+inline Vec3 Matrixd::preMult( const Vec3& v ) const
+{
+    switch(loadClassification())
+    {
+        case(IDENTITY):
+            return v;
+        case(TRANSLATE):
+            return Vec3(v.x()+_mat[3][0],v.y()+_mat[3][1],v.z()+_mat[3][2]);
+        case(RIGID):
+        case(AFFINE):
+            return Vec3( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]),
+                (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]),
+                (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]));
+        default:
+            break;
+    }
+    value_type d = 1.0/(_mat[0][3]*v.x()+_mat[1][3]*v.y()+_mat[2][3]*v.z()+_mat[3][3]) ;
+    return Vec3( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0])*d,
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1])*d,
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2])*d);
+}
+
+inline Vec4 Matrixd::postMult( const Vec4& v ) const
+{
+    return Vec4( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3]*v.w()),
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3]*v.w()),
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3]*v.w()),
+        (_mat[3][0]*v.x() + _mat[3][1]*v.y() + _mat[3][2]*v.z() + _mat[3][3]*v.w())) ;
+}
+
+inline Vec4 Matrixd::preMult( const Vec4& v ) const
+{
+    return Vec4( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]*v.w()),
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]*v.w()),
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]*v.w()),
+        (_mat[0][3]*v.x() + _mat[1][3]*v.y() + _mat[2][3]*v.z() + _mat[3][3]*v.w()));
+}
+inline Vec3 Matrixd::transform3x3(const Vec3& v,const Matrixd& m)
+{
+    return Vec3( (m._mat[0][0]*v.x() + m._mat[1][0]*v.y() + m._mat[2][0]*v.z()),
+                 (m._mat[0][1]*v.x() + m._mat[1][1]*v.y() + m._mat[2][1]*v.z()),
+                 (m._mat[0][2]*v.x() + m._mat[1][2]*v.y() + m._mat[2][2]*v.z()));
+}
+
+inline Vec3 Matrixd::transform3x3(const Matrixd& m,const Vec3& v)
+{
+    return Vec3( (m._mat[0][0]*v.x() + m._mat[0][1]*v.y() + m._mat[0][2]*v.z()),
+                 (m._mat[1][0]*v.x() + m._mat[1][1]*v.y() + m._mat[1][2]*v.z()),
+                 (m._mat[2][0]*v.x() + m._mat[2][1]*v.y() + m._mat[2][2]*v.z()) ) ;
+}
+
+
+inline Vec3 operator* (const Vec3& v, const Matrixd& m )
+{
+	return m.preMult(v);
+}
+inline Vec4 operator* (const Vec4& v, const Matrixd& m )
+{
+	return m.preMult(v);
+}
+
+inline Vec3 Matrixd::operator* (const Vec3& v) const
+{
+	return postMult(v);
+}
+inline Vec4 Matrixd::operator* (const Vec4& v) const
+{
+	return postMult(v);
+}
+
+inline Vec3d Matrixd::postMult( const Vec3d& v ) const
+{
+    double d = 1.0/(_mat[3][0]*v.x()+_mat[3][1]*v.y()+_mat[3][2]*v.z()+_mat[3][3]) ;
+    return Vec3d( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3])*d,
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3])*d,
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3])*d) ;
+}
+
+inline Vec3d Matrixd::preMult( const Vec3d& v ) const
+{
+    switch(loadClassification())
+    {
+        case(IDENTITY):
+            return v;
+        case(TRANSLATE):
+            return Vec3d(v.x()+_mat[3][0],v.y()+_mat[3][1],v.z()+_mat[3][2]);
+        case(RIGID):
+        case(AFFINE):
+            return Vec3d( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]),
+                (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]),
+                (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]));
+        default:
+            break;
+    }
+    double d = 1.0/(_mat[0][3]*v.x()+_mat[1][3]*v.y()+_mat[2][3]*v.z()+_mat[3][3]) ;
+    return Vec3d( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0])*d,
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1])*d,
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2])*d);
+}
+
+inline Vec4d Matrixd::postMult( const Vec4d& v ) const
+{
+    return Vec4d( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3]*v.w()),
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3]*v.w()),
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3]*v.w()),
+        (_mat[3][0]*v.x() + _mat[3][1]*v.y() + _mat[3][2]*v.z() + _mat[3][3]*v.w())) ;
+}
+
+inline Vec4d Matrixd::preMult( const Vec4d& v ) const
+{
+    return Vec4d( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]*v.w()),
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]*v.w()),
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]*v.w()),
+        (_mat[0][3]*v.x() + _mat[1][3]*v.y() + _mat[2][3]*v.z() + _mat[3][3]*v.w()));
+}
+
+inline Vec3d operator* (const Vec3d& v, const Matrixd& m )
+{
+	return m.preMult(v);
+}
+inline Vec4d operator* (const Vec4d& v, const Matrixd& m )
+{
+	return m.preMult(v);
+}
+
+inline Vec3d Matrixd::operator* (const Vec3d& v) const
+{
+	return postMult(v);
+}
+inline Vec4d Matrixd::operator* (const Vec4d& v) const
+{
+	return postMult(v);
+}
+
+inline std::ostream& operator<< (std::ostream& os, const Matrixd& m )
+{
+    os << "{"<<std::endl;
+    for(int row=0; row<4; ++row) {
+        os << "\t";
+        for(int col=0; col<4; ++col)
+            os << m(row,col) << " ";
+        os << std::endl;
+    }
+    os << "}" << std::endl;
+    return os;
+}
+
+
+} //namespace osg
+
+
+#endif
@@ -0,0 +1,419 @@
+#include <osg/Matrix.h>
+#include <osg/SIMD.h>
+
+using namespace osg;
+
+// Multiply the 4x4 row major matrices lhs and rhs and store in result.
+// All of rhs is loaded into registers up front and each row of lhs is read
+// before the matching row of result is written, so result may alias
+// either lhs or rhs.
+static inline void mult_4x4(float* result, const float* lhs, const float* rhs)
+{
+    simd4f r0 = simd4f_load(rhs);
+    simd4f r1 = simd4f_load(rhs+4);
+    simd4f r2 = simd4f_load(rhs+8);
+    simd4f r3 = simd4f_load(rhs+12);
+
+    for(int row=0; row<4; ++row)
+    {
+        const float* l = lhs+row*4;
+        simd4f t = simd4f_mul(simd4f_splat(l[0]),r0);
+        t = simd4f_madd(simd4f_splat(l[1]),r1,t);
+        t = simd4f_madd(simd4f_splat(l[2]),r2,t);
+        t = simd4f_madd(simd4f_splat(l[3]),r3,t);
+        simd4f_store(result+row*4,t);
+    }
+}
+
+// result = translate(lhs[3][0..2]) * rhs, rows 0..2 are those of rhs and
+// row 3 is the translation transformed by rhs.  result may alias rhs.
+static inline void mult_translate_lhs(float* result, const float* lhs, const float* rhs)
+{
+    float tx = lhs[12], ty = lhs[13], tz = lhs[14];
+    if (result!=rhs) std::copy(rhs,rhs+12,result);
+    simd4f t = simd4f_mul(simd4f_splat(tx),simd4f_load(rhs));
+    t = simd4f_madd(simd4f_splat(ty),simd4f_load(rhs+4),t);
+    t = simd4f_madd(simd4f_splat(tz),simd4f_load(rhs+8),t);
+    t = simd4f_add(t,simd4f_load(rhs+12));
+    simd4f_store(result+12,t);
+}
+
+// result = lhs * translate(rhs[3][0..2]), which adds the translation
+// scaled by the last column of lhs to each row.  result may alias lhs.
+static inline void mult_translate_rhs(float* result, const float* lhs, const float* rhs)
+{
+    simd4f t = simd4f_set(rhs[12],rhs[13],rhs[14],0.0f);
+    for(int row=0; row<4; ++row)
+    {
+        const float* l = lhs+row*4;
+        simd4f_store(result+row*4,simd4f_madd(simd4f_splat(l[3]),t,simd4f_load(l)));
+    }
+}
+
+#if defined(OSG_SIMD_SSE2)
+
+// Cramer's rule inversion, after Intel's "Streaming SIMD Extensions -
+// Inverse of 4x4 Matrix" application note.  Works entirely in registers
+// so dst may alias src.
+static bool invert_4x4_sse(float* dst, const float* src)
+{
+    __m128 minor0, minor1, minor2, minor3;
+    __m128 row0, row1, row2, row3;
+    __m128 det, tmp1;
+
+    // load the transpose of src.
+    tmp1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src)), (const __m64*)(src+ 4));
+    row1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src+8)), (const __m64*)(src+12));
+    row0 = _mm_shuffle_ps(tmp1, row1, 0x88);
+    row1 = _mm_shuffle_ps(row1, tmp1, 0xDD);
+    tmp1 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src+ 2)), (const __m64*)(src+ 6));
+    row3 = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(src+10)), (const __m64*)(src+14));
+    row2 = _mm_shuffle_ps(tmp1, row3, 0x88);
+    row3 = _mm_shuffle_ps(row3, tmp1, 0xDD);
+
+    tmp1   = _mm_mul_ps(row2, row3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor0 = _mm_mul_ps(row1, tmp1);
+    minor1 = _mm_mul_ps(row0, tmp1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp1), minor0);
+    minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor1);
+    minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+
+    tmp1   = _mm_mul_ps(row1, row2);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor0);
+    minor3 = _mm_mul_ps(row0, tmp1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp1));
+    minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor3);
+    minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+
+    tmp1   = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    row2   = _mm_shuffle_ps(row2, row2, 0x4E);
+    minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor0);
+    minor2 = _mm_mul_ps(row0, tmp1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp1));
+    minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp1), minor2);
+    minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+
+    tmp1   = _mm_mul_ps(row0, row1);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor2);
+    minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp1), minor3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp1), minor2);
+    minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp1));
+
+    tmp1   = _mm_mul_ps(row0, row3);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp1));
+    minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor2);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp1), minor1);
+    minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp1));
+
+    tmp1   = _mm_mul_ps(row0, row2);
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0xB1);
+    minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp1), minor1);
+    minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp1));
+    tmp1   = _mm_shuffle_ps(tmp1, tmp1, 0x4E);
+    minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp1));
+    minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp1), minor3);
+
+    // determinant, exact division rather than the reciprocal estimate
+    // of the original note to keep precision comparable with Gauss-Jordan.
+    det  = _mm_mul_ps(row0, minor0);
+    det  = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+    det  = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+    if (_mm_cvtss_f32(det)==0.0f) return false;
+
+    det  = _mm_div_ss(_mm_set_ss(1.0f), det);
+    det  = _mm_shuffle_ps(det, det, 0x00);
+
+    _mm_storeu_ps(dst,    _mm_mul_ps(det, minor0));
+    _mm_storeu_ps(dst+4,  _mm_mul_ps(det, minor1));
+    _mm_storeu_ps(dst+8,  _mm_mul_ps(det, minor2));
+    _mm_storeu_ps(dst+12, _mm_mul_ps(det, minor3));
+
+    return true;
+}
+
+#define MATRIX_INVERT_4X4_KERNEL invert_4x4_sse
+
+#endif
+
+#define Matrix_implementation Matrixf
+#include "Matrix_implementation.cpp"
+
+Matrixf::Matrixf( const Matrixd& other)
+{
+    set( other );
+}
+
+Matrixf& Matrixf::operator = (const Matrixd& other)
+{
+    set( other );
+    return *this;
+}
+
+void Matrixf::set(const Matrixd& other)
+{
+    const Matrixd::value_type* src = other.ptr();
+    float* dst = (float*)_mat;
+    for(int i=0;i<16;++i) dst[i] = (float)src[i];
+    storeClassification(UNCLASSIFIED);
+}
+
+// Batch transforms. Points are loaded four at a time, transposed into
+// x,y,z,w registers so each output component is a sequence of madds
+// against splatted matrix elements, then transposed back and stored.
+// The order of operations matches preMult()/transform3x3() so results
+// are identical to the per point methods.
+
+static inline void transform_xyz(simd4f& x, simd4f& y, simd4f& z, const simd4f c[4][4], bool translate, bool project)
+{
+    simd4f rx = simd4f_madd(z,c[2][0],simd4f_madd(y,c[1][0],simd4f_mul(x,c[0][0])));
+    simd4f ry = simd4f_madd(z,c[2][1],simd4f_madd(y,c[1][1],simd4f_mul(x,c[0][1])));
+    simd4f rz = simd4f_madd(z,c[2][2],simd4f_madd(y,c[1][2],simd4f_mul(x,c[0][2])));
+    if (translate)
+    {
+        rx = simd4f_add(rx,c[3][0]);
+        ry = simd4f_add(ry,c[3][1]);
+        rz = simd4f_add(rz,c[3][2]);
+    }
+    if (project)
+    {
+        simd4f rw = simd4f_add(simd4f_madd(z,c[2][3],simd4f_madd(y,c[1][3],simd4f_mul(x,c[0][3]))),c[3][3]);
+        simd4f d = simd4f_div(simd4f_splat(1.0f),rw);
+        rx = simd4f_mul(rx,d);
+        ry = simd4f_mul(ry,d);
+        rz = simd4f_mul(rz,d);
+    }
+    x = rx;
+    y = ry;
+    z = rz;
+}
+
+static void transform_vec3(const float* src, float* dst, unsigned int num, const float m[4][4], bool translate, bool project)
+{
+    simd4f c[4][4];
+    for(int row=0;row<4;++row)
+        for(int col=0;col<4;++col)
+            c[row][col] = simd4f_splat(m[row][col]);
+
+    unsigned int i=0;
+    for(;i+4<=num;i+=4,src+=12,dst+=12)
+    {
+        // each load picks up one point plus a stray component, which
+        // the transpose moves into the unused w register.
+        simd4f x = simd4f_load(src);
+        simd4f y = simd4f_load(src+3);
+        simd4f z = simd4f_load(src+6);
+        simd4f w = simd4f_load3(src+9);
+        simd4f_transpose(x,y,z,w);
+
+        transform_xyz(x,y,z,c,translate,project);
+
+        w = simd4f_zero();
+        simd4f_transpose(x,y,z,w);
+        // overlapping stores, each one overwrites the stray w of the previous.
+        simd4f_store(dst,x);
+        simd4f_store(dst+3,y);
+        simd4f_store(dst+6,z);
+        simd4f_store3(dst+9,w);
+    }
+
+    for(;i<num;++i,src+=3,dst+=3)
+    {
+        simd4f x = simd4f_load3(src);
+        simd4f y = simd4f_zero();
+        simd4f z = simd4f_zero();
+        simd4f w = simd4f_zero();
+        simd4f_transpose(x,y,z,w);
+
+        transform_xyz(x,y,z,c,translate,project);
+
+        simd4f_transpose(x,y,z,w);
+        simd4f_store3(dst,x);
+    }
+}
+
+void Matrixf::transform(const Vec3* src, Vec3* dst, unsigned int num) const
+{
+    transform_vec3((const float*)src,(float*)dst,num,_mat,true,getClassification()==PROJECTIVE);
+}
+
+void Matrixf::transform3x3(const Vec3* src, Vec3* dst, unsigned int num) const
+{
+    transform_vec3((const float*)src,(float*)dst,num,_mat,false,false);
+}
+
+void Matrixf::transformNormals(const Vec3* src, Vec3* dst, unsigned int num) const
+{
+    const float transposed[4][4] =
+    {
+        { _mat[0][0], _mat[1][0], _mat[2][0], 0.0f },
+        { _mat[0][1], _mat[1][1], _mat[2][1], 0.0f },
+        { _mat[0][2], _mat[1][2], _mat[2][2], 0.0f },
+        { 0.0f,       0.0f,       0.0f,       1.0f }
+    };
+    transform_vec3((const float*)src,(float*)dst,num,transposed,false,false);
+}
+
+void Matrixf::transform(const Vec4* src, Vec4* dst, unsigned int num) const
+{
+    simd4f c[4][4];
+    for(int row=0;row<4;++row)
+        for(int col=0;col<4;++col)
+            c[row][col] = simd4f_splat(_mat[row][col]);
+
+    const float* s = (const float*)src;
+    float* d = (float*)dst;
+
+    unsigned int i=0;
+    for(;i+4<=num;i+=4,s+=16,d+=16)
+    {
+        simd4f x = simd4f_load(s);
+        simd4f y = simd4f_load(s+4);
+        simd4f z = simd4f_load(s+8);
+        simd4f w = simd4f_load(s+12);
+        simd4f_transpose(x,y,z,w);
+
+        simd4f rx = simd4f_madd(w,c[3][0],simd4f_madd(z,c[2][0],simd4f_madd(y,c[1][0],simd4f_mul(x,c[0][0]))));
+        simd4f ry = simd4f_madd(w,c[3][1],simd4f_madd(z,c[2][1],simd4f_madd(y,c[1][1],simd4f_mul(x,c[0][1]))));
+        simd4f rz = simd4f_madd(w,c[3][2],simd4f_madd(z,c[2][2],simd4f_madd(y,c[1][2],simd4f_mul(x,c[0][2]))));
+        simd4f rw = simd4f_madd(w,c[3][3],simd4f_madd(z,c[2][3],simd4f_madd(y,c[1][3],simd4f_mul(x,c[0][3]))));
+
+        simd4f_transpose(rx,ry,rz,rw);
+        simd4f_store(d,rx);
+        simd4f_store(d+4,ry);
+        simd4f_store(d+8,rz);
+        simd4f_store(d+12,rw);
+    }
+
+    for(;i<num;++i)
+    {
+        dst[i] = preMult(src[i]);
+    }
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/Timer.h>
+#include <osg/ref_ptr.h>
+
+// the original scalar multiply, kept as the reference for benchmark_Matrix().
+#define INNER_PRODUCT(a,b,r,c) \
+     ((a)(r,0) * (b)(0,c)) \
+    +((a)(r,1) * (b)(1,c)) \
+    +((a)(r,2) * (b)(2,c)) \
+    +((a)(r,3) * (b)(3,c))
+
+static void mult_reference(Matrix& result, const Matrix& lhs, const Matrix& rhs)
+{
+    for(int row=0; row<4; ++row)
+        for(int col=0; col<4; ++col)
+            result(row,col) = INNER_PRODUCT(lhs, rhs, row, col);
+}
+
+#undef INNER_PRODUCT
+
+static float maxDifference(const Matrix& lhs, const Matrix& rhs)
+{
+    float maxDiff = 0.0f;
+    for(int row=0; row<4; ++row)
+        for(int col=0; col<4; ++col)
+            maxDiff = std::max(maxDiff,fabsf(lhs(row,col)-rhs(row,col)));
+    return maxDiff;
+}
+
+void benchmark_Matrix(unsigned int numIterations)
+{
+    osg::Timer timer;
+
+    Matrix affine = Matrix::scale(1.5f,2.0f,0.5f)*Matrix::rotate(0.3f,0.0f,0.0f,1.0f)*Matrix::translate(10.0f,-5.0f,2.0f);
+    Matrix projective = affine*Matrix::perspective(45.0,1.3,1.0,1000.0);
+
+    Matrix reference, result;
+    Timer_t t0, t1;
+
+    // multiply
+    t0 = timer.tick();
+    for(unsigned int i=0;i<numIterations;++i) { mult_reference(reference,affine,projective); affine(3,0) += 1e-6f; }
+    t1 = timer.tick();
+    double referenceMult = timer.delta_m(t0,t1);
+
+    t0 = timer.tick();
+    for(unsigned int i=0;i<numIterations;++i) { result.mult(affine,projective); affine(3,0) -= 1e-6f; }
+    t1 = timer.tick();
+    double simdMult = timer.delta_m(t0,t1);
+
+    mult_reference(reference,affine,projective);
+    result.mult(affine,projective);
+    std::cout<<"Matrix::mult          reference "<<referenceMult<<"ms  simd "<<simdMult<<"ms  max diff "<<maxDifference(reference,result)<<std::endl;
+
+    // general inverse
+    t0 = timer.tick();
+    for(unsigned int i=0;i<numIterations;++i) { invert_gaussJordan(reference,projective); projective(3,0) += 1e-6f; }
+    t1 = timer.tick();
+    double referenceInvert = timer.delta_m(t0,t1);
+
+    t0 = timer.tick();
+    for(unsigned int i=0;i<numIterations;++i) { result.invert_4x4(projective); projective(3,0) -= 1e-6f; }
+    t1 = timer.tick();
+    double simdInvert = timer.delta_m(t0,t1);
+
+    invert_gaussJordan(reference,projective);
+    result.invert_4x4(projective);
+    std::cout<<"Matrix::invert_4x4    reference "<<referenceInvert<<"ms  simd "<<simdInvert<<"ms  max diff "<<maxDifference(reference,result)<<std::endl;
+
+    // affine inverse
+    t0 = timer.tick();
+    for(unsigned int i=0;i<numIterations;++i) { invert_gaussJordan(reference,affine); affine(3,0) += 1e-6f; }
+    t1 = timer.tick();
+    referenceInvert = timer.delta_m(t0,t1);
+
+    t0 = timer.tick();
+    for(unsigned int i=0;i<numIterations;++i) { result.invert_4x3(affine); affine(3,0) -= 1e-6f; }
+    t1 = timer.tick();
+    double affineInvert = timer.delta_m(t0,t1);
+
+    invert_gaussJordan(reference,affine);
+    result.invert_4x3(affine);
+    std::cout<<"Matrix::invert_4x3    reference "<<referenceInvert<<"ms  affine "<<affineInvert<<"ms  max diff "<<maxDifference(reference,result)<<std::endl;
+
+    // batch point transforms, over one million points.
+    const unsigned int numPoints = 1000000;
+    ref_ptr<Vec3Array> pointArray = osgNew Vec3Array(numPoints);
+    ref_ptr<Vec3Array> resultArray = osgNew Vec3Array(numPoints);
+    Vec3Array& points = *pointArray;
+    Vec3Array& resultPoints = *resultArray;
+    std::vector<Vec3> referencePoints(numPoints);
+    for(unsigned int p=0;p<numPoints;++p) points[p].set((float)(p%101),(float)(p%37)*0.5f,(float)(p%13)-6.0f);
+
+    const Matrix* matrices[2] = { &affine, &projective };
+    const char* names[2] = { "affine    ", "projective" };
+    for(int mi=0;mi<2;++mi)
+    {
+        const Matrix& matrix = *matrices[mi];
+
+        t0 = timer.tick();
+        for(unsigned int p=0;p<numPoints;++p) referencePoints[p] = matrix.preMult(points[p]);
+        t1 = timer.tick();
+        double referenceTransform = timer.delta_m(t0,t1);
+
+        t0 = timer.tick();
+        matrix.transform(points,resultPoints);
+        t1 = timer.tick();
+        double simdTransform = timer.delta_m(t0,t1);
+
+        float maxDiff = 0.0f;
+        for(unsigned int p=0;p<numPoints;++p) maxDiff = std::max(maxDiff,(referencePoints[p]-resultPoints[p]).length());
+        std::cout<<"Matrix::transform "<<names[mi]<<" reference "<<referenceTransform<<"ms  simd "<<simdTransform<<"ms  max diff "<<maxDiff<<std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,631 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_MATRIXF
+#define OSG_MATRIXF 1
+
+#include <osg/Export.h>
+#include <osg/Vec3.h>
+#include <osg/Vec4.h>
+#include <osg/Vec3d.h>
+#include <osg/Vec4d.h>
+#include <osg/Array.h>
+
+#include <string.h>
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+
+namespace osg {
+
+class Quat;
+class Matrixd;
+
+/** Single precision 4x4 matrix, stored row major and applied to row
+  * vectors, i.e. v*M with the translation in the last row.
+  * Matrixf is a plain value type, use RefMatrix when a matrix needs to
+  * be reference counted and shared.*/
+class SG_EXPORT Matrixf
+{
+
+    public:
+
+        typedef float value_type;
+
+        /** Classification of the matrix by the kind of transform it applies,
+          * ordered from most to least specialised.  Each class is a subset
+          * of the ones that follow it, and is used to pick cheaper paths in
+          * multiplication, inversion and point transformation.*/
+        enum Classification
+        {
+            IDENTITY,
+            TRANSLATE,      ///< upper 3x3 is identity, non zero translation.
+            RIGID,          ///< upper 3x3 is orthonormal, plus translation.
+            AFFINE,         ///< last column is (0,0,0,1).
+            PROJECTIVE,
+            UNCLASSIFIED    ///< not yet computed, never returned by getClassification().
+        };
+
+        Matrixf();
+        Matrixf( const Matrixf& other);
+        explicit Matrixf( float const * const def );
+        Matrixf( float a00, float a01, float a02, float a03,
+            float a10, float a11, float a12, float a13,
+            float a20, float a21, float a22, float a23,
+            float a30, float a31, float a32, float a33);
+        Matrixf( const Matrixd& other);
+
+        ~Matrixf() {}
+
+
+        int compare(const Matrixf& m) const { return memcmp(_mat,m._mat,sizeof(_mat)); }
+
+        bool operator < (const Matrixf& m) const { return compare(m)<0; }
+        bool operator == (const Matrixf& m) const { return compare(m)==0; }
+        bool operator != (const Matrixf& m) const { return compare(m)!=0; }
+
+        inline float& operator()(int row, int col) { storeClassification(UNCLASSIFIED); return _mat[row][col]; }
+        inline float operator()(int row, int col) const { return _mat[row][col]; }
+
+        inline const bool valid() const { return !isNaN(); }
+        inline const bool isNaN() const { return osg::isNaN(_mat[0][0]) || osg::isNaN(_mat[0][1]) || osg::isNaN(_mat[0][2]) || osg::isNaN(_mat[0][3]) ||
+                                                 osg::isNaN(_mat[1][0]) || osg::isNaN(_mat[1][1]) || osg::isNaN(_mat[1][2]) || osg::isNaN(_mat[1][3]) ||
+                                                 osg::isNaN(_mat[2][0]) || osg::isNaN(_mat[2][1]) || osg::isNaN(_mat[2][2]) || osg::isNaN(_mat[2][3]) ||
+                                                 osg::isNaN(_mat[3][0]) || osg::isNaN(_mat[3][1]) || osg::isNaN(_mat[3][2]) || osg::isNaN(_mat[3][3]); }
+
+
+
+        inline Matrixf& operator = (const Matrixf& other)
+        {
+            if( &other == this ) return *this;
+            std::copy((const float*)other._mat,(const float*)other._mat+16,(float*)(_mat));
+            storeClassification(other.loadClassification());
+            return *this;
+        }
+        
+        Matrixf& operator = (const Matrixd& other);
+
+        inline void set(const Matrixf& other)
+        {
+            std::copy((const float*)other._mat,(const float*)other._mat+16,(float*)(_mat));
+            storeClassification(other.loadClassification());
+        }
+        
+        void set(const Matrixd& other);
+
+        inline void set(float const * const ptr)
+        {
+            std::copy(ptr,ptr+16,(float*)(_mat));
+            storeClassification(UNCLASSIFIED);
+        }
+        
+        void set( float a00, float a01, float a02, float a03,
+                  float a10, float a11, float a12, float a13,
+                  float a20, float a21, float a22, float a23,
+                  float a30, float a31, float a32, float a33);
+                  
+        float * ptr() { storeClassification(UNCLASSIFIED); return (float *)_mat; }
+        const float * ptr() const { return (const float *)_mat; }
+
+        void makeIdentity();
+        
+        void makeScale( const Vec3& );
+        void makeScale( float, float, float );
+        
+        void makeTranslate( const Vec3& );
+        void makeTranslate( float, float, float );
+        
+        void makeRotate( const Vec3& from, const Vec3& to );
+        void makeRotate( float angle, const Vec3& axis );
+        void makeRotate( float angle, float x, float y, float z );
+        void makeRotate( const Quat& );
+
+        /** make a rotation Matrix from euler angles.
+          * assume Z up, Y north, X east and euler convention
+          * as per Open Flight & Performer.
+          * Applies a positive rotation about Y axis for roll,
+          * then applies a positive roation about X for pitch,
+          * and finally a negative rotation about the Z axis.*/
+        void makeRotate( float heading, float pitch, float roll); //Euler angles
+        
+        
+        /** Set to a orthographic projection. See glOrtho for further details.*/
+        void makeOrtho(const double left, const double right,
+                       const double bottom, const double top,
+                       const double zNear, const double zFar);
+
+        /** Set to a 2D orthographic projection. See glOrtho2D for further details.*/
+        inline void makeOrtho2D(const double left, const double right,
+                                const double bottom, const double top)
+        {
+            makeOrtho(left,right,bottom,top,-1.0,1.0);
+        }
+
+        /** Set to a perspective projection. See glFrustum for further details.*/
+        void makeFrustum(const double left, const double right,
+                         const double bottom, const double top,
+                         const double zNear, const double zFar);
+
+        /** Set to a symmetrical perspective projection, See gluPerspective for further details.
+          * Aspect ratio is defined as width/height.*/
+        void makePerspective(const double fovy,const double aspectRatio,
+                             const double zNear, const double zFar);
+
+        /** Set to the position and orientation as per a camera, using the same convention as gluLookAt. */
+        void makeLookAt(const Vec3d& eye,const Vec3d& center,const Vec3d& up);
+        
+
+        /** invert the matrix rhs, automatically selecting the cheapest
+          * path for the classification of rhs.
+          * return false if rhs is singular.*/
+        bool invert( const Matrixf& rhs);
+
+        /** invert an affine matrix, i.e. one whose last column is (0,0,0,1),
+          * by inverting the upper 3x3 and back transforming the translation.
+          * Results are undefined if rhs is a projective matrix.*/
+        bool invert_4x3( const Matrixf& rhs);
+
+        /** invert a general 4x4 matrix.*/
+        bool invert_4x4( const Matrixf& rhs);
+
+        /** invert a rigid matrix, i.e. rotation and translation only, by
+          * transposing the upper 3x3. Results are undefined if the upper
+          * 3x3 of rhs is not orthonormal.*/
+        void invert_rigid( const Matrixf& rhs);
+
+        /** return true if the last column is (0,0,0,1), i.e. the matrix
+          * has no projective component.*/
+        inline bool isAffine() const { return _mat[0][3]==0.0f && _mat[1][3]==0.0f && _mat[2][3]==0.0f && _mat[3][3]==1.0f; }
+
+        /** return the classification of the matrix. It is computed on
+          * first use after the matrix has been modified and then cached,
+          * several threads may classify the same const matrix at once.
+          * The non-const operator() and ptr() drop the cached value as
+          * they may be written through, read a matrix which is not being
+          * modified through a const reference to keep it.
+          * RIGID allows a small tolerance on orthonormality, so that
+          * rotations built from Quat's still qualify.*/
+        inline Classification getClassification() const
+        {
+            Classification classification = loadClassification();
+            if (classification==UNCLASSIFIED)
+            {
+                classification = classify();
+                storeClassification(classification);
+            }
+            return classification;
+        }
+
+        /** return the cached classification without computing it,
+          * UNCLASSIFIED if the matrix has been modified since it was
+          * last classified. Used by operations too cheap to be worth
+          * classifying for, such as multiplication.*/
+        inline Classification getCachedClassification() const { return loadClassification(); }
+
+        //basic utility functions to create new matrices
+	inline static Matrixf identity( void );
+        inline static Matrixf scale( const Vec3& sv);
+        inline static Matrixf scale( float sx, float sy, float sz);
+        inline static Matrixf translate( const Vec3& dv);
+        inline static Matrixf translate( float x, float y, float z);
+        inline static Matrixf rotate( const Vec3& from, const Vec3& to);
+        inline static Matrixf rotate( float angle, float x, float y, float z);        
+        inline static Matrixf rotate( float angle, const Vec3& axis);
+        /** construct rotation matrix from euler angles, for conventions see makeRotate().*/
+        inline static Matrixf rotate( float heading, float pitch, float roll);
+        inline static Matrixf rotate( const Quat& quat);
+        inline static Matrixf inverse( const Matrixf& matrix);
+        
+        /** Create a orthographic projection. See glOrtho for further details.*/
+        inline static Matrixf ortho(const double left, const double right,
+                                   const double bottom, const double top,
+                                   const double zNear, const double zFar);
+
+        /** Create a 2D orthographic projection. See glOrtho for further details.*/
+        inline static Matrixf ortho2D(const double left, const double right,
+                                     const double bottom, const double top);
+
+        /** Create a perspective projection. See glFrustum for further details.*/
+        inline static Matrixf frustum(const double left, const double right,
+                                     const double bottom, const double top,
+                                     const double zNear, const double zFar);
+
+        /** Create a symmetrical perspective projection, See gluPerspective for further details.
+          * Aspect ratio is defined as width/height.*/
+        inline static Matrixf perspective(const double fovy,const double aspectRatio,
+                                         const double zNear, const double zFar);
+
+        /** Create the position and orientation as per a camera, using the same convention as gluLookAt. */
+        inline static Matrixf lookAt(const Vec3d& eye,const Vec3d& center,const Vec3d& up);
+
+
+        inline Vec3 preMult( const Vec3& v ) const;
+        inline Vec3 postMult( const Vec3& v ) const;
+        inline Vec3 operator* ( const Vec3& v ) const;
+        inline Vec4 preMult( const Vec4& v ) const;
+        inline Vec4 postMult( const Vec4& v ) const;
+        inline Vec4 operator* ( const Vec4& v ) const;
+
+        /** mixed precision transforms, the arithmetic is done in double so
+          * that large world coordinates keep their precision.*/
+        inline Vec3d preMult( const Vec3d& v ) const;
+        inline Vec3d postMult( const Vec3d& v ) const;
+        inline Vec3d operator* ( const Vec3d& v ) const;
+        inline Vec4d preMult( const Vec4d& v ) const;
+        inline Vec4d postMult( const Vec4d& v ) const;
+        inline Vec4d operator* ( const Vec4d& v ) const;
+
+        void setTrans( float tx, float ty, float tz );
+	void setTrans( const Vec3& v );
+        inline Vec3 getTrans() const { return Vec3(_mat[3][0],_mat[3][1],_mat[3][2]); } 
+        
+        inline Vec3 getScale() const { return Vec3(_mat[0][0],_mat[1][1],_mat[2][2]); }
+        
+    	/** apply apply an 3x3 transform of v*M[0..2,0..2]  */
+    	inline static Vec3 transform3x3(const Vec3& v,const Matrixf& m);
+    	/** apply apply an 3x3 transform of M[0..2,0..2]*v  */
+    	inline static Vec3 transform3x3(const Matrixf& m,const Vec3& v);
+
+        /** transform num points as per preMult(Vec3), i.e. dst[i] = src[i]*M
+          * including the divide by w for projective matrices.
+          * dst may be the same array as src, but must not partially overlap it.
+          * Points are processed four at a time with SIMD.*/
+        void transform(const Vec3* src, Vec3* dst, unsigned int num) const;
+
+        /** transform num vectors as per preMult(Vec4), i.e. dst[i] = src[i]*M.*/
+        void transform(const Vec4* src, Vec4* dst, unsigned int num) const;
+
+        /** apply the 3x3 transform src[i]*M[0..2,0..2] to num vectors,
+          * as per transform3x3(Vec3,Matrixf).*/
+        void transform3x3(const Vec3* src, Vec3* dst, unsigned int num) const;
+
+        /** apply the 3x3 transform M[0..2,0..2]*src[i] to num vectors,
+          * as per transform3x3(Matrixf,Vec3). Calling this on the inverse of a
+          * model matrix gives the correct transform for normals, as long as
+          * non uniform scales are acceptable to leave the normals unnormalized.*/
+        void transformNormals(const Vec3* src, Vec3* dst, unsigned int num) const;
+
+        /** transform all the points in src into dst, resizing dst to fit.*/
+        void transform(const Vec3Array& src, Vec3Array& dst) const;
+        /** transform all the points in array in place.*/
+        void transform(Vec3Array& array) const { transform(array,array); }
+        void transform(const Vec4Array& src, Vec4Array& dst) const;
+        void transform(Vec4Array& array) const { transform(array,array); }
+        void transform3x3(const Vec3Array& src, Vec3Array& dst) const;
+        void transform3x3(Vec3Array& array) const { transform3x3(array,array); }
+        void transformNormals(const Vec3Array& src, Vec3Array& dst) const;
+        void transformNormals(Vec3Array& array) const { transformNormals(array,array); }
+
+
+        // basic Matrix multiplication, our workhorse methods.
+        void mult( const Matrixf&, const Matrixf& );
+        void preMult( const Matrixf& );
+        void postMult( const Matrixf& );
+
+        inline void operator *= ( const Matrixf& other ) 
+        {    if( this == &other ) {
+                Matrixf temp(other);
+                postMult( temp );
+            }
+            else postMult( other ); 
+        }
+
+        inline Matrixf operator * ( const Matrixf &m ) const
+	{
+	    osg::Matrixf r;
+            r.mult(*this,m);
+	    return  r;
+	}
+
+
+// temporarily commented out while waiting for a more generic implementation
+// of MatrixProduct proxy class.
+//         // Helper class to optimize product expressions somewhat
+//         class MatrixProduct {
+//         public:
+//             const Matrixf& A;
+//             const Matrixf& B;
+// 
+//             MatrixProduct( const Matrixf& lhs, const Matrixf& rhs ) : A(lhs), B(rhs) {}
+//         };
+// 
+//         inline MatrixProduct operator * ( const Matrixf& other ) const    
+//             {    return MatrixProduct(*this, other); }
+// 
+//         inline void operator = ( const MatrixProduct& p ) 
+//             {
+//                 if( this == &(p.A)) postMult(p.B);
+//                 else if( this == &(p.B)) preMult(p.A);
+//                 else mult( p.A, p.B );
+//             }
+// 
+//         Matrixf( const MatrixProduct& p ) //allows implicit evaluation of the product
+//             {    mult( p.A, p.B ); }
+
+    private:
+
+        Classification classify() const;
+
+        // relaxed as the classification only caches a function of _mat.
+        inline Classification loadClassification() const { return (Classification)_classification.load(std::memory_order_relaxed); }
+        inline void storeClassification(Classification classification) const { _classification.store((unsigned char)classification,std::memory_order_relaxed); }
+
+        float _mat[4][4];
+        mutable std::atomic<unsigned char> _classification;
+
+};
+
+//static utility methods
+inline Matrixf Matrixf::identity(void)
+{
+    Matrixf m;
+    m.makeIdentity();
+    return m;
+}
+
+inline Matrixf Matrixf::scale(float sx, float sy, float sz)
+{
+    Matrixf m;
+    m.makeScale(sx,sy,sz);
+    return m;
+}
+
+inline Matrixf Matrixf::scale(const Vec3& v )
+{
+    return scale(v.x(), v.y(), v.z() );
+}
+
+inline Matrixf Matrixf::translate(float tx, float ty, float tz)
+{
+    Matrixf m;
+    m.makeTranslate(tx,ty,tz);
+    return m;
+}
+
+inline Matrixf Matrixf::translate(const Vec3& v )
+{
+    return translate(v.x(), v.y(), v.z() );
+}
+
+inline Matrixf Matrixf::rotate( const Quat& q )
+{
+    Matrixf m;
+    m.makeRotate( q );
+    return m;
+}
+inline Matrixf Matrixf::rotate(float angle, float x, float y, float z )
+{
+    Matrixf m;
+    m.makeRotate(angle,x,y,z);
+    return m;
+}
+inline Matrixf Matrixf::rotate(float angle, const Vec3& axis )
+{
+    Matrixf m;
+    m.makeRotate(angle,axis);
+    return m;
+}
+inline Matrixf Matrixf::rotate(float heading, float pitch, float roll)
+{
+    Matrixf m;
+    m.makeRotate(heading,pitch,roll);
+    return m;
+}
+inline Matrixf Matrixf::rotate(const Vec3& from, const Vec3& to )
+{
+    Matrixf m;
+    m.makeRotate(from,to);
+    return m;
+}
+
+inline Matrixf Matrixf::inverse( const Matrixf& matrix)
+{
+    Matrixf m;
+    m.invert(matrix);
+    return m;
+}
+
+inline Matrixf Matrixf::ortho(const double left, const double right,
+                            const double bottom, const double top,
+                            const double zNear, const double zFar)
+{
+    Matrixf m;
+    m.makeOrtho(left,right,bottom,top,zNear,zFar);
+    return m;
+}
+
+inline Matrixf Matrixf::ortho2D(const double left, const double right,
+                              const double bottom, const double top)
+{
+    Matrixf m;
+    m.makeOrtho2D(left,right,bottom,top);
+    return m;
+}
+
+inline Matrixf Matrixf::frustum(const double left, const double right,
+                              const double bottom, const double top,
+                              const double zNear, const double zFar)
+{
+    Matrixf m;
+    m.makeFrustum(left,right,bottom,top,zNear,zFar);
+    return m;
+}
+
+inline Matrixf Matrixf::perspective(const double fovy,const double aspectRatio,
+                                  const double zNear, const double zFar)
+{
+    Matrixf m;
+    m.makePerspective(fovy,aspectRatio,zNear,zFar);
+    return m;
+}
+
+inline Matrixf Matrixf::lookAt(const Vec3d& eye,const Vec3d& center,const Vec3d& up)
+{
+    Matrixf m;
+    m.makeLookAt(eye,center,up);
+    return m;
+}
+
+
+inline Vec3 Matrixf::postMult( const Vec3& v ) const
+{
+    float d = 1.0f/(_mat[3][0]*v.x()+_mat[3][1]*v.y()+_mat[3][2]*v.z()+_mat[3][3]) ;
+    return Vec3( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3])*d,
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3])*d,
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3])*d) ;
+}
+
+inline Vec3 Matrixf::preMult( const Vec3& v ) const
+{
+    switch(loadClassification())
+    {
+        case(IDENTITY):
+            return v;
+        case(TRANSLATE):
+            return Vec3(v.x()+_mat[3][0],v.y()+_mat[3][1],v.z()+_mat[3][2]);
+        case(RIGID):
+        case(AFFINE):
+            return Vec3( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]),
+                (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]),
+                (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]));
+        default:
+            break;
+    }
+    float d = 1.0f/(_mat[0][3]*v.x()+_mat[1][3]*v.y()+_mat[2][3]*v.z()+_mat[3][3]) ;
+    return Vec3( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0])*d,
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1])*d,
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2])*d);
+}
+
+inline Vec4 Matrixf::postMult( const Vec4& v ) const
+{
+    return Vec4( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3]*v.w()),
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3]*v.w()),
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3]*v.w()),
+        (_mat[3][0]*v.x() + _mat[3][1]*v.y() + _mat[3][2]*v.z() + _mat[3][3]*v.w())) ;
+}
+
+inline Vec4 Matrixf::preMult( const Vec4& v ) const
+{
+    return Vec4( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]*v.w()),
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]*v.w()),
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]*v.w()),
+        (_mat[0][3]*v.x() + _mat[1][3]*v.y() + _mat[2][3]*v.z() + _mat[3][3]*v.w()));
+}
+inline Vec3 Matrixf::transform3x3(const Vec3& v,const Matrixf& m)
+{
+    return Vec3( (m._mat[0][0]*v.x() + m._mat[1][0]*v.y() + m._mat[2][0]*v.z()),
+                 (m._mat[0][1]*v.x() + m._mat[1][1]*v.y() + m._mat[2][1]*v.z()),
+                 (m._mat[0][2]*v.x() + m._mat[1][2]*v.y() + m._mat[2][2]*v.z()));
+}
+
+inline Vec3 Matrixf::transform3x3(const Matrixf& m,const Vec3& v)
+{
+    return Vec3( (m._mat[0][0]*v.x() + m._mat[0][1]*v.y() + m._mat[0][2]*v.z()),
+                 (m._mat[1][0]*v.x() + m._mat[1][1]*v.y() + m._mat[1][2]*v.z()),
+                 (m._mat[2][0]*v.x() + m._mat[2][1]*v.y() + m._mat[2][2]*v.z()) ) ;
+}
+
+
+inline Vec3 operator* (const Vec3& v, const Matrixf& m )
+{
+	return m.preMult(v);
+}
+inline Vec4 operator* (const Vec4& v, const Matrixf& m )
+{
+	return m.preMult(v);
+}
+
+inline Vec3 Matrixf::operator* (const Vec3& v) const
+{
+	return postMult(v);
+}
+inline Vec4 Matrixf::operator* (const Vec4& v) const
+{
+	return postMult(v);
+}
+
+inline Vec3d Matrixf::postMult( const Vec3d& v ) const
+{
+    double d = 1.0/(_mat[3][0]*v.x()+_mat[3][1]*v.y()+_mat[3][2]*v.z()+_mat[3][3]) ;
+    return Vec3d( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3])*d,
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3])*d,
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3])*d) ;
+}
+
+inline Vec3d Matrixf::preMult( const Vec3d& v ) const
+{
+    switch(loadClassification())
+    {
+        case(IDENTITY):
+            return v;
+        case(TRANSLATE):
+            return Vec3d(v.x()+_mat[3][0],v.y()+_mat[3][1],v.z()+_mat[3][2]);
+        case(RIGID):
+        case(AFFINE):
+            return Vec3d( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]),
+                (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]),
+                (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]));
+        default:
+            break;
+    }
+    double d = 1.0/(_mat[0][3]*v.x()+_mat[1][3]*v.y()+_mat[2][3]*v.z()+_mat[3][3]) ;
+    return Vec3d( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0])*d,
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1])*d,
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2])*d);
+}
+
+inline Vec4d Matrixf::postMult( const Vec4d& v ) const
+{
+    return Vec4d( (_mat[0][0]*v.x() + _mat[0][1]*v.y() + _mat[0][2]*v.z() + _mat[0][3]*v.w()),
+        (_mat[1][0]*v.x() + _mat[1][1]*v.y() + _mat[1][2]*v.z() + _mat[1][3]*v.w()),
+        (_mat[2][0]*v.x() + _mat[2][1]*v.y() + _mat[2][2]*v.z() + _mat[2][3]*v.w()),
+        (_mat[3][0]*v.x() + _mat[3][1]*v.y() + _mat[3][2]*v.z() + _mat[3][3]*v.w())) ;
+}
+
+inline Vec4d Matrixf::preMult( const Vec4d& v ) const
+{
+    return Vec4d( (_mat[0][0]*v.x() + _mat[1][0]*v.y() + _mat[2][0]*v.z() + _mat[3][0]*v.w()),
+        (_mat[0][1]*v.x() + _mat[1][1]*v.y() + _mat[2][1]*v.z() + _mat[3][1]*v.w()),
+        (_mat[0][2]*v.x() + _mat[1][2]*v.y() + _mat[2][2]*v.z() + _mat[3][2]*v.w()),
+        (_mat[0][3]*v.x() + _mat[1][3]*v.y() + _mat[2][3]*v.z() + _mat[3][3]*v.w()));
+}
+
+inline Vec3d operator* (const Vec3d& v, const Matrixf& m )
+{
+	return m.preMult(v);
+}
+inline Vec4d operator* (const Vec4d& v, const Matrixf& m )
+{
+	return m.preMult(v);
+}
+
+inline Vec3d Matrixf::operator* (const Vec3d& v) const
+{
+	return postMult(v);
+}
+inline Vec4d Matrixf::operator* (const Vec4d& v) const
+{
+	return postMult(v);
+}
+
+inline std::ostream& operator<< (std::ostream& os, const Matrixf& m )
+{
+    os << "{"<<std::endl;
+    for(int row=0; row<4; ++row) {
+        os << "\t";
+        for(int col=0; col<4; ++col)
+            os << m(row,col) << " ";
+        os << std::endl;
+    }
+    os << "}" << std::endl;
+    return os;
+}
+
+
+} //namespace osg
+
+
+#endif
@@ -53,17 +53,83 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <assert.h>
 #include <string.h>
 #include <time.h>
 #include <stdarg.h>
 #include <new>
+#include <atomic>
+#include <thread>
 
 #if defined(__CYGWIN__) || !defined(WIN32)
 #include <unistd.h>
+#include <sys/mman.h>
+#else
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
 #endif
 
 #include <osg/MemoryManager>
+#include <osg/MemoryPool.h>
+#include <osg/Referenced.h>
+#include <typeinfo>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// The pool allocator statistics are reported with or without the memory manager
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static    void    getPoolStatistics(sMStats &stats)
+{
+    osg::MemoryPool::Statistics    poolStats = osg::MemoryPool::getStatistics();
+    stats.poolReservedMemory = poolStats.reservedMemory;
+    stats.poolUsedMemory     = poolStats.usedMemory;
+    stats.poolAllocUnitCount = poolStats.allocationCount;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Snapshots are plain malloc'ed memory, so that taking one does not disturb the allocations it reports
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static    sMSnapshot    *newSnapshot(const unsigned int entryCount)
+{
+    sMSnapshot    *snapshot = (sMSnapshot *) calloc(1, sizeof(sMSnapshot));
+    if (!snapshot) return NULL;
+
+    snapshot->entries = (sMEntry *) calloc(entryCount ? entryCount : 1, sizeof(sMEntry));
+    if (!snapshot->entries)
+    {
+        free(snapshot);
+        return NULL;
+    }
+
+    return snapshot;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static    int    compareEntryNames(const void *lhs, const void *rhs)
+{
+    const sMEntry    *a = (const sMEntry *) lhs;
+    const sMEntry    *b = (const sMEntry *) rhs;
+    if (a->kind != b->kind) return a->kind < b->kind ? -1 : 1;
+    return strcmp(a->name, b->name);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+static    int    compareEntrySizes(const void *lhs, const void *rhs)
+{
+    const sMEntry    *a = (const sMEntry *) lhs;
+    const sMEntry    *b = (const sMEntry *) rhs;
+    if (a->kind != b->kind) return a->kind < b->kind ? -1 : 1;
+    if (a->liveBytes != b->liveBytes) return a->liveBytes > b->liveBytes ? -1 : 1;
+    return strcmp(a->name, b->name);
+}
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 // -DOC- If you're like me, it's hard to gain trust in foreign code. This memory manager will try to INDUCE your code to crash (for
@@ -120,11 +186,16 @@ const        unsigned int    m_alloc_delete         = 6;
 const        unsigned int    m_alloc_delete_array   = 7;
 const        unsigned int    m_alloc_free           = 8;
 
-static        sMStats        stats;
-sMStats    m_getMemoryStatistics()
-{
-    return stats;
-}
+const        unsigned int    m_format_json          = 0;
+const        unsigned int    m_format_csv           = 1;
+
+const        unsigned int    m_entry_site           = 0;
+const        unsigned int    m_entry_class          = 1;
+
+const        unsigned int    m_guard_padding        = 0;
+const        unsigned int    m_guard_canary         = 1;
+const        unsigned int    m_guard_pages          = 2;
+const        unsigned int    m_guard_wipe_on_free   = 3;
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 // follows are the full implementations for use with OSG_USE_MEMORY_MANAGER in debug builds,
@@ -154,7 +225,6 @@ sMStats    m_getMemoryStatistics()
     // ---------------------------------------------------------------------------------------------------------------------------------
 
     #ifdef    STRESS_TEST
-    static    const    unsigned int    hashBits               = 12;
     static        bool        randomWipe             = true;
     static        bool        alwaysValidateAll      = true;
     static        bool        alwaysLogAll           = true;
@@ -162,7 +232,6 @@ sMStats    m_getMemoryStatistics()
     static        bool        cleanupLogOnFirstRun   = true;
     static    const    unsigned int    paddingSize            = 1024; // An extra 8K per allocation!
     #else
-    static    const    unsigned int    hashBits               = 12;
     static        bool        randomWipe             = false;
     static        bool        alwaysValidateAll      = false;
     static        bool        alwaysLogAll           = false;
@@ -171,6 +240,27 @@ sMStats    m_getMemoryStatistics()
     static    const    unsigned int    paddingSize            = 4;
     #endif
 
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- Guard modes -- the padding and wipes above catch most corruption, but cost 2 * paddingSize longs and two passes over
+    // every block. The cheaper modes let the tracker run on realistic scenes:
+    //
+    //   m_guard_padding       paddingSize longs before and after each block, blocks wiped on allocation and release if alwaysWipeAll
+    //   m_guard_canary        a headerSize prefix and a canarySize footer, checked on release and validation, no wipes
+    //   m_guard_pages         canaries, and one allocation in guardPageRate placed at the end of its own pages, just before an
+    //                         inaccessible page, so that an overrun faults at the offending instruction. Released guarded blocks stay
+    //                         inaccessible in a quarantine of the last guardQuarantineSize, so that using them after release faults too.
+    //   m_guard_wipe_on_free  a headerSize prefix only, blocks wiped with the releasedPattern when released
+    //
+    // Each allocation keeps the mode it was made with, so the mode can be changed at any time.
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    static    const    unsigned int    headerSize             = 16;   // Smallest prefix, keeps the reported addresses 16 byte aligned
+    static    const    unsigned int    canarySize             = 8;
+    static    const    unsigned int    guardQuarantineSize    = 256;
+    static        std::atomic<unsigned int>    guardMode(m_guard_padding);
+    static        std::atomic<unsigned int>    guardPageRate(64);
+    static    thread_local    unsigned int    guardPageCountdown = 0;
+
     // ---------------------------------------------------------------------------------------------------------------------------------
     // We define our own assert, because we don't want to bring up an assertion dialog, since that allocates RAM. Our new assert
     // simply declares a forced breakpoint.
@@ -195,24 +285,127 @@ sMStats    m_getMemoryStatistics()
     static        unsigned int    postfixPattern         = 0xdeadc0de; // Fill pattern for bytes following allocated blocks
     static        unsigned int    unusedPattern          = 0xfeedface; // Fill pattern for freshly allocated blocks
     static        unsigned int    releasedPattern        = 0xdeadbeef; // Fill pattern for deallocated blocks
+    static        unsigned int    untrackedPattern       = 0x5ca1ab1e; // Fill pattern for the header of blocks not sampled for tracking
 
     // ---------------------------------------------------------------------------------------------------------------------------------
     // Other locals
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    const    unsigned int    hashSize               = 1 << hashBits;
     static    const    char        *allocationTypes[]     = {"Unknown",
                                   "new",     "new[]",  "malloc",   "calloc",
                                   "realloc", "delete", "delete[]", "free"};
-    static        sAllocUnit    *hashTable[hashSize];
-    static        sAllocUnit    *reservoir;
-    static        unsigned int    currentAllocationCount = 0;
+    static    const    char        *guardModes[]          = {"padding", "canary", "pages", "wipe"};
+    static        std::atomic<unsigned int>    currentAllocationCount(0);
     static        unsigned int    breakOnAllocationCount = 0;
-    static    const    char        *sourceFile            = "??";
-    static        unsigned int    sourceLine             = 0;
     static        bool        staticDeinitTime       = false;
-    static        sAllocUnit    **reservoirBuffer      = NULL;
-    static        unsigned int    reservoirBufferSize    = 0;
+
+    // The owner set by m_setOwner() is kept per thread, so that allocations made by several threads at once are attributed to the
+    // right source lines.
+
+    static    thread_local    const char    *sourceFile        = "??";
+    static    thread_local    unsigned int    sourceLine         = 0;
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- The allocation units live in shardCount independent hash tables, picked by address, each with its own lock, so that
+    // threads allocating at the same time rarely wait for each other. Each table uses open addressing with linear probing and is
+    // rebuilt at twice the size as it fills, so finding an allocation stays O(1) however many are live.
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    static    const    unsigned int    shardBits              = 6;
+    static    const    unsigned int    shardCount             = 1 << shardBits;
+    static    const    unsigned int    initialTableSize       = 256;
+
+    typedef    struct
+    {
+        std::atomic<int>    lock;
+        sAllocUnit    **table;
+        unsigned int    tableSize;
+        unsigned int    unitCount;
+        unsigned int    deletedCount;
+        sAllocUnit    *reservoir;
+        sAllocUnit    **reservoirBuffer;
+        unsigned int    reservoirBufferSize;
+        unsigned long long    accumulatedReportedMemory;
+        unsigned long long    accumulatedActualMemory;
+        unsigned long long    accumulatedAllocUnitCount;
+        char        padding[64];    // Keeps the locks of neighbouring shards off the same cache line
+    } sShard;
+
+    static        sShard        shards[shardCount];
+    static        sAllocUnit    deletedUnit;    // Marks a table slot whose unit was removed, lookups probe on past it
+
+    // Totals and peaks across all the shards
+
+    static        std::atomic<unsigned long long>    totalReportedMemory(0);
+    static        std::atomic<unsigned long long>    totalActualMemory(0);
+    static        std::atomic<unsigned long long>    totalAllocUnitCount(0);
+    static        std::atomic<unsigned long long>    peakReportedMemory(0);
+    static        std::atomic<unsigned long long>    peakActualMemory(0);
+    static        std::atomic<unsigned long long>    peakAllocUnitCount(0);
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- Allocation sites. Each tracked allocation is counted against its owner (sourceFile:sourceLine) as it is made and freed, so
+    // the live and peak bytes of every site are known when m_takeSnapshot() is called. The sites are never removed.
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    typedef    struct
+    {
+        char        sourceFile[40];
+        unsigned int    sourceLine;
+        unsigned long long    liveBytes;
+        unsigned long long    liveCount;
+        unsigned long long    peakBytes;
+        unsigned long long    allocationCount;
+    } sSite;
+
+    static    const    unsigned int    noSite                 = 0xffffffff;
+    static        std::atomic<int>    siteLock(0);
+    static        sSite        *sites                 = NULL;
+    static        unsigned int    siteCount              = 0;
+    static        unsigned int    siteCapacity           = 0;
+    static        unsigned int    *siteTable             = NULL;    // Open addressing by owner, holds site index + 1, 0 when empty
+    static        unsigned int    siteTableSize          = 0;
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- Sampling. With a sample rate of N only about one allocation in N is tracked, the others just get a header marked with
+    // the untrackedPattern and go straight to malloc and free, so that the tracker can be left running in production to catch leaks.
+    // Statistics, memory reports and leak reports then only cover the tracked allocations. Set the rate with m_setSampleRate() or
+    // the OSG_MM_SAMPLE_RATE environment variable, a rate of 1 tracks everything.
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    static        std::atomic<unsigned int>    sampleRate(1);
+    static    thread_local    unsigned int    sampleCountdown    = 0;
+    static    thread_local    unsigned int    sampleSeed         = 0;
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // A spin lock guards each shard, unlike a mutex it never allocates and needs no constructor, so it works for allocations made
+    // during static initialization.
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    class    MemLock
+    {
+        public:
+            MemLock(std::atomic<int> &lock) : _lock(lock)
+            {
+                while (_lock.exchange(1, std::memory_order_acquire)) std::this_thread::yield();
+            }
+            ~MemLock()
+            {
+                _lock.store(0, std::memory_order_release);
+            }
+        private:
+            MemLock &operator = (const MemLock &);
+            std::atomic<int>    &_lock;
+    };
+
+    static        std::atomic<int>    logLock(0);
+
+    // Released guarded blocks, oldest first from quarantineNext
+
+    static        std::atomic<int>    quarantineLock(0);
+    static        void        *quarantineAddress[guardQuarantineSize];
+    static        size_t        quarantineSize[guardQuarantineSize];
+    static        unsigned int    quarantineNext         = 0;
 
 
 
@@ -229,6 +422,7 @@ sMStats    m_getMemoryStatistics()
         alwaysLogAll           = true;
         alwaysWipeAll          = true;
         cleanupLogOnFirstRun   = true;
+        guardMode              = m_guard_padding;
     }
 
 
@@ -245,6 +439,24 @@ sMStats    m_getMemoryStatistics()
                     activateStressTest();
                 }
 
+                if( (ptr = getenv("OSG_MM_SAMPLE_RATE")) != 0)
+                {
+                    m_setSampleRate(atoi(ptr));
+                }
+
+                if( (ptr = getenv("OSG_MM_GUARD_MODE")) != 0)
+                {
+                    for (unsigned int i = 0; i < sizeof(guardModes) / sizeof(guardModes[0]); i++)
+                    {
+                        if (strcmp(ptr, guardModes[i]) == 0) m_setGuardMode(i);
+                    }
+                }
+
+                if( (ptr = getenv("OSG_MM_GUARD_PAGE_RATE")) != 0)
+                {
+                    m_setGuardPageRate(atoi(ptr));
+                }
+
                 if( (ptr = getenv("OSG_MM_BREAK_ON_ALLOCATION")) != 0)
                 {
                     if (strcmp(ptr,"OFF")!=0)
@@ -295,7 +507,7 @@ sMStats    m_getMemoryStatistics()
 
     static    const char    *ownerString(const char *sourceFile, const unsigned int sourceLine)
     {
-        static    char    str[90];
+        static    thread_local    char    str[90];
         memset(str, 0, sizeof(str));
         sprintf(str, "%s(%05d)", sourceFileStripper(sourceFile), sourceLine);
         return str;
@@ -303,37 +515,33 @@ sMStats    m_getMemoryStatistics()
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    const char    *insertCommas(unsigned int value)
+    static    const char    *insertCommas(unsigned long long value)
     {
-        static    char    str[30];
-        memset(str, 0, sizeof(str));
+        static    thread_local    char    str[30];
+        char    digits[24];
+        sprintf(digits, "%llu", value);
 
-        sprintf(str, "%u", value);
-        if (strlen(str) > 3)
-        {
-            memmove(&str[strlen(str)-3], &str[strlen(str)-4], 4);
-            str[strlen(str) - 4] = ',';
-        }
-        if (strlen(str) > 7)
-        {
-            memmove(&str[strlen(str)-7], &str[strlen(str)-8], 8);
-            str[strlen(str) - 8] = ',';
-        }
-        if (strlen(str) > 11)
+        // A comma before every group of three digits counted from the right
+
+        unsigned int    length = (unsigned int) strlen(digits);
+        char        *ptr = str;
+        for (unsigned int i = 0; i < length; i++)
         {
-            memmove(&str[strlen(str)-11], &str[strlen(str)-12], 12);
-            str[strlen(str) - 12] = ',';
+            if (i && (length - i) % 3 == 0) *ptr++ = ',';
+            *ptr++ = digits[i];
         }
+        *ptr = 0;
 
         return str;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    const char    *memorySizeString(unsigned long size)
+    static    const char    *memorySizeString(unsigned long long size)
     {
-        static    char    str[90];
-             if (size > (1024*1024))    sprintf(str, "%10s (%7.2fM)", insertCommas(size), (float) size / (1024.0f * 1024.0f));
+        static    thread_local    char    str[90];
+             if (size > (1024*1024*1024))    sprintf(str, "%10s (%7.2fG)", insertCommas(size), (float) size / (1024.0f * 1024.0f * 1024.0f));
+        else if (size > (1024*1024))    sprintf(str, "%10s (%7.2fM)", insertCommas(size), (float) size / (1024.0f * 1024.0f));
         else if (size > 1024)        sprintf(str, "%10s (%7.2fK)", insertCommas(size), (float) size / 1024.0f);
         else                sprintf(str, "%10s bytes     ", insertCommas(size));
         return str;
@@ -341,21 +549,42 @@ sMStats    m_getMemoryStatistics()
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    sAllocUnit    *findAllocUnit(const void *reportedAddress)
+    static    unsigned long long    addressHash(const void *reportedAddress)
+    {
+        // Shift off the lower four bits, which are mostly zero because of alignment, then mix the rest so that both the shard,
+        // taken from the top bits, and the table slot, taken from the upper half, are well spread.
+
+        return ((unsigned long long) (size_t) reportedAddress >> 4) * 0x9e3779b97f4a7c15ULL;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    static    sShard    &findShard(const void *reportedAddress)
+    {
+        return shards[addressHash(reportedAddress) >> (64 - shardBits)];
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    static    unsigned int    firstSlot(const void *reportedAddress, const unsigned int tableSize)
+    {
+        return (unsigned int) (addressHash(reportedAddress) >> 32) & (tableSize - 1);
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // The following table functions must be called with the shard locked.
+
+    static    sAllocUnit    **findSlot(sShard &shard, const void *reportedAddress)
     {
         // Just in case...
         m_assert(reportedAddress != NULL);
 
-        // Use the address to locate the hash index. Note that we shift off the lower four bits. This is because most allocated
-        // addresses will be on four-, eight- or even sixteen-byte boundaries. If we didn't do this, the hash index would not have
-        // very good coverage.
+        if (!shard.table) return NULL;
 
-        unsigned int    hashIndex = ((unsigned int) reportedAddress >> 4) & (hashSize - 1);
-        sAllocUnit    *ptr = hashTable[hashIndex];
-        while(ptr)
+        unsigned int    mask = shard.tableSize - 1;
+        for (unsigned int i = firstSlot(reportedAddress, shard.tableSize); shard.table[i]; i = (i + 1) & mask)
         {
-            if (ptr->reportedAddress == reportedAddress) return ptr;
-            ptr = ptr->next;
+            if (shard.table[i] != &deletedUnit && shard.table[i]->reportedAddress == reportedAddress) return &shard.table[i];
         }
 
         return NULL;
@@ -363,913 +592,1404 @@ sMStats    m_getMemoryStatistics()
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    size_t    calculateActualSize(const size_t reportedSize)
+    static    bool    growTable(sShard &shard)
     {
-        // We use DWORDS as our padding, and a long is guaranteed to be 4 bytes, but an int is not (ANSI defines an int as
-        // being the standard word size for a processor; on a 32-bit machine, that's 4 bytes, but on a 64-bit machine, it's
-        // 8 bytes, which means an int can actually be larger than a long.)
+        // Rebuild the table at least a quarter full at most, dropping the deleted markers
 
-        return reportedSize + paddingSize * sizeof(long) * 2;
-    }
+        unsigned int    newSize = initialTableSize;
+        while (newSize < (shard.unitCount + 1) * 4) newSize *= 2;
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
+        sAllocUnit    **newTable = (sAllocUnit **) calloc(newSize, sizeof(sAllocUnit *));
+        if (!newTable) return false;
 
-    static    size_t    calculateReportedSize(const size_t actualSize)
-    {
-        // We use DWORDS as our padding, and a long is guaranteed to be 4 bytes, but an int is not (ANSI defines an int as
-        // being the standard word size for a processor; on a 32-bit machine, that's 4 bytes, but on a 64-bit machine, it's
-        // 8 bytes, which means an int can actually be larger than a long.)
+        for (unsigned int i = 0; i < shard.tableSize; i++)
+        {
+            sAllocUnit    *ptr = shard.table[i];
+            if (!ptr || ptr == &deletedUnit) continue;
+
+            unsigned int    j = firstSlot(ptr->reportedAddress, newSize);
+            while (newTable[j]) j = (j + 1) & (newSize - 1);
+            newTable[j] = ptr;
+        }
 
-        return actualSize - paddingSize * sizeof(long) * 2;
+        free(shard.table);
+        shard.table = newTable;
+        shard.tableSize = newSize;
+        shard.deletedCount = 0;
+        return true;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    void    *calculateReportedAddress(const void *actualAddress)
+    static    bool    insertAllocUnit(sShard &shard, sAllocUnit *allocUnit)
     {
-        // We allow this...
+        // Keep the table, deleted markers included, at most half full so that probe sequences stay short
 
-        if (!actualAddress) return NULL;
+        if ((shard.unitCount + shard.deletedCount + 1) * 2 > shard.tableSize && !growTable(shard)) return false;
 
-        // JUst account for the padding
+        unsigned int    mask = shard.tableSize - 1;
+        unsigned int    i = firstSlot(allocUnit->reportedAddress, shard.tableSize);
+        while (shard.table[i] && shard.table[i] != &deletedUnit) i = (i + 1) & mask;
+        if (shard.table[i] == &deletedUnit) shard.deletedCount--;
+        shard.table[i] = allocUnit;
+        shard.unitCount++;
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        return (void *) ((char *) actualAddress + sizeof(long) * paddingSize);
+    static    void    removeAllocUnit(sShard &shard, sAllocUnit **slot)
+    {
+        *slot = &deletedUnit;
+        shard.deletedCount++;
+        shard.unitCount--;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    void    wipeWithPattern(sAllocUnit *allocUnit, unsigned long pattern, const unsigned int originalReportedSize = 0)
+    static    sAllocUnit    *newAllocUnit(sShard &shard)
     {
-        // For a serious test run, we use wipes of random a random value. However, if this causes a crash, we don't want it to
-        // crash in a differnt place each time, so we specifically DO NOT call srand. If, by chance your program calls srand(),
-        // you may wish to disable that when running with a random wipe test. This will make any crashes more consistent so they
-        // can be tracked down easier.
+        // If necessary, grow the reservoir of unused allocation units
 
-        if (randomWipe)
+        if (!shard.reservoir)
         {
-            pattern = ((rand() & 0xff) << 24) | ((rand() & 0xff) << 16) | ((rand() & 0xff) << 8) | (rand() & 0xff);
-        }
+            // Allocate 256 reservoir elements
 
-        // -DOC- We should wipe with 0's if we're not in debug mode, so we can help hide bugs if possible when we release the
-        // product. So uncomment the following line for releases.
-        //
-        // Note that the "alwaysWipeAll" should be turned on for this to have effect, otherwise it won't do much good. But we'll
-        // leave it this way (as an option) because this does slow things down.
-    //    pattern = 0;
+            shard.reservoir = (sAllocUnit *) malloc(sizeof(sAllocUnit) * 256);
 
-        // This part of the operation is optional
+            // If you hit this assert, then the memory manager failed to allocate internal memory for tracking the
+            // allocations
+            m_assert(shard.reservoir != NULL);
 
-        if (alwaysWipeAll && allocUnit->reportedSize > originalReportedSize)
-        {
-            // Fill the bulk
+            // Danger Will Robinson!
 
-            long    *lptr = (long *) ((char *)allocUnit->reportedAddress + originalReportedSize);
-            int    length = allocUnit->reportedSize - originalReportedSize;
-            int    i;
-            for (i = 0; i < (length >> 2); i++, lptr++)
+            if (shard.reservoir == NULL) throw "Unable to allocate RAM for internal memory tracking data";
+
+            // Build a linked-list of the elements in our reservoir
+
+            memset(shard.reservoir, 0, sizeof(sAllocUnit) * 256);
+            for (unsigned int i = 0; i < 256 - 1; i++)
             {
-                *lptr = pattern;
+                shard.reservoir[i].next = &shard.reservoir[i+1];
             }
 
-            // Fill the remainder
+            // Add this address to our reservoirBuffer so we can free it later
 
-            unsigned int    shiftCount = 0;
-            char        *cptr = (char *) lptr;
-            for (i = 0; i < (length & 0x3); i++, cptr++, shiftCount += 8)
+            sAllocUnit    **temp = (sAllocUnit **) realloc(shard.reservoirBuffer, (shard.reservoirBufferSize + 1) * sizeof(sAllocUnit *));
+            m_assert(temp);
+            if (temp)
             {
-                *cptr = static_cast<char>((pattern >> shiftCount) & 0xff);
+                shard.reservoirBuffer = temp;
+                shard.reservoirBuffer[shard.reservoirBufferSize++] = shard.reservoir;
             }
         }
 
-        // Write in the prefix/postfix bytes
+        // Grab a new allocaton unit from the front of the reservoir
 
-        long        *pre = (long *) allocUnit->actualAddress;
-        long        *post = (long *) ((char *)allocUnit->actualAddress + allocUnit->actualSize - paddingSize * sizeof(long));
-        for (unsigned int i = 0; i < paddingSize; i++, pre++, post++)
-        {
-            *pre = prefixPattern;
-            *post = postfixPattern;
-        }
+        sAllocUnit    *au = shard.reservoir;
+        shard.reservoir = au->next;
+        memset(au, 0, sizeof(sAllocUnit));
+        return au;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    void    resetGlobals()
+    static    void    releaseAllocUnit(sShard &shard, sAllocUnit *allocUnit)
     {
-        sourceFile = "??";
-        sourceLine = 0;
+        // Add this allocation unit to the front of the reservoir of unused allocation units
+
+        memset(allocUnit, 0, sizeof(sAllocUnit));
+        allocUnit->next = shard.reservoir;
+        shard.reservoir = allocUnit;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    void    log(const char *format, ...)
+    static    sAllocUnit    *findAllocUnit(const void *reportedAddress)
     {
-        // Build the buffer
-
-        static char buffer[2048];
-        va_list    ap;
-        va_start(ap, format);
-        vsprintf(buffer, format, ap);
-        va_end(ap);
-
-        // Cleanup the log?
-
-        if (cleanupLogOnFirstRun) doCleanupLogOnFirstRun();
+        sShard        &shard = findShard(reportedAddress);
+        MemLock        lock(shard.lock);
+        sAllocUnit    **slot = findSlot(shard, reportedAddress);
+        return slot ? *slot : NULL;
+    }
 
-        // Open the log file
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        FILE    *fp = fopen("memory.log", "ab");
+    static    void    updatePeak(std::atomic<unsigned long long> &peak, const unsigned long long value)
+    {
+        unsigned long long    current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
 
-        // If you hit this assert, then the memory logger is unable to log information to a file (can't open the file for some
-        // reason.) You can interrogate the variable 'buffer' to see what was supposed to be logged (but won't be.)
-        m_assert(fp);
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        if (!fp) return;
+    static    void    addToTotals(const size_t reportedSize, const size_t actualSize, const unsigned int unitCount)
+    {
+        updatePeak(peakReportedMemory, totalReportedMemory.fetch_add(reportedSize, std::memory_order_relaxed) + reportedSize);
+        updatePeak(peakActualMemory, totalActualMemory.fetch_add(actualSize, std::memory_order_relaxed) + actualSize);
+        updatePeak(peakAllocUnitCount, totalAllocUnitCount.fetch_add(unitCount, std::memory_order_relaxed) + unitCount);
+    }
 
-        // Spit out the data to the log
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        fprintf(fp, "%s\r\n", buffer);
-        fclose(fp);
+    static    void    removeFromTotals(const size_t reportedSize, const size_t actualSize, const unsigned int unitCount)
+    {
+        totalReportedMemory.fetch_sub(reportedSize, std::memory_order_relaxed);
+        totalActualMemory.fetch_sub(actualSize, std::memory_order_relaxed);
+        totalAllocUnitCount.fetch_sub(unitCount, std::memory_order_relaxed);
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    void    dumpAllocations(FILE *fp)
+    static    unsigned int    siteHash(const char *sourceFile, const unsigned int sourceLine)
     {
-        fprintf(fp, "Alloc.   Addr       Size       Addr       Size                        BreakOn BreakOn              \r\n");
-        fprintf(fp, "Number Reported   Reported    Actual     Actual     Unused    Method  Dealloc Realloc Allocated by \r\n");
-        fprintf(fp, "------ ---------- ---------- ---------- ---------- ---------- -------- ------- ------- --------------------------------------------------- \r\n");
+        unsigned int    hash = 2166136261u;
+        for (const char *ptr = sourceFile; *ptr; ptr++) hash = (hash ^ (unsigned char) *ptr) * 16777619u;
+        return (hash ^ sourceLine) * 16777619u;
+    }
 
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Find the site of an owner, adding it the first time. The site lock must be held.
 
-        for (unsigned int i = 0; i < hashSize; i++)
+    static    unsigned int    findSite(const char *sourceFile, const unsigned int sourceLine)
+    {
+        if ((siteCount + 1) * 2 > siteTableSize)
         {
-            sAllocUnit *ptr = hashTable[i];
-            while(ptr)
+            unsigned int    newSize = siteTableSize ? siteTableSize * 2 : 1024;
+            unsigned int    *newTable = (unsigned int *) calloc(newSize, sizeof(unsigned int));
+            if (!newTable) return noSite;
+
+            for (unsigned int i = 0; i < siteCount; i++)
             {
-                fprintf(fp, "%06d 0x%08X 0x%08X 0x%08X 0x%08X 0x%08X %-8s    %c       %c    %s\r\n",
-                    ptr->allocationNumber,
-                    (unsigned int) ptr->reportedAddress, ptr->reportedSize,
-                    (unsigned int) ptr->actualAddress, ptr->actualSize,
-                    m_calcUnused(ptr),
-                    allocationTypes[ptr->allocationType],
-                    ptr->breakOnDealloc ? 'Y':'N',
-                    ptr->breakOnRealloc ? 'Y':'N',
-                    ownerString(ptr->sourceFile, ptr->sourceLine));
-                ptr = ptr->next;
+                unsigned int    j = siteHash(sites[i].sourceFile, sites[i].sourceLine) & (newSize - 1);
+                while (newTable[j]) j = (j + 1) & (newSize - 1);
+                newTable[j] = i + 1;
             }
+
+            free(siteTable);
+            siteTable = newTable;
+            siteTableSize = newSize;
+        }
+
+        unsigned int    i = siteHash(sourceFile, sourceLine) & (siteTableSize - 1);
+        for (; siteTable[i]; i = (i + 1) & (siteTableSize - 1))
+        {
+            sSite    &site = sites[siteTable[i] - 1];
+            if (site.sourceLine == sourceLine && !strcmp(site.sourceFile, sourceFile)) return siteTable[i] - 1;
         }
+
+        if (siteCount == siteCapacity)
+        {
+            unsigned int    newCapacity = siteCapacity ? siteCapacity * 2 : 256;
+            sSite    *newSites = (sSite *) realloc(sites, newCapacity * sizeof(sSite));
+            if (!newSites) return noSite;
+            sites = newSites;
+            siteCapacity = newCapacity;
+        }
+
+        sSite    &site = sites[siteCount];
+        memset(&site, 0, sizeof(sSite));
+        strncpy(site.sourceFile, sourceFile, sizeof(site.sourceFile) - 1);
+        site.sourceLine = sourceLine;
+        siteTable[i] = ++siteCount;
+        return siteCount - 1;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    static    void    dumpLeakReport()
+    static    unsigned int    addToSite(const char *sourceFile, const unsigned int sourceLine, const size_t reportedSize)
     {
-        // Open the report file
+        MemLock    lock(siteLock);
 
-        FILE    *fp = fopen("memleaks.log", "w+b");
-        //FILE    *fp = stderr;
+        unsigned int    index = findSite(sourceFile, sourceLine);
+        if (index == noSite) return noSite;
 
-        // If you hit this assert, then the memory report generator is unable to log information to a file (can't open the file for
-        // some reason.)
-        m_assert(fp);
-        if (!fp) return;
+        sSite    &site = sites[index];
+        site.liveBytes += reportedSize;
+        site.liveCount++;
+        site.allocationCount++;
+        if (site.liveBytes > site.peakBytes) site.peakBytes = site.liveBytes;
+        return index;
+    }
 
-        // Any leaks?
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        // Header
+    static    void    removeFromSite(const unsigned int index, const size_t reportedSize)
+    {
+        if (index == noSite) return;
 
-        static  char    timeString[25];
-        memset(timeString, 0, sizeof(timeString));
-        time_t  t = time(NULL);
-        struct  tm *tme = localtime(&t);
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "|                                          Memory leak report for:  %02d/%02d/%04d %02d:%02d:%02d                                            |\r\n", tme->tm_mon + 1, tme->tm_mday, tme->tm_year + 1900, tme->tm_hour, tme->tm_min, tme->tm_sec);
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "\r\n");
-        fprintf(fp, "\r\n");
-        if (stats.totalAllocUnitCount)
-        {
-            fprintf(fp, "%d memory leak%s found:\r\n", stats.totalAllocUnitCount, stats.totalAllocUnitCount == 1 ? "":"s");
-        }
-        else
-        {
-            fprintf(fp, "Congratulations! No memory leaks found!\r\n");
+        MemLock    lock(siteLock);
+        sites[index].liveBytes -= reportedSize;
+        sites[index].liveCount--;
+    }
 
-            // We can finally free up our own memory allocations
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            if (reservoirBuffer)
-            {
-                for (unsigned int i = 0; i < reservoirBufferSize; i++)
-                {
-                    free(reservoirBuffer[i]);
-                }
-                free(reservoirBuffer);
-                reservoirBuffer = 0;
-                reservoirBufferSize = 0;
-                reservoir = NULL;
-            }
-        }
-        fprintf(fp, "\r\n");
+    static    bool    sampleThisAllocation()
+    {
+        unsigned int    rate = sampleRate.load(std::memory_order_relaxed);
+        if (rate <= 1) return true;
 
-        if (stats.totalAllocUnitCount)
+        if (sampleCountdown > 1)
         {
-            dumpAllocations(fp);
+            sampleCountdown--;
+            return false;
         }
 
-        fclose(fp);
-    }
+        // Pick the gap to the next tracked allocation at random, averaging the rate, so that a regular pattern of allocations
+        // cannot keep slipping between the samples. The seed differs per thread.
 
+        if (!sampleSeed) sampleSeed = (unsigned int) (size_t) &sampleSeed | 1;
+        sampleSeed ^= sampleSeed << 13;
+        sampleSeed ^= sampleSeed >> 17;
+        sampleSeed ^= sampleSeed << 5;
+        sampleCountdown = 1 + sampleSeed % (2 * rate - 1);
+        return true;
+    }
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
-    // -DOC- Flags & options -- Call these routines to enable/disable the following options
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    bool    &m_alwaysValidateAll()
+    static    size_t    prefixSize(const unsigned int mode)
     {
-        // Force a validation of all allocation units each time we enter this software
-        return alwaysValidateAll;
+        // The padding is counted in longs, as it always was, the other modes only need the header that tells tracked blocks from
+        // untracked ones
+
+        return mode == m_guard_padding ? paddingSize * sizeof(long) : headerSize;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    bool    &m_alwaysLogAll()
+    static    size_t    postfixSize(const unsigned int mode, const size_t reportedSize)
     {
-        // Force a log of every allocation & deallocation into memory.log
-        return alwaysLogAll;
-    }
+        if (mode == m_guard_padding) return paddingSize * sizeof(long);
+        if (mode == m_guard_canary) return canarySize;
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
+        // A guarded block ends on the guard page rounded up to the alignment, overruns into the rounding are caught as canaries
 
-    bool    &m_alwaysWipeAll()
-    {
-        // Force this software to always wipe memory with a pattern when it is being allocated/dallocated
-        return alwaysWipeAll;
+        if (mode == m_guard_pages) return ((reportedSize + headerSize - 1) & ~(size_t) (headerSize - 1)) - reportedSize;
+        return 0;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    bool    &m_randomeWipe()
+    static    unsigned int    chooseGuardMode()
     {
-        // Force this software to use a random pattern when wiping memory -- good for stress testing
-        return randomWipe;
+        unsigned int    mode = guardMode.load(std::memory_order_relaxed);
+        if (mode != m_guard_pages) return mode;
+
+        // Guard pages cost at least two pages each, so only every guardPageRate'th allocation of each thread gets them
+
+        unsigned int    rate = guardPageRate.load(std::memory_order_relaxed);
+        if (guardPageCountdown > 1 && guardPageCountdown <= rate)
+        {
+            guardPageCountdown--;
+            return m_guard_canary;
+        }
+        guardPageCountdown = rate;
+        return m_guard_pages;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
-    // -DOC- Simply call this routine with the address of an allocated block of RAM, to cause it to force a breakpoint when it is
-    // reallocated.
+    // Page level access for the guard pages
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    bool    &m_breakOnRealloc(void *reportedAddress)
+    static    size_t    getPageSize()
     {
-        // Locate the existing allocation unit
+        #if defined(WIN32) && !defined(__CYGWIN__)
+        SYSTEM_INFO    info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+        #else
+        return (size_t) sysconf(_SC_PAGESIZE);
+        #endif
+    }
 
-        sAllocUnit    *au = findAllocUnit(reportedAddress);
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        // If you hit this assert, you tried to set a breakpoint on reallocation for an address that doesn't exist. Interrogate the
-        // stack frame or the variable 'au' to see which allocation this is.
-        m_assert(au != NULL);
+    static    void    *mapPages(const size_t size)
+    {
+        #if defined(WIN32) && !defined(__CYGWIN__)
+        return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        #else
+        void    *address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return address == MAP_FAILED ? NULL : address;
+        #endif
+    }
 
-        // If you hit this assert, you tried to set a breakpoint on reallocation for an address that wasn't allocated in a way that
-        // is compatible with reallocation.
-        m_assert(au->allocationType == m_alloc_malloc ||
-             au->allocationType == m_alloc_calloc ||
-             au->allocationType == m_alloc_realloc);
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        return au->breakOnRealloc;
+    static    void    protectPages(void *address, const size_t size)
+    {
+        #if defined(WIN32) && !defined(__CYGWIN__)
+        DWORD    oldProtection;
+        VirtualProtect(address, size, PAGE_NOACCESS, &oldProtection);
+        #else
+        mprotect(address, size, PROT_NONE);
+        #endif
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
-    // -DOC- Simply call this routine with the address of an allocated block of RAM, to cause it to force a breakpoint when it is
-    // deallocated.
+
+    static    void    unmapPages(void *address, const size_t size)
+    {
+        #if defined(WIN32) && !defined(__CYGWIN__)
+        (void) size;
+        VirtualFree(address, 0, MEM_RELEASE);
+        #else
+        munmap(address, size);
+        #endif
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Get a block laid out for the given guard mode, return its reported address, or NULL when out of memory
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    bool    &m_breakOnDealloc(void *reportedAddress)
+    static    void    *allocateBlock(const size_t reportedSize, const unsigned int mode, void *&actualAddress, size_t &actualSize)
     {
-        // Locate the existing allocation unit
+        if (mode == m_guard_pages)
+        {
+            static    const    size_t    pageSize = getPageSize();
+            size_t    dataSize = (headerSize + reportedSize + postfixSize(mode, reportedSize) + pageSize - 1) & ~(pageSize - 1);
+            actualSize = dataSize + pageSize;
+            actualAddress = mapPages(actualSize);
+            if (!actualAddress) return NULL;
+
+            protectPages((char *) actualAddress + dataSize, pageSize);
+            return (char *) actualAddress + dataSize - postfixSize(mode, reportedSize) - reportedSize;
+        }
 
-        sAllocUnit    *au = findAllocUnit(reportedAddress);
+        actualSize = prefixSize(mode) + reportedSize + postfixSize(mode, reportedSize);
+        actualAddress = malloc(actualSize);
+        if (!actualAddress) return NULL;
+        return (char *) actualAddress + prefixSize(mode);
+    }
 
-        // If you hit this assert, you tried to set a breakpoint on deallocation for an address that doesn't exist. Interrogate the
-        // stack frame or the variable 'au' to see which allocation this is.
-        m_assert(au != NULL);
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        return au->breakOnDealloc;
+    static    void    releaseBlock(void *actualAddress, const size_t actualSize, const unsigned int mode)
+    {
+        if (mode != m_guard_pages)
+        {
+            free(actualAddress);
+            return;
+        }
+
+        // Guarded blocks stay mapped and inaccessible until guardQuarantineSize more have been released, unmap the oldest
+
+        protectPages(actualAddress, actualSize);
+
+        void    *oldAddress;
+        size_t    oldSize;
+        {
+            MemLock    lock(quarantineLock);
+            oldAddress = quarantineAddress[quarantineNext];
+            oldSize = quarantineSize[quarantineNext];
+            quarantineAddress[quarantineNext] = actualAddress;
+            quarantineSize[quarantineNext] = actualSize;
+            quarantineNext = (quarantineNext + 1) % guardQuarantineSize;
+        }
+        if (oldAddress) unmapPages(oldAddress, oldSize);
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
-    // -DOC- When tracking down a difficult bug, use this routine to force a breakpoint on a specific allocation count
+    // Fill with a 32-bit pattern, in the same byte order whatever the size of a long, and check that a fill is intact
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    m_breakOnAllocation(unsigned int count)
+    static    void    fillWithPattern(void *address, const size_t size, const unsigned int pattern)
     {
-        breakOnAllocationCount = count;
+        unsigned char    *ptr = (unsigned char *) address;
+        size_t        filled = size < sizeof(pattern) ? size : sizeof(pattern);
+        for (size_t i = 0; i < filled; i++) ptr[i] = (unsigned char) (pattern >> (i * 8));
+
+        // Double up what is filled already, every copy starts on a whole pattern
+
+        while (filled < size)
+        {
+            size_t    count = filled < size - filled ? filled : size - filled;
+            memcpy(ptr + filled, ptr, count);
+            filled += count;
+        }
     }
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
-    // Used by the macros
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    m_setOwner(const char *file, const unsigned int line)
+    static    bool    checkPattern(const void *address, const size_t size, const unsigned int pattern)
     {
-        sourceFile = file;
-        sourceLine = line;
+        const unsigned char    *ptr = (const unsigned char *) address;
+        for (size_t i = 0; i < size; i++)
+        {
+            if (ptr[i] != (unsigned char) (pattern >> ((i & 3) * 8))) return false;
+        }
+        return true;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
-    // Global new/new[]
-    //
-    // These are the standard new/new[] operators. They are merely interface functions that operate like normal new/new[], but use our
-    // memory tracking routines.
+    // Untracked allocations carry a headerSize prefix only, filled with the untrackedPattern, so that they keep the same alignment as
+    // tracked ones and can be told apart from them when they are freed without looking them up.
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    using namespace std;
-
-    void    *operator new(size_t reportedSize) throw (std::bad_alloc)
+    static    void    *allocateUntracked(const size_t reportedSize, const bool clear)
     {
-        #ifdef TEST_MEMORY_MANAGER
-        log("ENTER: new");
-        #endif
+        char    *actualAddress = (char *) malloc(headerSize + reportedSize);
+        if (!actualAddress) return NULL;
 
-        // ANSI says: allocation requests of 0 bytes will still return a valid value
+        fillWithPattern(actualAddress, headerSize, untrackedPattern);
 
-        if (reportedSize == 0) reportedSize = 1;
+        void    *reportedAddress = actualAddress + headerSize;
+        if (clear) memset(reportedAddress, 0, reportedSize);
+        return reportedAddress;
+    }
 
-        // ANSI says: loop continuously because the error handler could possibly free up some memory
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        for(;;)
-        {
-            // Try the allocation
+    static    bool    isUntracked(const void *reportedAddress)
+    {
+        // Tracked allocations have the prefixPattern here, whatever their guard mode
 
-            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new, reportedSize);
-            if (ptr)
-            {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new");
-                #endif
-                return ptr;
-            }
+        return ((const unsigned int *) reportedAddress)[-1] == untrackedPattern;
+    }
 
-            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
-            // set it back again.
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            new_handler    nh = set_new_handler(0);
-            set_new_handler(nh);
+    static    void    *reallocateUntracked(void *reportedAddress, const size_t reportedSize)
+    {
+        char    *actualAddress = (char *) realloc((char *) reportedAddress - headerSize, headerSize + reportedSize);
+        return actualAddress ? actualAddress + headerSize : NULL;
+    }
 
-            // If there is an error handler, call it
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            if (nh)
-            {
-                (*nh)();
-            }
+    static    void    freeUntracked(const void *reportedAddress)
+    {
+        free((char *) reportedAddress - headerSize);
+    }
 
-            // Otherwise, throw the exception
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Which guard modes wipe the blocks
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            else
-            {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new");
-                #endif
-                throw std::bad_alloc();
-            }
-        }
+    static    bool    wipesOnAllocation(const sAllocUnit *allocUnit)
+    {
+        return allocUnit->guardMode == m_guard_padding && alwaysWipeAll;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    *operator new[](size_t reportedSize) throw (std::bad_alloc)
+    static    bool    wipesOnRelease(const sAllocUnit *allocUnit)
     {
-        #ifdef TEST_MEMORY_MANAGER
-        log("ENTER: new[]");
-        #endif
-
-        // The ANSI standard says that allocation requests of 0 bytes will still return a valid value
+        return (allocUnit->guardMode == m_guard_padding && alwaysWipeAll) || allocUnit->guardMode == m_guard_wipe_on_free;
+    }
 
-        if (reportedSize == 0) reportedSize = 1;
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        // ANSI says: loop continuously because the error handler could possibly free up some memory
+    static    void    wipeWithPattern(sAllocUnit *allocUnit, unsigned int pattern, const size_t originalReportedSize = 0)
+    {
+        // For a serious test run, we use wipes of random a random value. However, if this causes a crash, we don't want it to
+        // crash in a differnt place each time, so we specifically DO NOT call srand. If, by chance your program calls srand(),
+        // you may wish to disable that when running with a random wipe test. This will make any crashes more consistent so they
+        // can be tracked down easier.
 
-        for(;;)
+        if (randomWipe)
         {
-            // Try the allocation
-
-            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new_array, reportedSize);
-            if (ptr)
-            {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new[]");
-                #endif
-                return ptr;
-            }
+            pattern = ((rand() & 0xff) << 24) | ((rand() & 0xff) << 16) | ((rand() & 0xff) << 8) | (rand() & 0xff);
+        }
 
-            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
-            // set it back again.
+        // -DOC- We should wipe with 0's if we're not in debug mode, so we can help hide bugs if possible when we release the
+        // product. So uncomment the following line for releases.
+        //
+        // Note that the wipes only happen in the guard modes that ask for them (see wipesOnAllocation() and wipesOnRelease()),
+        // because this does slow things down.
+    //    pattern = 0;
 
-            new_handler    nh = set_new_handler(0);
-            set_new_handler(nh);
+        if (allocUnit->reportedSize > originalReportedSize)
+        {
+            fillWithPattern((char *) allocUnit->reportedAddress + originalReportedSize, allocUnit->reportedSize - originalReportedSize, pattern);
+        }
+    }
 
-            // If there is an error handler, call it
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            if (nh)
-            {
-                (*nh)();
-            }
+    static    void    writeGuards(sAllocUnit *allocUnit)
+    {
+        size_t    prefix = prefixSize(allocUnit->guardMode);
+        size_t    postfix = postfixSize(allocUnit->guardMode, allocUnit->reportedSize);
+        fillWithPattern((char *) allocUnit->reportedAddress - prefix, prefix, prefixPattern);
+        fillWithPattern((char *) allocUnit->reportedAddress + allocUnit->reportedSize, postfix, postfixPattern);
+    }
 
-            // Otherwise, throw the exception
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Resize a block in place with realloc() when it keeps its guard mode, otherwise move it to a new block laid out for the mode.
+    // Return the new reported address, or NULL leaving the block as it was when out of memory.
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            else
-            {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new[]");
-                #endif
-                throw std::bad_alloc();
-            }
+    static    void    *reallocateBlock(sAllocUnit *allocUnit, const size_t reportedSize, const unsigned int mode, void *&actualAddress, size_t &actualSize)
+    {
+        if (mode == allocUnit->guardMode && mode != m_guard_pages)
+        {
+            actualSize = prefixSize(mode) + reportedSize + postfixSize(mode, reportedSize);
+            actualAddress = realloc(allocUnit->actualAddress, actualSize);
+            if (!actualAddress) return NULL;
+            return (char *) actualAddress + prefixSize(mode);
         }
+
+        void    *reportedAddress = allocateBlock(reportedSize, mode, actualAddress, actualSize);
+        if (!reportedAddress) return NULL;
+
+        memcpy(reportedAddress, allocUnit->reportedAddress, reportedSize < allocUnit->reportedSize ? reportedSize : allocUnit->reportedSize);
+        if (wipesOnRelease(allocUnit)) wipeWithPattern(allocUnit, releasedPattern);
+        releaseBlock(allocUnit->actualAddress, allocUnit->actualSize, allocUnit->guardMode);
+        return reportedAddress;
     }
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
-    // Other global new/new[]
-    //
-    // These are the standard new/new[] operators as used by Microsoft's memory tracker. We don't want them interfering with our memory
-    // tracking efforts. Like the previous versions, these are merely interface functions that operate like normal new/new[], but use
-    // our memory tracking routines.
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    *operator new(size_t reportedSize, const char *sourceFile, int sourceLine) throw (std::bad_alloc)
+    static    void    resetGlobals()
     {
-        #ifdef TEST_MEMORY_MANAGER
-        log("ENTER: new");
-        #endif
+        sourceFile = "??";
+        sourceLine = 0;
+    }
 
-        // The ANSI standard says that allocation requests of 0 bytes will still return a valid value
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        if (reportedSize == 0) reportedSize = 1;
+    static    void    log(const char *format, ...)
+    {
+        // Build the buffer, one thread at a time
 
-        // ANSI says: loop continuously because the error handler could possibly free up some memory
+        MemLock    lock(logLock);
+        static char buffer[2048];
+        va_list    ap;
+        va_start(ap, format);
+        vsprintf(buffer, format, ap);
+        va_end(ap);
 
-        for(;;)
-        {
-            // Try the allocation
+        // Cleanup the log?
 
-            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new, reportedSize);
-            if (ptr)
-            {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new");
-                #endif
-                return ptr;
-            }
+        if (cleanupLogOnFirstRun) doCleanupLogOnFirstRun();
 
-            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
-            // set it back again.
+        // Open the log file
 
-            new_handler    nh = set_new_handler(0);
-            set_new_handler(nh);
+        FILE    *fp = fopen("memory.log", "ab");
 
-            // If there is an error handler, call it
+        // If you hit this assert, then the memory logger is unable to log information to a file (can't open the file for some
+        // reason.) You can interrogate the variable 'buffer' to see what was supposed to be logged (but won't be.)
+        m_assert(fp);
 
-            if (nh)
-            {
-                (*nh)();
-            }
+        if (!fp) return;
 
-            // Otherwise, throw the exception
+        // Spit out the data to the log
 
-            else
-            {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new");
-                #endif
-                throw std::bad_alloc();
-            }
-        }
+        fprintf(fp, "%s\r\n", buffer);
+        fclose(fp);
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    *operator new[](size_t reportedSize, const char *sourceFile, int sourceLine) throw (std::bad_alloc)
+    static    void    dumpAllocations(FILE *fp)
     {
-        #ifdef TEST_MEMORY_MANAGER
-        log("ENTER: new[]");
-        #endif
+        fprintf(fp, "Alloc.   Addr       Size       Addr       Size                        BreakOn BreakOn              \r\n");
+        fprintf(fp, "Number Reported   Reported    Actual     Actual     Unused    Method  Dealloc Realloc Allocated by \r\n");
+        fprintf(fp, "------ ---------- ---------- ---------- ---------- ---------- -------- ------- ------- --------------------------------------------------- \r\n");
 
-        // The ANSI standard says that allocation requests of 0 bytes will still return a valid value
 
-        if (reportedSize == 0) reportedSize = 1;
+        for (unsigned int s = 0; s < shardCount; s++)
+        {
+            MemLock    lock(shards[s].lock);
+            for (unsigned int i = 0; i < shards[s].tableSize; i++)
+            {
+                sAllocUnit *ptr = shards[s].table[i];
+                if (!ptr || ptr == &deletedUnit) continue;
 
-        // ANSI says: loop continuously because the error handler could possibly free up some memory
+                fprintf(fp, "%06d %10p 0x%08zX %10p 0x%08zX 0x%08zX %-8s    %c       %c    %s\r\n",
+                    ptr->allocationNumber,
+                    ptr->reportedAddress, ptr->reportedSize,
+                    ptr->actualAddress, ptr->actualSize,
+                    m_calcUnused(ptr),
+                    allocationTypes[ptr->allocationType],
+                    ptr->breakOnDealloc ? 'Y':'N',
+                    ptr->breakOnRealloc ? 'Y':'N',
+                    ownerString(ptr->sourceFile, ptr->sourceLine));
+            }
+        }
+    }
 
-        for(;;)
-        {
-            // Try the allocation
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new_array, reportedSize);
-            if (ptr)
-            {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new[]");
-                #endif
-                return ptr;
-            }
+    static    void    dumpLeakReport()
+    {
+        // Open the report file
 
-            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
-            // set it back again.
+        FILE    *fp = fopen("memleaks.log", "w+b");
+        //FILE    *fp = stderr;
 
-            new_handler    nh = set_new_handler(0);
-            set_new_handler(nh);
+        // If you hit this assert, then the memory report generator is unable to log information to a file (can't open the file for
+        // some reason.)
+        m_assert(fp);
+        if (!fp) return;
 
-            // If there is an error handler, call it
+        // Any leaks?
 
-            if (nh)
-            {
-                (*nh)();
-            }
+        // Header
 
-            // Otherwise, throw the exception
+        static  char    timeString[25];
+        memset(timeString, 0, sizeof(timeString));
+        time_t  t = time(NULL);
+        struct  tm *tme = localtime(&t);
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "|                                          Memory leak report for:  %02d/%02d/%04d %02d:%02d:%02d                                            |\r\n", tme->tm_mon + 1, tme->tm_mday, tme->tm_year + 1900, tme->tm_hour, tme->tm_min, tme->tm_sec);
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "\r\n");
+        fprintf(fp, "\r\n");
+        unsigned long long    leakCount = totalAllocUnitCount;
+        if (leakCount)
+        {
+            fprintf(fp, "%llu memory leak%s found:\r\n", leakCount, leakCount == 1 ? "":"s");
+            if (sampleRate > 1) fprintf(fp, "Only one allocation in %d was sampled for tracking.\r\n", (unsigned int) sampleRate);
+        }
+        else
+        {
+            fprintf(fp, "Congratulations! No memory leaks found!\r\n");
 
-            else
+            // We can finally free up our own memory allocations
+
+            for (unsigned int s = 0; s < shardCount; s++)
             {
-                #ifdef TEST_MEMORY_MANAGER
-                log("EXIT : new[]");
-                #endif
-                throw std::bad_alloc();
+                sShard    &shard = shards[s];
+                MemLock    lock(shard.lock);
+                for (unsigned int i = 0; i < shard.reservoirBufferSize; i++)
+                {
+                    free(shard.reservoirBuffer[i]);
+                }
+                free(shard.reservoirBuffer);
+                shard.reservoirBuffer = 0;
+                shard.reservoirBufferSize = 0;
+                shard.reservoir = NULL;
+                free(shard.table);
+                shard.table = NULL;
+                shard.tableSize = 0;
+                shard.deletedCount = 0;
             }
         }
+        fprintf(fp, "\r\n");
+
+        if (leakCount)
+        {
+            dumpAllocations(fp);
+        }
+
+        fclose(fp);
     }
 
+
     // ---------------------------------------------------------------------------------------------------------------------------------
-    // Global delete/delete[]
-    //
-    // These are the standard delete/delete[] operators. They are merely interface functions that operate like normal delete/delete[],
-    // but use our memory tracking routines.
+    // -DOC- Flags & options -- Call these routines to enable/disable the following options
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    operator delete(void *reportedAddress) throw ()
+    bool    &m_alwaysValidateAll()
     {
-        #ifdef TEST_MEMORY_MANAGER
-        log("ENTER: delete");
-        #endif
+        // Force a validation of all allocation units each time we enter this software
+        return alwaysValidateAll;
+    }
 
-        // ANSI says: delete & delete[] allow NULL pointers (they do nothing)
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        if (!reportedAddress) return;
+    bool    &m_alwaysLogAll()
+    {
+        // Force a log of every allocation & deallocation into memory.log
+        return alwaysLogAll;
+    }
 
-        m_deallocator(sourceFile, sourceLine, m_alloc_delete, reportedAddress);
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        #ifdef TEST_MEMORY_MANAGER
-        log("EXIT : delete");
-        #endif
+    bool    &m_alwaysWipeAll()
+    {
+        // Force this software to always wipe memory with a pattern when it is being allocated/dallocated
+        return alwaysWipeAll;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    operator delete[](void *reportedAddress) throw ()
+    bool    &m_randomeWipe()
     {
-        #ifdef TEST_MEMORY_MANAGER
-        log("ENTER: delete[]");
-        #endif
+        // Force this software to use a random pattern when wiping memory -- good for stress testing
+        return randomWipe;
+    }
 
-        // ANSI says: delete & delete[] allow NULL pointers (they do nothing)
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- Simply call this routine with the address of an allocated block of RAM, to cause it to force a breakpoint when it is
+    // reallocated.
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-        if (!reportedAddress) return;
+    bool    &m_breakOnRealloc(void *reportedAddress)
+    {
+        // Locate the existing allocation unit
 
-        m_deallocator(sourceFile, sourceLine, m_alloc_delete_array, reportedAddress);
+        sAllocUnit    *au = findAllocUnit(reportedAddress);
 
-        #ifdef TEST_MEMORY_MANAGER
-        log("EXIT : delete[]");
-        #endif
+        // If you hit this assert, you tried to set a breakpoint on reallocation for an address that doesn't exist. Interrogate the
+        // stack frame or the variable 'au' to see which allocation this is.
+        m_assert(au != NULL);
+
+        // If you hit this assert, you tried to set a breakpoint on reallocation for an address that wasn't allocated in a way that
+        // is compatible with reallocation.
+        m_assert(au->allocationType == m_alloc_malloc ||
+             au->allocationType == m_alloc_calloc ||
+             au->allocationType == m_alloc_realloc);
+
+        return au->breakOnRealloc;
     }
 
     // ---------------------------------------------------------------------------------------------------------------------------------
-    // Allocate memory and track it
+    // -DOC- Simply call this routine with the address of an allocated block of RAM, to cause it to force a breakpoint when it is
+    // deallocated.
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    *m_allocator(const char *sourceFile, const unsigned int sourceLine, const unsigned int allocationType, const size_t reportedSize)
+    bool    &m_breakOnDealloc(void *reportedAddress)
     {
-        try
-        {
-            #ifdef TEST_MEMORY_MANAGER
-            log("ENTER: m_allocator()");
-            #endif
+        // Locate the existing allocation unit
 
-            // Increase our allocation count
+        sAllocUnit    *au = findAllocUnit(reportedAddress);
 
-            currentAllocationCount++;
+        // If you hit this assert, you tried to set a breakpoint on deallocation for an address that doesn't exist. Interrogate the
+        // stack frame or the variable 'au' to see which allocation this is.
+        m_assert(au != NULL);
 
-            // Log the request
+        return au->breakOnDealloc;
+    }
 
-            if (alwaysLogAll) log("%05d %-40s %8s            : %s", currentAllocationCount, ownerString(sourceFile, sourceLine), allocationTypes[allocationType], memorySizeString(reportedSize));
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- When tracking down a difficult bug, use this routine to force a breakpoint on a specific allocation count
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            // If you hit this assert, you requested a breakpoint on a specific allocation count
-            m_assert(currentAllocationCount != breakOnAllocationCount);
+    void    m_breakOnAllocation(unsigned int count)
+    {
+        breakOnAllocationCount = count;
+    }
 
-            // If necessary, grow the reservoir of unused allocation units
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Used by the macros
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            if (!reservoir)
-            {
-                // Allocate 256 reservoir elements
+    void    m_setOwner(const char *file, const unsigned int line)
+    {
+        sourceFile = file;
+        sourceLine = line;
+    }
 
-                reservoir = (sAllocUnit *) malloc(sizeof(sAllocUnit) * 256);
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Global new/new[]
+    //
+    // These are the standard new/new[] operators. They are merely interface functions that operate like normal new/new[], but use our
+    // memory tracking routines.
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-                // If you hit this assert, then the memory manager failed to allocate internal memory for tracking the
-                // allocations
-                m_assert(reservoir != NULL);
+    using namespace std;
 
-                // Danger Will Robinson!
+    void    *operator new(size_t reportedSize) throw (std::bad_alloc)
+    {
+        #ifdef TEST_MEMORY_MANAGER
+        log("ENTER: new");
+        #endif
 
-                if (reservoir == NULL) throw "Unable to allocate RAM for internal memory tracking data";
+        // ANSI says: allocation requests of 0 bytes will still return a valid value
 
-                // Build a linked-list of the elements in our reservoir
+        if (reportedSize == 0) reportedSize = 1;
 
-                memset(reservoir, 0, sizeof(sAllocUnit) * 256);
-                for (unsigned int i = 0; i < 256 - 1; i++)
-                {
-                    reservoir[i].next = &reservoir[i+1];
-                }
+        // ANSI says: loop continuously because the error handler could possibly free up some memory
 
-                // Add this address to our reservoirBuffer so we can free it later
+        for(;;)
+        {
+            // Try the allocation
 
-                sAllocUnit    **temp = (sAllocUnit **) realloc(reservoirBuffer, (reservoirBufferSize + 1) * sizeof(sAllocUnit *));
-                m_assert(temp);
-                if (temp)
-                {
-                    reservoirBuffer = temp;
-                    reservoirBuffer[reservoirBufferSize++] = reservoir;
-                }
+            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new, reportedSize);
+            if (ptr)
+            {
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new");
+                #endif
+                return ptr;
             }
 
-            // Logical flow says this should never happen...
-            m_assert(reservoir != NULL);
-
-            // Grab a new allocaton unit from the front of the reservoir
+            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
+            // set it back again.
 
-            sAllocUnit    *au = reservoir;
-            reservoir = au->next;
+            new_handler    nh = set_new_handler(0);
+            set_new_handler(nh);
 
-            // Populate it with some real data
+            // If there is an error handler, call it
 
-            memset(au, 0, sizeof(sAllocUnit));
-            au->actualSize        = calculateActualSize(reportedSize);
-            #ifdef RANDOM_FAILURE
-            double    a = rand();
-            double    b = RAND_MAX / 100.0 * RANDOM_FAILURE;
-            if (a > b)
-            {
-                au->actualAddress = malloc(au->actualSize);
-            }
-            else
+            if (nh)
             {
-                log("!Random faiure!");
-                au->actualAddress = NULL;
+                (*nh)();
             }
-            #else
-            au->actualAddress     = malloc(au->actualSize);
-            #endif
-            au->reportedSize      = reportedSize;
-            au->reportedAddress   = calculateReportedAddress(au->actualAddress);
-            au->allocationType    = allocationType;
-            au->sourceLine        = sourceLine;
-            au->allocationNumber  = currentAllocationCount;
-            if (sourceFile) strncpy(au->sourceFile, sourceFileStripper(sourceFile), sizeof(au->sourceFile) - 1);
-            else        strcpy (au->sourceFile, "??");
-
-            // We don't want to assert with random failures, because we want the application to deal with them.
 
-            #ifndef RANDOM_FAILURE
-            // If you hit this assert, then the requested allocation simply failed (you're out of memory.) Interrogate the
-            // variable 'au' or the stack frame to see what you were trying to do.
-            m_assert(au->actualAddress != NULL);
-            #endif
+            // Otherwise, throw the exception
 
-            if (au->actualAddress == NULL)
+            else
             {
-                throw "Request for allocation failed. Out of memory.";
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new");
+                #endif
+                throw std::bad_alloc();
             }
+        }
+    }
 
-            // If you hit this assert, then this allocation was made from a source that isn't setup to use this memory tracking
-            // software, use the stack frame to locate the source and include our H file.
-            m_assert(allocationType != m_alloc_unknown);
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            // Insert the new allocation into the hash table
+    void    *operator new[](size_t reportedSize) throw (std::bad_alloc)
+    {
+        #ifdef TEST_MEMORY_MANAGER
+        log("ENTER: new[]");
+        #endif
 
-            unsigned int    hashIndex = ((unsigned int) au->reportedAddress >> 4) & (hashSize - 1);
-            if (hashTable[hashIndex]) hashTable[hashIndex]->prev = au;
-            au->next = hashTable[hashIndex];
-            au->prev = NULL;
-            hashTable[hashIndex] = au;
+        // The ANSI standard says that allocation requests of 0 bytes will still return a valid value
 
-            // Account for the new allocatin unit in our stats
+        if (reportedSize == 0) reportedSize = 1;
 
-            stats.totalReportedMemory += au->reportedSize;
-            stats.totalActualMemory   += au->actualSize;
-            stats.totalAllocUnitCount++;
-            if (stats.totalReportedMemory > stats.peakReportedMemory) stats.peakReportedMemory = stats.totalReportedMemory;
-            if (stats.totalActualMemory   > stats.peakActualMemory)   stats.peakActualMemory   = stats.totalActualMemory;
-            if (stats.totalAllocUnitCount > stats.peakAllocUnitCount) stats.peakAllocUnitCount = stats.totalAllocUnitCount;
-            stats.accumulatedReportedMemory += au->reportedSize;
-            stats.accumulatedActualMemory += au->actualSize;
-            stats.accumulatedAllocUnitCount++;
+        // ANSI says: loop continuously because the error handler could possibly free up some memory
 
-            // Prepare the allocation unit for use (wipe it with recognizable garbage)
+        for(;;)
+        {
+            // Try the allocation
 
-            wipeWithPattern(au, unusedPattern);
+            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new_array, reportedSize);
+            if (ptr)
+            {
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new[]");
+                #endif
+                return ptr;
+            }
 
-            // calloc() expects the reported memory address range to be filled with 0's
+            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
+            // set it back again.
 
-            if (allocationType == m_alloc_calloc)
+            new_handler    nh = set_new_handler(0);
+            set_new_handler(nh);
+
+            // If there is an error handler, call it
+
+            if (nh)
             {
-                memset(au->reportedAddress, 0, au->reportedSize);
+                (*nh)();
             }
 
-            // Validate every single allocated unit in memory
-
-            if (alwaysValidateAll) m_validateAllAllocUnits();
+            // Otherwise, throw the exception
 
-            // Log the result
+            else
+            {
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new[]");
+                #endif
+                throw std::bad_alloc();
+            }
+        }
+    }
 
-            if (alwaysLogAll) log("                                                                 OK: %010p (hash: %d)", au->reportedAddress, hashIndex);
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Other global new/new[]
+    //
+    // These are the standard new/new[] operators as used by Microsoft's memory tracker. We don't want them interfering with our memory
+    // tracking efforts. Like the previous versions, these are merely interface functions that operate like normal new/new[], but use
+    // our memory tracking routines.
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            // Resetting the globals insures that if at some later time, somebody calls our memory manager from an unknown
-            // source (i.e. they didn't include our H file) then we won't think it was the last allocation.
+    void    *operator new(size_t reportedSize, const char *sourceFile, int sourceLine) throw (std::bad_alloc)
+    {
+        #ifdef TEST_MEMORY_MANAGER
+        log("ENTER: new");
+        #endif
 
-            resetGlobals();
+        // The ANSI standard says that allocation requests of 0 bytes will still return a valid value
 
-            // Return the (reported) address of the new allocation unit
+        if (reportedSize == 0) reportedSize = 1;
 
-            #ifdef TEST_MEMORY_MANAGER
-            log("EXIT : m_allocator()");
-            #endif
+        // ANSI says: loop continuously because the error handler could possibly free up some memory
 
-            return au->reportedAddress;
-        }
-        catch(const char *err)
+        for(;;)
         {
-            // Deal with the errors
+            // Try the allocation
 
-            log(err);
-            resetGlobals();
+            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new, reportedSize);
+            if (ptr)
+            {
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new");
+                #endif
+                return ptr;
+            }
 
-            #ifdef TEST_MEMORY_MANAGER
-            log("EXIT : m_allocator()");
-            #endif
+            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
+            // set it back again.
 
-            return NULL;
+            new_handler    nh = set_new_handler(0);
+            set_new_handler(nh);
+
+            // If there is an error handler, call it
+
+            if (nh)
+            {
+                (*nh)();
+            }
+
+            // Otherwise, throw the exception
+
+            else
+            {
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new");
+                #endif
+                throw std::bad_alloc();
+            }
         }
     }
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
-    // Reallocate memory and track it
     // ---------------------------------------------------------------------------------------------------------------------------------
 
-    void    *m_reallocator(const char *sourceFile, const unsigned int sourceLine, const unsigned int reallocationType, const size_t reportedSize, void *reportedAddress)
+    void    *operator new[](size_t reportedSize, const char *sourceFile, int sourceLine) throw (std::bad_alloc)
     {
-        try
+        #ifdef TEST_MEMORY_MANAGER
+        log("ENTER: new[]");
+        #endif
+
+        // The ANSI standard says that allocation requests of 0 bytes will still return a valid value
+
+        if (reportedSize == 0) reportedSize = 1;
+
+        // ANSI says: loop continuously because the error handler could possibly free up some memory
+
+        for(;;)
         {
-            #ifdef TEST_MEMORY_MANAGER
-            log("ENTER: m_reallocator()");
-            #endif
+            // Try the allocation
 
-            // Calling realloc with a NULL should force same operations as a malloc
+            void    *ptr = m_allocator(sourceFile, sourceLine, m_alloc_new_array, reportedSize);
+            if (ptr)
+            {
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new[]");
+                #endif
+                return ptr;
+            }
 
-            if (!reportedAddress)
+            // There isn't a way to determine the new handler, except through setting it. So we'll just set it to NULL, then
+            // set it back again.
+
+            new_handler    nh = set_new_handler(0);
+            set_new_handler(nh);
+
+            // If there is an error handler, call it
+
+            if (nh)
             {
-                return m_allocator(sourceFile, sourceLine, reallocationType, reportedSize);
+                (*nh)();
             }
 
-            // Increase our allocation count
+            // Otherwise, throw the exception
 
-            currentAllocationCount++;
+            else
+            {
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : new[]");
+                #endif
+                throw std::bad_alloc();
+            }
+        }
+    }
 
-            // If you hit this assert, you requested a breakpoint on a specific allocation count
-            m_assert(currentAllocationCount != breakOnAllocationCount);
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Global delete/delete[]
+    //
+    // These are the standard delete/delete[] operators. They are merely interface functions that operate like normal delete/delete[],
+    // but use our memory tracking routines.
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            // Log the request
+    void    operator delete(void *reportedAddress) throw ()
+    {
+        #ifdef TEST_MEMORY_MANAGER
+        log("ENTER: delete");
+        #endif
 
-            if (alwaysLogAll) log("%05d %-40s %8s(%010p): %s", currentAllocationCount, ownerString(sourceFile, sourceLine), allocationTypes[reallocationType], reportedAddress, memorySizeString(reportedSize));
+        // ANSI says: delete & delete[] allow NULL pointers (they do nothing)
 
-            // Locate the existing allocation unit
+        if (!reportedAddress) return;
 
-            sAllocUnit    *au = findAllocUnit(reportedAddress);
+        m_deallocator(sourceFile, sourceLine, m_alloc_delete, reportedAddress);
 
-            // If you hit this assert, you tried to reallocate RAM that wasn't allocated by this memory manager.
-            m_assert(au != NULL);
-            if (au == NULL) throw "Request to reallocate RAM that was never allocated";
+        #ifdef TEST_MEMORY_MANAGER
+        log("EXIT : delete");
+        #endif
+    }
 
-            // If you hit this assert, then the allocation unit that is about to be reallocated is damaged. But you probably
-            // already know that from a previous assert you should have seen in validateAllocUnit() :)
-            m_assert(m_validateAllocUnit(au));
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            // If you hit this assert, then this reallocation was made from a source that isn't setup to use this memory
-            // tracking software, use the stack frame to locate the source and include our H file.
-            m_assert(reallocationType != m_alloc_unknown);
+    void    operator delete[](void *reportedAddress) throw ()
+    {
+        #ifdef TEST_MEMORY_MANAGER
+        log("ENTER: delete[]");
+        #endif
 
-            // If you hit this assert, you were trying to reallocate RAM that was not allocated in a way that is compatible with
-            // realloc. In other words, you have a allocation/reallocation mismatch.
-            m_assert(au->allocationType == m_alloc_malloc ||
-                 au->allocationType == m_alloc_calloc ||
-                 au->allocationType == m_alloc_realloc);
+        // ANSI says: delete & delete[] allow NULL pointers (they do nothing)
 
-            // If you hit this assert, then the "break on realloc" flag for this allocation unit is set (and will continue to be
-            // set until you specifically shut it off. Interrogate the 'au' variable to determine information about this
-            // allocation unit.
-            m_assert(au->breakOnRealloc == false);
+        if (!reportedAddress) return;
 
-            // Keep track of the original size
+        m_deallocator(sourceFile, sourceLine, m_alloc_delete_array, reportedAddress);
 
-            unsigned int    originalReportedSize = au->reportedSize;
+        #ifdef TEST_MEMORY_MANAGER
+        log("EXIT : delete[]");
+        #endif
+    }
 
-            // Do the reallocation
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Allocate memory and track it
+    // ---------------------------------------------------------------------------------------------------------------------------------
 
-            void    *oldReportedAddress = reportedAddress;
-            size_t    newActualSize = calculateActualSize(reportedSize);
-            void    *newActualAddress = NULL;
+    void    *m_allocator(const char *sourceFile, const unsigned int sourceLine, const unsigned int allocationType, const size_t reportedSize)
+    {
+        try
+        {
+            #ifdef TEST_MEMORY_MANAGER
+            log("ENTER: m_allocator()");
+            #endif
+
+            // Increase our allocation count
+
+            unsigned int    allocationNumber = ++currentAllocationCount;
+
+            // Log the request
+
+            if (alwaysLogAll) log("%05d %-40s %8s            : %s", allocationNumber, ownerString(sourceFile, sourceLine), allocationTypes[allocationType], memorySizeString(reportedSize));
+
+            // If you hit this assert, you requested a breakpoint on a specific allocation count
+            m_assert(allocationNumber != breakOnAllocationCount);
+
+            // Allocations left out of the sample only get a header marking them as untracked
+
+            if (!sampleThisAllocation())
+            {
+                void    *reportedAddress = allocateUntracked(reportedSize, allocationType == m_alloc_calloc);
+                if (reportedAddress == NULL) throw "Request for allocation failed. Out of memory.";
+                resetGlobals();
+
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : m_allocator()");
+                #endif
+
+                return reportedAddress;
+            }
+
+            // Do the allocation
+
+            unsigned int    mode = chooseGuardMode();
+            size_t    actualSize = 0;
+            void    *actualAddress = NULL;
+            void    *reportedAddress = NULL;
             #ifdef RANDOM_FAILURE
             double    a = rand();
             double    b = RAND_MAX / 100.0 * RANDOM_FAILURE;
             if (a > b)
             {
-                newActualAddress = realloc(au->actualAddress, newActualSize);
+                reportedAddress = allocateBlock(reportedSize, mode, actualAddress, actualSize);
             }
             else
             {
                 log("!Random faiure!");
             }
             #else
-            newActualAddress = realloc(au->actualAddress, newActualSize);
+            reportedAddress = allocateBlock(reportedSize, mode, actualAddress, actualSize);
             #endif
 
             // We don't want to assert with random failures, because we want the application to deal with them.
 
             #ifndef RANDOM_FAILURE
-            // If you hit this assert, then the requested allocation simply failed (you're out of memory) Interrogate the
-            // variable 'au' to see the original allocation. You can also query 'newActualSize' to see the amount of memory
-            // trying to be allocated. Finally, you can query 'reportedSize' to see how much memory was requested by the caller.
-            m_assert(newActualAddress);
+            // If you hit this assert, then the requested allocation simply failed (you're out of memory.) Interrogate the
+            // variable 'actualSize' or the stack frame to see what you were trying to do.
+            m_assert(reportedAddress != NULL);
             #endif
 
-            if (!newActualAddress) throw "Request for reallocation failed. Out of memory.";
+            if (reportedAddress == NULL)
+            {
+                throw "Request for allocation failed. Out of memory.";
+            }
+
+            // If you hit this assert, then this allocation was made from a source that isn't setup to use this memory tracking
+            // software, use the stack frame to locate the source and include our H file.
+            m_assert(allocationType != m_alloc_unknown);
 
-            // Remove this allocation from our stats (we'll add the new reallocation again later)
+            // Grab a new allocation unit from the reservoir of the shard that will track this address
 
-            stats.totalReportedMemory -= au->reportedSize;
-            stats.totalActualMemory   -= au->actualSize;
+            sShard    &shard = findShard(reportedAddress);
+            sAllocUnit    *au;
+            unsigned int    siteIndex;
+            {
+                MemLock    lock(shard.lock);
+                au = newAllocUnit(shard);
+            }
 
-            // Update the allocation with the new information
+            // Populate it with some real data
 
-            au->actualSize        = newActualSize;
-            au->actualAddress     = newActualAddress;
-            au->reportedSize      = calculateReportedSize(newActualSize);
-            au->reportedAddress   = calculateReportedAddress(newActualAddress);
-            au->allocationType    = reallocationType;
+            au->actualSize        = actualSize;
+            au->actualAddress     = actualAddress;
+            au->reportedSize      = reportedSize;
+            au->reportedAddress   = reportedAddress;
+            au->guardMode         = mode;
+            au->allocationType    = allocationType;
             au->sourceLine        = sourceLine;
-            au->allocationNumber  = currentAllocationCount;
+            au->allocationNumber  = allocationNumber;
             if (sourceFile) strncpy(au->sourceFile, sourceFileStripper(sourceFile), sizeof(au->sourceFile) - 1);
             else        strcpy (au->sourceFile, "??");
+            au->siteIndex         = siteIndex = addToSite(au->sourceFile, au->sourceLine, reportedSize);
 
-            // The reallocation may cause the address to change, so we should relocate our allocation unit within the hash table
+            // Prepare the allocation unit for use (wipe it with recognizable garbage)
 
-            unsigned int    hashIndex = (unsigned int) -1;
-            if (oldReportedAddress != au->reportedAddress)
+            if (wipesOnAllocation(au)) wipeWithPattern(au, unusedPattern);
+            writeGuards(au);
+
+            // calloc() expects the reported memory address range to be filled with 0's
+
+            if (allocationType == m_alloc_calloc)
             {
-                // Remove this allocation unit from the hash table
+                memset(au->reportedAddress, 0, au->reportedSize);
+            }
 
+            // Insert the new allocation into the shard's hash table, and account for it in our stats
+
+            {
+                MemLock    lock(shard.lock);
+                if (!insertAllocUnit(shard, au))
                 {
-                    unsigned int    hashIndex = ((unsigned int) oldReportedAddress >> 4) & (hashSize - 1);
-                    if (hashTable[hashIndex] == au)
-                    {
-                        hashTable[hashIndex] = hashTable[hashIndex]->next;
-                    }
-                    else
-                    {
-                        if (au->prev)    au->prev->next = au->next;
-                        if (au->next)    au->next->prev = au->prev;
-                    }
+                    releaseAllocUnit(shard, au);
+                    au = NULL;
                 }
+                else
+                {
+                    shard.accumulatedReportedMemory += reportedSize;
+                    shard.accumulatedActualMemory += actualSize;
+                    shard.accumulatedAllocUnitCount++;
+                }
+            }
+
+            if (au == NULL)
+            {
+                removeFromSite(siteIndex, reportedSize);
+                releaseBlock(actualAddress, actualSize, mode);
+                throw "Unable to allocate RAM for internal memory tracking data";
+            }
+
+            addToTotals(reportedSize, actualSize, 1);
+
+            // Validate every single allocated unit in memory
+
+            if (alwaysValidateAll) m_validateAllAllocUnits();
+
+            // Log the result
+
+            if (alwaysLogAll) log("                                                                 OK: %010p (shard: %d)", au->reportedAddress, (int) (&shard - shards));
+
+            // Resetting the globals insures that if at some later time, somebody calls our memory manager from an unknown
+            // source (i.e. they didn't include our H file) then we won't think it was the last allocation.
+
+            resetGlobals();
+
+            // Return the (reported) address of the new allocation unit
+
+            #ifdef TEST_MEMORY_MANAGER
+            log("EXIT : m_allocator()");
+            #endif
+
+            return reportedAddress;
+        }
+        catch(const char *err)
+        {
+            // Deal with the errors
+
+            log(err);
+            resetGlobals();
+
+            #ifdef TEST_MEMORY_MANAGER
+            log("EXIT : m_allocator()");
+            #endif
+
+            return NULL;
+        }
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // Reallocate memory and track it
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    void    *m_reallocator(const char *sourceFile, const unsigned int sourceLine, const unsigned int reallocationType, const size_t reportedSize, void *reportedAddress)
+    {
+        try
+        {
+            #ifdef TEST_MEMORY_MANAGER
+            log("ENTER: m_reallocator()");
+            #endif
+
+            // Calling realloc with a NULL should force same operations as a malloc
+
+            if (!reportedAddress)
+            {
+                return m_allocator(sourceFile, sourceLine, reallocationType, reportedSize);
+            }
+
+            // Increase our allocation count
+
+            unsigned int    allocationNumber = ++currentAllocationCount;
+
+            // If you hit this assert, you requested a breakpoint on a specific allocation count
+            m_assert(allocationNumber != breakOnAllocationCount);
+
+            // Log the request
+
+            if (alwaysLogAll) log("%05d %-40s %8s(%010p): %s", allocationNumber, ownerString(sourceFile, sourceLine), allocationTypes[reallocationType], reportedAddress, memorySizeString(reportedSize));
+
+            // Untracked allocations stay untracked
+
+            if (isUntracked(reportedAddress))
+            {
+                void    *newReportedAddress = reallocateUntracked(reportedAddress, reportedSize);
+                if (newReportedAddress == NULL) throw "Request for reallocation failed. Out of memory.";
+                resetGlobals();
+
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : m_reallocator()");
+                #endif
+
+                return newReportedAddress;
+            }
+
+            // Locate the existing allocation unit
+
+            sAllocUnit    *au = findAllocUnit(reportedAddress);
+
+            // If you hit this assert, you tried to reallocate RAM that wasn't allocated by this memory manager.
+            m_assert(au != NULL);
+            if (au == NULL) throw "Request to reallocate RAM that was never allocated";
+
+            // If you hit this assert, then the allocation unit that is about to be reallocated is damaged. But you probably
+            // already know that from a previous assert you should have seen in validateAllocUnit() :)
+            m_assert(m_validateAllocUnit(au));
+
+            // If you hit this assert, then this reallocation was made from a source that isn't setup to use this memory
+            // tracking software, use the stack frame to locate the source and include our H file.
+            m_assert(reallocationType != m_alloc_unknown);
+
+            // If you hit this assert, you were trying to reallocate RAM that was not allocated in a way that is compatible with
+            // realloc. In other words, you have a allocation/reallocation mismatch.
+            m_assert(au->allocationType == m_alloc_malloc ||
+                 au->allocationType == m_alloc_calloc ||
+                 au->allocationType == m_alloc_realloc);
+
+            // If you hit this assert, then the "break on realloc" flag for this allocation unit is set (and will continue to be
+            // set until you specifically shut it off. Interrogate the 'au' variable to determine information about this
+            // allocation unit.
+            m_assert(au->breakOnRealloc == false);
+
+            // Keep track of the original size
+
+            size_t    originalReportedSize = au->reportedSize;
+            size_t    originalActualSize = au->actualSize;
+
+            // Take the allocation unit out of the table before the old block is released or moved, so that another thread
+            // being handed the same address by malloc meanwhile can't have its unit confused with this one
+
+            void    *oldReportedAddress = reportedAddress;
+            {
+                sShard    &oldShard = findShard(oldReportedAddress);
+                MemLock    lock(oldShard.lock);
+                sAllocUnit    **slot = findSlot(oldShard, oldReportedAddress);
+                m_assert(slot && *slot == au);
+                if (slot) removeAllocUnit(oldShard, slot);
+            }
+
+            // Do the reallocation
+
+            unsigned int    mode = chooseGuardMode();
+            size_t    newActualSize = 0;
+            void    *newActualAddress = NULL;
+            void    *newReportedAddress = NULL;
+            #ifdef RANDOM_FAILURE
+            double    a = rand();
+            double    b = RAND_MAX / 100.0 * RANDOM_FAILURE;
+            if (a > b)
+            {
+                newReportedAddress = reallocateBlock(au, reportedSize, mode, newActualAddress, newActualSize);
+            }
+            else
+            {
+                log("!Random faiure!");
+            }
+            #else
+            newReportedAddress = reallocateBlock(au, reportedSize, mode, newActualAddress, newActualSize);
+            #endif
+
+            // We don't want to assert with random failures, because we want the application to deal with them.
+
+            #ifndef RANDOM_FAILURE
+            // If you hit this assert, then the requested allocation simply failed (you're out of memory) Interrogate the
+            // variable 'au' to see the original allocation. You can also query 'newActualSize' to see the amount of memory
+            // trying to be allocated. Finally, you can query 'reportedSize' to see how much memory was requested by the caller.
+            m_assert(newReportedAddress);
+            #endif
 
-                // Re-insert it back into the hash table
+            if (!newReportedAddress)
+            {
+                // The old block is untouched, track it again
 
-                hashIndex = ((unsigned int) au->reportedAddress >> 4) & (hashSize - 1);
-                if (hashTable[hashIndex]) hashTable[hashIndex]->prev = au;
-                au->next = hashTable[hashIndex];
-                au->prev = NULL;
-                hashTable[hashIndex] = au;
+                sShard    &oldShard = findShard(oldReportedAddress);
+                MemLock    lock(oldShard.lock);
+                if (!insertAllocUnit(oldShard, au)) log("Unable to allocate RAM for internal memory tracking data, allocation %d is no longer tracked", au->allocationNumber);
+                throw "Request for reallocation failed. Out of memory.";
             }
 
+            // Remove this allocation from our stats (we'll add the new reallocation again later)
+
+            removeFromTotals(au->reportedSize, au->actualSize, 0);
+
+            // The reallocation may cause the address to change, the allocation unit goes back in the shard of the new address
+
+            sShard    &shard = findShard(newReportedAddress);
+
+            // Update the allocation with the new information
+
+            au->actualSize        = newActualSize;
+            au->actualAddress     = newActualAddress;
+            au->reportedSize      = reportedSize;
+            au->reportedAddress   = newReportedAddress;
+            au->guardMode         = mode;
+            au->allocationType    = reallocationType;
+            au->sourceLine        = sourceLine;
+            au->allocationNumber  = allocationNumber;
+            au->isReferenced      = false;
+            if (sourceFile) strncpy(au->sourceFile, sourceFileStripper(sourceFile), sizeof(au->sourceFile) - 1);
+            else        strcpy (au->sourceFile, "??");
+
+            // The reallocation now belongs to its own owner
+
+            removeFromSite(au->siteIndex, originalReportedSize);
+            au->siteIndex         = addToSite(au->sourceFile, au->sourceLine, au->reportedSize);
+
             // Account for the new allocatin unit in our stats
 
-            stats.totalReportedMemory += au->reportedSize;
-            stats.totalActualMemory   += au->actualSize;
-            if (stats.totalReportedMemory > stats.peakReportedMemory) stats.peakReportedMemory = stats.totalReportedMemory;
-            if (stats.totalActualMemory   > stats.peakActualMemory)   stats.peakActualMemory   = stats.totalActualMemory;
-            int    deltaReportedSize = reportedSize - originalReportedSize;
-            if (deltaReportedSize > 0)
+            ptrdiff_t    deltaReportedSize = (ptrdiff_t) reportedSize - (ptrdiff_t) originalReportedSize;
+            ptrdiff_t    deltaActualSize = (ptrdiff_t) newActualSize - (ptrdiff_t) originalActualSize;
             {
-                stats.accumulatedReportedMemory += deltaReportedSize;
-                stats.accumulatedActualMemory += deltaReportedSize;
+                MemLock    lock(shard.lock);
+                if (!insertAllocUnit(shard, au))
+                {
+                    // Without room in the table the allocation can no longer be tracked, though it stays valid
+
+                    log("Unable to allocate RAM for internal memory tracking data, allocation %d is no longer tracked", au->allocationNumber);
+                }
+                if (deltaReportedSize > 0) shard.accumulatedReportedMemory += deltaReportedSize;
+                if (deltaActualSize > 0) shard.accumulatedActualMemory += deltaActualSize;
             }
+            addToTotals(au->reportedSize, au->actualSize, 0);
 
             // Prepare the allocation unit for use (wipe it with recognizable garbage)
 
-            wipeWithPattern(au, unusedPattern, originalReportedSize);
+            if (wipesOnAllocation(au)) wipeWithPattern(au, unusedPattern, originalReportedSize);
+            writeGuards(au);
 
             // If you hit this assert, then something went wrong, because the allocation unit was properly validated PRIOR to
             // the reallocation. This should not happen.
@@ -1281,7 +2001,7 @@ sMStats    m_getMemoryStatistics()
 
             // Log the result
 
-            if (alwaysLogAll) log("                                                                 OK: %010p (hash: %d)", au->reportedAddress, hashIndex);
+            if (alwaysLogAll) log("                                                                 OK: %010p (shard: %d)", au->reportedAddress, (int) (&shard - shards));
 
             // Resetting the globals insures that if at some later time, somebody calls our memory manager from an unknown
             // source (i.e. they didn't include our H file) then we won't think it was the last allocation.
@@ -1327,9 +2047,33 @@ sMStats    m_getMemoryStatistics()
 
             if (alwaysLogAll) log("      %-40s %8s(%010p)", ownerString(sourceFile, sourceLine), allocationTypes[deallocationType], reportedAddress);
 
-            // Go get the allocation unit
+            // Untracked allocations were never entered in the tables
 
-            sAllocUnit    *au = findAllocUnit(reportedAddress);
+            if (reportedAddress && isUntracked(reportedAddress))
+            {
+                freeUntracked(reportedAddress);
+                resetGlobals();
+
+                #ifdef TEST_MEMORY_MANAGER
+                log("EXIT : m_deallocator()");
+                #endif
+
+                return;
+            }
+
+            // Go get the allocation unit, and remove it from its shard's hash table
+
+            sShard    &shard = findShard(reportedAddress);
+            sAllocUnit    *au = NULL;
+            {
+                MemLock    lock(shard.lock);
+                sAllocUnit    **slot = findSlot(shard, reportedAddress);
+                if (slot)
+                {
+                    au = *slot;
+                    removeAllocUnit(shard, slot);
+                }
+            }
 
             // If you hit this assert, you tried to deallocate RAM that wasn't allocated by this memory manager.
             m_assert(au != NULL);
@@ -1363,315 +2107,1010 @@ sMStats    m_getMemoryStatistics()
             // Wipe the deallocated RAM with a new pattern. This doen't actually do us much good in debug mode under WIN32,
             // because Microsoft's memory debugging & tracking utilities will wipe it right after we do. Oh well.
 
-            wipeWithPattern(au, releasedPattern);
+            if (wipesOnRelease(au)) wipeWithPattern(au, releasedPattern);
 
             // Do the deallocation
 
-            free(au->actualAddress);
+            releaseBlock(au->actualAddress, au->actualSize, au->guardMode);
+
+            // Remove this allocation from our stats
+
+            removeFromTotals(au->reportedSize, au->actualSize, 1);
+            removeFromSite(au->siteIndex, au->reportedSize);
+
+            // Return this allocation unit to the reservoir of unused allocation units
+
+            {
+                MemLock    lock(shard.lock);
+                releaseAllocUnit(shard, au);
+            }
+
+            // Resetting the globals insures that if at some later time, somebody calls our memory manager from an unknown
+            // source (i.e. they didn't include our H file) then we won't think it was the last allocation.
+
+            resetGlobals();
+
+            // Validate every single allocated unit in memory
+
+            if (alwaysValidateAll) m_validateAllAllocUnits();
+
+            // If we're in the midst of static deinitialization time, track any pending memory leaks
+
+            if (staticDeinitTime) dumpLeakReport();
+        }
+        catch(const char *err)
+        {
+            // Deal with errors
+
+            log(err);
+            resetGlobals();
+        }
+
+        #ifdef TEST_MEMORY_MANAGER
+        log("EXIT : m_deallocator()");
+        #endif
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- The following utilitarian allow you to become proactive in tracking your own memory, or help you narrow in on those tough
+    // bugs.
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    bool    m_validateAddress(const void *reportedAddress)
+    {
+        // Just see if the address exists in our allocation routines
+
+        return findAllocUnit(reportedAddress) != NULL;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    static    void    checkGuards(const sAllocUnit *allocUnit, bool &preIntact, bool &postIntact)
+    {
+        // How much padding there is to check depends on the guard mode of the allocation
+
+        size_t    prefix = prefixSize(allocUnit->guardMode);
+        size_t    postfix = postfixSize(allocUnit->guardMode, allocUnit->reportedSize);
+        preIntact = checkPattern((char *) allocUnit->reportedAddress - prefix, prefix, prefixPattern);
+        postIntact = checkPattern((char *) allocUnit->reportedAddress + allocUnit->reportedSize, postfix, postfixPattern);
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    bool    m_validateAllocUnit(const sAllocUnit *allocUnit)
+    {
+        // Make sure the padding is untouched
+
+        bool    preIntact, postIntact;
+        checkGuards(allocUnit, preIntact, postIntact);
+        bool    errorFlag = false;
+
+        if (!preIntact)
+        {
+            log("A memory allocation unit was corrupt because of an underrun:");
+            m_dumpAllocUnit(allocUnit, "  ");
+            errorFlag = true;
+        }
+
+        // If you hit this assert, then you should know that this allocation unit has been damaged. Something (possibly the
+        // owner?) has underrun the allocation unit (modified a few bytes prior to the start). You can interrogate the
+        // variable 'allocUnit' to see statistics and information about this damaged allocation unit.
+        m_assert(preIntact);
+
+        if (!postIntact)
+        {
+            log("A memory allocation unit was corrupt because of an overrun:");
+            m_dumpAllocUnit(allocUnit, "  ");
+            errorFlag = true;
+        }
+
+        // If you hit this assert, then you should know that this allocation unit has been damaged. Something (possibly the
+        // owner?) has overrun the allocation unit (modified a few bytes after the end). You can interrogate the variable
+        // 'allocUnit' to see statistics and information about this damaged allocation unit.
+        m_assert(postIntact);
+
+        // Return the error status (we invert it, because a return of 'false' means error)
+
+        return !errorFlag;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    bool    m_validateAllAllocUnits()
+    {
+        // Just go through each allocation unit in the hash table and count the ones that have errors
+
+        unsigned int    errors = 0;
+        for (unsigned int s = 0; s < shardCount; s++)
+        {
+            sShard    &shard = shards[s];
+            MemLock    lock(shard.lock);
+
+            unsigned int    allocCount = 0;
+            unsigned int    deletedCount = 0;
+            for (unsigned int i = 0; i < shard.tableSize; i++)
+            {
+                sAllocUnit    *ptr = shard.table[i];
+                if (!ptr) continue;
+                if (ptr == &deletedUnit)
+                {
+                    deletedCount++;
+                    continue;
+                }
+
+                allocCount++;
+                if (!m_validateAllocUnit(ptr)) errors++;
+            }
+
+            // Test for hash-table correctness, the counts are only stable per shard while other threads allocate
+
+            if (allocCount != shard.unitCount || deletedCount != shard.deletedCount)
+            {
+                log("Memory tracking hash table corrupt!");
+                errors++;
+            }
+
+            // If you hit this assert, then the internal memory (hash table) used by this memory tracking software is damaged! The
+            // best way to track this down is to use the alwaysLogAll flag in conjunction with STRESS_TEST macro to narrow in on the
+            // offending code. After running the application with these settings (and hitting this assert again), interrogate the
+            // memory.log file to find the previous successful operation. The corruption will have occurred between that point and
+            // this assertion.
+            m_assert(allocCount == shard.unitCount);
+        }
+
+        // If you hit this assert, then you've probably already been notified that there was a problem with a allocation unit in a
+        // prior call to validateAllocUnit(), but this assert is here just to make sure you know about it. :)
+        m_assert(errors == 0);
+
+        // Log any errors
+
+        if (errors) log("While validting all allocation units, %d allocation unit(s) were found to have problems", errors);
+
+        // Return the error status
+
+        return errors != 0;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- Unused RAM calculation routines. Use these to determine how much of your RAM is unused (in bytes)
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    size_t    m_calcUnused(const sAllocUnit *allocUnit)
+    {
+        const unsigned int    *ptr = (const unsigned int *) allocUnit->reportedAddress;
+        size_t            count = 0;
+
+        for (size_t i = 0; i + sizeof(unusedPattern) <= allocUnit->reportedSize; i += sizeof(unusedPattern), ptr++)
+        {
+            if (*ptr == unusedPattern) count += sizeof(unusedPattern);
+        }
+
+        return count;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    size_t    m_calcAllUnused()
+    {
+        // Just go through each allocation unit in the hash table and count the unused RAM
+
+        size_t    total = 0;
+        for (unsigned int s = 0; s < shardCount; s++)
+        {
+            MemLock    lock(shards[s].lock);
+            for (unsigned int i = 0; i < shards[s].tableSize; i++)
+            {
+                sAllocUnit    *ptr = shards[s].table[i];
+                if (ptr && ptr != &deletedUnit) total += m_calcUnused(ptr);
+            }
+        }
+
+        return total;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+    // -DOC- The following functions are for logging and statistics reporting.
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    void    m_dumpAllocUnit(const sAllocUnit *allocUnit, const char *prefix)
+    {
+        log("%sAddress (reported): %010p",       prefix, allocUnit->reportedAddress);
+        log("%sAddress (actual)  : %010p",       prefix, allocUnit->actualAddress);
+        log("%sSize (reported)   : 0x%08zX (%s)", prefix, allocUnit->reportedSize, memorySizeString(allocUnit->reportedSize));
+        log("%sSize (actual)     : 0x%08zX (%s)", prefix, allocUnit->actualSize, memorySizeString(allocUnit->actualSize));
+        log("%sOwner             : %s(%d)",  prefix, allocUnit->sourceFile, allocUnit->sourceLine);
+        log("%sAllocation type   : %s",          prefix, allocationTypes[allocUnit->allocationType]);
+        log("%sAllocation number : %d",          prefix, allocUnit->allocationNumber);
+        log("%sGuard mode        : %s",          prefix, guardModes[allocUnit->guardMode]);
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    void    m_dumpMemoryReport(const char *filename, const bool overwrite)
+    {
+        // Open the report file
+
+        FILE    *fp = NULL;
+
+        if (overwrite)    fp = fopen(filename, "w+b");
+        else        fp = fopen(filename, "ab");
+
+        // If you hit this assert, then the memory report generator is unable to log information to a file (can't open the file for
+        // some reason.)
+        m_assert(fp);
+        if (!fp) return;
+
+        sMStats    stats = m_getMemoryStatistics();
+
+            // Header
+
+            static  char    timeString[25];
+            memset(timeString, 0, sizeof(timeString));
+            time_t  t = time(NULL);
+            struct  tm *tme = localtime(&t);
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+            fprintf(fp, "|                                             Memory report for: %02d/%02d/%04d %02d:%02d:%02d                                               |\r\n", tme->tm_mon + 1, tme->tm_mday, tme->tm_year + 1900, tme->tm_hour, tme->tm_min, tme->tm_sec);
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "\r\n");
+        if (sampleRate > 1) fprintf(fp, "Only one allocation in %d was sampled for tracking, the figures below cover those alone.\r\n", (unsigned int) sampleRate);
+        fprintf(fp, "\r\n");
+
+        // Report summary
+
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "|                                                           T O T A L S                                                            |\r\n");
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "              Allocation unit count: %10s\r\n", insertCommas(stats.totalAllocUnitCount));
+        fprintf(fp, "            Reported to application: %s\r\n", memorySizeString(stats.totalReportedMemory));
+        fprintf(fp, "         Actual total memory in use: %s\r\n", memorySizeString(stats.totalActualMemory));
+        fprintf(fp, "           Memory tracking overhead: %s\r\n", memorySizeString(stats.totalActualMemory - stats.totalReportedMemory));
+        fprintf(fp, "\r\n");
+
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "|                                                            P E A K S                                                             |\r\n");
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "              Allocation unit count: %10s\r\n", insertCommas(stats.peakAllocUnitCount));
+        fprintf(fp, "            Reported to application: %s\r\n", memorySizeString(stats.peakReportedMemory));
+        fprintf(fp, "                             Actual: %s\r\n", memorySizeString(stats.peakActualMemory));
+        fprintf(fp, "           Memory tracking overhead: %s\r\n", memorySizeString(stats.peakActualMemory - stats.peakReportedMemory));
+        fprintf(fp, "\r\n");
+
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "|                                                      A C C U M U L A T E D                                                       |\r\n");
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "              Allocation unit count: %s\r\n", memorySizeString(stats.accumulatedAllocUnitCount));
+        fprintf(fp, "            Reported to application: %s\r\n", memorySizeString(stats.accumulatedReportedMemory));
+        fprintf(fp, "                             Actual: %s\r\n", memorySizeString(stats.accumulatedActualMemory));
+        fprintf(fp, "\r\n");
+
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "|                                                            P O O L S                                                             |\r\n");
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "              Allocation unit count: %10s\r\n", insertCommas(stats.poolAllocUnitCount));
+        fprintf(fp, "                     Used by blocks: %s\r\n", memorySizeString(stats.poolUsedMemory));
+        fprintf(fp, "                  Reserved in slabs: %s\r\n", memorySizeString(stats.poolReservedMemory));
+        fprintf(fp, "\r\n");
+
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "|                                                           U N U S E D                                                            |\r\n");
+        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
+        fprintf(fp, "    Memory allocated but not in use: %s\r\n", memorySizeString(m_calcAllUnused()));
+        fprintf(fp, "\r\n");
+
+        dumpAllocations(fp);
+
+        fclose(fp);
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    sMStats    m_getMemoryStatistics()
+    {
+        sMStats    stats;
+        stats.totalReportedMemory = totalReportedMemory;
+        stats.totalActualMemory   = totalActualMemory;
+        stats.totalAllocUnitCount = totalAllocUnitCount;
+        stats.peakReportedMemory  = peakReportedMemory;
+        stats.peakActualMemory    = peakActualMemory;
+        stats.peakAllocUnitCount  = peakAllocUnitCount;
+        stats.accumulatedReportedMemory = 0;
+        stats.accumulatedActualMemory = 0;
+        stats.accumulatedAllocUnitCount = 0;
+
+        for (unsigned int s = 0; s < shardCount; s++)
+        {
+            MemLock    lock(shards[s].lock);
+            stats.accumulatedReportedMemory += shards[s].accumulatedReportedMemory;
+            stats.accumulatedActualMemory += shards[s].accumulatedActualMemory;
+            stats.accumulatedAllocUnitCount += shards[s].accumulatedAllocUnitCount;
+        }
+
+        getPoolStatistics(stats);
+        return stats;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    void    m_setSampleRate(unsigned int rate)
+    {
+        sampleRate = rate ? rate : 1;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    unsigned int    m_getSampleRate()
+    {
+        return sampleRate;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    void    m_setGuardMode(unsigned int mode)
+    {
+        if (mode <= m_guard_wipe_on_free) guardMode = mode;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    unsigned int    m_getGuardMode()
+    {
+        return guardMode;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    void    m_setGuardPageRate(unsigned int rate)
+    {
+        guardPageRate = rate ? rate : 1;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    unsigned int    m_getGuardPageRate()
+    {
+        return guardPageRate;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    void    m_markReferenced(const void *reportedAddress)
+    {
+        // Objects on the stack, inside other allocations or not sampled are not found, and stay unmarked
+
+        sShard    &shard = findShard(reportedAddress);
+        MemLock    lock(shard.lock);
+        sAllocUnit    **slot = findSlot(shard, reportedAddress);
+        if (slot) (*slot)->isReferenced = true;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    static    void    getClassName(const char *typeName, char *name, const size_t size)
+    {
+        #if defined(__GNUC__)
+        int    status = 0;
+        char    *demangled = abi::__cxa_demangle(typeName, NULL, NULL, &status);
+        if (demangled)
+        {
+            strncpy(name, demangled, size - 1);
+            free(demangled);
+            return;
+        }
+        #endif
+
+        // MSVC names read "class osg::Node"
+
+        if (!strncmp(typeName, "class ", 6)) typeName += 6;
+        else if (!strncmp(typeName, "struct ", 7)) typeName += 7;
+        strncpy(name, typeName, size - 1);
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+    sMSnapshot    *m_takeSnapshot()
+    {
+        // Copy the sites, then total the live objects by class. The class of an object is read from its type_info under the
+        // shard lock, so the object cannot be freed meanwhile; one being destroyed reports the class its destructors have reached.
+
+        typedef    struct
+        {
+            const char    *typeName;
+            unsigned long long    liveBytes;
+            unsigned long long    liveCount;
+        } sClassTotal;
+
+        sSite        *siteCopy = NULL;
+        unsigned int    siteCopyCount = 0;
+        {
+            MemLock    lock(siteLock);
+            siteCopy = (sSite *) malloc((siteCount ? siteCount : 1) * sizeof(sSite));
+            if (!siteCopy) return NULL;
+            memcpy(siteCopy, sites, siteCount * sizeof(sSite));
+            siteCopyCount = siteCount;
+        }
+
+        unsigned int    classTableSize = 256;
+        unsigned int    classCount = 0;
+        sClassTotal    *classTable = (sClassTotal *) calloc(classTableSize, sizeof(sClassTotal));
+        for (unsigned int s = 0; s < shardCount && classTable; s++)
+        {
+            MemLock    lock(shards[s].lock);
+            for (unsigned int i = 0; i < shards[s].tableSize && classTable; i++)
+            {
+                sAllocUnit    *ptr = shards[s].table[i];
+                if (!ptr || ptr == &deletedUnit || !ptr->isReferenced) continue;
+
+                const char    *typeName = typeid(*(const osg::Referenced *) ptr->reportedAddress).name();
+
+                if ((classCount + 1) * 2 > classTableSize)
+                {
+                    sClassTotal    *newTable = (sClassTotal *) calloc(classTableSize * 2, sizeof(sClassTotal));
+                    if (newTable)
+                    {
+                        for (unsigned int j = 0; j < classTableSize; j++)
+                        {
+                            if (!classTable[j].typeName) continue;
+                            unsigned int    k = (unsigned int) (((size_t) classTable[j].typeName >> 3) & (classTableSize * 2 - 1));
+                            while (newTable[k].typeName) k = (k + 1) & (classTableSize * 2 - 1);
+                            newTable[k] = classTable[j];
+                        }
+                        classTableSize *= 2;
+                    }
+                    free(classTable);
+                    classTable = newTable;
+                    if (!classTable) break;
+                }
+
+                unsigned int    k = (unsigned int) (((size_t) typeName >> 3) & (classTableSize - 1));
+                while (classTable[k].typeName && classTable[k].typeName != typeName) k = (k + 1) & (classTableSize - 1);
+                if (!classTable[k].typeName)
+                {
+                    classTable[k].typeName = typeName;
+                    classCount++;
+                }
+                classTable[k].liveBytes += ptr->reportedSize;
+                classTable[k].liveCount++;
+            }
+        }
+
+        sMSnapshot    *snapshot = classTable ? newSnapshot(siteCopyCount + classCount) : NULL;
+        if (snapshot)
+        {
+            snapshot->stats = m_getMemoryStatistics();
+
+            for (unsigned int i = 0; i < siteCopyCount; i++)
+            {
+                sMEntry    &entry = snapshot->entries[snapshot->entryCount++];
+                sprintf(entry.name, "%s:%u", siteCopy[i].sourceFile, siteCopy[i].sourceLine);
+                entry.kind            = m_entry_site;
+                entry.liveBytes       = (long long) siteCopy[i].liveBytes;
+                entry.liveCount       = (long long) siteCopy[i].liveCount;
+                entry.peakBytes       = (long long) siteCopy[i].peakBytes;
+                entry.allocationCount = (long long) siteCopy[i].allocationCount;
+            }
+
+            for (unsigned int i = 0; i < classTableSize; i++)
+            {
+                if (!classTable[i].typeName) continue;
+
+                sMEntry    &entry = snapshot->entries[snapshot->entryCount++];
+                getClassName(classTable[i].typeName, entry.name, sizeof(entry.name));
+                entry.kind            = m_entry_class;
+                entry.liveBytes       = (long long) classTable[i].liveBytes;
+                entry.liveCount       = (long long) classTable[i].liveCount;
+            }
+
+            qsort(snapshot->entries, snapshot->entryCount, sizeof(sMEntry), compareEntrySizes);
+        }
+
+        free(classTable);
+        free(siteCopy);
+        return snapshot;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------------------------------
+
+
+#else // OSG_USE_MEMORY_MANAGER
+
+    // ----------------------------------------------------------------------------------------------------------------
+    // dummy implementation for optimized build.
+    // ----------------------------------------------------------------------------------------------------------------
+
+    void        m_setOwner(const char *, const unsigned int ) { }
+    bool        &m_breakOnRealloc(void *) { static bool result=false; return result; }
+    bool        &m_breakOnDealloc(void *) { static bool result=false; return result; }
+    void         m_breakOnAllocation(unsigned int ) {} 
+
+    void  *m_allocator(const char *, const unsigned int ,
+                                         const unsigned int , const size_t ) { return 0L;}
+    void  *m_reallocator(const char *, const unsigned int ,
+                                          const unsigned int , const size_t , void *) { return 0L;}
+    void  m_deallocator(const char *, const unsigned int ,
+                                         const unsigned int , const void *) {}
+
+    bool        m_validateAddress(const void *)  { return true; }
+    bool        m_validateAllocUnit(const sAllocUnit *)  { return true; }
+    bool        m_validateAllAllocUnits() { return true; }
+
+    size_t    m_calcUnused(const sAllocUnit *) { return 0; }
+    size_t    m_calcAllUnused() { return 0; }
 
-            // Remove this allocation unit from the hash table
+    void        m_dumpAllocUnit(const sAllocUnit *, const char *) {}
+    void        m_dumpMemoryReport(const char *, const bool ) {}
+    sMStats     m_getMemoryStatistics() { sMStats stats = sMStats(); getPoolStatistics(stats); return stats; }
 
-            unsigned int    hashIndex = ((unsigned int) au->reportedAddress >> 4) & (hashSize - 1);
-            if (hashTable[hashIndex] == au)
-            {
-                hashTable[hashIndex] = au->next;
-            }
-            else
-            {
-                if (au->prev)    au->prev->next = au->next;
-                if (au->next)    au->next->prev = au->prev;
-            }
+    void        m_setSampleRate(unsigned int ) {}
+    unsigned int    m_getSampleRate() { return 1; }
 
-            // Remove this allocation from our stats
+    void        m_setGuardMode(unsigned int ) {}
+    unsigned int    m_getGuardMode() { return m_guard_padding; }
+    void        m_setGuardPageRate(unsigned int ) {}
+    unsigned int    m_getGuardPageRate() { return 1; }
 
-            stats.totalReportedMemory -= au->reportedSize;
-            stats.totalActualMemory   -= au->actualSize;
-            stats.totalAllocUnitCount--;
+    void        m_markReferenced(const void *) {}
+    sMSnapshot  *m_takeSnapshot() { sMSnapshot *snapshot = newSnapshot(0); if (snapshot) snapshot->stats = m_getMemoryStatistics(); return snapshot; }
 
-            // Add this allocation unit to the front of our reservoir of unused allocation units
+#endif // OSG_USE_MEMORY_MANAGER
 
-            memset(au, 0, sizeof(sAllocUnit));
-            au->next = reservoir;
-            reservoir = au;
+// ---------------------------------------------------------------------------------------------------------------------------------
+// -DOC- Snapshot diffs and exports work the same with or without the memory manager
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-            // Resetting the globals insures that if at some later time, somebody calls our memory manager from an unknown
-            // source (i.e. they didn't include our H file) then we won't think it was the last allocation.
+sMSnapshot    *m_diffSnapshots(const sMSnapshot *before, const sMSnapshot *after)
+{
+    if (!before || !after) return NULL;
 
-            resetGlobals();
+    // Sort copies of both by name, then walk them together; entries found in one snapshot only are diffed against zero
 
-            // Validate every single allocated unit in memory
+    sMSnapshot    *diff = newSnapshot(before->entryCount + after->entryCount);
+    sMEntry        *a = (sMEntry *) malloc((before->entryCount + 1) * sizeof(sMEntry));
+    sMEntry        *b = (sMEntry *) malloc((after->entryCount + 1) * sizeof(sMEntry));
+    if (!diff || !a || !b)
+    {
+        m_releaseSnapshot(diff);
+        free(a);
+        free(b);
+        return NULL;
+    }
 
-            if (alwaysValidateAll) m_validateAllAllocUnits();
+    memcpy(a, before->entries, before->entryCount * sizeof(sMEntry));
+    memcpy(b, after->entries, after->entryCount * sizeof(sMEntry));
+    qsort(a, before->entryCount, sizeof(sMEntry), compareEntryNames);
+    qsort(b, after->entryCount, sizeof(sMEntry), compareEntryNames);
 
-            // If we're in the midst of static deinitialization time, track any pending memory leaks
+    unsigned int    i = 0, j = 0;
+    while (i < before->entryCount || j < after->entryCount)
+    {
+        int    order = i == before->entryCount ? 1 : j == after->entryCount ? -1 : compareEntryNames(&a[i], &b[j]);
 
-            if (staticDeinitTime) dumpLeakReport();
+        sMEntry    entry;
+        if (order < 0)
+        {
+            entry = a[i++];
+            entry.liveBytes = -entry.liveBytes;
+            entry.liveCount = -entry.liveCount;
+            entry.peakBytes = -entry.peakBytes;
+            entry.allocationCount = -entry.allocationCount;
         }
-        catch(const char *err)
+        else if (order > 0)
         {
-            // Deal with errors
-
-            log(err);
-            resetGlobals();
+            entry = b[j++];
+        }
+        else
+        {
+            entry = b[j];
+            entry.liveBytes -= a[i].liveBytes;
+            entry.liveCount -= a[i].liveCount;
+            entry.peakBytes -= a[i].peakBytes;
+            entry.allocationCount -= a[i].allocationCount;
+            i++;
+            j++;
         }
 
-        #ifdef TEST_MEMORY_MANAGER
-        log("EXIT : m_deallocator()");
-        #endif
+        if (entry.liveBytes || entry.liveCount || entry.peakBytes || entry.allocationCount) diff->entries[diff->entryCount++] = entry;
     }
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
-    // -DOC- The following utilitarian allow you to become proactive in tracking your own memory, or help you narrow in on those tough
-    // bugs.
-    // ---------------------------------------------------------------------------------------------------------------------------------
+    qsort(diff->entries, diff->entryCount, sizeof(sMEntry), compareEntrySizes);
 
-    bool    m_validateAddress(const void *reportedAddress)
-    {
-        // Just see if the address exists in our allocation routines
+    // The statistics are those of the later snapshot, they are totals and peaks rather than something to subtract
 
-        return findAllocUnit(reportedAddress) != NULL;
-    }
+    diff->stats = after->stats;
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
+    free(a);
+    free(b);
+    return diff;
+}
 
-    bool    m_validateAllocUnit(const sAllocUnit *allocUnit)
-    {
-        // Make sure the padding is untouched
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-        long    *pre = (long *) allocUnit->actualAddress;
-        long    *post = (long *) ((char *)allocUnit->actualAddress + allocUnit->actualSize - paddingSize * sizeof(long));
-        bool    errorFlag = false;
-        for (unsigned int i = 0; i < paddingSize; i++, pre++, post++)
-        {
-            if (*pre != (long) prefixPattern)
-            {
-                log("A memory allocation unit was corrupt because of an underrun:");
-                m_dumpAllocUnit(allocUnit, "  ");
-                errorFlag = true;
-            }
+void    m_releaseSnapshot(sMSnapshot *snapshot)
+{
+    if (!snapshot) return;
+    free(snapshot->entries);
+    free(snapshot);
+}
 
-            // If you hit this assert, then you should know that this allocation unit has been damaged. Something (possibly the
-            // owner?) has underrun the allocation unit (modified a few bytes prior to the start). You can interrogate the
-            // variable 'allocUnit' to see statistics and information about this damaged allocation unit.
-            m_assert(*pre == (long) prefixPattern);
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-            if (*post != (long) postfixPattern)
-            {
-                log("A memory allocation unit was corrupt because of an overrun:");
-                m_dumpAllocUnit(allocUnit, "  ");
-                errorFlag = true;
-            }
+static    void    writeJSONString(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (const char *ptr = str; *ptr; ptr++)
+    {
+        if (*ptr == '"' || *ptr == '\\') fputc('\\', fp);
+        fputc(*ptr, fp);
+    }
+    fputc('"', fp);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// -DOC- The JSON holds a "stats" object with the sMStats fields, then "sites" and "classes" arrays of entries. The CSV has one row
+// per entry under the header kind,name,liveBytes,liveCount,peakBytes,allocationCount, preceded by one "stat" row per sMStats field
+// with its value in the liveBytes column.
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-            // If you hit this assert, then you should know that this allocation unit has been damaged. Something (possibly the
-            // owner?) has overrun the allocation unit (modified a few bytes after the end). You can interrogate the variable
-            // 'allocUnit' to see statistics and information about this damaged allocation unit.
-            m_assert(*post == (long) postfixPattern);
+bool    m_exportSnapshot(const sMSnapshot *snapshot, const char *filename, const unsigned int format)
+{
+    if (!snapshot) return false;
+
+    FILE    *fp = fopen(filename, "wb");
+    if (!fp) return false;
+
+    const sMStats    &stats = snapshot->stats;
+    const char    *statNames[] = {"totalReportedMemory", "totalActualMemory", "peakReportedMemory", "peakActualMemory",
+                        "accumulatedReportedMemory", "accumulatedActualMemory", "accumulatedAllocUnitCount",
+                        "totalAllocUnitCount", "peakAllocUnitCount", "poolReservedMemory", "poolUsedMemory",
+                        "poolAllocUnitCount"};
+    const unsigned long long    statValues[] = {stats.totalReportedMemory, stats.totalActualMemory, stats.peakReportedMemory,
+                        stats.peakActualMemory, stats.accumulatedReportedMemory, stats.accumulatedActualMemory,
+                        stats.accumulatedAllocUnitCount, stats.totalAllocUnitCount, stats.peakAllocUnitCount,
+                        stats.poolReservedMemory, stats.poolUsedMemory, stats.poolAllocUnitCount};
+    const unsigned int    statCount = sizeof(statValues) / sizeof(statValues[0]);
+
+    if (format == m_format_csv)
+    {
+        fprintf(fp, "kind,name,liveBytes,liveCount,peakBytes,allocationCount\n");
+        for (unsigned int i = 0; i < statCount; i++)
+        {
+            fprintf(fp, "stat,%s,%llu,,,\n", statNames[i], statValues[i]);
         }
+        for (unsigned int i = 0; i < snapshot->entryCount; i++)
+        {
+            const sMEntry    &entry = snapshot->entries[i];
 
-        // Return the error status (we invert it, because a return of 'false' means error)
+            // Template class names hold commas, so quote the names
 
-        return !errorFlag;
+            fprintf(fp, "%s,\"%s\",%lld,%lld,%lld,%lld\n", entry.kind == m_entry_site ? "site" : "class", entry.name,
+                entry.liveBytes, entry.liveCount, entry.peakBytes, entry.allocationCount);
+        }
     }
-
-    // ---------------------------------------------------------------------------------------------------------------------------------
-
-    bool    m_validateAllAllocUnits()
+    else
     {
-        // Just go through each allocation unit in the hash table and count the ones that have errors
+        fprintf(fp, "{\n  \"stats\": {");
+        for (unsigned int i = 0; i < statCount; i++)
+        {
+            fprintf(fp, "%s\n    \"%s\": %llu", i ? "," : "", statNames[i], statValues[i]);
+        }
+        fprintf(fp, "\n  }");
 
-        unsigned int    errors = 0;
-        unsigned int    allocCount = 0;
-        for (unsigned int i = 0; i < hashSize; i++)
+        for (unsigned int kind = m_entry_site; kind <= m_entry_class; kind++)
         {
-            sAllocUnit    *ptr = hashTable[i];
-            while(ptr)
+            fprintf(fp, ",\n  \"%s\": [", kind == m_entry_site ? "sites" : "classes");
+            bool    first = true;
+            for (unsigned int i = 0; i < snapshot->entryCount; i++)
             {
-                allocCount++;
-                if (!m_validateAllocUnit(ptr)) errors++;
-                ptr = ptr->next;
+                const sMEntry    &entry = snapshot->entries[i];
+                if (entry.kind != kind) continue;
+
+                fprintf(fp, "%s\n    {\"name\": ", first ? "" : ",");
+                writeJSONString(fp, entry.name);
+                fprintf(fp, ", \"liveBytes\": %lld, \"liveCount\": %lld", entry.liveBytes, entry.liveCount);
+                if (kind == m_entry_site) fprintf(fp, ", \"peakBytes\": %lld, \"allocationCount\": %lld", entry.peakBytes, entry.allocationCount);
+                fprintf(fp, "}");
+                first = false;
             }
+            fprintf(fp, "%s]", first ? "" : "\n  ");
         }
+        fprintf(fp, "\n}\n");
+    }
 
-        // Test for hash-table correctness
+    bool    ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
 
-        if (allocCount != stats.totalAllocUnitCount)
-        {
-            log("Memory tracking hash table corrupt!");
-            errors++;
-        }
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-        // If you hit this assert, then the internal memory (hash table) used by this memory tracking software is damaged! The
-        // best way to track this down is to use the alwaysLogAll flag in conjunction with STRESS_TEST macro to narrow in on the
-        // offending code. After running the application with these settings (and hitting this assert again), interrogate the
-        // memory.log file to find the previous successful operation. The corruption will have occurred between that point and this
-        // assertion.
-        m_assert(allocCount == stats.totalAllocUnitCount);
+bool    m_exportMemoryReport(const char *filename, const unsigned int format)
+{
+    sMSnapshot    *snapshot = m_takeSnapshot();
+    bool        ok = m_exportSnapshot(snapshot, filename, format);
+    m_releaseSnapshot(snapshot);
+    return ok;
+}
 
-        // If you hit this assert, then you've probably already been notified that there was a problem with a allocation unit in a
-        // prior call to validateAllocUnit(), but this assert is here just to make sure you know about it. :)
-        m_assert(errors == 0);
 
-        // Log any errors
+#if defined(OSG_USE_UNIT_TESTS) && defined(OSG_USE_MEMORY_MANAGER)
 
-        if (errors) log("While validting all allocation units, %d allocation unit(s) were found to have problems", errors);
+#include <vector>
+#include <osg/ref_ptr>
 
-        // Return the error status
+// ---------------------------------------------------------------------------------------------------------------------------------
+// -DOC- Unit tests, they need the memory manager. Each leaves the sample rate and guard modes as it found them.
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-        return errors != 0;
-    }
+class MemoryManagerTestObject : public osg::Referenced
+{
+    public:
+        char    payload[200];
+};
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
-    // -DOC- Unused RAM calculation routines. Use these to determine how much of your RAM is unused (in bytes)
-    // ---------------------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-    unsigned int    m_calcUnused(const sAllocUnit *allocUnit)
-    {
-        const unsigned long    *ptr = (const unsigned long *) allocUnit->reportedAddress;
-        unsigned int        count = 0;
+static    char    *readTestFile(const char *filename)
+{
+    FILE    *fp = fopen(filename, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char    *text = (char *) malloc(size + 1);
+    if (text) text[fread(text, 1, size, fp)] = 0;
+    fclose(fp);
+    return text;
+}
 
-        for (unsigned int i = 0; i < allocUnit->reportedSize; i += sizeof(long), ptr++)
-        {
-            if (*ptr == unusedPattern) count += sizeof(long);
-        }
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-        return count;
+static    const sMEntry    *findEntry(const sMSnapshot *snapshot, const unsigned int kind, const char *name)
+{
+    for (unsigned int i = 0; i < snapshot->entryCount; i++)
+    {
+        if (snapshot->entries[i].kind == kind && !strcmp(snapshot->entries[i].name, name)) return &snapshot->entries[i];
     }
+    return NULL;
+}
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Allocate from two sites and two objects of one class between two snapshots, then check their diff, and the diff exported as
+// CSV and as JSON to filename.
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-    unsigned int    m_calcAllUnused()
+void    test_MemoryManager_snapshots(const char *filename)
+{
+    unsigned int    sampleRate = m_getSampleRate();
+    m_setSampleRate(1);
+
+    sMSnapshot    *before = m_takeSnapshot();
+
+    void        *siteA[3];
+    void        *siteB[2];
+    for (unsigned int i = 0; i < 3; i++) siteA[i] = m_allocator("snapshotSiteA.cpp", 10, m_alloc_malloc, 100);
+    for (unsigned int i = 0; i < 2; i++) siteB[i] = m_allocator("snapshotSiteB.cpp", 20, m_alloc_malloc, 1000);
+    osg::ref_ptr<MemoryManagerTestObject>    objects[2] = {osgNew MemoryManagerTestObject, osgNew MemoryManagerTestObject};
+
+    sMSnapshot    *after = m_takeSnapshot();
+    sMSnapshot    *diff = m_diffSnapshots(before, after);
+
+    // Earlier runs may have left these sites behind, so their peaks are not checked
+
+    const long long    objectBytes = 2 * (long long) sizeof(MemoryManagerTestObject);
+    const sMEntry    *a = diff ? findEntry(diff, m_entry_site, "snapshotSiteA.cpp:10") : NULL;
+    const sMEntry    *b = diff ? findEntry(diff, m_entry_site, "snapshotSiteB.cpp:20") : NULL;
+    const sMEntry    *c = diff ? findEntry(diff, m_entry_class, "MemoryManagerTestObject") : NULL;
+    bool        passed = a && a->liveBytes == 300 && a->liveCount == 3 && a->allocationCount == 3 &&
+                     b && b->liveBytes == 2000 && b->liveCount == 2 && b->allocationCount == 2 &&
+                     c && c->liveBytes == objectBytes && c->liveCount == 2;
+
+    char        expected[256];
+    char        *text = NULL;
+    passed = passed && m_exportSnapshot(diff, filename, m_format_csv) && (text = readTestFile(filename)) != NULL;
+    if (text)
     {
-        // Just go through each allocation unit in the hash table and count the unused RAM
-
-        unsigned int    total = 0;
-        for (unsigned int i = 0; i < hashSize; i++)
-        {
-            sAllocUnit    *ptr = hashTable[i];
-            while(ptr)
-            {
-                total += m_calcUnused(ptr);
-                ptr = ptr->next;
-            }
-        }
-
-        return total;
+        sprintf(expected, "site,\"snapshotSiteA.cpp:10\",300,3,%lld,3\n", a->peakBytes);
+        passed = passed && strstr(text, expected);
+        sprintf(expected, "site,\"snapshotSiteB.cpp:20\",2000,2,%lld,2\n", b->peakBytes);
+        passed = passed && strstr(text, expected);
+        sprintf(expected, "class,\"MemoryManagerTestObject\",%lld,2,0,0\n", objectBytes);
+        passed = passed && strstr(text, expected);
+        free(text);
+        text = NULL;
     }
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
-    // -DOC- The following functions are for logging and statistics reporting.
-    // ---------------------------------------------------------------------------------------------------------------------------------
-
-    void    m_dumpAllocUnit(const sAllocUnit *allocUnit, const char *prefix)
+    passed = passed && m_exportSnapshot(diff, filename, m_format_json) && (text = readTestFile(filename)) != NULL;
+    if (text)
     {
-        log("%sAddress (reported): %010p",       prefix, allocUnit->reportedAddress);
-        log("%sAddress (actual)  : %010p",       prefix, allocUnit->actualAddress);
-        log("%sSize (reported)   : 0x%08X (%s)", prefix, allocUnit->reportedSize, memorySizeString(allocUnit->reportedSize));
-        log("%sSize (actual)     : 0x%08X (%s)", prefix, allocUnit->actualSize, memorySizeString(allocUnit->actualSize));
-        log("%sOwner             : %s(%d)",  prefix, allocUnit->sourceFile, allocUnit->sourceLine);
-        log("%sAllocation type   : %s",          prefix, allocationTypes[allocUnit->allocationType]);
-        log("%sAllocation number : %d",          prefix, allocUnit->allocationNumber);
+        sprintf(expected, "{\"name\": \"snapshotSiteA.cpp:10\", \"liveBytes\": 300, \"liveCount\": 3, \"peakBytes\": %lld, \"allocationCount\": 3}", a->peakBytes);
+        passed = passed && strstr(text, expected);
+        sprintf(expected, "{\"name\": \"snapshotSiteB.cpp:20\", \"liveBytes\": 2000, \"liveCount\": 2, \"peakBytes\": %lld, \"allocationCount\": 2}", b->peakBytes);
+        passed = passed && strstr(text, expected);
+        sprintf(expected, "{\"name\": \"MemoryManagerTestObject\", \"liveBytes\": %lld, \"liveCount\": 2}", objectBytes);
+        passed = passed && strstr(text, expected) && strstr(text, "\"sites\": [") && strstr(text, "\"classes\": [");
+        free(text);
     }
+    remove(filename);
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
+    m_releaseSnapshot(diff);
+    m_releaseSnapshot(after);
+    m_releaseSnapshot(before);
+    objects[0] = objects[1] = NULL;
+    for (unsigned int i = 0; i < 3; i++) m_deallocator("snapshotSiteA.cpp", 11, m_alloc_free, siteA[i]);
+    for (unsigned int i = 0; i < 2; i++) m_deallocator("snapshotSiteB.cpp", 21, m_alloc_free, siteB[i]);
+    m_setSampleRate(sampleRate);
 
-    void    m_dumpMemoryReport(const char *filename, const bool overwrite)
-    {
-        // Open the report file
+    printf("MemoryManager snapshots %s\n", passed ? "OK" : "FAILED");
+}
 
-        FILE    *fp = NULL;
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Allocate a block in each guard mode and check its layout, that a one byte overrun is found in canary mode, that released page
+// guarded blocks go into the quarantine and which modes wipe released blocks.
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-        if (overwrite)    fp = fopen(filename, "w+b");
-        else        fp = fopen(filename, "ab");
+void    test_MemoryManager_guardModes()
+{
+    unsigned int    sampleRate = m_getSampleRate();
+    unsigned int    mode = m_getGuardMode();
+    unsigned int    pageRate = m_getGuardPageRate();
+    m_setSampleRate(1);
+    m_setGuardPageRate(1);
+
+    const size_t    size = 13;
+    const size_t    pageSize = getPageSize();
+    bool        passed = true;
+    for (unsigned int guardMode = m_guard_padding; guardMode <= m_guard_wipe_on_free; guardMode++)
+    {
+        m_setGuardMode(guardMode);
+        char        *block = (char *) m_allocator(__FILE__, __LINE__, m_alloc_malloc, size);
+        sAllocUnit    *au = findAllocUnit(block);
+        if (!au || au->guardMode != guardMode)
+        {
+            printf("  %s mode block not tracked in its mode FAILED\n", guardModes[guardMode]);
+            passed = false;
+            continue;
+        }
 
-        // If you hit this assert, then the memory report generator is unable to log information to a file (can't open the file for
-        // some reason.)
-        m_assert(fp);
-        if (!fp) return;
+        bool    layout = !isUntracked(block) && ((size_t) block & (headerSize - 1)) == 0;
+        bool    preIntact, postIntact;
+        checkGuards(au, preIntact, postIntact);
+        layout = layout && preIntact && postIntact;
+        if (guardMode == m_guard_padding)
+        {
+            layout = layout && au->actualSize == 2 * paddingSize * sizeof(long) + size;
+        }
+        else if (guardMode == m_guard_canary)
+        {
+            layout = layout && au->actualSize == headerSize + size + canarySize;
 
-            // Header
+            // Step one byte past the end, then put the canary back so that the block can be released
 
-            static  char    timeString[25];
-            memset(timeString, 0, sizeof(timeString));
-            time_t  t = time(NULL);
-            struct  tm *tme = localtime(&t);
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-            fprintf(fp, "|                                             Memory report for: %02d/%02d/%04d %02d:%02d:%02d                                               |\r\n", tme->tm_mon + 1, tme->tm_mday, tme->tm_year + 1900, tme->tm_hour, tme->tm_min, tme->tm_sec);
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "\r\n");
-        fprintf(fp, "\r\n");
+            char    canary = block[size];
+            block[size] = ~canary;
+            checkGuards(au, preIntact, postIntact);
+            layout = layout && preIntact && !postIntact;
+            block[size] = canary;
+            layout = layout && m_validateAllocUnit(au);
+        }
+        else if (guardMode == m_guard_pages)
+        {
+            // The block and its rounding end right where the inaccessible page starts
 
-        // Report summary
+            size_t    end = (size_t) block + size + postfixSize(guardMode, size);
+            layout = layout && (end & (pageSize - 1)) == 0 && end + pageSize == (size_t) au->actualAddress + au->actualSize;
+        }
+        else
+        {
+            layout = layout && au->actualSize == headerSize + size;
+        }
+        layout = layout && wipesOnRelease(au) == (guardMode == m_guard_wipe_on_free || (guardMode == m_guard_padding && alwaysWipeAll));
 
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "|                                                           T O T A L S                                                            |\r\n");
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "              Allocation unit count: %10s\r\n", insertCommas(stats.totalAllocUnitCount));
-        fprintf(fp, "            Reported to application: %s\r\n", memorySizeString(stats.totalReportedMemory));
-        fprintf(fp, "         Actual total memory in use: %s\r\n", memorySizeString(stats.totalActualMemory));
-        fprintf(fp, "           Memory tracking overhead: %s\r\n", memorySizeString(stats.totalActualMemory - stats.totalReportedMemory));
-        fprintf(fp, "\r\n");
+        void    *actualAddress = au->actualAddress;
+        m_deallocator(__FILE__, __LINE__, m_alloc_free, block);
 
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "|                                                            P E A K S                                                             |\r\n");
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "              Allocation unit count: %10s\r\n", insertCommas(stats.peakAllocUnitCount));
-        fprintf(fp, "            Reported to application: %s\r\n", memorySizeString(stats.peakReportedMemory));
-        fprintf(fp, "                             Actual: %s\r\n", memorySizeString(stats.peakActualMemory));
-        fprintf(fp, "           Memory tracking overhead: %s\r\n", memorySizeString(stats.peakActualMemory - stats.peakReportedMemory));
-        fprintf(fp, "\r\n");
+        if (guardMode == m_guard_pages)
+        {
+            bool    quarantined = false;
+            MemLock    lock(quarantineLock);
+            for (unsigned int i = 0; i < guardQuarantineSize; i++) quarantined = quarantined || quarantineAddress[i] == actualAddress;
+            layout = layout && quarantined;
+        }
 
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "|                                                      A C C U M U L A T E D                                                       |\r\n");
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "              Allocation unit count: %s\r\n", memorySizeString(stats.accumulatedAllocUnitCount));
-        fprintf(fp, "            Reported to application: %s\r\n", memorySizeString(stats.accumulatedReportedMemory));
-        fprintf(fp, "                             Actual: %s\r\n", memorySizeString(stats.accumulatedActualMemory));
-        fprintf(fp, "\r\n");
+        if (!layout) printf("  %s mode layout FAILED\n", guardModes[guardMode]);
+        passed = passed && layout;
+    }
 
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "|                                                           U N U S E D                                                            |\r\n");
-        fprintf(fp, " ---------------------------------------------------------------------------------------------------------------------------------- \r\n");
-        fprintf(fp, "    Memory allocated but not in use: %s\r\n", memorySizeString(m_calcAllUnused()));
-        fprintf(fp, "\r\n");
+    m_setGuardMode(mode);
+    m_setGuardPageRate(pageRate);
+    m_setSampleRate(sampleRate);
 
-        dumpAllocations(fp);
+    printf("MemoryManager guard modes %s\n", passed ? "OK" : "FAILED");
+}
 
-        fclose(fp);
-    }
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Mix malloc, realloc and free of numThreads threads across the shards with one allocation in four tracked. Each block holds a
+// fill that must survive reallocation, and must be tracked exactly when its header is not marked untracked.
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-    // ---------------------------------------------------------------------------------------------------------------------------------
+static    void    stressLoop(unsigned int seed, std::atomic<unsigned int> *numTracked, std::atomic<unsigned int> *numUntracked,
+                   std::atomic<unsigned int> *numFailed)
+{
+    const unsigned int    numSlots = 64;
+    unsigned char    *blocks[numSlots] = {NULL};
+    size_t        sizes[numSlots] = {0};
+    unsigned int    random = seed;
+    unsigned int    failed = 0;
 
+    for (unsigned int i = 0; i < 200000; i++)
+    {
+        random = random * 1103515245 + 12345;
+        unsigned int    k = (random >> 8) & (numSlots - 1);
+        size_t        size = ((random >> 16) & 255) + 1;
+        unsigned char    fill = (unsigned char) (k + 1);
 
-#else // OSG_USE_MEMORY_MANAGER
+        if (blocks[k])
+        {
+            for (size_t j = 0; j < sizes[k]; j++) failed += blocks[k][j] != fill;
+        }
 
-    // ----------------------------------------------------------------------------------------------------------------
-    // dummy implementation for optimized build.
-    // ----------------------------------------------------------------------------------------------------------------
+        if (!blocks[k] || (random >> 24) & 1)
+        {
+            blocks[k] = (unsigned char *) (blocks[k] ? m_reallocator(__FILE__, __LINE__, m_alloc_realloc, size, blocks[k]) :
+                                    m_allocator(__FILE__, __LINE__, m_alloc_malloc, size));
+            if (!blocks[k])
+            {
+                failed++;
+                continue;
+            }
+            size_t    kept = sizes[k] < size ? sizes[k] : size;
+            for (size_t j = 0; j < kept; j++) failed += blocks[k][j] != fill;
+            memset(blocks[k], fill, size);
+            sizes[k] = size;
+
+            bool    untracked = isUntracked(blocks[k]);
+            failed += untracked == (findAllocUnit(blocks[k]) != NULL);
+            if (untracked) (*numUntracked)++;
+            else (*numTracked)++;
+        }
+        else
+        {
+            m_deallocator(__FILE__, __LINE__, m_alloc_free, blocks[k]);
+            blocks[k] = NULL;
+            sizes[k] = 0;
+        }
+    }
 
-    void        m_setOwner(const char *, const unsigned int ) { }
-    bool        &m_breakOnRealloc(void *) { static bool result=false; return result; }
-    bool        &m_breakOnDealloc(void *) { static bool result=false; return result; }
-    void         m_breakOnAllocation(unsigned int ) {} 
+    for (unsigned int k = 0; k < numSlots; k++)
+    {
+        if (blocks[k]) m_deallocator(__FILE__, __LINE__, m_alloc_free, blocks[k]);
+    }
+    *numFailed += failed;
+}
 
-    void  *m_allocator(const char *, const unsigned int ,
-                                         const unsigned int , const size_t ) { return 0L;}
-    void  *m_reallocator(const char *, const unsigned int ,
-                                          const unsigned int , const size_t , void *) { return 0L;}
-    void  m_deallocator(const char *, const unsigned int ,
-                                         const unsigned int , const void *) {}
+// ---------------------------------------------------------------------------------------------------------------------------------
 
-    bool        m_validateAddress(const void *)  { return true; }
-    bool        m_validateAllocUnit(const sAllocUnit *)  { return true; }
-    bool        m_validateAllAllocUnits() { return true; }
+void    test_MemoryManager_threads(unsigned int numThreads)
+{
+    unsigned int    sampleRate = m_getSampleRate();
+    m_setSampleRate(4);
 
-    unsigned int    m_calcUnused(const sAllocUnit *) { return 0; }
-    unsigned int    m_calcAllUnused() { return 0; }
+    unsigned long long    numUnits = m_getMemoryStatistics().totalAllocUnitCount;
+    std::atomic<unsigned int>    numTracked(0), numUntracked(0), numFailed(0);
+    {
+        std::vector<std::thread>    threads;
+        for (unsigned int t = 0; t < numThreads; t++) threads.push_back(std::thread(stressLoop, t + 1, &numTracked, &numUntracked, &numFailed));
+        for (unsigned int t = 0; t < numThreads; t++) threads[t].join();
+    }
+    m_setSampleRate(sampleRate);
 
-    void        m_dumpAllocUnit(const sAllocUnit *, const char *) {}
-    void        m_dumpMemoryReport(const char *, const bool ) {}
+    // Every block was released, so the tracked units are back where they started. m_validateAllAllocUnits() returns true on errors.
 
-#endif // OSG_USE_MEMORY_MANAGER
+    bool    passed = numFailed == 0 && numTracked > 0 && numUntracked > numTracked &&
+             m_getMemoryStatistics().totalAllocUnitCount == numUnits && !m_validateAllAllocUnits();
+    printf("MemoryManager %u threads  %u tracked  %u untracked  %u failed  %s\n", numThreads, numTracked.load(), numUntracked.load(),
+        numFailed.load(), passed ? "OK" : "FAILED");
+}
 
+#endif // OSG_USE_UNIT_TESTS && OSG_USE_MEMORY_MANAGER
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 // mmgr.cpp - End of file
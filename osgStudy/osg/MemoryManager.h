@@ -38,23 +38,46 @@ typedef    struct tag_au
     bool        breakOnDealloc;
     bool        breakOnRealloc;
     unsigned int    allocationNumber;
+    unsigned int    siteIndex;
+    bool        isReferenced;
+    unsigned int    guardMode;            // The m_guard_* mode the allocation was made with
     struct tag_au    *next;
     struct tag_au    *prev;
 } sAllocUnit;
 
 typedef    struct
 {
-    unsigned int    totalReportedMemory;
-    unsigned int    totalActualMemory;
-    unsigned int    peakReportedMemory;
-    unsigned int    peakActualMemory;
-    unsigned int    accumulatedReportedMemory;
-    unsigned int    accumulatedActualMemory;
-    unsigned int    accumulatedAllocUnitCount;
-    unsigned int    totalAllocUnitCount;
-    unsigned int    peakAllocUnitCount;
+    unsigned long long    totalReportedMemory;
+    unsigned long long    totalActualMemory;
+    unsigned long long    peakReportedMemory;
+    unsigned long long    peakActualMemory;
+    unsigned long long    accumulatedReportedMemory;
+    unsigned long long    accumulatedActualMemory;
+    unsigned long long    accumulatedAllocUnitCount;
+    unsigned long long    totalAllocUnitCount;
+    unsigned long long    peakAllocUnitCount;
+    unsigned long long    poolReservedMemory;    // osg::MemoryPool slabs, whether or not the memory manager is enabled
+    unsigned long long    poolUsedMemory;
+    unsigned long long    poolAllocUnitCount;
 } sMStats;
 
+typedef    struct
+{
+    char        name[128];            // "sourceFile:sourceLine" for a site, the class name for a class
+    unsigned int    kind;                 // m_entry_site or m_entry_class
+    long long    liveBytes;            // signed, so that a diff can show shrinking
+    long long    liveCount;
+    long long    peakBytes;            // sites only, classes are only known for live allocations
+    long long    allocationCount;      // sites only
+} sMEntry;
+
+typedef    struct
+{
+    sMStats        stats;
+    unsigned int    entryCount;
+    sMEntry        *entries;             // sorted by decreasing liveBytes within each kind
+} sMSnapshot;
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // External constants
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -69,6 +92,17 @@ SG_EXPORT extern const    unsigned int    m_alloc_delete;
 SG_EXPORT extern const    unsigned int    m_alloc_delete_array;
 SG_EXPORT extern const    unsigned int    m_alloc_free;
 
+SG_EXPORT extern const    unsigned int    m_format_json;
+SG_EXPORT extern const    unsigned int    m_format_csv;
+
+SG_EXPORT extern const    unsigned int    m_entry_site;
+SG_EXPORT extern const    unsigned int    m_entry_class;
+
+SG_EXPORT extern const    unsigned int    m_guard_padding;
+SG_EXPORT extern const    unsigned int    m_guard_canary;
+SG_EXPORT extern const    unsigned int    m_guard_pages;
+SG_EXPORT extern const    unsigned int    m_guard_wipe_on_free;
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Used by the macros
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -106,8 +140,8 @@ SG_EXPORT extern bool m_validateAllAllocUnits();
 // Unused RAM calculations
 // ---------------------------------------------------------------------------------------------------------------------------------
 
-SG_EXPORT extern unsigned int    m_calcUnused(const sAllocUnit *allocUnit);
-SG_EXPORT extern unsigned int    m_calcAllUnused();
+SG_EXPORT extern size_t          m_calcUnused(const sAllocUnit *allocUnit);
+SG_EXPORT extern size_t          m_calcAllUnused();
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Logging and reporting
@@ -117,6 +151,42 @@ SG_EXPORT extern void        m_dumpAllocUnit(const sAllocUnit *allocUnit, const
 SG_EXPORT extern void        m_dumpMemoryReport(const char *filename = "memreport.log", const bool overwrite = true);
 SG_EXPORT extern sMStats     m_getMemoryStatistics();
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Machine readable reports -- a snapshot holds the statistics, the live and peak bytes of every allocation site and the live bytes
+// of every class derived from osg::Referenced. Diff two snapshots to find what grew between them, for instance between frames, and
+// export snapshots as JSON or CSV for offline tools. Without the memory manager a snapshot only holds the pool statistics.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+SG_EXPORT extern sMSnapshot  *m_takeSnapshot();
+SG_EXPORT extern sMSnapshot  *m_diffSnapshots(const sMSnapshot *before, const sMSnapshot *after);
+SG_EXPORT extern void        m_releaseSnapshot(sMSnapshot *snapshot);
+SG_EXPORT extern bool        m_exportSnapshot(const sMSnapshot *snapshot, const char *filename, const unsigned int format = m_format_json);
+SG_EXPORT extern bool        m_exportMemoryReport(const char *filename = "memreport.json", const unsigned int format = m_format_json);
+
+// Called by the osg::Referenced constructors, so that snapshots can aggregate the allocations holding objects by class
+
+SG_EXPORT extern void        m_markReferenced(const void *reportedAddress);
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Sampling -- track only about one allocation in rate, the others go straight to malloc/free. Statistics and reports then cover
+// the sampled allocations only. The default rate of 1 tracks everything, OSG_MM_SAMPLE_RATE sets the rate at startup.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+SG_EXPORT extern void        m_setSampleRate(unsigned int rate);
+SG_EXPORT extern unsigned int    m_getSampleRate();
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Guard modes -- choose how tracked allocations are guarded against overruns and use after free, from the full padding and wipes
+// (m_guard_padding, the default) down to a small canary footer (m_guard_canary), canaries plus guard pages around one allocation
+// in rate (m_guard_pages) or wiping released blocks only (m_guard_wipe_on_free). OSG_MM_GUARD_MODE (padding, canary, pages or
+// wipe) and OSG_MM_GUARD_PAGE_RATE set them at startup.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+SG_EXPORT extern void        m_setGuardMode(unsigned int mode);
+SG_EXPORT extern unsigned int    m_getGuardMode();
+SG_EXPORT extern void        m_setGuardPageRate(unsigned int rate);
+SG_EXPORT extern unsigned int    m_getGuardPageRate();
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Variations of global operators new & delete
 // ---------------------------------------------------------------------------------------------------------------------------------
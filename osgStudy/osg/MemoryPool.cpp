@@ -0,0 +1,363 @@
+#include <osg/MemoryPool.h>
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <stdlib.h>
+
+using namespace osg;
+
+namespace
+{
+
+struct FreeBlock
+{
+    FreeBlock* next;
+};
+
+/** Spin lock held for a few pointer operations at a time. It needs no
+  * construction, so the pools work for objects created by static constructors.*/
+class ScopedSpinLock
+{
+    public:
+        ScopedSpinLock(std::atomic<int>& lock) : _lock(lock)
+        {
+            while (_lock.exchange(1,std::memory_order_acquire)) std::this_thread::yield();
+        }
+        ~ScopedSpinLock() { _lock.store(0,std::memory_order_release); }
+    private:
+        ScopedSpinLock& operator = (const ScopedSpinLock&);
+        std::atomic<int>& _lock;
+};
+
+/** The blocks of one size class shared between the threads. Plain data, zero
+  * initialised and never destroyed, as objects may still be deleted during
+  * static destruction.*/
+struct SharedPool
+{
+    std::atomic<int>    lock;
+    FreeBlock*          freeList;
+    char*               slabCursor;
+    char*               slabEnd;
+};
+
+/** A thread's cached free blocks, and the net count of blocks it allocated
+  * minus those it freed per size class. The counts are only written by the
+  * owning thread, atomics let getStatistics() read them from another.*/
+struct ThreadCache
+{
+    enum State { UNREGISTERED, ACTIVE, RETIRED };
+
+    int                     state;
+    FreeBlock*              freeList[MemoryPool::NUM_SIZE_CLASSES];
+    unsigned int            numFree[MemoryPool::NUM_SIZE_CLASSES];
+    std::atomic<long long>  liveCount[MemoryPool::NUM_SIZE_CLASSES];
+    ThreadCache*            next;
+};
+
+SharedPool s_pools[MemoryPool::NUM_SIZE_CLASSES];
+std::atomic<size_t> s_reservedMemory;
+
+// the caches of the running threads, and the counts of those which have exited.
+std::atomic<int> s_registryLock;
+ThreadCache* s_registry;
+long long s_retiredLiveCount[MemoryPool::NUM_SIZE_CLASSES];
+
+thread_local ThreadCache s_threadCache;
+
+inline unsigned int sizeClass(size_t size) { return size==0 ? 0 : (unsigned int)((size-1)/MemoryPool::GRANULARITY); }
+inline size_t blockSize(unsigned int sizeClass) { return (sizeClass+1)*MemoryPool::GRANULARITY; }
+
+inline void addLiveCount(ThreadCache& cache, unsigned int c, long long delta)
+{
+    cache.liveCount[c].store(cache.liveCount[c].load(std::memory_order_relaxed)+delta,std::memory_order_relaxed);
+}
+
+/** Take up to maxBlocks blocks from the shared pool of size class c, carving a
+  * new slab when it runs out. Return the number taken, linked from head.*/
+unsigned int takeShared(unsigned int c, unsigned int maxBlocks, FreeBlock*& head)
+{
+    SharedPool& pool = s_pools[c];
+    const size_t size = blockSize(c);
+
+    ScopedSpinLock lock(pool.lock);
+
+    unsigned int numTaken = 0;
+    head = 0;
+    while (numTaken<maxBlocks)
+    {
+        FreeBlock* block = pool.freeList;
+        if (block)
+        {
+            pool.freeList = block->next;
+        }
+        else
+        {
+            if (pool.slabCursor+size>pool.slabEnd)
+            {
+                char* slab = (char*)malloc(MemoryPool::SLAB_SIZE);
+                if (!slab) break;
+                s_reservedMemory.fetch_add(MemoryPool::SLAB_SIZE,std::memory_order_relaxed);
+                pool.slabCursor = slab;
+                pool.slabEnd = slab+MemoryPool::SLAB_SIZE;
+            }
+            block = (FreeBlock*)pool.slabCursor;
+            pool.slabCursor += size;
+        }
+        block->next = head;
+        head = block;
+        ++numTaken;
+    }
+    return numTaken;
+}
+
+/** Return the list of blocks from head to tail to the shared pool of size class c.*/
+void giveShared(unsigned int c, FreeBlock* head, FreeBlock* tail)
+{
+    SharedPool& pool = s_pools[c];
+    ScopedSpinLock lock(pool.lock);
+    tail->next = pool.freeList;
+    pool.freeList = head;
+}
+
+void retireThreadCache(ThreadCache& cache)
+{
+    for(unsigned int c=0;c<MemoryPool::NUM_SIZE_CLASSES;++c)
+    {
+        FreeBlock* head = cache.freeList[c];
+        if (!head) continue;
+        FreeBlock* tail = head;
+        while (tail->next) tail = tail->next;
+        giveShared(c,head,tail);
+        cache.freeList[c] = 0;
+        cache.numFree[c] = 0;
+    }
+
+    ScopedSpinLock lock(s_registryLock);
+    for(ThreadCache** link=&s_registry;*link;link=&(*link)->next)
+    {
+        if (*link==&cache)
+        {
+            *link = cache.next;
+            break;
+        }
+    }
+    for(unsigned int c=0;c<MemoryPool::NUM_SIZE_CLASSES;++c)
+    {
+        s_retiredLiveCount[c] += cache.liveCount[c].load(std::memory_order_relaxed);
+    }
+    cache.state = ThreadCache::RETIRED;
+}
+
+struct ThreadCacheRetirer
+{
+    ~ThreadCacheRetirer() { retireThreadCache(s_threadCache); }
+};
+
+/** Return the calling thread's cache, registering it on first use. Once the
+  * thread has started exiting this returns 0, blocks then go straight to the
+  * shared pools.*/
+ThreadCache* getThreadCache()
+{
+    ThreadCache& cache = s_threadCache;
+    if (cache.state==ThreadCache::ACTIVE) return &cache;
+    if (cache.state==ThreadCache::RETIRED) return 0;
+
+    static thread_local ThreadCacheRetirer retirer;
+    (void)retirer;
+
+    ScopedSpinLock lock(s_registryLock);
+    cache.next = s_registry;
+    s_registry = &cache;
+    cache.state = ThreadCache::ACTIVE;
+    return &cache;
+}
+
+}
+
+void* MemoryPool::allocate(size_t size)
+{
+    // with the memory manager every object goes through the global operator new, so that it is tracked and reported.
+#ifdef OSG_USE_MEMORY_MANAGER
+    return ::operator new(size);
+#else
+    if (size>MAX_POOLED_SIZE) return ::operator new(size);
+
+    const unsigned int c = sizeClass(size);
+    ThreadCache* cache = getThreadCache();
+    if (!cache)
+    {
+        FreeBlock* block;
+        if (takeShared(c,1,block)==0) throw std::bad_alloc();
+        ScopedSpinLock lock(s_registryLock);
+        ++s_retiredLiveCount[c];
+        return block;
+    }
+
+    FreeBlock* block = cache->freeList[c];
+    if (!block)
+    {
+        cache->numFree[c] = takeShared(c,BATCH_SIZE,cache->freeList[c]);
+        block = cache->freeList[c];
+        if (!block) throw std::bad_alloc();
+    }
+    cache->freeList[c] = block->next;
+    --cache->numFree[c];
+    addLiveCount(*cache,c,1);
+    return block;
+#endif
+}
+
+void MemoryPool::deallocate(void* ptr,size_t size)
+{
+    if (!ptr) return;
+#ifdef OSG_USE_MEMORY_MANAGER
+    (void)size;
+    ::operator delete(ptr);
+#else
+    if (size>MAX_POOLED_SIZE)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    const unsigned int c = sizeClass(size);
+    FreeBlock* block = (FreeBlock*)ptr;
+    ThreadCache* cache = getThreadCache();
+    if (!cache)
+    {
+        giveShared(c,block,block);
+        ScopedSpinLock lock(s_registryLock);
+        --s_retiredLiveCount[c];
+        return;
+    }
+
+    block->next = cache->freeList[c];
+    cache->freeList[c] = block;
+    addLiveCount(*cache,c,-1);
+
+    // hand a batch back once the thread holds two, so that blocks freed by a
+    // thread which does not allocate them return to the others.
+    if (++cache->numFree[c]>2*BATCH_SIZE)
+    {
+        FreeBlock* head = cache->freeList[c];
+        FreeBlock* tail = head;
+        for(unsigned int i=1;i<BATCH_SIZE;++i) tail = tail->next;
+        cache->freeList[c] = tail->next;
+        cache->numFree[c] -= BATCH_SIZE;
+        giveShared(c,head,tail);
+    }
+#endif
+}
+
+MemoryPool::Statistics MemoryPool::getStatistics()
+{
+    long long liveCount[NUM_SIZE_CLASSES];
+    {
+        ScopedSpinLock lock(s_registryLock);
+        for(unsigned int c=0;c<NUM_SIZE_CLASSES;++c) liveCount[c] = s_retiredLiveCount[c];
+        for(ThreadCache* cache=s_registry;cache;cache=cache->next)
+        {
+            for(unsigned int c=0;c<NUM_SIZE_CLASSES;++c) liveCount[c] += cache->liveCount[c].load(std::memory_order_relaxed);
+        }
+    }
+
+    Statistics stats;
+    stats.reservedMemory = s_reservedMemory.load(std::memory_order_relaxed);
+    stats.usedMemory = 0;
+    stats.allocationCount = 0;
+    for(unsigned int c=0;c<NUM_SIZE_CLASSES;++c)
+    {
+        // a thread's count may be read mid update, never report less than nothing.
+        if (liveCount[c]<=0) continue;
+        stats.usedMemory += (size_t)liveCount[c]*blockSize(c);
+        stats.allocationCount += (size_t)liveCount[c];
+    }
+    return stats;
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/RefMatrix.h>
+#include <osg/ref_ptr>
+#include <osg/Timer.h>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// the same RefMatrix taken from the global heap, to compare the pool against.
+class HeapRefMatrix : public RefMatrix
+{
+    public:
+        static void* operator new(size_t size) { return ::operator new(size); }
+        static void operator delete(void* ptr) { ::operator delete(ptr); }
+};
+
+// a RefMatrix which may be built in place and destroyed by hand.
+class PlacedRefMatrix : public RefMatrix
+{
+    public:
+        virtual ~PlacedRefMatrix() {}
+};
+
+template<class T>
+double timeCreateDelete(unsigned int numThreads, unsigned int numObjects)
+{
+    Timer timer;
+    Timer_t t0 = timer.tick();
+    std::vector<std::thread> threads;
+    for(unsigned int t=0;t<numThreads;++t)
+    {
+        threads.push_back(std::thread([numObjects]()
+        {
+            std::vector< ref_ptr<RefMatrix> > objects(numObjects);
+            for(unsigned int i=0;i<numObjects;++i) objects[i] = new T;
+            for(unsigned int i=0;i<numObjects;i+=2) objects[i] = 0;
+            for(unsigned int i=0;i<numObjects;i+=2) objects[i] = new T;
+            objects.clear();
+        }));
+    }
+    for(unsigned int t=0;t<threads.size();++t) threads[t].join();
+    return timer.delta_m(t0,timer.tick());
+}
+
+}
+
+/** Time creating and releasing numObjects RefMatrix on each of numThreads
+  * threads, from the global heap and from the MemoryPool, then check that blocks
+  * freed on another thread than the one allocating them are accounted, and that
+  * placement and nothrow new still reach a pooled class.*/
+void benchmark_MemoryPool(unsigned int numThreads, unsigned int numObjects)
+{
+    MemoryPool::Statistics before = MemoryPool::getStatistics();
+    double heapTime = timeCreateDelete<HeapRefMatrix>(numThreads,numObjects);
+    double poolTime = timeCreateDelete<RefMatrix>(numThreads,numObjects);
+
+    std::vector< ref_ptr<RefMatrix> > objects(numObjects);
+    for(unsigned int i=0;i<numObjects;++i) objects[i] = new RefMatrix;
+    MemoryPool::Statistics live = MemoryPool::getStatistics();
+    std::thread([&objects]() { objects.clear(); }).join();
+    MemoryPool::Statistics after = MemoryPool::getStatistics();
+
+    bool passed = live.allocationCount==before.allocationCount+numObjects &&
+                  after.allocationCount==before.allocationCount &&
+                  live.usedMemory>=numObjects*sizeof(RefMatrix);
+
+    ref_ptr<RefMatrix> nothrowMatrix = new (std::nothrow) RefMatrix;
+    passed = passed && nothrowMatrix.valid() && MemoryPool::getStatistics().allocationCount==before.allocationCount+1;
+    nothrowMatrix = 0;
+
+    void* buffer = ::operator new(sizeof(PlacedRefMatrix));
+    PlacedRefMatrix* placedMatrix = new (buffer) PlacedRefMatrix;
+    passed = passed && placedMatrix==buffer && MemoryPool::getStatistics().allocationCount==before.allocationCount;
+    placedMatrix->~PlacedRefMatrix();
+    ::operator delete(buffer);
+
+    std::cout<<"MemoryPool "<<numThreads<<" threads x "<<numObjects<<" RefMatrix of "<<sizeof(RefMatrix)<<" bytes"<<std::endl;
+    std::cout<<"  heap "<<heapTime<<"ms  pool "<<poolTime<<"ms  reserved "<<after.reservedMemory/1024<<"k"
+             <<"  used with "<<numObjects<<" live "<<live.usedMemory/1024<<"k"<<(passed?"  OK":"  FAILED")<<std::endl;
+}
+
+#endif
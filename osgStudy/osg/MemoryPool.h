@@ -0,0 +1,75 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_MEMORYPOOL
+#define OSG_MEMORYPOOL 1
+
+#include <osg/Export.h>
+
+#include <stddef.h>
+#include <new>
+
+namespace osg {
+
+/** META_PoolAllocated macro defines class operator new and delete which take
+  * the memory for the class, and all the classes derived from it, from the
+  * MemoryPool. Use in classes of which many small instances are created, such
+  * as nodes and state attributes. The class must have a virtual destructor so
+  * that delete passes the size of the derived class. The placement and nothrow
+  * forms are declared too, as a class operator new hides all the global ones.
+  * The pool needs the size to take a block back, which a nothrow delete is not
+  * given, so a constructor throwing from new(std::nothrow) leaks its block.*/
+#define META_PoolAllocated \
+        static void* operator new(size_t size) { return osg::MemoryPool::allocate(size); } \
+        static void operator delete(void* ptr,size_t size) { osg::MemoryPool::deallocate(ptr,size); } \
+        static void* operator new(size_t size,const std::nothrow_t&) throw() { try { return osg::MemoryPool::allocate(size); } catch(...) { return 0; } } \
+        static void* operator new(size_t,void* ptr) throw() { return ptr; } \
+        static void operator delete(void*,void*) throw() {}
+
+/** Size class allocator for small objects. Blocks are carved out of SLAB_SIZE
+  * slabs, each size class holding blocks of a multiple of GRANULARITY bytes, so
+  * that building a large scene graph does not fragment the heap and pays no per
+  * allocation heap header. Requests larger than MAX_POOLED_SIZE go to the
+  * global operator new.
+  *
+  * Each thread keeps a cache of free blocks per size class, refilled from and
+  * returned to the shared pools BATCH_SIZE blocks at a time, so most calls take
+  * no lock. Blocks may be freed by a different thread from the one that
+  * allocated them. Slabs are kept for reuse, never returned to the heap.*/
+class SG_EXPORT MemoryPool
+{
+    public:
+
+        enum
+        {
+            GRANULARITY = 16,
+            MAX_POOLED_SIZE = 1024,
+            NUM_SIZE_CLASSES = MAX_POOLED_SIZE/GRANULARITY,
+            SLAB_SIZE = 65536,
+            BATCH_SIZE = 32
+        };
+
+        static void* allocate(size_t size);
+
+        /** Free ptr, size must be the size passed to allocate().*/
+        static void deallocate(void* ptr,size_t size);
+
+        struct Statistics
+        {
+            /** bytes held in slabs, used or not.*/
+            size_t  reservedMemory;
+            /** bytes in blocks currently allocated, rounded up to the size class.*/
+            size_t  usedMemory;
+            /** number of blocks currently allocated.*/
+            size_t  allocationCount;
+        };
+
+        /** Return the statistics of the pooled allocations, those larger than
+          * MAX_POOLED_SIZE are not included.*/
+        static Statistics getStatistics();
+};
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 #define OSG_NODE 1
 
 #include <osg/Object.h>
+#include <osg/MemoryPool.h>
 #include <osg/StateSet.h>
 #include <osg/BoundingSphere.h>
 #include <osg/NodeCallback.h>
@@ -45,6 +46,9 @@ class SG_EXPORT Node : public Object
         /** Copy constructor using CopyOp to manage deep vs shallow copy.*/
         Node(const Node&,const CopyOp& copyop=CopyOp::SHALLOW_COPY);
 
+        /** Nodes, and all the node types derived from Node, are allocated from the MemoryPool.*/
+        META_PoolAllocated
+
         /** clone the an object of the same type as the node.*/
         virtual Object* cloneType() const { return osgNew Node(); }
 
@@ -197,8 +201,9 @@ class SG_EXPORT Node : public Object
 
 
         /** Mark this node's bounding sphere dirty.
-            Forcing it to be computed on the next call to getBound().*/
-        void dirtyBound();
+            Forcing it to be computed on the next call to getBound(),
+            and that of its parents through their dirtyBound().*/
+        virtual void dirtyBound();
 
 
     protected:
@@ -1,9 +1,144 @@
 #include <osg/Notify.h>
+#include <osg/AsyncNotifyHandler.h>
+#include <osg/ref_ptr.h>
 #include <string>
+#include <vector>
+#include <sstream>
+#include <mutex>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
 
 using namespace std;
 
-osg::NotifySeverity g_NotifyLevel = osg::NOTICE;
+std::atomic<osg::NotifySeverity> osg::g_NotifyLevel(osg::DEBUG_FP);
+
+// read OSGNOTIFYLEVEL during static initialization, so that isNotifyEnabled() filters from the start.
+static bool s_NotifyLevelInitialized = osg::initNotifyLevel();
+
+namespace
+{
+
+/** The subsystems, and the levels set for subsystems by name, including those
+  * of subsystems not created yet. Created on first use, so that subsystems can
+  * be created by static constructors.*/
+struct NotifySubsystemRegistry
+{
+    typedef std::vector< std::pair<std::string,osg::NotifySeverity> > LevelList;
+
+    std::mutex              _mutex;
+    osg::NotifySubsystem*   _subsystems;
+    LevelList               _levels;
+
+    NotifySubsystemRegistry() : _subsystems(0) {}
+};
+
+NotifySubsystemRegistry& getNotifySubsystemRegistry()
+{
+    static NotifySubsystemRegistry s_registry;
+    return s_registry;
+}
+
+/** Holds the NotifyHandler, constant initialized so that it can be used
+  * during static initialization, and flagged when destroyed at exit so that
+  * later messages go straight to stderr rather than to a new handler.*/
+struct NotifyHandlerHolder
+{
+    std::atomic<osg::NotifyHandler*>    _handler;
+    bool                                _destroyed;
+
+    ~NotifyHandlerHolder()
+    {
+        _destroyed = true;
+        osg::NotifyHandler* handler = _handler.exchange(0);
+        if (handler) handler->unref();
+    }
+};
+
+NotifyHandlerHolder s_NotifyHandler;
+
+/** Collects the message a thread is writing, and hands it to the
+  * NotifyHandler when the message is ended with std::endl or flushed.*/
+class NotifyStreamBuffer : public std::stringbuf
+{
+    public:
+
+        NotifyStreamBuffer() : _severity(osg::NOTICE), _subsystem(0) {}
+
+        void setMessageSource(osg::NotifySeverity severity, const osg::NotifySubsystem* subsystem)
+        {
+            _severity = severity;
+            _subsystem = subsystem;
+        }
+
+    protected:
+
+        virtual int sync()
+        {
+            std::string message = str();
+            if (message.empty()) return 0;
+            str(std::string());
+
+            if (_subsystem) message = std::string(_subsystem->getName())+": "+message;
+
+            osg::NotifyHandler* handler = osg::getNotifyHandler();
+            if (handler) handler->notify(_severity,message.c_str());
+            else fputs(message.c_str(),stderr);
+            return 0;
+        }
+
+        osg::NotifySeverity             _severity;
+        const osg::NotifySubsystem*     _subsystem;
+};
+
+/** Each thread writes its messages into a stream of its own, so that messages
+  * sent by several threads at once do not mix.*/
+class NotifyStream : public std::ostream
+{
+    public:
+
+        NotifyStream() : std::ostream(0) { rdbuf(&_buffer); }
+
+        NotifyStream& setMessageSource(osg::NotifySeverity severity, const osg::NotifySubsystem* subsystem)
+        {
+            _buffer.setMessageSource(severity,subsystem);
+            return *this;
+        }
+
+    protected:
+
+        NotifyStreamBuffer _buffer;
+};
+
+NotifyStream& getNotifyStream()
+{
+    static thread_local NotifyStream s_NotifyStream;
+    return s_NotifyStream;
+}
+
+bool parseNotifySeverity(std::string level, osg::NotifySeverity& severity)
+{
+    // Convert to upper case
+    for(std::string::iterator i=level.begin();
+        i!=level.end();
+        ++i)
+    {
+        *i=toupper(*i);
+    }
+
+    if(level.find("ALWAYS")!=std::string::npos)          severity=osg::ALWAYS;
+    else if(level.find("FATAL")!=std::string::npos)      severity=osg::FATAL;
+    else if(level.find("WARN")!=std::string::npos)       severity=osg::WARN;
+    else if(level.find("NOTICE")!=std::string::npos)     severity=osg::NOTICE;
+    else if(level.find("DEBUG_INFO")!=std::string::npos) severity=osg::DEBUG_INFO;
+    else if(level.find("DEBUG_FP")!=std::string::npos)   severity=osg::DEBUG_FP;
+    else if(level.find("INFO")!=std::string::npos)       severity=osg::INFO;
+    else if(level.find("DEBUG")!=std::string::npos)      severity=osg::DEBUG_INFO;
+    else return false;
+    return true;
+}
+
+}
 
 void osg::setNotifyLevel(osg::NotifySeverity severity)
 {
@@ -21,11 +156,9 @@ osg::NotifySeverity osg::getNotifyLevel()
 
 bool osg::initNotifyLevel()
 {
-    static bool s_NotifyInit = false;
+    static std::atomic<bool> s_NotifyInit(false);
 
-    if (s_NotifyInit) return true;
-    
-    s_NotifyInit = true;
+    if (s_NotifyInit.exchange(true)) return true;
 
     // g_NotifyLevel
     // =============
@@ -36,55 +169,168 @@ bool osg::initNotifyLevel()
     if (!OSGNOTIFYLEVEL) OSGNOTIFYLEVEL=getenv("OSGNOTIFYLEVEL");
     if(OSGNOTIFYLEVEL)
     {
-
+        // the global level, and name=level pairs for subsystems, i.e. WARN,osgUtil=DEBUG
         std::string stringOSGNOTIFYLEVEL(OSGNOTIFYLEVEL);
-
-        // Convert to upper case
-        for(std::string::iterator i=stringOSGNOTIFYLEVEL.begin();
-            i!=stringOSGNOTIFYLEVEL.end();
-            ++i)
+        std::string::size_type start = 0;
+        while (start<=stringOSGNOTIFYLEVEL.size())
         {
-            *i=toupper(*i);
-        }
+            std::string::size_type end = stringOSGNOTIFYLEVEL.find_first_of(",; ",start);
+            if (end==std::string::npos) end = stringOSGNOTIFYLEVEL.size();
+
+            std::string token = stringOSGNOTIFYLEVEL.substr(start,end-start);
+            std::string::size_type equals = token.find('=');
+            osg::NotifySeverity severity;
+            if (equals==std::string::npos)
+            {
+                if (parseNotifySeverity(token,severity)) g_NotifyLevel = severity;
+            }
+            else if (parseNotifySeverity(token.substr(equals+1),severity))
+            {
+                osg::setNotifyLevel(token.substr(0,equals).c_str(),severity);
+            }
 
-        if(stringOSGNOTIFYLEVEL.find("ALWAYS")!=std::string::npos)          g_NotifyLevel=osg::ALWAYS;
-        else if(stringOSGNOTIFYLEVEL.find("FATAL")!=std::string::npos)      g_NotifyLevel=osg::FATAL;
-        else if(stringOSGNOTIFYLEVEL.find("WARN")!=std::string::npos)       g_NotifyLevel=osg::WARN;
-        else if(stringOSGNOTIFYLEVEL.find("NOTICE")!=std::string::npos)     g_NotifyLevel=osg::NOTICE;
-        else if(stringOSGNOTIFYLEVEL.find("INFO")!=std::string::npos)       g_NotifyLevel=osg::INFO;
-        else if(stringOSGNOTIFYLEVEL.find("DEBUG_INFO")!=std::string::npos) g_NotifyLevel=osg::DEBUG_INFO;
-        else if(stringOSGNOTIFYLEVEL.find("DEBUG_FP")!=std::string::npos)   g_NotifyLevel=osg::DEBUG_FP;
-        else if(stringOSGNOTIFYLEVEL.find("DEBUG")!=std::string::npos)      g_NotifyLevel=osg::DEBUG_INFO;
- 
+            start = end+1;
+        }
     }
 
     return true;
 
 }
 
-#if defined(WIN32) && !(defined(__CYGWIN__) || defined(__MINGW32__))
-const char* NullStreamName = "nul";
-#else
-const char* NullStreamName = "/dev/null";
-#endif
+osg::NotifySubsystem::NotifySubsystem(const char* name):
+    _name(name),
+    _ownNotifyLevel(osg::NOTICE),
+    _notifyLevel(&g_NotifyLevel),
+    _next(0)
+{
+    osg::initNotifyLevel();
+
+    NotifySubsystemRegistry& registry = getNotifySubsystemRegistry();
+    std::lock_guard<std::mutex> lock(registry._mutex);
+    for(NotifySubsystemRegistry::LevelList::iterator itr=registry._levels.begin();itr!=registry._levels.end();++itr)
+    {
+        if (itr->first==_name) setNotifyLevel(itr->second);
+    }
+    _next = registry._subsystems;
+    registry._subsystems = this;
+}
+
+void osg::NotifySubsystem::setNotifyLevel(osg::NotifySeverity severity)
+{
+    _ownNotifyLevel = severity;
+    _notifyLevel = &_ownNotifyLevel;
+}
+
+void osg::setNotifyLevel(const char* subsystem, osg::NotifySeverity severity)
+{
+    NotifySubsystemRegistry& registry = getNotifySubsystemRegistry();
+    std::lock_guard<std::mutex> lock(registry._mutex);
+
+    NotifySubsystemRegistry::LevelList::iterator itr;
+    for(itr=registry._levels.begin();itr!=registry._levels.end() && itr->first!=subsystem;++itr) {}
+    if (itr!=registry._levels.end()) itr->second = severity;
+    else registry._levels.push_back(std::make_pair(std::string(subsystem),severity));
+
+    for(osg::NotifySubsystem* s=registry._subsystems;s;s=s->_next)
+    {
+        if (strcmp(s->_name,subsystem)==0) s->setNotifyLevel(severity);
+    }
+}
+
+void osg::StandardNotifyHandler::notify(osg::NotifySeverity severity, const char* message)
+{
+    if (severity<=osg::WARN) fputs(message,stderr);
+    else
+    {
+        fputs(message,stdout);
+        fflush(stdout);
+    }
+}
+
+void osg::setNotifyHandler(osg::NotifyHandler* handler)
+{
+    if (handler) handler->ref();
+    osg::NotifyHandler* previous = s_NotifyHandler._handler.exchange(handler);
+    if (previous) previous->unref();
+}
+
+osg::NotifyHandler* osg::getNotifyHandler()
+{
+    osg::NotifyHandler* handler = s_NotifyHandler._handler.load(std::memory_order_acquire);
+    if (handler || s_NotifyHandler._destroyed) return handler;
+
+    // create the default handler on first use, another thread may be doing the same.
+    const char* OSGNOTIFYHANDLER = getenv("OSG_NOTIFY_HANDLER");
+    osg::ref_ptr<osg::NotifyHandler> defaultHandler;
+    if (OSGNOTIFYHANDLER && (strcmp(OSGNOTIFYHANDLER,"ASYNC")==0 || strcmp(OSGNOTIFYHANDLER,"async")==0)) defaultHandler = osgNew osg::AsyncNotifyHandler;
+    else defaultHandler = osgNew osg::StandardNotifyHandler;
+
+    if (s_NotifyHandler._handler.compare_exchange_strong(handler,defaultHandler.get()))
+    {
+        defaultHandler->ref();
+        return defaultHandler.get();
+    }
+    return handler;
+}
 
 std::ostream& osg::notify(const osg::NotifySeverity severity)
 {
-    // set up global notify null stream for inline notify
-    static std::ofstream s_NotifyNulStream(NullStreamName);
+    // set up global notify null stream for inline notify, without a stream
+    // buffer it is in the bad state, so that the << operators return without
+    // formatting anything.
+    static std::ostream s_NotifyNulStream(0);
 
     static bool initialized = false;
     if (!initialized) 
     {
-        std::cerr<<""; // dummy op to force construction of cerr, before a reference is passed back to calling code.
-        std::cout<<""; // dummy op to force construction of cout, before a reference is passed back to calling code.
         initialized = osg::initNotifyLevel();
     }
 
     if (severity<=g_NotifyLevel)
     {
-        if (severity<=osg::WARN) return std::cerr;
-        else return std::cout;
+        return getNotifyStream().setMessageSource(severity,0);
+    }
+    return s_NotifyNulStream;
+}
+
+std::ostream& osg::notify(const osg::NotifySubsystem& subsystem, const osg::NotifySeverity severity)
+{
+    static std::ostream s_NotifyNulStream(0);
+
+    if (subsystem.isNotifyEnabled(severity))
+    {
+        return getNotifyStream().setMessageSource(severity,&subsystem);
     }
     return s_NotifyNulStream;
 }
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/Timer.h>
+
+/** Time numMessages filtered out warnings, as streamed by the clamping helpers
+  * of BoundsChecking.h, sent with notify() and with OSG_NOTIFY.*/
+void benchmark_Notify(unsigned int numMessages)
+{
+    osg::NotifySeverity previousLevel = osg::getNotifyLevel();
+    osg::setNotifyLevel(osg::FATAL);
+
+    float value = 2.0f;
+    osg::Timer timer;
+    osg::Timer_t t0 = timer.tick();
+    for(unsigned int i=0;i<numMessages;++i)
+    {
+        osg::notify(osg::WARN)<<"Warning: "<<"value"<<" of "<<value+(float)i<<" is above permitted maximum, clampping to "<<1.0f<<"."<<std::endl;
+    }
+    osg::Timer_t t1 = timer.tick();
+    for(unsigned int i=0;i<numMessages;++i)
+    {
+        OSG_NOTIFY(osg::WARN)<<"Warning: "<<"value"<<" of "<<value+(float)i<<" is above permitted maximum, clampping to "<<1.0f<<"."<<std::endl;
+    }
+    osg::Timer_t t2 = timer.tick();
+
+    osg::setNotifyLevel(previousLevel);
+    std::cout<<"Notify "<<numMessages<<" filtered messages, notify() "<<timer.delta_m(t0,t1)<<"ms  OSG_NOTIFY "<<timer.delta_m(t1,t2)<<"ms"<<std::endl;
+}
+
+#endif
@@ -2,11 +2,13 @@
 //Distributed under the terms of the GNU Library General Public License (LGPL)
 //as published by the Free Software Foundation.
 
-#ifndef OSG_NOTIFY
-#define OSG_NOTIFY 1
+#ifndef OSG_NOTIFY_H
+#define OSG_NOTIFY_H 1
 
 #include <osg/Export.h>
+#include <osg/Referenced.h>
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <memory>
@@ -29,8 +31,11 @@ enum NotifySeverity {
     DEBUG_FP=6
 };
 
-/** global notify level. */
-//SG_EXPORT extern NotifySeverity g_NotifyLevel;
+/** global notify level, read inline by isNotifyEnabled(). Until the level
+  * has been initialized from OSGNOTIFYLEVEL every message passes the check,
+  * and notify() itself does the filtering. Atomic, as any thread may send
+  * messages while another sets the level.*/
+SG_EXPORT extern std::atomic<NotifySeverity> g_NotifyLevel;
 
 /** global notify nul stream. added for Mac OSX */
 //SG_EXPORT extern std::auto_ptr<std::ofstream> g_NotifyNulStream;
@@ -87,6 +92,100 @@ SG_EXPORT extern std::ostream& notify(const NotifySeverity severity);
 
 inline std::ostream& notify(void) { return notify(osg::INFO); }
 
+/** return true if messages of the given severity are currently sent to the console.*/
+inline bool isNotifyEnabled(const NotifySeverity severity) { return severity<=g_NotifyLevel.load(std::memory_order_relaxed); }
+
+/** set the level of the named subsystem, including subsystems created later.*/
+SG_EXPORT extern void setNotifyLevel(const char* subsystem, NotifySeverity severity);
+
+/** Part of the library or of an application whose messages are filtered at a
+  * level of their own, set with setNotifyLevel(name,severity) or within
+  * OSG_NOTIFY_LEVEL, for instance OSG_NOTIFY_LEVEL=WARN,osgUtil=DEBUG.
+  * Subsystems without a level of their own follow the global level. Create
+  * subsystems as statics, they stay registered until exit.*/
+class SG_EXPORT NotifySubsystem
+{
+    public:
+
+        NotifySubsystem(const char* name);
+
+        const char* getName() const { return _name; }
+
+        /** return true if messages of the given severity in this subsystem are currently sent.*/
+        inline bool isNotifyEnabled(const NotifySeverity severity) const { return severity<=_notifyLevel.load(std::memory_order_relaxed)->load(std::memory_order_relaxed); }
+
+        /** give the subsystem a level of its own, use setNotifyLevel(name,severity) to set subsystems by name.*/
+        void setNotifyLevel(NotifySeverity severity);
+
+    protected:
+
+        NotifySubsystem(const NotifySubsystem&);
+        NotifySubsystem& operator = (const NotifySubsystem&);
+
+        friend void setNotifyLevel(const char* subsystem, NotifySeverity severity);
+
+        const char*             _name;
+        std::atomic<NotifySeverity>                         _ownNotifyLevel;
+        std::atomic<const std::atomic<NotifySeverity>*>     _notifyLevel;
+        NotifySubsystem*        _next;
+};
+
+/** notify for a message of subsystem, the message is prefixed with the subsystem name.*/
+SG_EXPORT extern std::ostream& notify(const NotifySubsystem& subsystem, const NotifySeverity severity);
+
+/** Receives the messages sent with notify(), one call for each message ended
+  * by std::endl or a flush. Called by the thread sending the message, so from
+  * several threads at once.*/
+class SG_EXPORT NotifyHandler : public Referenced
+{
+    public:
+
+        virtual void notify(NotifySeverity severity, const char* message) = 0;
+
+    protected:
+
+        virtual ~NotifyHandler() {}
+};
+
+/** Default NotifyHandler, writes WARN and more severe messages to stderr and
+  * the others to stdout, each message in one write so that messages sent by
+  * several threads do not interleave. The sending thread waits for the write,
+  * use an AsyncNotifyHandler to keep terminal I/O off render threads.*/
+class SG_EXPORT StandardNotifyHandler : public NotifyHandler
+{
+    public:
+
+        virtual void notify(NotifySeverity severity, const char* message);
+};
+
+/** set the handler which all messages go to, a StandardNotifyHandler by
+  * default, or an AsyncNotifyHandler when OSG_NOTIFY_HANDLER is ASYNC. Set
+  * it at startup or while no other thread is sending messages, as the
+  * previous handler is released straight away.*/
+SG_EXPORT extern void setNotifyHandler(NotifyHandler* handler);
+
+/** get the handler which all messages go to.*/
+SG_EXPORT extern NotifyHandler* getNotifyHandler();
+
 }
 
+/** Messages less important than OSG_NOTIFY_COMPILE_LEVEL are compiled out of
+  * OSG_NOTIFY, define it before including Notify.h, for instance to osg::WARN
+  * in release builds. By default every level is compiled in.*/
+#ifndef OSG_NOTIFY_COMPILE_LEVEL
+    #define OSG_NOTIFY_COMPILE_LEVEL osg::DEBUG_FP
+#endif
+
+/** Use in place of osg::notify(level) on paths where messages are usually
+  * filtered out: when the level is disabled the message is neither formatted
+  * nor are its arguments evaluated, costing a single branch, and levels above
+  * OSG_NOTIFY_COMPILE_LEVEL cost nothing at all. Use as a stream, i.e.
+  * OSG_NOTIFY(osg::WARN)<<"Warning: "<<value<<std::endl;*/
+#define OSG_NOTIFY(level) \
+    if ((level)>OSG_NOTIFY_COMPILE_LEVEL || !osg::isNotifyEnabled(level)) {} else osg::notify(level)
+
+/** OSG_NOTIFY for the messages of a NotifySubsystem, filtered at the level of the subsystem.*/
+#define OSG_NOTIFY_SUBSYSTEM(subsystem,level) \
+    if ((level)>OSG_NOTIFY_COMPILE_LEVEL || !(subsystem).isNotifyEnabled(level)) {} else osg::notify(subsystem,level)
+
 #endif
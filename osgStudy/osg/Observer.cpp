@@ -0,0 +1,59 @@
+#include <osg/Observer.h>
+
+using namespace osg;
+
+ObserverSet::ObserverSet(const Referenced* observedObject):
+    _observedObject(const_cast<Referenced*>(observedObject))
+{
+}
+
+Referenced* ObserverSet::getObservedObject() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _observedObject;
+}
+
+Referenced* ObserverSet::addRefLock() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_observedObject) return 0;
+
+    // a count of one means the last reference had already gone, and the object
+    // is waiting for this mutex in signalObjectDeleted() before being deleted.
+    if (_observedObject->ref()==1)
+    {
+        _observedObject->unref_nodelete();
+        return 0;
+    }
+    return _observedObject;
+}
+
+void ObserverSet::addObserver(Observer* observer)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _observers.insert(observer);
+}
+
+void ObserverSet::removeObserver(Observer* observer)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _observers.erase(observer);
+}
+
+void ObserverSet::signalObjectDeleted()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // unref() signals before the destructor, which signals again.
+    if (!_observedObject) return;
+
+    for(Observers::iterator itr=_observers.begin();
+        itr!=_observers.end();
+        ++itr)
+    {
+        (*itr)->objectDeleted(_observedObject);
+    }
+    _observers.clear();
+    _observedObject = 0;
+}
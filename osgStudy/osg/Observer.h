@@ -0,0 +1,76 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_OBSERVER
+#define OSG_OBSERVER 1
+
+#include <osg/Referenced.h>
+
+#include <mutex>
+#include <set>
+
+namespace osg {
+
+/** Observer base class for tracking when objects are deleted, register with
+  * Referenced::addObserver(). An observer must remove itself from the objects
+  * it observes before it is deleted.*/
+class SG_EXPORT Observer
+{
+
+    public:
+        Observer() {}
+        virtual ~Observer() {}
+
+        /** called when an observed object is deleted, before its destructor runs if it
+            was released by unref(), otherwise from Referenced's destructor, after the
+            derived parts are gone, so only use object as a key. The call is made with
+            the object's ObserverSet locked, so it must not lock an observer_ptr to the
+            same object or add or remove observers of it.*/
+        virtual void objectDeleted(Referenced* /*object*/) {}
+
+};
+
+/** The block shared by everything observing one Referenced object, created by
+  * Referenced::getOrCreateObserverSet() when the object is first observed.
+  * It outlives the object, which clears it as it is deleted, so observers can
+  * tell whether the object is still there, see observer_ptr. It also holds the
+  * Observers to notify of the deletion.*/
+class SG_EXPORT ObserverSet : public Referenced
+{
+
+    public:
+        ObserverSet(const Referenced* observedObject);
+
+        /** return the observed object, 0 once it has been deleted. When other threads
+            may release the object, the answer can be out of date as soon as it is
+            returned, use addRefLock() to keep hold of the object.*/
+        Referenced* getObservedObject() const;
+
+        /** take a reference to the observed object and return it, return 0 without
+            taking a reference if the object has been deleted or is being deleted.*/
+        Referenced* addRefLock() const;
+
+        void addObserver(Observer* observer);
+        void removeObserver(Observer* observer);
+
+        /** called by the observed object as it is deleted, notify the observers once.*/
+        void signalObjectDeleted();
+
+    protected:
+        virtual ~ObserverSet() {}
+
+        ObserverSet(const ObserverSet&) : Referenced(), _observedObject(0) {}
+        ObserverSet& operator = (const ObserverSet&) { return *this; }
+
+        typedef std::set<Observer*> Observers;
+
+        mutable std::mutex  _mutex;
+        Referenced*         _observedObject;
+        Observers           _observers;
+
+};
+
+}
+
+#endif
@@ -142,10 +142,10 @@ class SG_EXPORT Plane
         }
         
         
-        /** intersection test between plane and bounding sphere.
-            return 1 if the bs is completely above plane,
-            return 0 if the bs intersects the plane,
-            return -1 if the bs is completely below the plane.*/
+        /** intersection test between plane and bounding box.
+            return 1 if the bb is completely above plane,
+            return 0 if the bb intersects the plane,
+            return -1 if the bb is completely below the plane.*/
         inline const int intersect(const BoundingBox& bb) const
         {
              // if lowest point above plane than all above.
@@ -160,14 +160,51 @@ class SG_EXPORT Plane
             
         }
 
+        /** intersection test between plane and a center/extent box, without
+            branches: the box reaches |n.extent| either side of its center.
+            return 1 if the box is completely above plane,
+            return 0 if the box intersects the plane,
+            return -1 if the box is completely below the plane.*/
+        inline const int intersect(const CenterExtentBox& box) const
+        {
+            float d = distance(box._center);
+            float r = fabsf(_fv[0])*box._extent.x()+
+                      fabsf(_fv[1])*box._extent.y()+
+                      fabsf(_fv[2])*box._extent.z();
+            return (int)(d>r) - (int)(d<-r);
+        }
+
         /** Transform the plane by matrix.  Note, this operations carries out
           * the calculation of the inverse of the matrix since to transforms
           * planes must be multiplied my the inverse transposed. This
-          * make this operation expensive.  If the inverse has been already
+          * make this operation expensive, except for identity, translate only
+          * and rigid matrices which are handled directly.  If the inverse has been already
           * calculated elsewhere then use transformProvidingInverse() instead.
           * See http://www.worldserver.com/turk/computergraphics/NormalTransformations.pdf*/
         inline void transform(const osg::Matrix& matrix)
         {
+            switch(matrix.getClassification())
+            {
+                case(osg::Matrix::IDENTITY):
+                    makeUnitLength();
+                    return;
+                case(osg::Matrix::TRANSLATE):
+                    // normal is unchanged, only the distance moves.
+                    _fv[3] -= _fv[0]*matrix(3,0) + _fv[1]*matrix(3,1) + _fv[2]*matrix(3,2);
+                    makeUnitLength();
+                    return;
+                case(osg::Matrix::RIGID):
+                {
+                    // inverse transpose of a rotation is the rotation itself.
+                    Vec3 normal(Matrix::transform3x3(Vec3(_fv[0],_fv[1],_fv[2]),matrix));
+                    _fv.set(normal[0],normal[1],normal[2],_fv[3]-normal*matrix.getTrans());
+                    makeUnitLength();
+                    calculateUpperLowerBBCorners();
+                    return;
+                }
+                default:
+                    break;
+            }
             osg::Matrix inverse;
             inverse.invert(matrix);
             transformProvidingInverse(inverse);
@@ -0,0 +1,412 @@
+#include <osg/Polytope.h>
+#include <osg/SIMD.h>
+
+using namespace osg;
+
+// Batch culling. The planes selected by the current mask are gathered once
+// per call with their coefficients splatted, then each group of four volumes
+// is tested against them, keeping per lane the mask of the planes still
+// intersected and whether any plane has the volume below it. Distances are
+// summed in the order of Plane::distance() so the results match the single
+// volume tests exactly.
+
+namespace
+{
+
+struct BatchPlane
+{
+    simd4f          a, b, c, d;
+    simd4i          selector;
+    // index into {min,max} of the coordinates of the box corner furthest
+    // along the normal, as Plane::calculateUpperLowerBBCorners().
+    unsigned int    upperX, upperY, upperZ;
+};
+
+/** Fill planes with the planes selected by mask, return their number.*/
+unsigned int getBatchPlanes(const Polytope::PlaneList& planeList,Polytope::ClippingMask mask,BatchPlane* planes)
+{
+    unsigned int numPlanes = 0;
+    Polytope::ClippingMask selector_mask = 0x1;
+    for(unsigned int i=0;i<planeList.size() && i<32;++i,selector_mask<<=1)
+    {
+        if (!(mask&selector_mask)) continue;
+
+        const Plane& plane = planeList[i];
+        BatchPlane& bp = planes[numPlanes++];
+        bp.a = simd4f_splat(plane[0]);
+        bp.b = simd4f_splat(plane[1]);
+        bp.c = simd4f_splat(plane[2]);
+        bp.d = simd4f_splat(plane[3]);
+        bp.selector = simd4i_splat(selector_mask);
+        bp.upperX = plane[0]>=0.0f ? 1 : 0;
+        bp.upperY = plane[1]>=0.0f ? 1 : 0;
+        bp.upperZ = plane[2]>=0.0f ? 1 : 0;
+    }
+    return numPlanes;
+}
+
+inline simd4f distance(const BatchPlane& plane,simd4f x,simd4f y,simd4f z)
+{
+    return simd4f_add(simd4f_madd(plane.c,z,simd4f_madd(plane.b,y,simd4f_mul(plane.a,x))),plane.d);
+}
+
+/** Load num floats from ptr, padding the last group of a batch by repeating the first.*/
+inline simd4f loadPadded(const float* ptr,unsigned int num)
+{
+    if (num>=4) return simd4f_load(ptr);
+    float v[4];
+    for(unsigned int k=0;k<4;++k) v[k] = ptr[k<num ? k : 0];
+    return simd4f_load(v);
+}
+
+/** Write the results of the first num lanes, return the number not outside.*/
+inline unsigned int storeResults(simd4i mask,simd4i outside,unsigned int num,signed char* results,Polytope::ClippingMask* masks)
+{
+    unsigned int laneMasks[4];
+    simd4i_store(laneMasks,simd4i_andnot(mask,outside));
+    const int outsideBits = simd4i_movemask(outside);
+
+    unsigned int numVisible = 0;
+    for(unsigned int k=0;k<num;++k)
+    {
+        if (outsideBits&(1<<k)) results[k] = -1;
+        else
+        {
+            results[k] = laneMasks[k] ? 0 : 1;
+            ++numVisible;
+        }
+        if (masks) masks[k] = laneMasks[k];
+    }
+    return numVisible;
+}
+
+unsigned int cullSpheres(const BatchPlane* planes,unsigned int numPlanes,simd4i mask,
+                         simd4f x,simd4f y,simd4f z,simd4f radius,
+                         unsigned int num,signed char* results,Polytope::ClippingMask* masks)
+{
+    const simd4f negRadius = simd4f_sub(simd4f_zero(),radius);
+    simd4i outside = simd4i_splat(0);
+    for(unsigned int p=0;p<numPlanes;++p)
+    {
+        simd4f d = distance(planes[p],x,y,z);
+        outside = simd4i_or(outside,simd4f_cmplt(d,negRadius));
+        // subsequent checks against this plane not required by the lanes above it.
+        mask = simd4i_andnot(mask,simd4i_and(simd4f_cmpgt(d,radius),planes[p].selector));
+        if (simd4i_movemask(outside)==0xf) break;
+    }
+    return storeResults(mask,outside,num,results,masks);
+}
+
+unsigned int cullBoxes(const BatchPlane* planes,unsigned int numPlanes,simd4i mask,
+                       const simd4f x[2],const simd4f y[2],const simd4f z[2],
+                       unsigned int num,signed char* results,Polytope::ClippingMask* masks)
+{
+    simd4i outside = simd4i_splat(0);
+    for(unsigned int p=0;p<numPlanes;++p)
+    {
+        const BatchPlane& plane = planes[p];
+        // if lowest point above plane than all above, if highest point is below plane then all below.
+        simd4f lower = distance(plane,x[1-plane.upperX],y[1-plane.upperY],z[1-plane.upperZ]);
+        simd4f upper = distance(plane,x[plane.upperX],y[plane.upperY],z[plane.upperZ]);
+        outside = simd4i_or(outside,simd4f_cmplt(upper,simd4f_zero()));
+        mask = simd4i_andnot(mask,simd4i_and(simd4f_cmpgt(lower,simd4f_zero()),plane.selector));
+        if (simd4i_movemask(outside)==0xf) break;
+    }
+    return storeResults(mask,outside,num,results,masks);
+}
+
+}
+
+unsigned int Polytope::contains(const SphereBatch& spheres,signed char* results,ClippingMask* masks) const
+{
+    BatchPlane planes[32];
+    const unsigned int numPlanes = getBatchPlanes(_planeList,_maskStack.back(),planes);
+    const simd4i mask = simd4i_splat(_maskStack.back());
+
+    unsigned int numVisible = 0;
+    for(unsigned int i=0;i<spheres.num;i+=4)
+    {
+        const unsigned int num = spheres.num-i<4 ? spheres.num-i : 4;
+        numVisible += cullSpheres(planes,numPlanes,mask,
+                                  loadPadded(spheres.centerX+i,num),
+                                  loadPadded(spheres.centerY+i,num),
+                                  loadPadded(spheres.centerZ+i,num),
+                                  loadPadded(spheres.radius+i,num),
+                                  num,results+i,masks ? masks+i : 0);
+    }
+    return numVisible;
+}
+
+unsigned int Polytope::contains(const BoxBatch& boxes,signed char* results,ClippingMask* masks) const
+{
+    BatchPlane planes[32];
+    const unsigned int numPlanes = getBatchPlanes(_planeList,_maskStack.back(),planes);
+    const simd4i mask = simd4i_splat(_maskStack.back());
+
+    unsigned int numVisible = 0;
+    for(unsigned int i=0;i<boxes.num;i+=4)
+    {
+        const unsigned int num = boxes.num-i<4 ? boxes.num-i : 4;
+        const simd4f x[2] = { loadPadded(boxes.xMin+i,num), loadPadded(boxes.xMax+i,num) };
+        const simd4f y[2] = { loadPadded(boxes.yMin+i,num), loadPadded(boxes.yMax+i,num) };
+        const simd4f z[2] = { loadPadded(boxes.zMin+i,num), loadPadded(boxes.zMax+i,num) };
+        numVisible += cullBoxes(planes,numPlanes,mask,x,y,z,num,results+i,masks ? masks+i : 0);
+    }
+    return numVisible;
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/Timer.h>
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+
+namespace
+{
+
+float randomFloat(float min,float max) { return min+(max-min)*(float)rand()/(float)RAND_MAX; }
+
+}
+
+/** Cull numVolumes random spheres and boxes around a perspective frustum,
+  * one at a time with contains() and as a batch, with all the planes active
+  * and with the near and far planes masked off. Check that the results and
+  * masks agree and report the times.*/
+void benchmark_Polytope(unsigned int numVolumes)
+{
+    Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(Matrix::perspective(45.0,1.3,1.0,1000.0));
+
+    std::vector<float> cx(numVolumes), cy(numVolumes), cz(numVolumes), radius(numVolumes);
+    std::vector<float> xMin(numVolumes), yMin(numVolumes), zMin(numVolumes), xMax(numVolumes), yMax(numVolumes), zMax(numVolumes);
+    std::vector<BoundingSphere> spheres(numVolumes);
+    std::vector<BoundingBox> boxes(numVolumes);
+    for(unsigned int i=0;i<numVolumes;++i)
+    {
+        Vec3 center(randomFloat(-600.0f,600.0f),randomFloat(-600.0f,600.0f),randomFloat(-1100.0f,100.0f));
+        float r = randomFloat(0.1f,50.0f);
+        spheres[i].set(center,r);
+        cx[i] = center.x(); cy[i] = center.y(); cz[i] = center.z(); radius[i] = r;
+
+        Vec3 extent(randomFloat(0.1f,50.0f),randomFloat(0.1f,50.0f),randomFloat(0.1f,50.0f));
+        boxes[i].set(center-extent,center+extent);
+        xMin[i] = boxes[i].xMin(); yMin[i] = boxes[i].yMin(); zMin[i] = boxes[i].zMin();
+        xMax[i] = boxes[i].xMax(); yMax[i] = boxes[i].yMax(); zMax[i] = boxes[i].zMax();
+    }
+
+    Polytope::SphereBatch sphereBatch;
+    sphereBatch.num = numVolumes;
+    sphereBatch.centerX = &cx.front(); sphereBatch.centerY = &cy.front(); sphereBatch.centerZ = &cz.front();
+    sphereBatch.radius = &radius.front();
+
+    Polytope::BoxBatch boxBatch;
+    boxBatch.num = numVolumes;
+    boxBatch.xMin = &xMin.front(); boxBatch.yMin = &yMin.front(); boxBatch.zMin = &zMin.front();
+    boxBatch.xMax = &xMax.front(); boxBatch.yMax = &yMax.front(); boxBatch.zMax = &zMax.front();
+
+    std::vector<signed char> results(numVolumes), referenceResults(numVolumes);
+    std::vector<Polytope::ClippingMask> masks(numVolumes), referenceMasks(numVolumes);
+
+    Timer timer;
+    for(int pass=0;pass<2;++pass)
+    {
+        // second pass with the near and far planes switched off, as a parent fully between them would leave.
+        if (pass==1)
+        {
+            frustum.setResultMask(0xf);
+            frustum.pushCurrentMask();
+        }
+
+        for(int volumeType=0;volumeType<2;++volumeType)
+        {
+            Timer_t t0 = timer.tick();
+            unsigned int numReference = 0;
+            for(unsigned int i=0;i<numVolumes;++i)
+            {
+                bool visible = volumeType==0 ? frustum.contains(spheres[i]) : frustum.contains(boxes[i]);
+                referenceMasks[i] = visible ? frustum.getResultMask() : 0;
+                referenceResults[i] = visible ? (referenceMasks[i] ? 0 : 1) : -1;
+                if (visible) ++numReference;
+            }
+            Timer_t t1 = timer.tick();
+            unsigned int numVisible = volumeType==0 ? frustum.contains(sphereBatch,&results.front(),&masks.front()) :
+                                                      frustum.contains(boxBatch,&results.front(),&masks.front());
+            Timer_t t2 = timer.tick();
+
+            bool passed = numVisible==numReference && results==referenceResults && masks==referenceMasks;
+            std::cout<<"Polytope::contains "<<(volumeType==0 ? "spheres " : "boxes   ")<<(pass==0 ? "6 planes " : "4 planes ")
+                     <<numVolumes<<" volumes  single "<<timer.delta_m(t0,t1)<<"ms  batch "<<timer.delta_m(t1,t2)<<"ms  "
+                     <<numVisible<<" visible"<<(passed?"  OK":"  FAILED")<<std::endl;
+        }
+    }
+    frustum.popCurrentMask();
+}
+
+/** Cull numObjects random spheres scattered around a camera which turns and
+  * moves a little each frame, for numFrames frames, with and without per
+  * object plane hints. Check that the hints do not change the results and,
+  * with OSG_POLYTOPE_PLANE_HINT_STATISTICS defined, report their hit rate and
+  * the planes tested per object.*/
+void benchmark_PolytopePlaneHint(unsigned int numObjects, unsigned int numFrames)
+{
+    std::vector<BoundingSphere> spheres(numObjects);
+    for(unsigned int i=0;i<numObjects;++i)
+    {
+        spheres[i].set(Vec3(randomFloat(-1000.0f,1000.0f),randomFloat(-1000.0f,1000.0f),randomFloat(-1000.0f,1000.0f)),randomFloat(0.1f,20.0f));
+    }
+
+    // hints kept by the caller alongside the objects, and for every 16th object in a side table.
+    std::vector<Polytope::PlaneHint> hints(numObjects);
+    Polytope::PlaneHintMap hintMap;
+
+    Polytope frustum, sideTableFrustum;
+    std::vector<bool> visible(numObjects);
+    std::vector<Polytope::ClippingMask> masks(numObjects);
+    Timer timer;
+    double plainTime = 0.0, hintTime = 0.0;
+    unsigned int numPlainPlaneTests = 0;
+    bool passed = true;
+    for(unsigned int frame=0;frame<numFrames;++frame)
+    {
+        frustum.setToUnitFrustum();
+        frustum.transformProvidingInverse(Matrix::rotate((float)frame*0.005f,0.0f,1.0f,0.0f)*
+                                          Matrix::translate(0.0f,0.0f,-(float)frame*0.5f)*
+                                          Matrix::perspective(45.0,1.3,1.0,1000.0));
+        sideTableFrustum.set(frustum.getPlaneList());
+
+        Timer_t t0 = timer.tick();
+        for(unsigned int i=0;i<numObjects;++i)
+        {
+            visible[i] = frustum.contains(spheres[i]);
+            masks[i] = frustum.getResultMask();
+        }
+        Timer_t t1 = timer.tick();
+        for(unsigned int i=0;i<numObjects;++i)
+        {
+            bool hintedVisible = frustum.contains(spheres[i],hints[i]);
+            passed = passed && hintedVisible==visible[i] && (!visible[i] || frustum.getResultMask()==masks[i]);
+        }
+        Timer_t t2 = timer.tick();
+        plainTime += timer.delta_m(t0,t1);
+        hintTime += timer.delta_m(t1,t2);
+
+        for(unsigned int i=0;i<numObjects;i+=16)
+        {
+            passed = passed && sideTableFrustum.contains(spheres[i],hintMap[&spheres[i]])==visible[i];
+        }
+
+        // the planes the plain contains() tested, stopping at the first rejecting one.
+        for(unsigned int i=0;i<numObjects;++i)
+        {
+            for(unsigned int p=0;p<frustum.getPlaneList().size();++p)
+            {
+                ++numPlainPlaneTests;
+                if (frustum.getPlaneList()[p].intersect(spheres[i])<0) break;
+            }
+        }
+    }
+
+    std::cout<<"Polytope plane hints "<<numObjects<<" objects x "<<numFrames<<" frames  plain "<<plainTime<<"ms  hinted "<<hintTime<<"ms"<<std::endl;
+    std::cout<<"  planes per object plain "<<(float)numPlainPlaneTests/(float)(numObjects*numFrames);
+#ifdef OSG_POLYTOPE_PLANE_HINT_STATISTICS
+    const Polytope::PlaneHintStatistics& stats = frustum.getPlaneHintStatistics();
+    std::cout<<"  hinted "<<(float)stats.numPlaneTests/(float)stats.numTests
+             <<"  hit rate "<<stats.getHitRate()*100.0f<<"%  side table hit rate "<<sideTableFrustum.getPlaneHintStatistics().getHitRate()*100.0f<<"%";
+#endif
+    std::cout<<(passed?"  OK":"  FAILED")<<std::endl;
+}
+
+/** Test numBoxes random boxes against the planes of a perspective frustum with
+  * Plane::intersect(const BoundingBox&) and the center/extent
+  * Plane::intersect(const CenterExtentBox&), then cull them with
+  * Polytope::contains() of both forms and containsUnrolled(). The boxes are
+  * scattered all around the view, then mostly in view where the loop can not
+  * stop early. Each test is timed on its own, the best of numRuns runs, and
+  * the results are checked to agree afterwards.*/
+void benchmark_PolytopeBoxTests(unsigned int numBoxes, unsigned int numRuns)
+{
+    Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(Matrix::perspective(45.0,1.3,1.0,1000.0));
+    const Polytope::PlaneList& planes = frustum.getPlaneList();
+
+    std::vector<BoundingBox> boxes(numBoxes);
+    std::vector<CenterExtentBox> centerExtentBoxes(numBoxes);
+    std::vector<signed char> reference(numBoxes*planes.size()), results(numBoxes*planes.size());
+    std::vector<char> visible(numBoxes), centerExtentVisible(numBoxes), unrolledVisible(numBoxes);
+    std::vector<Polytope::ClippingMask> masks(numBoxes), unrolledMasks(numBoxes);
+    Timer timer;
+
+    for(int distribution=0;distribution<2;++distribution)
+    {
+        const float range = distribution==0 ? 1000.0f : 300.0f;
+        for(unsigned int i=0;i<numBoxes;++i)
+        {
+            Vec3 center(randomFloat(-range,range),randomFloat(-range,range),distribution==0 ? randomFloat(-1000.0f,1000.0f) : randomFloat(-900.0f,-300.0f));
+            Vec3 extent(randomFloat(0.1f,50.0f),randomFloat(0.1f,50.0f),randomFloat(0.1f,50.0f));
+            boxes[i].set(center-extent,center+extent);
+            centerExtentBoxes[i].set(boxes[i]);
+        }
+
+        double planeTime = 1e30, centerExtentPlaneTime = 1e30;
+        double containsTime = 1e30, centerExtentContainsTime = 1e30, unrolledTime = 1e30;
+        for(unsigned int run=0;run<numRuns;++run)
+        {
+            Timer_t t0 = timer.tick();
+            for(unsigned int i=0;i<numBoxes;++i)
+                for(unsigned int p=0;p<planes.size();++p) reference[i*planes.size()+p] = planes[p].intersect(boxes[i]);
+            Timer_t t1 = timer.tick();
+            for(unsigned int i=0;i<numBoxes;++i)
+                for(unsigned int p=0;p<planes.size();++p) results[i*planes.size()+p] = planes[p].intersect(centerExtentBoxes[i]);
+            Timer_t t2 = timer.tick();
+            planeTime = std::min(planeTime,timer.delta_m(t0,t1));
+            centerExtentPlaneTime = std::min(centerExtentPlaneTime,timer.delta_m(t1,t2));
+
+            t0 = timer.tick();
+            for(unsigned int i=0;i<numBoxes;++i)
+            {
+                visible[i] = frustum.contains(boxes[i]);
+            }
+            t1 = timer.tick();
+            for(unsigned int i=0;i<numBoxes;++i)
+            {
+                centerExtentVisible[i] = frustum.contains(centerExtentBoxes[i]);
+                masks[i] = frustum.getResultMask();
+            }
+            t2 = timer.tick();
+            for(unsigned int i=0;i<numBoxes;++i)
+            {
+                unrolledVisible[i] = frustum.containsUnrolled(centerExtentBoxes[i]);
+                unrolledMasks[i] = frustum.getResultMask();
+            }
+            Timer_t t3 = timer.tick();
+            containsTime = std::min(containsTime,timer.delta_m(t0,t1));
+            centerExtentContainsTime = std::min(centerExtentContainsTime,timer.delta_m(t1,t2));
+            unrolledTime = std::min(unrolledTime,timer.delta_m(t2,t3));
+        }
+
+        // the center/extent test rounds differently, only boxes touching a plane may disagree.
+        unsigned int numCenterExtentDifferences = 0;
+        for(unsigned int i=0;i<results.size();++i) if (results[i]!=reference[i]) ++numCenterExtentDifferences;
+
+        unsigned int numVisible = 0, numUnrolledVisible = 0;
+        bool passed = true;
+        for(unsigned int i=0;i<numBoxes;++i)
+        {
+            if (visible[i]) ++numVisible;
+            if (unrolledVisible[i]) ++numUnrolledVisible;
+            passed = passed && unrolledVisible[i]==centerExtentVisible[i] && (!unrolledVisible[i] || unrolledMasks[i]==masks[i]);
+        }
+
+        std::cout<<(distribution==0 ? "scattered " : "in view   ")<<numBoxes<<" boxes, best of "<<numRuns<<" runs"<<std::endl;
+        std::cout<<"  Plane::intersect x "<<planes.size()<<" planes  min/max "<<planeTime
+                 <<"ms  center/extent "<<centerExtentPlaneTime<<"ms "<<numCenterExtentDifferences<<" differences"<<std::endl;
+        std::cout<<"  Polytope::contains  min/max "<<containsTime<<"ms "<<numVisible<<" visible"
+                 <<"  center/extent "<<centerExtentContainsTime<<"ms  unrolled "<<unrolledTime<<"ms "
+                 <<numUnrolledVisible<<" visible"<<(passed?"  OK":"  FAILED")<<std::endl;
+    }
+}
+
+#endif
@@ -8,6 +8,17 @@
 #include <osg/Plane>
 #include <osg/fast_back_stack>
 
+#include <unordered_map>
+
+/* Define OSG_POLYTOPE_PLANE_HINT_STATISTICS to count the hinted contains() in
+ * Polytope::getPlaneHintStatistics(), which otherwise stay at zero and cost
+ * nothing in the culling loop.*/
+#ifdef OSG_POLYTOPE_PLANE_HINT_STATISTICS
+    #define OSG_PLANE_HINT_STATISTIC(counter) ++_planeHintStatistics.counter
+#else
+    #define OSG_PLANE_HINT_STATISTIC(counter)
+#endif
+
 namespace osg {
 
 
@@ -18,6 +29,70 @@ class SG_EXPORT Polytope
 
     public:
 
+        typedef unsigned int                    ClippingMask;
+        typedef std::vector<Plane>              PlaneList;
+        typedef std::vector<Vec3>               VertexList;
+        typedef fast_back_stack<ClippingMask>   MaskStack;
+
+        /** Bounding spheres in structure of arrays layout, for the batch contains().*/
+        struct SphereBatch
+        {
+            SphereBatch() : num(0), centerX(0), centerY(0), centerZ(0), radius(0) {}
+
+            unsigned int    num;
+            const float*    centerX;
+            const float*    centerY;
+            const float*    centerZ;
+            const float*    radius;
+        };
+
+        /** Bounding boxes in structure of arrays layout, for the batch contains().*/
+        struct BoxBatch
+        {
+            BoxBatch() : num(0), xMin(0), yMin(0), zMin(0), xMax(0), yMax(0), zMax(0) {}
+
+            unsigned int    num;
+            const float*    xMin;
+            const float*    yMin;
+            const float*    zMin;
+            const float*    xMax;
+            const float*    yMax;
+            const float*    zMax;
+        };
+
+        /** Hint of the plane to test first, kept per culled object across
+          * frames by the hinted contains(). 0 when there is no hint, otherwise
+          * the index of the plane which last rejected the object plus one, so
+          * that zero initialised storage starts without hints.*/
+        typedef unsigned char                   PlaneHint;
+
+        /** Side table of hints keyed by the culled object, such as a Node, for
+          * callers which have nowhere to keep them. operator[] adds missing
+          * entries without a hint. A lookup costs about as much as a few plane
+          * tests, so callers which can should keep the hint beside the object.*/
+        typedef std::unordered_map<const void*,PlaneHint> PlaneHintMap;
+
+        /** Counts of the hinted contains() since the last resetPlaneHintStatistics(),
+          * kept only when OSG_POLYTOPE_PLANE_HINT_STATISTICS is defined.*/
+        struct PlaneHintStatistics
+        {
+            PlaneHintStatistics() : numTests(0), numHinted(0), numHits(0), numRejected(0), numPlaneTests(0) {}
+
+            /** fraction of the tests given a hint in which the hinted plane rejected the volume.*/
+            inline float getHitRate() const { return numHinted ? (float)numHits/(float)numHinted : 0.0f; }
+
+            /** hinted contains() calls which tested at least one plane.*/
+            unsigned int    numTests;
+            /** tests given the hint of a plane in the current mask.*/
+            unsigned int    numHinted;
+            /** tests in which the hinted plane rejected the volume.*/
+            unsigned int    numHits;
+            /** tests in which any plane rejected the volume.*/
+            unsigned int    numRejected;
+            /** planes tested, including the hinted ones.*/
+            unsigned int    numPlaneTests;
+        };
+
         inline Polytope() {setupMask();}
 
         inline Polytope(const Polytope& cv) : 
@@ -209,6 +284,96 @@ class SG_EXPORT Polytope
             return true;
         }
 
+        /** Check whether any part of a bounding sphere is contained within clipping set,
+            as contains(const BoundingSphere&), testing the plane given by hint first.
+            When a plane rejects the sphere hint is set to it, so that with a slow moving
+            view an object outside is usually rejected by the first plane tested.*/
+        inline const bool contains(const osg::BoundingSphere& bs,PlaneHint& hint)
+        {
+            return containsWithHint(bs,hint);
+        }
+
+        /** Check whether any part of a bounding box is contained within clipping set,
+            testing the plane given by hint first. See contains(const BoundingSphere&,PlaneHint&).*/
+        inline const bool contains(const osg::BoundingBox& bb,PlaneHint& hint)
+        {
+            return containsWithHint(bb,hint);
+        }
+
+        inline const PlaneHintStatistics& getPlaneHintStatistics() const { return _planeHintStatistics; }
+
+        inline void resetPlaneHintStatistics() { _planeHintStatistics = PlaneHintStatistics(); }
+
+        /** Check a batch of bounding spheres against the planes of the current
+          * mask, four at a time with SIMD. results[i] is set as Plane::intersect()
+          * does, 1 if sphere i is entirely inside, 0 if it intersects and -1 if
+          * it is outside. If masks is not 0, masks[i] is set to the result mask
+          * contains(const BoundingSphere&) would leave for the sphere, the planes
+          * it still intersects, or 0 if it is outside. Unlike the single sphere
+          * version the result mask of the polytope is not modified.
+          * Returns the number of spheres not outside.*/
+        unsigned int contains(const SphereBatch& spheres,signed char* results,ClippingMask* masks=0) const;
+
+        /** Check a batch of bounding boxes against the planes of the current
+          * mask, four at a time with SIMD. See contains(const SphereBatch&,..).*/
+        unsigned int contains(const BoxBatch& boxes,signed char* results,ClippingMask* masks=0) const;
+
+        /** Check whether any part of a center/extent box is contained within clipping set,
+            as contains(const BoundingBox&) but using Plane::intersect(const CenterExtentBox&).*/
+        inline const bool contains(const osg::CenterExtentBox& box)
+        {
+            if (!_maskStack.back()) return true;
+
+            _resultMask = _maskStack.back();
+            ClippingMask selector_mask = 0x1;
+
+            for(PlaneList::const_iterator itr=_planeList.begin();
+                itr!=_planeList.end();
+                ++itr)
+            {
+                if (_resultMask&selector_mask)
+                {
+                    int res=itr->intersect(box);
+                    if (res<0) return false; // outside clipping set.
+                    else if (res>0) _resultMask ^= selector_mask; // subsequent checks against this plane not required.
+                }
+                selector_mask <<= 1; 
+            }
+            return true;
+        }
+
+        /** Check whether any part of a center/extent box is contained within clipping set,
+            as contains(const CenterExtentBox&), for polytopes of up to 8 planes such as
+            view frustums. Every plane is tested in straight line code and the results
+            are combined as bit masks, so there is no branch per plane. As it never
+            stops at the first plane a box is below, it only pays off when most boxes
+            are in view, contains() is as fast when most are culled. Polytopes with
+            more planes fall back to contains().*/
+        inline const bool containsUnrolled(const osg::CenterExtentBox& box)
+        {
+            if (!_maskStack.back()) return true;
+            if (_planeList.size()>8) return contains(box);
+
+            ClippingMask below = 0, above = 0;
+            const Plane* planes = _planeList.empty() ? 0 : &_planeList.front();
+            switch(_planeList.size())
+            {
+                case(8): intersectBits(planes[7],box,7,below,above); // fall through
+                case(7): intersectBits(planes[6],box,6,below,above); // fall through
+                case(6): intersectBits(planes[5],box,5,below,above); // fall through
+                case(5): intersectBits(planes[4],box,4,below,above); // fall through
+                case(4): intersectBits(planes[3],box,3,below,above); // fall through
+                case(3): intersectBits(planes[2],box,2,below,above); // fall through
+                case(2): intersectBits(planes[1],box,1,below,above); // fall through
+                case(1): intersectBits(planes[0],box,0,below,above); // fall through
+                default: break;
+            }
+
+            if (below&_maskStack.back()) return false; // outside clipping set.
+            _resultMask = _maskStack.back()&~above; // subsequent checks against the planes above not required.
+            return true;
+        }
+
         /** Check whether all of vertex list is contained with clipping set.*/
         inline const bool containsAllOf(const std::vector<Vec3>& vertices)
         {
@@ -314,11 +479,68 @@ class SG_EXPORT Polytope
         
     protected:
 
+        static inline void intersectBits(const Plane& plane,const CenterExtentBox& box,unsigned int index,ClippingMask& below,ClippingMask& above)
+        {
+            float d = plane.distance(box._center);
+            float r = fabsf(plane[0])*box._extent.x()+fabsf(plane[1])*box._extent.y()+fabsf(plane[2])*box._extent.z();
+            below |= (ClippingMask)(d<-r)<<index;
+            above |= (ClippingMask)(d>r)<<index;
+        }
+
+        template<class T>
+        inline bool containsWithHint(const T& volume,PlaneHint& hint)
+        {
+            if (!_maskStack.back()) return true;
+
+            OSG_PLANE_HINT_STATISTIC(numTests);
+            _resultMask = _maskStack.back();
+
+            // only the planes the mask has a bit for are ever tested.
+            ClippingMask hint_mask = 0;
+            if (hint>0 && hint<=_planeList.size() && hint<=sizeof(ClippingMask)*8 && (_resultMask&((ClippingMask)1<<(hint-1))))
+            {
+                hint_mask = (ClippingMask)1<<(hint-1);
+                OSG_PLANE_HINT_STATISTIC(numHinted);
+                OSG_PLANE_HINT_STATISTIC(numPlaneTests);
+                int res=_planeList[hint-1].intersect(volume);
+                if (res<0)
+                {
+                    OSG_PLANE_HINT_STATISTIC(numHits);
+                    OSG_PLANE_HINT_STATISTIC(numRejected);
+                    return false;
+                }
+                else if (res>0) _resultMask ^= hint_mask;
+            }
+
+            ClippingMask selector_mask = 0x1;
+            for(PlaneList::const_iterator itr=_planeList.begin();
+                itr!=_planeList.end();
+                ++itr)
+            {
+                // the hinted plane has been tested already.
+                if ((_resultMask&selector_mask) && selector_mask!=hint_mask)
+                {
+                    OSG_PLANE_HINT_STATISTIC(numPlaneTests);
+                    int res=itr->intersect(volume);
+                    if (res<0)
+                    {
+                        hint = (PlaneHint)(itr-_planeList.begin()+1);
+                        OSG_PLANE_HINT_STATISTIC(numRejected);
+                        return false;
+                    }
+                    else if (res>0) _resultMask ^= selector_mask;
+                }
+                selector_mask <<= 1;
+            }
+            return true;
+        }
+
 
         MaskStack                           _maskStack;
         ClippingMask                        _resultMask;
         PlaneList                           _planeList;
         VertexList                          _referenceVertexList;
+        PlaneHintStatistics                 _planeHintStatistics;
 
 };
 
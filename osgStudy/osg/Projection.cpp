@@ -4,18 +4,17 @@ using namespace osg;
 
 Projection::Projection()
 {
-    _matrix = osgNew Matrix;
 }
 
 Projection::Projection(const Projection& projection,const CopyOp& copyop):
     Group(projection,copyop),
-    _matrix(osgNew Matrix(*projection._matrix))
+    _matrix(projection._matrix)
 {    
 }
 
-Projection::Projection(const Matrix& mat )
+Projection::Projection(const Matrix& mat ):
+    _matrix(mat)
 {
-    _matrix = osgNew Matrix(mat);
 }
 
 
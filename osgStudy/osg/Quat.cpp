@@ -1,8 +1,9 @@
-#include <stdio>
+#include <stdio.h>
 #include <osg/Quat.h>
 #include <osg/Vec4.h>
 #include <osg/Vec3.h>
 #include <osg/Types.h>
+#include <osg/SIMD.h>
 
 #include <math.h>
 
@@ -189,6 +190,38 @@ void Quat::slerp( const float t, const Quat& from, const Quat& to )
 }
 
 
+/// Normalised linear interpolation, a linear blend along the shorter arc
+/// which is then renormalised. It traces the same arc as slerp but does not
+/// move along it at constant angular velocity, the error peaks at t=0.5.
+void Quat::nlerp( const float t, const Quat& from, const Quat& to )
+{
+    float cosomega = from.asVec4() * to.asVec4();
+    float scale_to = (cosomega<0.0f) ? -t : t;
+
+    _fv = (from._fv*(1.0f-t)) + (to._fv*scale_to);
+
+    float len2 = _fv.length2();
+    if (len2>0.0f) _fv *= 1.0f/sqrtf(len2);
+}
+
+
+/// Approximate Spherical Linear Interpolation.
+/// nlerp with t first adjusted by a polynomial in t and |cos(omega)| which
+/// restores the constant angular velocity of slerp, after the fit given in
+/// A. Kapoulkine, "Approximating slerp", 2015.  No trig calls are needed and
+/// the deviation from slerp stays below 0.001 radians, see test_Quat_slerp().
+void Quat::approximateSlerp( const float t, const Quat& from, const Quat& to )
+{
+    float d = fabsf(from.asVec4() * to.asVec4());
+    float A = 1.0904f + d*(-3.2452f + d*(3.55645f - d*1.43519f));
+    float B = 0.848013f + d*(-1.06021f + d*0.215638f);
+    float k = A*(t-0.5f)*(t-0.5f) + B;
+    float ot = t + t*(t-0.5f)*(t-1.0f)*k;
+
+    nlerp(ot, from, to);
+}
+
+
 #define QX  _fv[0]
 #define QY  _fv[1]
 #define QZ  _fv[2]
@@ -299,7 +332,97 @@ void Quat::get( Matrix& m ) const
     m(3,3) = 1;
 }
 
+/// Batch version of get(Matrix&) combined with a scale and translation,
+/// four quaternions are converted per pass with the SIMD kernels, each
+/// lane holding one quaternion.  A short final batch is padded by repeating
+/// the first entry so that every matrix goes through the same arithmetic.
+void Quat::getMatrices( const Quat* rotations, const Vec3* positions, const Vec3* scales,
+                        Matrix* matrices, unsigned int num )
+{
+    const simd4f one = simd4f_splat(1.0f);
+    const simd4f unit_w = simd4f_set(0.0f,0.0f,0.0f,1.0f);
+
+    for(unsigned int i=0;i<num;i+=4)
+    {
+        unsigned int n = (num-i<4) ? num-i : 4;
+
+        simd4f q[4], sc[4], row3[4];
+        for(unsigned int k=0;k<4;++k)
+        {
+            unsigned int j = i + ((k<n) ? k : 0);
+            q[k] = simd4f_load(rotations[j]._fv.ptr());
+            sc[k] = scales ? simd4f_load3(scales[j].ptr()) : one;
+            row3[k] = positions ? simd4f_add(simd4f_load3(positions[j].ptr()),unit_w) : unit_w;
+        }
+
+        // transpose to one register per component, lane k holding entry i+k.
+        simd4f_transpose(q[0],q[1],q[2],q[3]);
+        simd4f_transpose(sc[0],sc[1],sc[2],sc[3]);
+        simd4f x = q[0], y = q[1], z = q[2], w = q[3];
+
+        simd4f x2 = simd4f_add(x,x);
+        simd4f y2 = simd4f_add(y,y);
+        simd4f z2 = simd4f_add(z,z);
+
+        simd4f xx = simd4f_mul(x,x2);
+        simd4f xy = simd4f_mul(x,y2);
+        simd4f xz = simd4f_mul(x,z2);
+        simd4f yy = simd4f_mul(y,y2);
+        simd4f yz = simd4f_mul(y,z2);
+        simd4f zz = simd4f_mul(z,z2);
+        simd4f wx = simd4f_mul(w,x2);
+        simd4f wy = simd4f_mul(w,y2);
+        simd4f wz = simd4f_mul(w,z2);
+
+        // as per get(Matrix&), with row r scaled by the r'th scale component.
+        simd4f row0[4] = { simd4f_mul(sc[0],simd4f_sub(one,simd4f_add(yy,zz))),
+                           simd4f_mul(sc[0],simd4f_add(xy,wz)),
+                           simd4f_mul(sc[0],simd4f_sub(xz,wy)),
+                           simd4f_zero() };
+        simd4f row1[4] = { simd4f_mul(sc[1],simd4f_sub(xy,wz)),
+                           simd4f_mul(sc[1],simd4f_sub(one,simd4f_add(xx,zz))),
+                           simd4f_mul(sc[1],simd4f_add(yz,wx)),
+                           simd4f_zero() };
+        simd4f row2[4] = { simd4f_mul(sc[2],simd4f_add(xz,wy)),
+                           simd4f_mul(sc[2],simd4f_sub(yz,wx)),
+                           simd4f_mul(sc[2],simd4f_sub(one,simd4f_add(xx,yy))),
+                           simd4f_zero() };
+
+        // back to one register per matrix row.
+        simd4f_transpose(row0[0],row0[1],row0[2],row0[3]);
+        simd4f_transpose(row1[0],row1[1],row1[2],row1[3]);
+        simd4f_transpose(row2[0],row2[1],row2[2],row2[3]);
+
+        for(unsigned int k=0;k<n;++k)
+        {
+            float* m = matrices[i+k].ptr();
+            simd4f_store(m,row0[k]);
+            simd4f_store(m+4,row1[k]);
+            simd4f_store(m+8,row2[k]);
+            simd4f_store(m+12,row3[k]);
+        }
+    }
+}
+
+void Quat::set( const Matrixd& m )
+{
+    set(Matrixf(m));
+}
+
+void Quat::get( Matrixd& m ) const
+{
+    Matrixf mf;
+    get(mf);
+    m.set(mf);
+}
+
 #ifdef OSG_USE_UNIT_TESTS
+
+#include <stdlib.h>
+#include <iostream>
+
+using namespace std;
+
 void test_Quat_Eueler(float heading,float pitch,float roll)
 {
     osg::Quat q;
@@ -332,13 +455,88 @@ void test_Quat_Eueler(float heading,float pitch,float roll)
     
 }
 
+// angle in radians between the rotations represented by two unit quaternions.
+static double angle_between(const osg::Quat& a,const osg::Quat& b)
+{
+    // atan2 of the chord lengths stays accurate for small angles, unlike acos of the dot product.
+    osg::Vec4 bv = (a.asVec4()*b.asVec4()<0.0f) ? -b.asVec4() : b.asVec4();
+    return 4.0*atan2((double)(a.asVec4()-bv).length(),(double)(a.asVec4()+bv).length());
+}
+
+static osg::Quat random_Quat()
+{
+    osg::Vec3 axis((float)rand()/RAND_MAX-0.5f,(float)rand()/RAND_MAX-0.5f,(float)rand()/RAND_MAX-0.5f);
+    if (axis.length2()==0.0f) axis.set(0.0f,0.0f,1.0f);
+    osg::Quat q;
+    q.makeRotate((float)rand()/RAND_MAX*2.0f*osg::PI,axis);
+    return q;
+}
+
+/** compare nlerp and approximateSlerp against slerp over random pairs
+  * of rotations, and getMatrices against the one at a time path.*/
+bool test_Quat_slerp()
+{
+    double max_nlerp = 0.0;
+    double max_approximate = 0.0;
+    for(unsigned int i=0;i<10000;++i)
+    {
+        osg::Quat from = random_Quat();
+        osg::Quat to = random_Quat();
+        for(unsigned int j=0;j<=20;++j)
+        {
+            float t = (float)j/20.0f;
+            osg::Quat reference, q;
+            reference.slerp(t,from,to);
+
+            q.nlerp(t,from,to);
+            double e = angle_between(reference,q);
+            if (e>max_nlerp) max_nlerp = e;
+
+            q.approximateSlerp(t,from,to);
+            e = angle_between(reference,q);
+            if (e>max_approximate) max_approximate = e;
+        }
+    }
+    cout << "nlerp max error "<<max_nlerp<<" radians"<<endl;
+    cout << "approximateSlerp max error "<<max_approximate<<" radians"<<endl;
+
+    const unsigned int num = 103;
+    osg::Quat rotations[num];
+    osg::Vec3 positions[num];
+    osg::Vec3 scales[num];
+    for(unsigned int i=0;i<num;++i)
+    {
+        rotations[i] = random_Quat();
+        positions[i].set(rand()%1000,rand()%1000,rand()%1000);
+        scales[i].set(0.5f+(float)rand()/RAND_MAX,0.5f+(float)rand()/RAND_MAX,0.5f+(float)rand()/RAND_MAX);
+    }
+    osg::Matrix matrices[num];
+    osg::Quat::getMatrices(rotations,positions,scales,matrices,num);
+
+    double max_matrix = 0.0;
+    for(unsigned int i=0;i<num;++i)
+    {
+        osg::Matrix reference = osg::Matrix::scale(scales[i])*rotations[i].getMatrix()*osg::Matrix::translate(positions[i]);
+        for(int row=0;row<4;++row)
+            for(int col=0;col<4;++col)
+            {
+                double e = fabs(reference(row,col)-matrices[i](row,col));
+                if (e>max_matrix) max_matrix = e;
+            }
+    }
+    cout << "getMatrices max error "<<max_matrix<<endl;
+
+    return max_nlerp<0.15 && max_approximate<0.001 && max_matrix<1e-4;
+}
+
 void test_Quat()
 {
 
-    test_Quat_Eueler(osg::DegreesToRadians(20),0,0);
-    test_Quat_Eueler(0,osg::DegreesToRadians(20),0);
-    test_Quat_Eueler(0,0,osg::DegreesToRadians(20));
-    test_Quat_Eueler(osg::DegreesToRadians(20),osg::DegreesToRadians(20),osg::DegreesToRadians(20));
-    return 0;
+    test_Quat_Eueler(osg::DegreesToRadians(20.0f),0,0);
+    test_Quat_Eueler(0,osg::DegreesToRadians(20.0f),0);
+    test_Quat_Eueler(0,0,osg::DegreesToRadians(20.0f));
+    test_Quat_Eueler(osg::DegreesToRadians(20.0f),osg::DegreesToRadians(20.0f),osg::DegreesToRadians(20.0f));
+
+    if (!test_Quat_slerp()) cout << "test_Quat_slerp() failed"<<endl;
 }
 #endif
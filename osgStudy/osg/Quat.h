@@ -227,6 +227,18 @@ class SG_EXPORT Quat
         /** Spherical Linear Interpolation.
 	    As t goes from 0 to 1, the Quat object goes from "from" to "to". */
         void slerp   ( const float t, const Quat& from, const Quat& to);
+
+        /** Normalised Linear Interpolation.
+            Follows the same arc as slerp, taking the shorter way round, but
+            the angular velocity is not constant so mid way values lag or lead
+            slerp by up to 0.15 radians.  Much cheaper than slerp.*/
+        void nlerp   ( const float t, const Quat& from, const Quat& to);
+
+        /** Approximate Spherical Linear Interpolation.
+            nlerp with t corrected to match slerp's constant angular velocity,
+            the result stays within 0.001 radians of slerp for unit quaternions
+            and needs no trigonometric functions.*/
+        void approximateSlerp ( const float t, const Quat& from, const Quat& to);
         
         /** Set quaternion to be equivalent to specified matrix.*/
         void set( const Matrix& m );
@@ -234,6 +246,19 @@ class SG_EXPORT Quat
         /** Get the equivalent matrix for this quaternion.*/
         void get( Matrix& m ) const;
 
+        /** Set quaternion to be equivalent to specified double precision matrix.*/
+        void set( const Matrixd& m );
+
+        /** Get the equivalent double precision matrix for this quaternion.*/
+        void get( Matrixd& m ) const;
+
+        /** Convert num rotations to matrices in one go, each matrix being
+            Matrix::scale(scales[i])*rotations[i].getMatrix()*Matrix::translate(positions[i]).
+            positions and scales may be NULL, in which case no translation or
+            scale is applied.  Uses the SIMD kernels, four quaternions at a time.*/
+        static void getMatrices( const Quat* rotations, const Vec3* positions, const Vec3* scales,
+                                 Matrix* matrices, unsigned int num );
+
         /** Get the equivalent matrix for this quaternion.*/
         Matrix getMatrix() const
         {
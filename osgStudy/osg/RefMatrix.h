@@ -0,0 +1,38 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_REFMATRIX
+#define OSG_REFMATRIX 1
+
+#include <osg/Object.h>
+#include <osg/Matrix.h>
+#include <osg/MemoryPool.h>
+
+namespace osg {
+
+/** Reference counted Matrix, for the cases where a matrix really needs to
+  * be shared between several owners. Prefer holding a plain Matrix by value.*/
+class SG_EXPORT RefMatrix : public Object, public Matrix
+{
+    public:
+
+        RefMatrix():Object(),Matrix() {}
+        RefMatrix( const Matrix& other) : Object(), Matrix(other) {}
+        RefMatrix( const RefMatrix& other,const CopyOp& copyop=CopyOp::SHALLOW_COPY) : Object(other,copyop), Matrix(other) {}
+        explicit RefMatrix( Matrix::value_type const * const def ):Object(), Matrix(def) {}
+
+        META_Object(osg,RefMatrix);
+
+        META_PoolAllocated
+
+        inline RefMatrix& operator = (const Matrix& other) { Matrix::operator=(other); return *this; }
+
+    protected:
+
+        virtual ~RefMatrix() {}
+};
+
+}
+
+#endif
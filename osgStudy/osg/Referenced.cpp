@@ -0,0 +1,220 @@
+#include <osg/Referenced.h>
+#include <osg/Observer.h>
+#include <osg/Notify.h>
+#include <typeinfo>
+
+using namespace osg;
+
+Referenced::~Referenced()
+{
+    if (referenceCount()>0)
+    {
+        OSG_NOTIFY(WARN)<<"Warning: deleting still referenced object "<<this<<" of type '"<<typeid(this).name()<<"'"<<std::endl;
+        OSG_NOTIFY(WARN)<<"         the final reference count was "<<referenceCount()<<", memory corruption possible."<<std::endl;
+    }
+
+    // objects deleted directly rather than through unref() still tell their observers.
+    ObserverSet* observerSet = getObserverSet();
+    if (observerSet)
+    {
+        observerSet->signalObjectDeleted();
+        observerSet->unref();
+    }
+}
+
+void Referenced::signalObserversAndDelete() const
+{
+    // clear the observers before any destructor runs, so that none of them can
+    // take a reference to a partly destroyed object.
+    ObserverSet* observerSet = getObserverSet();
+    if (observerSet) observerSet->signalObjectDeleted();
+    delete this;
+}
+
+ObserverSet* Referenced::getOrCreateObserverSet() const
+{
+#ifdef OSG_REFERENCED_NON_ATOMIC
+    if (!_observerSet)
+    {
+        _observerSet = osgNew ObserverSet(this);
+        _observerSet->ref();
+    }
+    return _observerSet;
+#else
+    ObserverSet* observerSet = _observerSet.load(std::memory_order_acquire);
+    if (observerSet) return observerSet;
+
+    ObserverSet* newObserverSet = osgNew ObserverSet(this);
+    newObserverSet->ref();
+    if (_observerSet.compare_exchange_strong(observerSet,newObserverSet,std::memory_order_acq_rel))
+    {
+        return newObserverSet;
+    }
+
+    // another thread created the set first, observerSet now holds it.
+    newObserverSet->unref();
+    return observerSet;
+#endif
+}
+
+const bool Referenced::isThreadSafe()
+{
+#ifdef OSG_REFERENCED_NON_ATOMIC
+    return false;
+#else
+    return true;
+#endif
+}
+
+void Referenced::addObserver(Observer* observer) const
+{
+    getOrCreateObserverSet()->addObserver(observer);
+}
+
+void Referenced::removeObserver(Observer* observer) const
+{
+    ObserverSet* observerSet = getObserverSet();
+    if (observerSet) observerSet->removeObserver(observer);
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/Timer.h>
+#include <osg/ref_ptr.h>
+#include <osg/observer_ptr.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static void refLoop(const Referenced* object, unsigned int numIterations)
+{
+    for(unsigned int i=0;i<numIterations;++i)
+    {
+        object->ref();
+        object->unref();
+    }
+}
+
+static double timeRefLoops(const std::vector< ref_ptr<Referenced> >& objects, unsigned int numIterations)
+{
+    Timer timer;
+    Timer_t t0 = timer.tick();
+    std::vector<std::thread> threads;
+    for(unsigned int t=0;t<objects.size();++t)
+    {
+        threads.push_back(std::thread(refLoop,objects[t].get(),numIterations));
+    }
+    for(unsigned int t=0;t<threads.size();++t) threads[t].join();
+    return timer.delta_m(t0,timer.tick());
+}
+
+/** Time numIterations ref/unref pairs on each of numThreads threads, first with
+  * every thread on its own object, then with all of them on one shared object,
+  * where the atomic count makes the threads contend for the same cache line.
+  * The shared pass is skipped when OSG_REFERENCED_NON_ATOMIC is defined, it would race.*/
+void benchmark_Referenced(unsigned int numThreads, unsigned int numIterations)
+{
+    std::vector< ref_ptr<Referenced> > separate(numThreads);
+    for(unsigned int t=0;t<numThreads;++t) separate[t] = osgNew Referenced;
+    double separateTime = timeRefLoops(separate,numIterations);
+
+    std::cout<<"Referenced "<<(Referenced::isThreadSafe()?"atomic":"non atomic")<<", "<<numThreads<<" threads x "<<numIterations<<" ref/unref pairs"<<std::endl;
+    std::cout<<"  separate objects "<<separateTime<<"ms ("<<separateTime*1e6/numIterations<<"ns per pair)";
+
+    if (Referenced::isThreadSafe())
+    {
+        std::vector< ref_ptr<Referenced> > shared(numThreads,osgNew Referenced);
+        double sharedTime = timeRefLoops(shared,numIterations);
+        std::cout<<"  shared object "<<sharedTime<<"ms ("<<sharedTime*1e6/numIterations<<"ns per pair)";
+        if (shared[0]->referenceCount()!=(int)numThreads) std::cout<<"  FAILED, count "<<shared[0]->referenceCount();
+    }
+    std::cout<<std::endl;
+}
+
+/** Check that an observer_ptr follows its object's lifetime, also while other
+  * threads are locking it as the last reference is released.*/
+void test_observer_ptr(unsigned int numThreads, unsigned int numObjects)
+{
+    bool passed = true;
+
+    ref_ptr<Referenced> object = osgNew Referenced;
+    observer_ptr<Referenced> observer(object);
+    passed = passed && !observer.expired() && observer.lock()==object;
+    passed = passed && object->referenceCount()==1;
+
+    ref_ptr<Referenced> moved(std::move(object));
+    passed = passed && !object.valid() && moved->referenceCount()==1;
+    moved = 0;
+    passed = passed && observer.expired() && !observer.lock().valid();
+
+    // race lock() against the release of the last reference, a successful lock
+    // must always find a live object, checked through its reference count.
+    // A plain int count cannot be shared between threads, so stay on this one.
+    if (!Referenced::isThreadSafe()) numThreads = 0;
+    unsigned int numLocked = 0;
+    for(unsigned int i=0;i<numObjects && passed;++i)
+    {
+        ref_ptr<Referenced> raced = osgNew Referenced;
+        observer_ptr<Referenced> racedObserver(raced);
+        std::vector<std::thread> threads;
+        std::vector<int> locked(numThreads,0);
+        for(unsigned int t=0;t<numThreads;++t)
+        {
+            threads.push_back(std::thread([&racedObserver,&locked,t]()
+            {
+                for(int attempt=0;attempt<100;++attempt)
+                {
+                    ref_ptr<Referenced> strong = racedObserver.lock();
+                    if (strong.valid())
+                    {
+                        if (strong->referenceCount()<1) locked[t] = -1000000;
+                        ++locked[t];
+                    }
+                }
+            }));
+        }
+        raced = 0;
+        for(unsigned int t=0;t<numThreads;++t)
+        {
+            threads[t].join();
+            if (locked[t]<0) passed = false;
+            else numLocked += locked[t];
+        }
+        passed = passed && racedObserver.expired();
+    }
+
+    std::cout<<"observer_ptr "<<numObjects<<" objects raced on "<<numThreads<<" threads, "<<numLocked<<" locks"<<(passed?"  OK":"  FAILED")<<std::endl;
+}
+
+/** An Observer counting the deletions it sees.*/
+struct CountingObserver : public Observer
+{
+    CountingObserver() : _numDeleted(0) {}
+    virtual void objectDeleted(Referenced*) { ++_numDeleted; }
+    int _numDeleted;
+};
+
+/** Check that observers are told of each deletion once, and not after being removed.*/
+void test_Observer()
+{
+    CountingObserver observer;
+    CountingObserver removed;
+
+    ref_ptr<Referenced> first = osgNew Referenced;
+    ref_ptr<Referenced> second = osgNew Referenced;
+    bool passed = first->getObserverSet()==0;
+
+    first->addObserver(&observer);
+    second->addObserver(&observer);
+    second->addObserver(&removed);
+    second->removeObserver(&removed);
+    passed = passed && first->getObserverSet()!=0;
+
+    first = 0;
+    second = 0;
+    passed = passed && observer._numDeleted==2 && removed._numDeleted==0;
+
+    std::cout<<"Observer"<<(passed?"  OK":"  FAILED")<<std::endl;
+}
+
+#endif
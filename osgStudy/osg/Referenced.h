@@ -7,27 +7,39 @@
 
 #include <osg/Export.h>
 
+/* The reference count is atomic so that objects can be shared between threads,
+ * taking a reference is relaxed and releasing one is an acquire/release decrement.
+ * Define OSG_REFERENCED_NON_ATOMIC in single threaded builds to count with a plain
+ * int instead.*/
+#ifndef OSG_REFERENCED_NON_ATOMIC
+    #include <atomic>
+#endif
+
 namespace osg {
 
+class Observer;
+class ObserverSet;
+
 /** Base class from providing referencing counted objects.*/
 class SG_EXPORT Referenced
 {
 
     public:
-        Referenced() { _refCount=0; }
-        Referenced(const Referenced&) { _refCount=0; }
+        Referenced() : _refCount(0), _observerSet(0) { markAllocation(); }
+        Referenced(const Referenced&) : _refCount(0), _observerSet(0) { markAllocation(); }
 
         inline Referenced& operator = (Referenced&) { return *this; }
 
         /** increment the reference count by one, indicating that 
-            this object has another pointer which is referencing it.*/
-        inline void ref() const { ++_refCount; }
+            this object has another pointer which is referencing it.
+            Return the new reference count.*/
+        inline int ref() const;
         
         /** decrement the reference count by one, indicating that 
             a pointer to this object is referencing it.  If the
             reference count goes to zero, it is assumed that this object
             is no longer referenced and is automatically deleted.*/
-        inline void unref() const { --_refCount; if (_refCount<=0) delete this; }
+        inline void unref() const;
         
         /** decrement the reference count by one, indicating that 
             a pointer to this object is referencing it.  However, do
@@ -35,17 +47,87 @@ class SG_EXPORT Referenced
             should only be called if the user knows exactly who will
             be resonsible for, one should prefer unref() over unref_nodelete() 
             as the later can lead to memory leaks.*/
-        inline void unref_nodelete() const { --_refCount; }
+        inline void unref_nodelete() const;
         
         /** return the number pointers currently referencing this object. */
-        inline const int referenceCount() const { return _refCount; }
+        inline const int referenceCount() const;
+
+        /** return true if the reference count is atomic, see OSG_REFERENCED_NON_ATOMIC.*/
+        static const bool isThreadSafe();
+
+        /** get the set of observers watching this object, creating it the first time
+            the object is observed, so that objects never observed do not pay for one.*/
+        ObserverSet* getOrCreateObserverSet() const;
+
+        /** get the set of observers, 0 if this object has never been observed.*/
+        inline ObserverSet* getObserverSet() const;
+
+        /** add an Observer to be told when this object is deleted.*/
+        void addObserver(Observer* observer) const;
+
+        /** remove an Observer previously added with addObserver().*/
+        void removeObserver(Observer* observer) const;
 
     protected:
         virtual ~Referenced();
+
+        /** tell the observers that this object is going, and delete it.*/
+        void signalObserversAndDelete() const;
+
+        /** let the memory manager report the allocation holding this object by class.*/
+        inline void markAllocation()
+        {
+#ifdef OSG_USE_MEMORY_MANAGER
+            m_markReferenced(this);
+#endif
+        }
+
+#ifdef OSG_REFERENCED_NON_ATOMIC
         mutable int _refCount;
+        mutable ObserverSet* _observerSet;
+#else
+        mutable std::atomic<int> _refCount;
+        mutable std::atomic<ObserverSet*> _observerSet;
+#endif
 
 };
 
+#ifdef OSG_REFERENCED_NON_ATOMIC
+
+inline int Referenced::ref() const { return ++_refCount; }
+
+inline void Referenced::unref() const { --_refCount; if (_refCount<=0) signalObserversAndDelete(); }
+
+inline void Referenced::unref_nodelete() const { --_refCount; }
+
+inline const int Referenced::referenceCount() const { return _refCount; }
+
+inline ObserverSet* Referenced::getObserverSet() const { return _observerSet; }
+
+#else
+
+// the caller already holds a reference, so taking another needs no ordering.
+inline int Referenced::ref() const { return _refCount.fetch_add(1,std::memory_order_relaxed)+1; }
+
+// release orders this thread's use of the object before the deletion, acquire
+// orders every other thread's use before it. A separate acquire fence on the last
+// reference only would save little and is not understood by thread sanitizers.
+inline void Referenced::unref() const
+{
+    if (_refCount.fetch_sub(1,std::memory_order_acq_rel)<=1)
+    {
+        signalObserversAndDelete();
+    }
+}
+
+inline void Referenced::unref_nodelete() const { _refCount.fetch_sub(1,std::memory_order_release); }
+
+inline const int Referenced::referenceCount() const { return _refCount.load(std::memory_order_relaxed); }
+
+inline ObserverSet* Referenced::getObserverSet() const { return _observerSet.load(std::memory_order_acquire); }
+
+#endif
+
 }
 
 #endif
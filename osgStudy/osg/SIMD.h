@@ -0,0 +1,167 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_SIMD
+#define OSG_SIMD 1
+
+/** Thin four wide float vector abstraction used by the maths kernels.
+  * The instruction set is chosen at compile time:
+  *   OSG_SIMD_SSE2 - x86/x64 with SSE2 (also used for AVX builds, the
+  *                   compiler emits VEX encoded versions of the same ops).
+  *   OSG_SIMD_NEON - ARM with NEON.
+  *   neither       - plain C++ scalar fallback.
+  * Define OSG_SIMD_DISABLE to force the scalar fallback, useful when
+  * comparing results against the reference implementations.*/
+
+#if !defined(OSG_SIMD_DISABLE)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+        #define OSG_SIMD_SSE2 1
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #define OSG_SIMD_NEON 1
+    #endif
+#endif
+
+#if defined(OSG_SIMD_SSE2)
+    #include <emmintrin.h>
+#elif defined(OSG_SIMD_NEON)
+    #include <arm_neon.h>
+#endif
+
+namespace osg {
+
+#if defined(OSG_SIMD_SSE2)
+
+typedef __m128 simd4f;
+
+inline simd4f simd4f_load(const float* ptr) { return _mm_loadu_ps(ptr); }
+inline void   simd4f_store(float* ptr,simd4f v) { _mm_storeu_ps(ptr,v); }
+inline simd4f simd4f_set(float x,float y,float z,float w) { return _mm_setr_ps(x,y,z,w); }
+inline simd4f simd4f_splat(float f) { return _mm_set1_ps(f); }
+inline simd4f simd4f_zero() { return _mm_setzero_ps(); }
+inline simd4f simd4f_add(simd4f a,simd4f b) { return _mm_add_ps(a,b); }
+inline simd4f simd4f_sub(simd4f a,simd4f b) { return _mm_sub_ps(a,b); }
+inline simd4f simd4f_mul(simd4f a,simd4f b) { return _mm_mul_ps(a,b); }
+inline simd4f simd4f_div(simd4f a,simd4f b) { return _mm_div_ps(a,b); }
+/** return a*b+c.*/
+inline simd4f simd4f_madd(simd4f a,simd4f b,simd4f c) { return _mm_add_ps(_mm_mul_ps(a,b),c); }
+/** load x,y,z leaving w as 0, without touching ptr[3].*/
+inline simd4f simd4f_load3(const float* ptr) { return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)ptr)),_mm_load_ss(ptr+2)); }
+/** store x,y,z without touching ptr[3].*/
+inline void   simd4f_store3(float* ptr,simd4f v) { _mm_storel_pi((__m64*)ptr,v); _mm_store_ss(ptr+2,_mm_movehl_ps(v,v)); }
+/** transpose the 4x4 matrix held in rows r0..r3.*/
+inline void   simd4f_transpose(simd4f& r0,simd4f& r1,simd4f& r2,simd4f& r3) { _MM_TRANSPOSE4_PS(r0,r1,r2,r3); }
+
+/** four lane bit mask, the comparisons set all the bits of a lane where they hold.*/
+typedef __m128i simd4i;
+
+inline simd4i simd4i_splat(unsigned int i) { return _mm_set1_epi32((int)i); }
+inline void   simd4i_store(unsigned int* ptr,simd4i v) { _mm_storeu_si128((__m128i*)ptr,v); }
+inline simd4i simd4i_and(simd4i a,simd4i b) { return _mm_and_si128(a,b); }
+inline simd4i simd4i_or(simd4i a,simd4i b) { return _mm_or_si128(a,b); }
+/** return a with the bits set in b cleared.*/
+inline simd4i simd4i_andnot(simd4i a,simd4i b) { return _mm_andnot_si128(b,a); }
+/** return the top bit of each lane packed into bits 0..3.*/
+inline int    simd4i_movemask(simd4i v) { return _mm_movemask_ps(_mm_castsi128_ps(v)); }
+inline simd4i simd4f_cmpgt(simd4f a,simd4f b) { return _mm_castps_si128(_mm_cmpgt_ps(a,b)); }
+inline simd4i simd4f_cmplt(simd4f a,simd4f b) { return _mm_castps_si128(_mm_cmplt_ps(a,b)); }
+
+#elif defined(OSG_SIMD_NEON)
+
+typedef float32x4_t simd4f;
+
+inline simd4f simd4f_load(const float* ptr) { return vld1q_f32(ptr); }
+inline void   simd4f_store(float* ptr,simd4f v) { vst1q_f32(ptr,v); }
+inline simd4f simd4f_set(float x,float y,float z,float w) { float v[4] = {x,y,z,w}; return vld1q_f32(v); }
+inline simd4f simd4f_splat(float f) { return vdupq_n_f32(f); }
+inline simd4f simd4f_zero() { return vdupq_n_f32(0.0f); }
+inline simd4f simd4f_add(simd4f a,simd4f b) { return vaddq_f32(a,b); }
+inline simd4f simd4f_sub(simd4f a,simd4f b) { return vsubq_f32(a,b); }
+inline simd4f simd4f_mul(simd4f a,simd4f b) { return vmulq_f32(a,b); }
+inline simd4f simd4f_div(simd4f a,simd4f b) { float va[4],vb[4]; vst1q_f32(va,a); vst1q_f32(vb,b); return simd4f_set(va[0]/vb[0],va[1]/vb[1],va[2]/vb[2],va[3]/vb[3]); }
+/** return a*b+c.*/
+inline simd4f simd4f_madd(simd4f a,simd4f b,simd4f c) { return vmlaq_f32(c,a,b); }
+/** load x,y,z leaving w as 0, without touching ptr[3].*/
+inline simd4f simd4f_load3(const float* ptr) { return vcombine_f32(vld1_f32(ptr),vld1_lane_f32(ptr+2,vdup_n_f32(0.0f),0)); }
+/** store x,y,z without touching ptr[3].*/
+inline void   simd4f_store3(float* ptr,simd4f v) { vst1_f32(ptr,vget_low_f32(v)); vst1q_lane_f32(ptr+2,v,2); }
+/** transpose the 4x4 matrix held in rows r0..r3.*/
+inline void   simd4f_transpose(simd4f& r0,simd4f& r1,simd4f& r2,simd4f& r3)
+{
+    float32x4x2_t t01 = vtrnq_f32(r0,r1);
+    float32x4x2_t t23 = vtrnq_f32(r2,r3);
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]),vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]),vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]),vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]),vget_high_f32(t23.val[1]));
+}
+
+/** four lane bit mask, the comparisons set all the bits of a lane where they hold.*/
+typedef uint32x4_t simd4i;
+
+inline simd4i simd4i_splat(unsigned int i) { return vdupq_n_u32(i); }
+inline void   simd4i_store(unsigned int* ptr,simd4i v) { vst1q_u32(ptr,v); }
+inline simd4i simd4i_and(simd4i a,simd4i b) { return vandq_u32(a,b); }
+inline simd4i simd4i_or(simd4i a,simd4i b) { return vorrq_u32(a,b); }
+/** return a with the bits set in b cleared.*/
+inline simd4i simd4i_andnot(simd4i a,simd4i b) { return vbicq_u32(a,b); }
+/** return the top bit of each lane packed into bits 0..3.*/
+inline int    simd4i_movemask(simd4i v)
+{
+    static const int shifts[4] = {0,1,2,3};
+    uint32x4_t bits = vshlq_u32(vshrq_n_u32(v,31),vld1q_s32(shifts));
+    uint32x2_t sum = vadd_u32(vget_low_u32(bits),vget_high_u32(bits));
+    return (int)vget_lane_u32(vpadd_u32(sum,sum),0);
+}
+inline simd4i simd4f_cmpgt(simd4f a,simd4f b) { return vcgtq_f32(a,b); }
+inline simd4i simd4f_cmplt(simd4f a,simd4f b) { return vcltq_f32(a,b); }
+
+#else
+
+struct simd4f { float v[4]; };
+
+inline simd4f simd4f_load(const float* ptr) { simd4f r; r.v[0]=ptr[0]; r.v[1]=ptr[1]; r.v[2]=ptr[2]; r.v[3]=ptr[3]; return r; }
+inline void   simd4f_store(float* ptr,simd4f a) { ptr[0]=a.v[0]; ptr[1]=a.v[1]; ptr[2]=a.v[2]; ptr[3]=a.v[3]; }
+inline simd4f simd4f_set(float x,float y,float z,float w) { simd4f r; r.v[0]=x; r.v[1]=y; r.v[2]=z; r.v[3]=w; return r; }
+inline simd4f simd4f_splat(float f) { return simd4f_set(f,f,f,f); }
+inline simd4f simd4f_zero() { return simd4f_splat(0.0f); }
+inline simd4f simd4f_add(simd4f a,simd4f b) { return simd4f_set(a.v[0]+b.v[0],a.v[1]+b.v[1],a.v[2]+b.v[2],a.v[3]+b.v[3]); }
+inline simd4f simd4f_sub(simd4f a,simd4f b) { return simd4f_set(a.v[0]-b.v[0],a.v[1]-b.v[1],a.v[2]-b.v[2],a.v[3]-b.v[3]); }
+inline simd4f simd4f_mul(simd4f a,simd4f b) { return simd4f_set(a.v[0]*b.v[0],a.v[1]*b.v[1],a.v[2]*b.v[2],a.v[3]*b.v[3]); }
+inline simd4f simd4f_div(simd4f a,simd4f b) { return simd4f_set(a.v[0]/b.v[0],a.v[1]/b.v[1],a.v[2]/b.v[2],a.v[3]/b.v[3]); }
+/** return a*b+c.*/
+inline simd4f simd4f_madd(simd4f a,simd4f b,simd4f c) { return simd4f_set(a.v[0]*b.v[0]+c.v[0],a.v[1]*b.v[1]+c.v[1],a.v[2]*b.v[2]+c.v[2],a.v[3]*b.v[3]+c.v[3]); }
+/** load x,y,z leaving w as 0, without touching ptr[3].*/
+inline simd4f simd4f_load3(const float* ptr) { return simd4f_set(ptr[0],ptr[1],ptr[2],0.0f); }
+/** store x,y,z without touching ptr[3].*/
+inline void   simd4f_store3(float* ptr,simd4f a) { ptr[0]=a.v[0]; ptr[1]=a.v[1]; ptr[2]=a.v[2]; }
+/** transpose the 4x4 matrix held in rows r0..r3.*/
+inline void   simd4f_transpose(simd4f& r0,simd4f& r1,simd4f& r2,simd4f& r3)
+{
+    simd4f c0 = simd4f_set(r0.v[0],r1.v[0],r2.v[0],r3.v[0]);
+    simd4f c1 = simd4f_set(r0.v[1],r1.v[1],r2.v[1],r3.v[1]);
+    simd4f c2 = simd4f_set(r0.v[2],r1.v[2],r2.v[2],r3.v[2]);
+    simd4f c3 = simd4f_set(r0.v[3],r1.v[3],r2.v[3],r3.v[3]);
+    r0 = c0; r1 = c1; r2 = c2; r3 = c3;
+}
+
+/** four lane bit mask, the comparisons set all the bits of a lane where they hold.*/
+struct simd4i { unsigned int v[4]; };
+
+inline simd4i simd4i_set(unsigned int x,unsigned int y,unsigned int z,unsigned int w) { simd4i r; r.v[0]=x; r.v[1]=y; r.v[2]=z; r.v[3]=w; return r; }
+inline simd4i simd4i_splat(unsigned int i) { return simd4i_set(i,i,i,i); }
+inline void   simd4i_store(unsigned int* ptr,simd4i a) { ptr[0]=a.v[0]; ptr[1]=a.v[1]; ptr[2]=a.v[2]; ptr[3]=a.v[3]; }
+inline simd4i simd4i_and(simd4i a,simd4i b) { return simd4i_set(a.v[0]&b.v[0],a.v[1]&b.v[1],a.v[2]&b.v[2],a.v[3]&b.v[3]); }
+inline simd4i simd4i_or(simd4i a,simd4i b) { return simd4i_set(a.v[0]|b.v[0],a.v[1]|b.v[1],a.v[2]|b.v[2],a.v[3]|b.v[3]); }
+/** return a with the bits set in b cleared.*/
+inline simd4i simd4i_andnot(simd4i a,simd4i b) { return simd4i_set(a.v[0]&~b.v[0],a.v[1]&~b.v[1],a.v[2]&~b.v[2],a.v[3]&~b.v[3]); }
+/** return the top bit of each lane packed into bits 0..3.*/
+inline int    simd4i_movemask(simd4i a) { return (int)((a.v[0]>>31)|((a.v[1]>>31)<<1)|((a.v[2]>>31)<<2)|((a.v[3]>>31)<<3)); }
+inline simd4i simd4f_cmpgt(simd4f a,simd4f b) { return simd4i_set(a.v[0]>b.v[0]?~0u:0u,a.v[1]>b.v[1]?~0u:0u,a.v[2]>b.v[2]?~0u:0u,a.v[3]>b.v[3]?~0u:0u); }
+inline simd4i simd4f_cmplt(simd4f a,simd4f b) { return simd4i_set(a.v[0]<b.v[0]?~0u:0u,a.v[1]<b.v[1]?~0u:0u,a.v[2]<b.v[2]?~0u:0u,a.v[3]<b.v[3]?~0u:0u); }
+
+#endif
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <osg/Export.h>
 #include <osg/Object.h>
+#include <osg/MemoryPool.h>
 #include <osg/GL.h>
 
 #include <typeinfo>
@@ -153,6 +154,9 @@ class SG_EXPORT StateAttribute : public Object
         
         StateAttribute(const StateAttribute& sa,const CopyOp& copyop=CopyOp::SHALLOW_COPY): 
             Object(sa,copyop) {}
+
+        /** State attributes are allocated from the MemoryPool.*/
+        META_PoolAllocated
         
 
         /** Clone the type of an attribute, with Object* return type.
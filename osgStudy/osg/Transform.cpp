@@ -2,14 +2,14 @@
 
 using namespace osg;
 
+Transform::InverseStats Transform::s_inverseStats;
+
 Transform::Transform()
 {
     _referenceFrame = RELATIVE_TO_PARENTS;
 
 #ifdef USE_DEPRECATED_API
-    _deprecated_matrix = osgNew Matrix;
-    _deprecated_inverse = osgNew Matrix;
-    _deprecated_inverseDirty = false;
+    _deprecated_inverseState = INVERSE_VALID;
 #endif
 }
 
@@ -19,21 +19,20 @@ Transform::Transform(const Transform& transform,const CopyOp& copyop):
     _referenceFrame(transform._referenceFrame)
 #ifdef USE_DEPRECATED_API
     ,
-    _deprecated_matrix(osgNew Matrix(*transform._deprecated_matrix)),
-    _deprecated_inverse(osgNew Matrix(*transform._deprecated_inverse)),
-    _deprecated_inverseDirty(transform._deprecated_inverseDirty)
+    _deprecated_matrix(transform._deprecated_matrix),
+    _deprecated_inverse(transform._deprecated_inverse),
+    _deprecated_inverseState(transform._deprecated_inverseState.load()==INVERSE_VALID ? INVERSE_VALID : INVERSE_DIRTY)
 #endif
 {    
 }
 
 #ifdef USE_DEPRECATED_API
-Transform::Transform(const Matrix& mat )
+Transform::Transform(const Matrix& mat ):
+    _deprecated_matrix(mat)
 {
     _referenceFrame = RELATIVE_TO_PARENTS;
 
-    _deprecated_matrix = osgNew Matrix(mat);
-    _deprecated_inverse = osgNew Matrix();
-    _deprecated_inverseDirty = false;
+    dirtyInverse();
 }
 #endif
 
@@ -8,6 +8,9 @@
 #include <osg/Group.h>
 #include <osg/Matrix.h>
 
+#include <atomic>
+#include <thread>
+
 namespace osg {
 
 /** Transform - is group which all children are transformed by the the Transform's osg::Matrix.  
@@ -83,6 +86,36 @@ class SG_EXPORT Transform : public Group
 
 
 
+        /** Counters for the lazily computed inverse matrices, shared by all transforms.
+          * Setting or multiplying a matrix only marks its inverse dirty, the inverse
+          * is computed when computeWorldToLocalMatrix() next needs it. Atomic, as
+          * traversals on several threads may compute inverses at once.*/
+        struct InverseStats
+        {
+            InverseStats():_numDirtied(0),_numComputed(0) {}
+
+            /** number of matrix updates, each of which used to invert straight away.*/
+            std::atomic<unsigned int> _numDirtied;
+            /** number of inversions actually computed.*/
+            std::atomic<unsigned int> _numComputed;
+
+            unsigned int getNumAvoided() const
+            {
+                unsigned int numDirtied = _numDirtied.load(std::memory_order_relaxed);
+                unsigned int numComputed = _numComputed.load(std::memory_order_relaxed);
+                return numDirtied>numComputed ? numDirtied-numComputed : 0;
+            }
+
+            void reset()
+            {
+                _numDirtied.store(0,std::memory_order_relaxed);
+                _numComputed.store(0,std::memory_order_relaxed);
+            }
+        };
+
+        static const InverseStats& getInverseStats() { return s_inverseStats; }
+        static void resetInverseStats() { s_inverseStats.reset(); }
+
         /** Get the transformation matrix which moves from local coords to world coords.
           * Return true if Matrix passed in has been modified and */
         inline const bool getLocalToWorldMatrix(Matrix& matrix,NodeVisitor* nv) const
@@ -136,39 +169,40 @@ class SG_EXPORT Transform : public Group
 #else
 
         /** Set the transform's matrix.*/
-        void setMatrix(const Matrix& mat) { (*_deprecated_matrix) = mat; _deprecated_inverseDirty=true; computeInverse(); dirtyBound(); }
+        void setMatrix(const Matrix& mat) { _deprecated_matrix = mat; dirtyInverse(); dirtyBound(); }
         
         /** Get the transform's matrix. */
-        inline const Matrix& getMatrix() const { return *_deprecated_matrix; }
+        inline const Matrix& getMatrix() const { return _deprecated_matrix; }
 
         /** preMult transform.*/
-        void preMult(const Matrix& mat) { _deprecated_matrix->preMult(mat); _deprecated_inverseDirty=true; computeInverse(); dirtyBound(); }
+        void preMult(const Matrix& mat) { _deprecated_matrix.preMult(mat); dirtyInverse(); dirtyBound(); }
         
         /** postMult transform.*/
-        void postMult(const Matrix& mat)  { _deprecated_matrix->postMult(mat); _deprecated_inverseDirty=true; computeInverse(); dirtyBound(); }
+        void postMult(const Matrix& mat)  { _deprecated_matrix.postMult(mat); dirtyInverse(); dirtyBound(); }
     
         virtual const bool computeLocalToWorldMatrix(Matrix& matrix,NodeVisitor*) const
         {
             if (_referenceFrame==RELATIVE_TO_PARENTS)
             {
-                matrix.preMult(*_deprecated_matrix);
+                matrix.preMult(_deprecated_matrix);
             }
             else // absolute
             {
-                matrix = *_deprecated_matrix;
+                matrix = _deprecated_matrix;
             }
             return true;
         }
 
         virtual const bool computeWorldToLocalMatrix(Matrix& matrix,NodeVisitor*) const
         {
+            computeInverse();
             if (_referenceFrame==RELATIVE_TO_PARENTS)
             {
-                matrix.postMult(*_deprecated_inverse);
+                matrix.postMult(_deprecated_inverse);
             }
             else // absolute
             {
-                matrix = *_deprecated_inverse;
+                matrix = _deprecated_inverse;
             }
             return true;
         }
@@ -191,19 +225,53 @@ class SG_EXPORT Transform : public Group
 
         ReferenceFrame                      _referenceFrame;
 
-#ifdef USE_DEPRECATED_API
-        inline void computeInverse() const
+        static InverseStats                 s_inverseStats;
+
+        /** State of a lazily computed inverse, held in an atomic per transform.*/
+        enum InverseState
+        {
+            INVERSE_VALID,
+            INVERSE_DIRTY,
+            INVERSE_COMPUTING
+        };
+
+        /** Mark inverse as needing to be recomputed from its matrix. Like the
+          * matrix itself, only to be changed while no traversal reads it.*/
+        static inline void dirtyLazyInverse(std::atomic<unsigned char>& inverseState)
+        {
+            inverseState.store(INVERSE_DIRTY,std::memory_order_release);
+            s_inverseStats._numDirtied.fetch_add(1,std::memory_order_relaxed);
+        }
+
+        /** Invert matrix into inverse if it is dirty. Cull and pick traversals
+          * on several threads may ask at once, the one which moves the state
+          * from dirty to computing inverts it while the others yield until it
+          * is published as valid, the acquire load ordering their reads of
+          * inverse after the write. Transforms never wait on one another.*/
+        static inline void computeLazyInverse(const Matrix& matrix,Matrix& inverse,std::atomic<unsigned char>& inverseState)
         {
-            if (_deprecated_inverseDirty)
+            for(;;)
             {
-                _deprecated_inverse->invert(*_deprecated_matrix);
-                _deprecated_inverseDirty = false;
+                unsigned char state = inverseState.load(std::memory_order_acquire);
+                if (state==INVERSE_VALID) return;
+                if (state==INVERSE_DIRTY &&
+                    inverseState.compare_exchange_weak(state,INVERSE_COMPUTING,std::memory_order_acquire)) break;
+                std::this_thread::yield();
             }
+
+            inverse.invert(matrix);
+            inverseState.store(INVERSE_VALID,std::memory_order_release);
+            s_inverseStats._numComputed.fetch_add(1,std::memory_order_relaxed);
         }
 
-        ref_ptr<Matrix>                     _deprecated_matrix;
-        mutable ref_ptr<Matrix>             _deprecated_inverse;
-        mutable bool                        _deprecated_inverseDirty;        
+#ifdef USE_DEPRECATED_API
+        inline void dirtyInverse() { dirtyLazyInverse(_deprecated_inverseState); }
+
+        inline void computeInverse() const { computeLazyInverse(_deprecated_matrix,_deprecated_inverse,_deprecated_inverseState); }
+
+        Matrix                              _deprecated_matrix;
+        mutable Matrix                      _deprecated_inverse;
+        mutable std::atomic<unsigned char>  _deprecated_inverseState;
 #endif
 
 };
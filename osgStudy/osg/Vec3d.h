@@ -0,0 +1,187 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_VEC3D
+#define OSG_VEC3D 1
+
+#include <osg/Vec3.h>
+
+#include <iostream>
+
+namespace osg {
+
+/** Double precision counterpart of Vec3, for positions that need more
+    than float precision such as eye points and world coordinates in
+    large scenes. Converts implicitly to and from Vec3, so it can be
+    handed to the float API once the large offsets have been removed.
+*/
+class Vec3d
+{
+    public:
+
+        Vec3d() { _v[0]=0.0; _v[1]=0.0; _v[2]=0.0;}
+        Vec3d(double x,double y,double z) { _v[0]=x; _v[1]=y; _v[2]=z; }
+        Vec3d(const Vec3& v) { _v[0]=v._v[0]; _v[1]=v._v[1]; _v[2]=v._v[2]; }
+
+        inline operator Vec3() const { return Vec3(_v[0],_v[1],_v[2]); }
+
+        double _v[3];
+
+	inline const bool operator == (const Vec3d& v) const { return _v[0]==v._v[0] && _v[1]==v._v[1] && _v[2]==v._v[2]; }
+        
+        inline const bool operator != (const Vec3d& v) const { return _v[0]!=v._v[0] || _v[1]!=v._v[1] || _v[2]!=v._v[2]; }
+
+	inline const bool operator <  (const Vec3d& v) const
+        {
+            if (_v[0]<v._v[0]) return true;
+            else if (_v[0]>v._v[0]) return false;
+            else if (_v[1]<v._v[1]) return true;
+            else if (_v[1]>v._v[1]) return false;
+            else return (_v[2]<v._v[2]);
+        }
+
+        inline double* ptr() { return _v; }
+        inline const double* ptr() const { return _v; }
+
+        inline void set( double x, double y, double z)
+        {
+            _v[0]=x; _v[1]=y; _v[2]=z;
+        }
+
+        inline double& operator [] (int i) { return _v[i]; }
+        inline const double operator [] (int i) const { return _v[i]; }
+
+        inline double& x() { return _v[0]; }
+        inline double& y() { return _v[1]; }
+        inline double& z() { return _v[2]; }
+
+        inline const double x() const { return _v[0]; }
+        inline const double y() const { return _v[1]; }
+        inline const double z() const { return _v[2]; }
+
+        inline const bool valid() const { return !isNaN(); }
+        inline const bool isNaN() const { return osg::isNaN(_v[0]) || osg::isNaN(_v[1]) || osg::isNaN(_v[2]); }
+
+        /// dot product
+        inline double operator * (const Vec3d& rhs) const
+        {
+            return _v[0]*rhs._v[0]+_v[1]*rhs._v[1]+_v[2]*rhs._v[2];
+        }
+
+        /// cross product
+        inline const Vec3d operator ^ (const Vec3d& rhs) const
+        {
+            return Vec3d(_v[1]*rhs._v[2]-_v[2]*rhs._v[1],
+                _v[2]*rhs._v[0]-_v[0]*rhs._v[2] ,
+                _v[0]*rhs._v[1]-_v[1]*rhs._v[0]);
+        }
+
+        /// multiply by scalar
+        inline const Vec3d operator * (const double& rhs) const
+        {
+            return Vec3d(_v[0]*rhs, _v[1]*rhs, _v[2]*rhs);
+        }
+
+        /// unary multiply by scalar
+        inline Vec3d& operator *= (const double& rhs)
+        {
+            _v[0]*=rhs;
+            _v[1]*=rhs;
+            _v[2]*=rhs;
+            return *this;
+        }
+
+        /// divide by scalar
+        inline const Vec3d operator / (const double& rhs) const
+        {
+            return Vec3d(_v[0]/rhs, _v[1]/rhs, _v[2]/rhs);
+        }
+
+        /// unary divide by scalar
+        inline Vec3d& operator /= (const double& rhs)
+        {
+            _v[0]/=rhs;
+            _v[1]/=rhs;
+            _v[2]/=rhs;
+            return *this;
+        }
+
+        /// binary vector add
+        inline const Vec3d operator + (const Vec3d& rhs) const
+        {
+            return Vec3d(_v[0]+rhs._v[0], _v[1]+rhs._v[1], _v[2]+rhs._v[2]);
+        }
+
+        /** unary vector add.  Slightly more efficient because no temporary
+            intermediate object*/
+        inline Vec3d& operator += (const Vec3d& rhs)
+        {
+            _v[0] += rhs._v[0];
+            _v[1] += rhs._v[1];
+            _v[2] += rhs._v[2];
+            return *this;
+        }
+
+        /// binary vector subtract
+        inline const Vec3d operator - (const Vec3d& rhs) const
+        {
+            return Vec3d(_v[0]-rhs._v[0], _v[1]-rhs._v[1], _v[2]-rhs._v[2]);
+        }
+
+        /// unary vector subtract
+        inline Vec3d& operator -= (const Vec3d& rhs)
+        {
+            _v[0]-=rhs._v[0];
+            _v[1]-=rhs._v[1];
+            _v[2]-=rhs._v[2];
+            return *this;
+        }
+
+        /// negation operator.  Returns the negative of the Vec3d
+        inline const Vec3d operator - () const
+        {
+            return Vec3d (-_v[0], -_v[1], -_v[2]);
+        }
+
+        /// Length of the vector = sqrt( vec . vec )
+        inline const double length() const
+        {
+            return sqrt( _v[0]*_v[0] + _v[1]*_v[1] + _v[2]*_v[2] );
+        }
+
+        /// Length squared of the vector = vec . vec
+        inline const double length2() const
+        {
+            return _v[0]*_v[0] + _v[1]*_v[1] + _v[2]*_v[2];
+        }
+
+        /** normalize the vector so that it has length unity
+            returns the previous length of the vector*/
+        inline const double normalize()
+        {
+            double norm = Vec3d::length();
+            if (norm>0.0)
+            {
+                _v[0] /= norm;
+                _v[1] /= norm;
+                _v[2] /= norm;
+            }                
+            return( norm );
+        }
+
+	friend inline std::ostream& operator << (std::ostream& output, const Vec3d& vec);
+
+};	// end of class Vec3d
+
+inline std::ostream& operator << (std::ostream& output, const Vec3d& vec)
+{
+    output << vec._v[0] << " "
+           << vec._v[1] << " "
+           << vec._v[2];
+    return output; 	// to enable cascading
+}
+
+}	// end of namespace osg
+
+#endif
@@ -0,0 +1,242 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_VEC4D
+#define OSG_VEC4D 1
+
+#include <osg/Vec3d.h>
+#include <osg/Vec4.h>
+
+#include <iostream>
+
+namespace osg {
+
+/** Double precision counterpart of Vec4, used for homogeneous
+    coordinates in large scenes. Converts implicitly to and from Vec4.
+*/
+class Vec4d
+{
+    public:
+
+	// Methods are defined here so that they are implicitly inlined
+
+        Vec4d() { _v[0]=0.0; _v[1]=0.0; _v[2]=0.0; _v[3]=0.0;}
+        
+        Vec4d(double x, double y, double z, double w)
+        {
+            _v[0]=x;
+            _v[1]=y;
+            _v[2]=z;
+            _v[3]=w;
+        }
+
+        Vec4d(const Vec4& v)
+        {
+            _v[0]=v._v[0];
+            _v[1]=v._v[1];
+            _v[2]=v._v[2];
+            _v[3]=v._v[3];
+        }
+
+        Vec4d(const Vec3d& v3,double w)
+        {
+            _v[0]=v3[0];
+            _v[1]=v3[1];
+            _v[2]=v3[2];
+            _v[3]=w;
+        }
+            
+
+        double _v[4];
+
+        inline operator Vec4() const { return Vec4(_v[0],_v[1],_v[2],_v[3]); }
+
+        inline const bool operator == (const Vec4d& v) const { return _v[0]==v._v[0] && _v[1]==v._v[1] && _v[2]==v._v[2] && _v[3]==v._v[3]; }
+
+        inline const bool operator != (const Vec4d& v) const { return _v[0]!=v._v[0] || _v[1]!=v._v[1] || _v[2]!=v._v[2] || _v[3]!=v._v[3]; }
+
+        inline const bool operator <  (const Vec4d& v) const
+        {
+            if (_v[0]<v._v[0]) return true;
+            else if (_v[0]>v._v[0]) return false;
+            else if (_v[1]<v._v[1]) return true;
+            else if (_v[1]>v._v[1]) return false;
+            else if (_v[2]<v._v[2]) return true;
+            else if (_v[2]>v._v[2]) return false;
+            else return (_v[3]<v._v[3]);
+        }
+
+        inline double* ptr() { return _v; }
+        inline const double* ptr() const { return _v; }
+
+        inline void set( double x, double y, double z, double w)
+        {
+            _v[0]=x; _v[1]=y; _v[2]=z; _v[3]=w;
+        }
+
+        inline double& operator [] (const int i) { return _v[i]; }
+        inline double  operator [] (const int i) const { return _v[i]; }
+
+        inline double& x() { return _v[0]; }
+        inline double& y() { return _v[1]; }
+        inline double& z() { return _v[2]; }
+        inline double& w() { return _v[3]; }
+
+        inline double x() const { return _v[0]; }
+        inline double y() const { return _v[1]; }
+        inline double z() const { return _v[2]; }
+        inline double w() const { return _v[3]; }
+
+        inline unsigned long asABGR() const
+        {
+            return (unsigned long)clampTo((_v[0]*255.0),0.0,255.0)<<24 |
+                   (unsigned long)clampTo((_v[1]*255.0),0.0,255.0)<<16 |
+                   (unsigned long)clampTo((_v[2]*255.0),0.0,255.0)<<8  |
+                   (unsigned long)clampTo((_v[3]*255.0),0.0,255.0);
+        }
+
+        inline const unsigned long asRGBA() const
+        {
+            return (unsigned long)clampTo((_v[3]*255.0),0.0,255.0)<<24 |
+                   (unsigned long)clampTo((_v[2]*255.0),0.0,255.0)<<16 |
+                   (unsigned long)clampTo((_v[1]*255.0),0.0,255.0)<<8  |
+                   (unsigned long)clampTo((_v[0]*255.0),0.0,255.0);
+        }
+
+        inline const bool valid() const { return !isNaN(); }
+        inline const bool isNaN() const { return osg::isNaN(_v[0]) || osg::isNaN(_v[1]) || osg::isNaN(_v[2]) || osg::isNaN(_v[3]); }
+
+        /// dot product
+        inline double operator * (const Vec4d& rhs) const
+        {
+            return _v[0]*rhs._v[0]+
+	           _v[1]*rhs._v[1]+
+	           _v[2]*rhs._v[2]+
+	           _v[3]*rhs._v[3] ;
+        }
+
+        /// multiply by scalar
+        inline Vec4d operator * (const double rhs) const
+        {
+            return Vec4d(_v[0]*rhs, _v[1]*rhs, _v[2]*rhs, _v[3]*rhs);
+        }
+
+        /// unary multiply by scalar
+        inline Vec4d& operator *= (const double rhs)
+        {
+            _v[0]*=rhs;
+            _v[1]*=rhs;
+            _v[2]*=rhs;
+            _v[3]*=rhs;
+            return *this;
+        }
+
+        /// divide by scalar
+        inline Vec4d operator / (const double rhs) const
+        {
+            return Vec4d(_v[0]/rhs, _v[1]/rhs, _v[2]/rhs, _v[3]/rhs);
+        }
+
+        /// unary divide by scalar
+        inline Vec4d& operator /= (const double rhs)
+        {
+            _v[0]/=rhs;
+            _v[1]/=rhs;
+            _v[2]/=rhs;
+            _v[3]/=rhs;
+            return *this;
+        }
+
+        /// binary vector add
+        inline Vec4d operator + (const Vec4d& rhs) const
+        {
+            return Vec4d(_v[0]+rhs._v[0], _v[1]+rhs._v[1],
+		        _v[2]+rhs._v[2], _v[3]+rhs._v[3]);
+        }
+
+        /** unary vector add.  Slightly more efficient because no temporary
+            intermediate object*/
+        inline Vec4d& operator += (const Vec4d& rhs)
+        {
+            _v[0] += rhs._v[0];
+            _v[1] += rhs._v[1];
+            _v[2] += rhs._v[2];
+            _v[3] += rhs._v[3];
+            return *this;
+        }
+
+        /// binary vector subtract
+        inline Vec4d operator - (const Vec4d& rhs) const
+        {
+            return Vec4d(_v[0]-rhs._v[0], _v[1]-rhs._v[1],
+		        _v[2]-rhs._v[2], _v[3]-rhs._v[3] );
+        }
+
+        /// unary vector subtract
+        inline Vec4d& operator -= (const Vec4d& rhs)
+        {
+            _v[0]-=rhs._v[0];
+            _v[1]-=rhs._v[1];
+            _v[2]-=rhs._v[2];
+            _v[3]-=rhs._v[3];
+            return *this;
+        }
+
+        /// negation operator.  Returns the negative of the Vec4d
+        inline const Vec4d operator - () const
+        {
+            return Vec4d (-_v[0], -_v[1], -_v[2], -_v[3]);
+        }
+
+        /// Length of the vector = sqrt( vec . vec )
+        inline const double length() const
+        {
+            return sqrt( _v[0]*_v[0] + _v[1]*_v[1] + _v[2]*_v[2] + _v[3]*_v[3]);
+        }
+
+        /// Length squared of the vector = vec . vec
+        inline const double length2() const
+        {
+            return _v[0]*_v[0] + _v[1]*_v[1] + _v[2]*_v[2] + _v[3]*_v[3];
+        }
+
+        /** normalize the vector so that it has length unity
+            returns the previous length of the vector*/
+        inline const double normalize()
+        {
+            double norm = Vec4d::length();
+            _v[0] /= norm;
+            _v[1] /= norm;
+            _v[2] /= norm;
+            _v[3] /= norm;
+            return( norm );
+        }
+
+        friend inline std::ostream& operator << (std::ostream& output, const Vec4d& vec)
+        {
+	    output << vec._v[0] << " "
+                   << vec._v[1] << " "
+                   << vec._v[2] << " "
+                   << vec._v[3];
+	    return output; 	// to enable cascading
+	}
+
+};	// end of class Vec4d
+
+
+/** Compute the dot product of a (Vec3d,1.0) and a Vec4d.*/
+inline double operator * (const Vec3d& lhs,const Vec4d& rhs)
+{
+    return lhs[0]*rhs[0]+lhs[1]*rhs[1]+lhs[2]*rhs[2]+rhs[3];
+}
+
+/** Compute the dot product of a Vec4d and a (Vec3d,1.0).*/
+inline double operator * (const Vec4d& lhs,const Vec3d& rhs)
+{
+    return lhs[0]*rhs[0]+lhs[1]*rhs[1]+lhs[2]*rhs[2]+lhs[3];
+}
+
+}	// end of namespace osg
+
+#endif
@@ -0,0 +1,63 @@
+//C++ header - Open Scene Graph - Copyright (C) 1998-2002 Robert Osfield
+//Distributed under the terms of the GNU Library General Public License (LGPL)
+//as published by the Free Software Foundation.
+
+#ifndef OSG_OBSERVER_PTR
+#define OSG_OBSERVER_PTR 1
+
+#include <osg/ref_ptr.h>
+#include <osg/Observer.h>
+
+namespace osg {
+
+/** Smart pointer which observes a referenced counted object without holding a
+  * reference to it, so that caches can keep track of objects without keeping
+  * them alive. Use lock() to get a ref_ptr to the object while it still exists.*/
+template<class T>
+class observer_ptr
+{
+
+    public:
+        observer_ptr() :_ptr(0L) {}
+        observer_ptr(T* t):_reference(t ? t->getOrCreateObserverSet() : 0),_ptr(t) {}
+        observer_ptr(const ref_ptr<T>& rp):_reference(rp.valid() ? rp->getOrCreateObserverSet() : 0),_ptr(const_cast<T*>(rp.get())) {}
+
+        inline observer_ptr& operator = (T* ptr)
+        {
+            _reference = ptr ? ptr->getOrCreateObserverSet() : 0;
+            _ptr = ptr;
+            return *this;
+        }
+
+        inline observer_ptr& operator = (const ref_ptr<T>& rp)
+        {
+            return operator = (const_cast<T*>(rp.get()));
+        }
+
+        /** return a ref_ptr to the object, or an invalid ref_ptr if the object has been deleted.*/
+        inline ref_ptr<T> lock() const
+        {
+            if (!_reference.valid() || !_reference->addRefLock()) return ref_ptr<T>();
+            return ref_ptr<T>(_ptr,adopt_ref);
+        }
+
+        /** return true if nothing is observed or the object has been deleted.*/
+        inline const bool expired() const { return !_reference.valid() || _reference->getObservedObject()==0L; }
+
+        inline void reset() { _reference = 0; _ptr = 0L; }
+
+        /** compare the observed addresses, which stay valid as keys after the object has gone.*/
+        inline const bool operator == (const observer_ptr& op) const { return (_ptr==op._ptr); }
+
+        inline const bool operator != (const observer_ptr& op) const { return (_ptr!=op._ptr); }
+
+        inline const bool operator < (const observer_ptr& op) const { return (_ptr<op._ptr); }
+
+    private:
+        ref_ptr<ObserverSet>    _reference;
+        T*                      _ptr;
+};
+
+}
+
+#endif
@@ -7,6 +7,11 @@
 
 namespace osg {
 
+/** Tag for constructing a ref_ptr that takes over a reference already counted,
+  * such as one given up by ref_ptr::release(), rather than taking a new one.*/
+struct adopt_ref_t {};
+static const adopt_ref_t adopt_ref = adopt_ref_t();
+
 /** Smart pointer for handling referenced counted objects.*/
 template<class T>
 class ref_ptr
@@ -15,7 +20,10 @@ class ref_ptr
     public:
         ref_ptr() :_ptr(0L) {}
         ref_ptr(T* t):_ptr(t)              { if (_ptr) _ptr->ref(); }
+        ref_ptr(T* t,adopt_ref_t):_ptr(t)  {}
         ref_ptr(const ref_ptr& rp):_ptr(rp._ptr)  { if (_ptr) _ptr->ref(); }
+        /** move the reference out of rp, leaving rp invalid, without touching the reference count.*/
+        ref_ptr(ref_ptr&& rp) noexcept :_ptr(rp._ptr) { rp._ptr = 0L; }
         ~ref_ptr()                           { if (_ptr) _ptr->unref(); }
 
         inline ref_ptr& operator = (const ref_ptr& rp)
@@ -31,6 +39,17 @@ class ref_ptr
             return *this;
         }
 
+        inline ref_ptr& operator = (ref_ptr&& rp) noexcept
+        {
+            if (this==&rp) return *this;
+            T* tmp_ptr = _ptr;
+            _ptr = rp._ptr;
+            rp._ptr = 0L;
+            // unref last, as in the copy assignment above.
+            if (tmp_ptr) tmp_ptr->unref();
+            return *this;
+        }
+
         inline ref_ptr& operator = (T* ptr)
         {
             if (_ptr==ptr) return *this;
@@ -101,10 +120,20 @@ class ref_ptr
           * only use when absolutely required.*/
         inline T* take() { T* tmp=_ptr; if (_ptr) _ptr->unref_nodelete(); _ptr=0; return tmp;}
 
+        /** give up the object pointed to by ref_ptr without unreferencing it, return the pointer
+          * to the object, whose reference the caller now owns, see the adopt_ref constructor.*/
+        inline T* release() { T* tmp=_ptr; _ptr=0; return tmp; }
+
+        /** exchange the objects pointed to, without touching either reference count.*/
+        inline void swap(ref_ptr& rp) { T* tmp=_ptr; _ptr=rp._ptr; rp._ptr=tmp; }
+
     private:
         T* _ptr;
 };
 
+template<class T>
+inline void swap(ref_ptr<T>& lhs,ref_ptr<T>& rhs) { lhs.swap(rhs); }
+
 }
 
 #endif
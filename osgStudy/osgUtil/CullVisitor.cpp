@@ -0,0 +1,376 @@
+#include "CullVisitor.h"
+#include <osg/Group.h>
+#include <osg/Transform.h>
+
+using namespace osgUtil;
+
+CullVisitor::CullVisitor() :
+	osg::NodeVisitor(TRAVERSE_ACTIVE_CHILDREN),
+	_usePlaneHints(false)
+{
+	reset();
+}
+
+CullVisitor::~CullVisitor()
+{
+}
+
+void CullVisitor::reset()
+{
+	_renderList.clear();
+	_statistics = Statistics();
+	setViewMatrices(_projection, _modelViewList.empty() ? osg::Matrix() : _modelViewList.front());
+}
+
+void CullVisitor::setViewMatrices(const osg::Matrix& projection, const osg::Matrix& modelView)
+{
+	_projection = projection;
+
+	// copy first, modelView may be the root of the list being cleared.
+	osg::Matrix root(modelView);
+	_frustumStack.clear();
+	_modelViewStack.clear();
+	_modelViewList.clear();
+	pushModelViewMatrix(root, false);
+}
+
+void CullVisitor::pushModelViewMatrix(const osg::Matrix& modelView, bool keepMask)
+{
+	osg::Polytope::ClippingMask mask = _frustumStack.empty() ? 0 : _frustumStack.back().getCurrentMask();
+
+	_modelViewList.push_back(modelView);
+	_modelViewStack.push_back(&_modelViewList.back());
+
+	// the clip space cube taken back to the local coordinates, plane for plane,
+	// so that the parent's mask still applies.
+	_frustumStack.push_back(osg::Polytope());
+	osg::Polytope& frustum = _frustumStack.back();
+	frustum.setToUnitFrustum();
+	frustum.transformProvidingInverse(modelView*_projection);
+	// pushed rather than set, fast_back_stack only keeps its bottom value once
+	// something is pushed over it, so a child's pop would otherwise leave its
+	// mask behind for the siblings.
+	if (keepMask) frustum.setResultMask(mask);
+	frustum.pushCurrentMask();
+}
+
+void CullVisitor::popModelViewMatrix()
+{
+	_frustumStack.pop_back();
+	_modelViewStack.pop_back();
+}
+
+bool CullVisitor::enterNode(osg::Node& node)
+{
+	++_statistics._numNodesVisited;
+
+	// before isCullingActive(), which needs the bound computed.
+	const osg::BoundingSphere& bs = node.getBound();
+
+	osg::Polytope& frustum = _frustumStack.back();
+	osg::Polytope::ClippingMask mask = frustum.getCurrentMask();
+	if (!node.isCullingActive())
+	{
+		++_statistics._numNodesCullingDisabled;
+		frustum.setResultMask(mask);
+	}
+	else if (!mask)
+	{
+		// an ancestor is inside all the planes.
+		++_statistics._numNodesInside;
+		frustum.setResultMask(0);
+	}
+	else if (_usePlaneHints)
+	{
+		++_statistics._numBoundTests;
+		osg::Polytope::PlaneHint& hint = _planeHints[&node];
+		osg::Polytope::PlaneHint previousHint = hint;
+		if (!frustum.contains(bs, hint))
+		{
+			// any other plane rejecting the node would have replaced the hint.
+			if (previousHint && hint==previousHint) ++_statistics._numPlaneHintHits;
+			++_statistics._numNodesCulled;
+			return false;
+		}
+	}
+	else
+	{
+		++_statistics._numBoundTests;
+		if (!frustum.contains(bs))
+		{
+			++_statistics._numNodesCulled;
+			return false;
+		}
+	}
+
+	frustum.pushCurrentMask();
+	return true;
+}
+
+void CullVisitor::leaveNode()
+{
+	_frustumStack.back().popCurrentMask();
+}
+
+void CullVisitor::handleCallbacksAndTraverse(osg::Node& node)
+{
+	osg::NodeCallback* callback = node.getCullCallback();
+	if (callback) (*callback)(&node, this);
+	else traverse(node);
+}
+
+void CullVisitor::handleCallbacksAndTraverse(osg::Group& node)
+{
+	// with culling disabled below the group its cells can't be culled either.
+	if (!node.getCullCallback() && node.isCullingActive())
+	{
+		CellCuller culler(*this);
+		if (node.acceptBoundingVolumeHierarchy(culler)) return;
+	}
+	handleCallbacksAndTraverse(static_cast<osg::Node&>(node));
+}
+
+bool CullVisitor::CellCuller::enterCell(const osg::BoundingBox& bb)
+{
+	osg::Polytope& frustum = _cv._frustumStack.back();
+	if (frustum.getCurrentMask())
+	{
+		++_cv._statistics._numCellTests;
+		if (!frustum.contains(bb))
+		{
+			++_cv._statistics._numCellsCulled;
+			return false;
+		}
+	}
+	else
+	{
+		frustum.setResultMask(0);
+	}
+
+	frustum.pushCurrentMask();
+	return true;
+}
+
+void CullVisitor::CellCuller::leaveCell()
+{
+	_cv._frustumStack.back().popCurrentMask();
+}
+
+void CullVisitor::apply(osg::Node& node)
+{
+	if (!enterNode(node)) return;
+
+	_renderList.push_back(RenderLeaf(&node, _modelViewStack.back()));
+	handleCallbacksAndTraverse(node);
+
+	leaveNode();
+}
+
+void CullVisitor::apply(osg::Group& node)
+{
+	if (!enterNode(node)) return;
+
+	handleCallbacksAndTraverse(node);
+
+	leaveNode();
+}
+
+void CullVisitor::apply(osg::Transform& node)
+{
+	if (!enterNode(node)) return;
+
+	osg::Matrix modelView(*_modelViewStack.back());
+	node.getLocalToWorldMatrix(modelView, this);
+	// the planes an absolute transform's parents are inside of say nothing of it.
+	pushModelViewMatrix(modelView, node.getReferenceFrame()==osg::Transform::RELATIVE_TO_PARENTS);
+
+	handleCallbacksAndTraverse(node);
+
+	popModelViewMatrix();
+	leaveNode();
+}
+
+#ifdef OSG_USE_UNIT_TESTS
+
+#include <osg/MatrixTransform.h>
+#include <osg/Timer.h>
+#include <iostream>
+#include <stdlib.h>
+#include <float.h>
+
+namespace
+{
+	/** A leaf with a fixed bound, standing in for a Geode.*/
+	class BoundedNode : public osg::Node
+	{
+	public:
+		BoundedNode(const osg::BoundingSphere& bs) : _fixedBound(bs) {}
+
+	protected:
+		virtual const bool computeBound() const
+		{
+			_bsphere = _fixedBound;
+			_bsphere_computed = true;
+			return true;
+		}
+
+		osg::BoundingSphere _fixedBound;
+	};
+
+	/** A group traversing its first child only, as a Switch does.*/
+	class FirstChildGroup : public osg::Group
+	{
+	public:
+		virtual void traverse(osg::NodeVisitor& nv)
+		{
+			if (!_children.empty()) _children.front()->accept(nv);
+		}
+	};
+
+	class Leaf
+	{
+	public:
+		osg::Node* _node;
+		osg::BoundingSphere _worldBound;
+	};
+	typedef std::vector<Leaf> LeafList;
+
+	/** Build a quadtree over the square of the given center and half size on the
+	  * y=0 plane, with leaves of radius 5 at depth 0. With transforms every level
+	  * in transformLevel is a MatrixTransform moving its children to its center.*/
+	osg::Node* createQuadTree(const osg::Vec3& center, float halfSize, unsigned int depth, unsigned int transformLevel, const osg::Vec3& offset, LeafList& leaves)
+	{
+		if (depth==0)
+		{
+			Leaf leaf;
+			leaf._node = osgNew BoundedNode(osg::BoundingSphere(center-offset, 5.0f));
+			leaf._worldBound.set(center, 5.0f);
+			leaves.push_back(leaf);
+			return leaf._node;
+		}
+
+		osg::Group* group;
+		osg::Vec3 childOffset(offset);
+		if (depth==transformLevel)
+		{
+			group = osgNew osg::MatrixTransform(osg::Matrix::translate(center-offset));
+			childOffset = center;
+		}
+		else
+		{
+			group = osgNew osg::Group;
+		}
+
+		float quarter = halfSize*0.5f;
+		for (int i = 0; i<4; ++i)
+		{
+			osg::Vec3 childCenter(center.x()+((i&1) ? quarter : -quarter), 0.0f, center.z()+((i&2) ? quarter : -quarter));
+			group->addChild(createQuadTree(childCenter, quarter, depth-1, transformLevel, childOffset, leaves));
+		}
+		return group;
+	}
+
+	void cullGraph(const char* name, osg::Node* root, const LeafList& leaves, unsigned int numNodes, const osg::Matrix& projection, const osg::Matrix& modelView, unsigned int numRepeats, bool usePlaneHints = false)
+	{
+		osg::ref_ptr<CullVisitor> cv = osgNew CullVisitor;
+		cv->setViewMatrices(projection, modelView);
+		cv->setUsePlaneHints(usePlaneHints);
+
+		// bounds and any hierarchy are computed on the first traversal.
+		root->accept(*cv);
+
+		osg::Timer timer;
+		osg::Timer_t t0 = timer.tick();
+		for (unsigned int i = 0; i<numRepeats; ++i)
+		{
+			cv->reset();
+			root->accept(*cv);
+		}
+		osg::Timer_t t1 = timer.tick();
+
+		// each leaf on its own, in world coordinates.
+		osg::Polytope frustum;
+		frustum.setToUnitFrustum();
+		frustum.transformProvidingInverse(modelView*projection);
+		unsigned int numVisibleLeaves = 0;
+		for (LeafList::const_iterator itr = leaves.begin(); itr!=leaves.end(); ++itr)
+		{
+			if (frustum.contains(itr->_worldBound)) ++numVisibleLeaves;
+		}
+
+		const CullVisitor::Statistics& stats = cv->getStatistics();
+		std::cout<<name<<" "<<numNodes<<" nodes, "<<leaves.size()<<" leaves  "<<timer.delta_m(t0, t1)/numRepeats<<"ms per cull"<<std::endl;
+		std::cout<<"  visited "<<stats._numNodesVisited<<"  bound tests "<<stats._numBoundTests<<"  inside without test "<<stats._numNodesInside
+			<<"  culling disabled "<<stats._numNodesCullingDisabled<<"  culled "<<stats._numNodesCulled
+			<<"  cell tests "<<stats._numCellTests<<"  cells culled "<<stats._numCellsCulled<<"  plane hint hits "<<stats._numPlaneHintHits
+			<<"  render list "<<cv->getRenderList().size()<<(cv->getRenderList().size()==numVisibleLeaves ? "  OK" : "  FAILED")<<std::endl;
+	}
+}
+
+/** Cull synthetic scene graphs of 4^depth leaves laid out on a plane, looking
+  * across it: a quadtree of groups, the same with MatrixTransforms two levels
+  * down, one with culling disabled on a leaf, and a flat group without and
+  * with a bounding volume hierarchy, which must not be walked when the group
+  * selects its children. The quadtree is culled with plane hints as well. Report the nodes visited, tested, accepted and culled, and check the render list holds
+  * the leaves that are in view when tested one at a time.*/
+void benchmark_CullVisitor(unsigned int depth, unsigned int numRepeats)
+{
+	osg::Matrix projection = osg::Matrix::perspective(45.0, 1.3, 1.0, 2000.0);
+	osg::Matrix modelView = osg::Matrix::translate(0.0f, -20.0f, 0.0f);
+	const float halfSize = 2000.0f;
+
+	unsigned int numNodes = 0;
+	for (unsigned int level = 0, n = 1; level<=depth; ++level, n *= 4) numNodes += n;
+
+	LeafList leaves;
+	osg::ref_ptr<osg::Node> quadTree = createQuadTree(osg::Vec3(0.0f, 0.0f, 0.0f), halfSize, depth, 0, osg::Vec3(), leaves);
+	cullGraph("quadtree           ", quadTree.get(), leaves, numNodes, projection, modelView, numRepeats);
+	cullGraph("quadtree hints     ", quadTree.get(), leaves, numNodes, projection, modelView, numRepeats, true);
+
+	LeafList transformedLeaves;
+	osg::ref_ptr<osg::Node> transformedTree = createQuadTree(osg::Vec3(0.0f, 0.0f, 0.0f), halfSize, depth, depth-2, osg::Vec3(), transformedLeaves);
+	cullGraph("quadtree transforms", transformedTree.get(), transformedLeaves, numNodes, projection, modelView, numRepeats);
+
+	// a leaf behind the camera, which must be kept along with all its ancestors.
+	osg::BoundingSphere worldBound = leaves.back()._worldBound;
+	leaves.back()._node->setCullingActive(false);
+	leaves.back()._worldBound.set(osg::Vec3(), FLT_MAX);
+	cullGraph("culling disabled   ", quadTree.get(), leaves, numNodes, projection, modelView, numRepeats);
+	leaves.back()._node->setCullingActive(true);
+	leaves.back()._worldBound = worldBound;
+
+	LeafList flatLeaves;
+	osg::ref_ptr<osg::Group> flat = osgNew osg::Group;
+	for (LeafList::const_iterator itr = leaves.begin(); itr!=leaves.end(); ++itr)
+	{
+		Leaf leaf;
+		leaf._node = osgNew BoundedNode(itr->_worldBound);
+		leaf._worldBound = itr->_worldBound;
+		flat->addChild(leaf._node);
+		flatLeaves.push_back(leaf);
+	}
+	cullGraph("flat group         ", flat.get(), flatLeaves, flatLeaves.size()+1, projection, modelView, numRepeats);
+
+	flat->setBoundingVolumeHierarchy(osgNew osg::BoundingVolumeHierarchy);
+	cullGraph("flat hierarchy     ", flat.get(), flatLeaves, flatLeaves.size()+1, projection, modelView, numRepeats);
+
+	// of the visible leaves only the first child is traversed.
+	LeafList firstChildLeaves;
+	osg::ref_ptr<osg::Group> firstChild = osgNew FirstChildGroup;
+	firstChild->setBoundingVolumeHierarchy(osgNew osg::BoundingVolumeHierarchy);
+	osg::Polytope frustum;
+	frustum.setToUnitFrustum();
+	frustum.transformProvidingInverse(modelView*projection);
+	for (LeafList::const_iterator itr = flatLeaves.begin(); itr!=flatLeaves.end(); ++itr)
+	{
+		if (!frustum.contains(itr->_worldBound)) continue;
+		Leaf leaf;
+		leaf._node = osgNew BoundedNode(itr->_worldBound);
+		leaf._worldBound = itr->_worldBound;
+		firstChild->addChild(leaf._node);
+		if (firstChildLeaves.empty()) firstChildLeaves.push_back(leaf);
+	}
+	cullGraph("first child only   ", firstChild.get(), firstChildLeaves, firstChild->getNumChildren()+1, projection, modelView, numRepeats);
+}
+
+#endif
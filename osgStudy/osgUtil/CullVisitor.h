@@ -0,0 +1,166 @@
+#pragma once
+#include <osg/NodeVisitor.h>
+#include <osg/Polytope.h>
+#include <osg/Matrix.h>
+
+#include "Export.h"
+#include <deque>
+#include <vector>
+
+namespace osgUtil
+{
+	/** Reference view frustum culling traversal. Nodes are tested against the
+	  * frustum with Node::getBound(), the planes a node lies fully inside of are
+	  * switched off for its subgraph through the Polytope mask stack, so once a
+	  * subgraph is wholly in view its nodes are accepted without any plane test.
+	  * Nodes which are not culling active, having culling disabled themselves or
+	  * below them, are never culled. Leaf nodes left are emitted into a flat
+	  * render list with their model view matrix.*/
+	class OSGUTIL_EXPORT CullVisitor : public osg::NodeVisitor
+	{
+	public:
+		CullVisitor();
+		virtual ~CullVisitor();
+
+		/** Clear the render list and the statistics, call before each traversal.*/
+		virtual void reset();
+
+		/** Set the projection and the model view at the top of the scene graph.*/
+		void setViewMatrices(const osg::Matrix& projection, const osg::Matrix& modelView);
+
+		const osg::Matrix& getProjectionMatrix() const
+		{
+			return _projection;
+		}
+
+		/** Test each node's bound against the plane which rejected it last
+		  * first, see Polytope::contains(const BoundingSphere&,PlaneHint&). The
+		  * hints are kept by node across traversals in a side table, which only
+		  * pays off when plane tests cost more than the lookup. Off by default.*/
+		void setUsePlaneHints(bool usePlaneHints)
+		{
+			_usePlaneHints = usePlaneHints;
+		}
+		bool getUsePlaneHints() const
+		{
+			return _usePlaneHints;
+		}
+
+		/** Forget the plane hints, such as when the scene graph is replaced.*/
+		void clearPlaneHints()
+		{
+			_planeHints.clear();
+		}
+
+		class RenderLeaf
+		{
+		public:
+			RenderLeaf(osg::Node* node, const osg::Matrix* modelView) :
+				_node(node),
+				_modelView(modelView) {}
+
+			osg::Node* _node;
+			/** valid until the next reset().*/
+			const osg::Matrix* _modelView;
+		};
+		typedef std::vector<RenderLeaf> RenderList;
+
+		const RenderList& getRenderList() const
+		{
+			return _renderList;
+		}
+
+		/** Node counts of the traversal since the last reset().*/
+		class Statistics
+		{
+		public:
+			Statistics() :
+				_numNodesVisited(0),
+				_numNodesCulled(0),
+				_numBoundTests(0),
+				_numNodesInside(0),
+				_numNodesCullingDisabled(0),
+				_numCellTests(0),
+				_numCellsCulled(0),
+				_numPlaneHintHits(0) {}
+
+			/** nodes reached by the traversal, culled or not.*/
+			unsigned int _numNodesVisited;
+			/** nodes whose bound is outside the frustum, their subgraphs are not visited.*/
+			unsigned int _numNodesCulled;
+			/** nodes whose bound was tested against the frustum planes.*/
+			unsigned int _numBoundTests;
+			/** nodes accepted without a test, an ancestor being fully inside the frustum.*/
+			unsigned int _numNodesInside;
+			/** nodes accepted without a test as they are not culling active.*/
+			unsigned int _numNodesCullingDisabled;
+			/** cells of groups' bounding volume hierarchies tested against the frustum.*/
+			unsigned int _numCellTests;
+			/** cells outside the frustum, the children below them are not visited.*/
+			unsigned int _numCellsCulled;
+			/** nodes culled by the plane of their hint, see setUsePlaneHints().*/
+			unsigned int _numPlaneHintHits;
+		};
+
+		const Statistics& getStatistics() const
+		{
+			return _statistics;
+		}
+
+		virtual void apply(osg::Node& node);
+		virtual void apply(osg::Group& node);
+		virtual void apply(osg::Transform& node);
+
+	protected:
+		/** Test node against the current frustum, pushing the mask of the planes
+		  * its subgraph still needs testing against. Return false if it is culled,
+		  * in which case nothing is pushed.*/
+		bool enterNode(osg::Node& node);
+		void leaveNode();
+
+		void handleCallbacksAndTraverse(osg::Node& node);
+		/** As for a Node, but through the group's bounding volume hierarchy if it
+		  * has one and is culling active.*/
+		void handleCallbacksAndTraverse(osg::Group& node);
+
+		/** Culls the cells of a bounding volume hierarchy, see BoundingVolumeHierarchy::accept().*/
+		class CellCuller
+		{
+		public:
+			CellCuller(CullVisitor& cv) : _cv(cv) {}
+
+			bool enterCell(const osg::BoundingBox& bb);
+			void leaveCell();
+			void applyChild(osg::Node& child)
+			{
+				child.accept(_cv);
+			}
+
+			CullVisitor& _cv;
+		};
+		friend class CellCuller;
+
+		void pushModelViewMatrix(const osg::Matrix& modelView, bool keepMask);
+		void popModelViewMatrix();
+
+		osg::Matrix _projection;
+
+		/** the frustum in the local coordinates of each model view pushed.*/
+		typedef std::vector<osg::Polytope> FrustumStack;
+		FrustumStack _frustumStack;
+
+		/** the model view matrices of the traversal, a deque so that the render
+		  * leaves can point at them.*/
+		typedef std::deque<osg::Matrix> ModelViewList;
+		ModelViewList _modelViewList;
+
+		typedef std::vector<const osg::Matrix*> ModelViewStack;
+		ModelViewStack _modelViewStack;
+
+		RenderList _renderList;
+		Statistics _statistics;
+
+		bool _usePlaneHints;
+		osg::Polytope::PlaneHintMap _planeHints;
+	};
+}
@@ -1,8 +1,10 @@
 #pragma once
 #include <osg/NodeVisitor.h>
+#include <osg/Group.h>
 #include <osg/LineSegment.h>
 #include <osg/Geode.h>
 #include <osg/Matrix.h>
+#include <osg/FrameArena.h>
 
 #include "Export.h"
 #include <map>
@@ -21,8 +23,8 @@ namespace osgUtil
 		osg::NodePath _nodePath;
 		osg::ref_ptr<osg::Geode> _geode;
 		osg::ref_ptr<osg::Drawable> _drawable;
-		osg::ref_ptr<osg::Matrix> _matrix;
-		osg::ref_ptr < osg::Matrix> _inverse;
+		osg::Matrix _matrix;
+		osg::Matrix _inverse;
 		vecIndexList _vecIndexList;
 		int _primitiveIndex;
 		osg::Vec3 _intersectPoint;
@@ -58,11 +60,7 @@ namespace osgUtil
 		}
 		const osg::Vec3 getWorldIntersectPoint() const
 		{
-			if (_matrix.valid())
-			{
-				return _intersectPoint * (*_matrix);
-			}
-			return _intersectPoint;
+			return _intersectPoint * _matrix;
 		}
 		const osg::Vec3 getWorldIntersectNormal() const;
 	};
@@ -111,18 +109,26 @@ namespace osgUtil
 		virtual void apply(osg::LOD& node);
 
 	protected:
+		/** Per level state of a traversal. States made by createIntersectState()
+		  * live in the visitor's arena, along with their lists.*/
 		class IntersectState : public osg::Referenced
 		{
 		public:
-			IntersectState();
-			osg::ref_ptr<osg::Matrix> _matrix;
-			osg::ref_ptr<osg::Matrix> _inverse;
-			typedef std::pair<osg::ref_ptr<osg::LineSegment>, osg::ref_ptr<osg::LineSegment>> LineSegmentPair;
-			typedef std::vector<LineSegmentPair> LineSegmentList;
-			LineSegmentList _segList;
+			META_ArenaAllocated
 
+			typedef std::pair<osg::ref_ptr<osg::LineSegment>, osg::ref_ptr<osg::LineSegment>> LineSegmentPair;
+			typedef std::vector<LineSegmentPair, osg::FrameArena::Allocator<LineSegmentPair>> LineSegmentList;
 			typedef unsigned int LineSegmentmentMask;
-			typedef std::vector<LineSegmentmentMask> LineSegmentmentMaskStack;
+			typedef std::vector<LineSegmentmentMask, osg::FrameArena::Allocator<LineSegmentmentMask>> LineSegmentmentMaskStack;
+
+			IntersectState();
+			IntersectState(osg::FrameArena* arena) :
+				_segList(LineSegmentList::allocator_type(arena)),
+				_segmentMaskStack(LineSegmentmentMaskStack::allocator_type(arena)) {}
+
+			osg::Matrix _matrix;
+			osg::Matrix _inverse;
+			LineSegmentList _segList;
 			LineSegmentmentMaskStack _segmentMaskStack;
 			
 			bool isCulled(const osg::BoundingSphere& bs, LineSegmentmentMask& segMaskOut);
@@ -144,6 +150,59 @@ namespace osgUtil
 		bool enterNode(osg::Node& node);
 		void leaveNode();
 
+		/** Skips the cells of a bounding volume hierarchy no segment hits, see
+		  * BoundingVolumeHierarchy::accept().*/
+		class CellIntersector
+		{
+		public:
+			CellIntersector(IntersectVisitor& iv) : _iv(iv) {}
+
+			bool enterCell(const osg::BoundingBox& bb)
+			{
+				IntersectState* cis = _iv._intersectStateStack.back().get();
+				IntersectState::LineSegmentmentMask sm = 0xffffffff;
+				if (cis->isCulled(bb, sm)) return false;
+				cis->_segmentMaskStack.push_back(sm);
+				return true;
+			}
+			void leaveCell()
+			{
+				_iv._intersectStateStack.back()->_segmentMaskStack.pop_back();
+			}
+			void applyChild(osg::Node& child)
+			{
+				child.accept(_iv);
+			}
+
+			IntersectVisitor& _iv;
+		};
+		friend class CellIntersector;
+
+		/** Traverse group, through its bounding volume hierarchy if it has one, for
+		  * apply(Group&) and apply(Transform&) between enterNode() and leaveNode().*/
+		void traverseGroup(osg::Group& group)
+		{
+			CellIntersector intersector(*this);
+			if (!group.acceptBoundingVolumeHierarchy(intersector)) traverse(group);
+		}
+
+		/** Create the state of a new traversal level, and the transformed segments
+		  * it holds, in _arena. They live until releaseTransientData(), which
+		  * reset() calls before each pick. Hits must keep heap copies of the
+		  * transformed segments, arena ones would keep the arena from rewinding.*/
+		IntersectState* createIntersectState() { return new (_arena) IntersectState(&_arena); }
+		osg::LineSegment* createLineSegment() { return new (_arena) osg::LineSegment; }
+
+		/** Drop the states, then rewind _arena, keeping its blocks for the next pick.*/
+		void releaseTransientData()
+		{
+			_intersectStateStack.clear();
+			_arena.reset();
+		}
+
+		/** Declared before _intersectStateStack so that the states die first.*/
+		osg::FrameArena _arena;
+
 		typedef std::vector<osg::ref_ptr<IntersectState>> IntersectStateStack;
 		IntersectStateStack _intersectStateStack;
 		osg::NodePath _nodePath;